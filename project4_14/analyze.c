@@ -195,8 +195,6 @@ static void insertNode(TreeNode *t){
     case FunctionK:
       if (_checkDuplicatedSymbol(t, LocalNFunc))
       {
-        TreeNode *tmp;
-        int count = 0;
         callFuncName = t->attr.name;
         t->info = getSymbolInfo(t);
         st_insert(t->attr.name, t->lineno, functionMemLoc, t->info);
@@ -204,13 +202,6 @@ static void insertNode(TreeNode *t){
         
         callFromFunc = 1;
         st_scopeIn(callFromFunc);
-
-        tmp = t->child[0];
-        while(tmp!=NULL){
-          count++;
-          tmp = tmp->sibling;
-        }
-        getHashTableTop()->memlow += 4*count;
       }
       break;
     case SimpleK:
@@ -249,9 +240,13 @@ static void insertNode(TreeNode *t){
       if (_checkDuplicatedSymbol(t, LocalNFunc))
       {
         t->info = getSymbolInfo(t);
-        memloc = getHashTableTop()->memlow;
+        /* memlow counts the parameters seen so far */
+        if( getHashTableTop()->memlow < 4*NUM_ARG_REGS )
+          memloc = PARAM_REG_BASE + getHashTableTop()->memlow;
+        else
+          memloc = PARAM_STACK_BASE + getHashTableTop()->memlow;
         st_insert(t->attr.name, t->lineno, memloc, t->info);
-        getHashTableTop()->memlow -= 4;
+        getHashTableTop()->memlow += 4;
         // memloc -= 4;
         // if (callFrom != NULL)
         {
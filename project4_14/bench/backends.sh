@@ -0,0 +1,88 @@
+#!/bin/sh
+#####################################################
+# File: backends.sh                                 #
+# Runs each program in kernels/ on its fixed input  #
+# with every other backend (--run, --jit, the C and #
+# x86-64 targets built natively, and the TM target  #
+# in ltm) and compares the output with the expected #
+# one                                               #
+#####################################################
+#
+# usage: bench/backends.sh [compiler]
+#   CC         compiles the --target=c output (cc)
+#   LTM        the TM simulator (./ltm)
+#   BACKENDS   the backends to run (vm jit c x86-64 tm)
+#
+# A backend that cannot run here, like the JIT or
+# x86-64 on other machines, is reported as skipped.
+# A wrong output or a failed build makes the exit
+# status 1
+
+COMPILER=${1:-./project4_14}
+CC=${CC:-cc}
+LTM=${LTM:-./ltm}
+BACKENDS=${BACKENDS:-vm jit c x86-64 tm}
+KERNELS=$(dirname "$0")/kernels
+
+if [ ! -x "$COMPILER" ]; then
+  echo "$COMPILER not found (run make)" >&2
+  exit 1
+fi
+case $COMPILER in /*) ;; *) COMPILER=$(pwd)/$COMPILER ;; esac
+case $LTM in /*) ;; *) LTM=$(pwd)/$LTM ;; esac
+case $KERNELS in /*) ;; *) KERNELS=$(pwd)/$KERNELS ;; esac
+
+dir=$(mktemp -d) || exit 1
+trap 'rm -rf "$dir"' EXIT INT TERM
+
+# run BACKEND NAME: write the output of kernel NAME to
+# $dir/out; returns 1 if it does not build and 2 if
+# the backend is not available here (the listing of
+# --run and --jit goes to stderr)
+run() {
+  in=$KERNELS/$2.in
+  rm -f "$dir/out"
+  case $1 in
+    vm)
+      (cd "$dir" && "$COMPILER" --no-prompts --run "$2.c" < "$in" > out) ;;
+    jit)
+      [ "$(uname -m)" = x86_64 ] || return 2
+      (cd "$dir" && "$COMPILER" --no-prompts --jit "$2.c" < "$in" > out) ;;
+    c)
+      command -v "$CC" > /dev/null || return 2
+      (cd "$dir" && "$COMPILER" --no-prompts --target=c "$2.c" > /dev/null &&
+        $CC -std=c99 -O2 -o "$2.c.x" "$2.gen.c") || return 1
+      "$dir/$2.c.x" < "$in" > "$dir/out" ;;
+    x86-64)
+      [ "$(uname -m)" = x86_64 ] && command -v as > /dev/null || return 2
+      (cd "$dir" && "$COMPILER" --no-prompts --target=x86-64 "$2.c" > /dev/null &&
+        as -o "$2.o" "$2.s" && ld -o "$2.x86" "$2.o") || return 1
+      "$dir/$2.x86" < "$in" > "$dir/out" ;;
+    tm)
+      [ -x "$LTM" ] || return 2
+      (cd "$dir" && "$COMPILER" --target=tm "$2.c" > /dev/null) || return 1
+      "$LTM" "$dir/$2.tmc" < "$in" > "$dir/out" ;;
+  esac
+  return 0
+}
+
+bad=0
+printf "%-10s" "kernel"
+for b in $BACKENDS; do printf " %8s" "$b"; done
+echo
+for src in "$KERNELS"/*.c; do
+  name=$(basename "$src" .c)
+  cp "$src" "$dir/$name.c"
+  printf "%-10s" "$name"
+  for b in $BACKENDS; do
+    run $b $name 2> /dev/null
+    case $? in
+      1) status=BROKEN; bad=1 ;;
+      2) status=skipped ;;
+      *) if cmp -s "$dir/out" "$KERNELS/$name.out"; then status=ok; else status=WRONG; bad=1; fi ;;
+    esac
+    printf " %8s" $status
+  done
+  echo
+done
+exit $bad
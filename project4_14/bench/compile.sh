@@ -0,0 +1,140 @@
+#!/bin/sh
+#####################################################
+# File: compile.sh                                  #
+# Compile-throughput benchmark: grows generated     #
+# programs (gen.c) along each axis, times every     #
+# phase with --time-passes and fits the growth of   #
+# each phase against the number of tree nodes       #
+#####################################################
+#
+# usage: bench/compile.sh [compiler]
+#   SCALES  multipliers of the base size (1 2 4 8 16)
+#   REPEAT  runs per program; the fastest counts (3)
+#   LIMIT   exponents above this are reported as
+#           superlinear (1.3)
+#
+# A phase whose time grows like nodes^k gets the
+# exponent k, from a least-squares line through
+# (log nodes, log ms); phases that never take 0.5 ms
+# are too noisy to fit and are left out
+
+COMPILER=${1:-./project4_14}
+GEN=${GEN:-bench/gen}
+SCALES=${SCALES:-"1 2 4 8 16"}
+REPEAT=${REPEAT:-3}
+LIMIT=${LIMIT:-1.3}
+
+# base sizes, in the order of the axes below
+BASE="8 40 2 4 8 16"
+AXES="functions statements depth expression identifiers arrays"
+FLAGS="-f -s -d -e -i -a"
+
+for f in "$COMPILER" "$GEN"; do
+  if [ ! -x "$f" ]; then
+    echo "$f not found (run make bench)" >&2
+    exit 1
+  fi
+done
+case $COMPILER in /*) ;; *) COMPILER=$(pwd)/$COMPILER ;; esac
+
+dir=$(mktemp -d) || exit 1
+trap 'rm -rf "$dir"' EXIT INT TERM
+data=$dir/data
+
+# nth WORDS N: the Nth word of WORDS
+nth() { echo "$1" | awk -v n="$2" '{ print $n }'; }
+
+a=1
+for axis in $AXES; do
+  for scale in $SCALES; do
+    args=""
+    i=1
+    for flag in $FLAGS; do
+      v=$(nth "$BASE" $i)
+      [ $i -eq $a ] && v=$((v * scale))
+      args="$args $flag $v"
+      i=$((i + 1))
+    done
+    "$GEN" $args > "$dir/bench.c"
+    lines=$(wc -l < "$dir/bench.c")
+    r=0
+    while [ $r -lt "$REPEAT" ]; do
+      if ! (cd "$dir" && "$COMPILER" --time-passes --stats bench.c \
+              > /dev/null 2> stats); then
+        echo "compiling $GEN$args failed" >&2
+        exit 1
+      fi
+      awk -v axis=$axis -v scale=$scale -v lines=$lines '
+        $1 == "phase" { inTable = 1; next }
+        inTable && $1 == "total" { inTable = 0 }
+        inTable && NF == 7 { ms[$1] = $2; order[n++] = $1 }
+        $1 == "tree" && $2 == "nodes" { nodes = $3 }
+        END { for (i = 0; i < n; i++)
+                print axis, scale, lines, nodes, order[i], ms[order[i]] }
+      ' "$dir/stats" >> "$data"
+      r=$((r + 1))
+    done
+  done
+  a=$((a + 1))
+done
+
+awk -v limit=$LIMIT '
+  # the fastest of the repeated runs
+  { key = $1 SUBSEP $2 SUBSEP $5
+    if (!(key in ms) || $6 < ms[key]) ms[key] = $6
+    lines[$1, $2] = $3; nodes[$1, $2] = $4
+    if (!(($1, $2) in seenRun)) { seenRun[$1, $2] = 1; run[nrun++] = $1 SUBSEP $2 }
+    if (!($1 in seenAxis)) { seenAxis[$1] = 1; axes[naxes++] = $1 }
+    if (!($5 in seenPhase)) { seenPhase[$5] = 1; phases[nphases++] = $5 }
+  }
+  END {
+    printf "%-12s %5s %7s %8s %10s %10s %8s", "axis", "scale", "lines",
+           "nodes", "total ms", "lines/s", "us/node"
+    for (p = 0; p < nphases; p++) printf " %9s", phases[p]
+    printf "\n"
+    for (r = 0; r < nrun; r++) {
+      split(run[r], k, SUBSEP)
+      total = 0
+      for (p = 0; p < nphases; p++) total += ms[k[1], k[2], phases[p]]
+      printf "%-12s %5d %7d %8d %10.3f %10.0f %8.3f", k[1], k[2],
+             lines[k[1], k[2]], nodes[k[1], k[2]], total,
+             (total > 0 ? lines[k[1], k[2]] / total * 1000 : 0),
+             (nodes[k[1], k[2]] > 0 ? total * 1000 / nodes[k[1], k[2]] : 0)
+      for (p = 0; p < nphases; p++) printf " %9.3f", ms[k[1], k[2], phases[p]]
+      printf "\n"
+    }
+
+    printf "\ngrowth exponent of each phase in the number of nodes\n"
+    printf "%-12s", "axis"
+    for (p = 0; p < nphases; p++) printf " %9s", phases[p]
+    printf " %9s\n", "total"
+    for (a = 0; a < naxes; a++) {
+      printf "%-12s", axes[a]
+      for (p = 0; p <= nphases; p++) {
+        n = sx = sy = sxx = sxy = big = 0
+        for (r = 0; r < nrun; r++) {
+          split(run[r], k, SUBSEP)
+          if (k[1] != axes[a]) continue
+          if (p < nphases) t = ms[k[1], k[2], phases[p]]
+          else { t = 0; for (q = 0; q < nphases; q++) t += ms[k[1], k[2], phases[q]] }
+          if (t >= 0.5) big = 1
+          if (t <= 0 || nodes[k[1], k[2]] <= 0) continue
+          x = log(nodes[k[1], k[2]]); y = log(t)
+          n++; sx += x; sy += y; sxx += x * x; sxy += x * y
+        }
+        d = n * sxx - sx * sx
+        # the arrays axis does not change the number of nodes
+        if (!big || n < 3 || d <= 1e-9 * n * sxx) { printf " %9s", "-"; continue }
+        slope = (n * sxy - sx * sy) / d
+        if (slope > limit) {
+          printf " %8.2f*", slope
+          flagged = flagged sprintf("  %s: %s grows like nodes^%.2f\n",
+                                    axes[a], p < nphases ? phases[p] : "total", slope)
+        }
+        else printf " %9.2f", slope
+      }
+      printf "\n"
+    }
+    if (flagged != "") printf "\nsuperlinear (exponent above %s):\n%s", limit, flagged
+  }
+' "$data"
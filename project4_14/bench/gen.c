@@ -0,0 +1,247 @@
+/****************************************************/
+/* File: gen.c                                      */
+/* Generator of synthetic C- programs for the       */
+/* compile-throughput benchmark (compile.sh)        */
+/****************************************************/
+
+/* The program grows along six axes:
+ *   -f  number of functions
+ *   -s  statements per function
+ *   -d  nesting depth of the nested blocks
+ *   -e  depth of each expression
+ *   -i  local variables per function
+ *   -a  size of the global and local arrays
+ * Every function calls only the first one and every
+ * loop runs three times, so the programs also run
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int functions = 10;
+static int statements = 20;
+static int depth = 2;
+static int exprDepth = 4;
+static int idents = 8;
+static int arraySize = 16;
+
+static int seed = 1;
+
+/* a small LCG, so the programs do not depend on the
+ * C library's rand
+ */
+static int pick(int n)
+{
+  seed = seed * 1103515245 + 12345;
+  return ((unsigned)seed >> 16) % n;
+}
+
+/* C- identifiers are letters only: n is written in
+ * base 26 with the digits a..z after the prefix
+ */
+static char * name(char prefix, int n)
+{
+  static char buf[4][16];
+  static int next = 0;
+  char * s = buf[next++ % 4];
+  char digits[16];
+  int k = 0, i = 1;
+  do
+  { digits[k++] = 'a' + n % 26;
+    n /= 26;
+  } while (n > 0);
+  s[0] = prefix;
+  while (k > 0)
+    s[i++] = digits[--k];
+  s[i] = '\0';
+  return s;
+}
+
+static void indent(int level)
+{
+  int i;
+  for (i = 0; i < level; i++)
+    fputs("  ", stdout);
+}
+
+/* Procedure leaf writes a variable, a constant or an
+ * array element; level is the number of nested
+ * blocks whose variables are visible
+ */
+static void leaf(int level)
+{
+  switch (pick(level > 0 ? 5 : 4))
+  { case 0:
+      printf("%d", pick(100));
+      break;
+    case 1:
+      printf("garr[%d]", pick(arraySize));
+      break;
+    case 2:
+      printf("larr[%d]", pick(arraySize));
+      break;
+    case 3:
+      printf("%s", name('v', pick(idents)));
+      break;
+    default:
+      printf("%s", name('w', pick(level)));
+      break;
+  }
+}
+
+/* Procedure expr writes an expression d operators
+ * deep; the operators nest to the right, so its size
+ * is linear in d
+ */
+static void expr(int d, int level)
+{
+  static char * ops[] = { "+", "-", "*", "+" };
+  if (d == 0)
+  { leaf(level);
+    return;
+  }
+  leaf(level);
+  printf(" %s (", ops[pick(4)]);
+  expr(d - 1, level);
+  printf(")");
+}
+
+static void assign(int level, int indentBy)
+{
+  indent(indentBy);
+  if (pick(2))
+    printf("%s = ", name('v', pick(idents)));
+  else
+    printf("larr[%d] = ", pick(arraySize));
+  expr(exprDepth, level);
+  printf(";\n");
+}
+
+/* Procedure nest writes depth blocks inside each
+ * other, each declaring a variable, so the innermost
+ * statement looks names up through every scope
+ */
+static void nest(int level, int indentBy)
+{
+  if (level == depth)
+  { assign(level, indentBy);
+    return;
+  }
+  indent(indentBy);
+  printf("if (%s < %d) {\n", name('v', pick(idents)), pick(100));
+  indent(indentBy + 1);
+  printf("int %s;\n", name('w', level));
+  indent(indentBy + 1);
+  printf("%s = ", name('w', level));
+  expr(exprDepth, level);
+  printf(";\n");
+  nest(level + 1, indentBy + 1);
+  indent(indentBy);
+  printf("}\n");
+}
+
+static void statement(int f, int k)
+{
+  switch (k % 5)
+  { case 0:
+    case 1:
+      assign(0, 1);
+      break;
+    case 2:
+      indent(1);
+      printf("garr[%d] = ", pick(arraySize));
+      expr(exprDepth, 0);
+      printf(";\n");
+      break;
+    case 3:
+      if (f == 0)
+      { indent(1);
+        printf("output(");
+        expr(exprDepth, 0);
+        printf(");\n");
+      }
+      else
+      { indent(1);
+        printf("%s = %s(", name('v', pick(idents)), name('f', 0));
+        expr(exprDepth, 0);
+        printf(");\n");
+      }
+      break;
+    default:
+      if (k % 10 == 4)
+        nest(0, 1);
+      else
+      { indent(1);
+        printf("n = 0;\n");
+        indent(1);
+        printf("while (n < 3) {\n");
+        assign(0, 2);
+        indent(2);
+        printf("n = n + 1;\n");
+        indent(1);
+        printf("}\n");
+      }
+      break;
+  }
+}
+
+static void function(int f)
+{
+  int i;
+  printf("\nint %s(int x)\n{\n", name('f', f));
+  for (i = 0; i < idents; i++)
+    printf("  int %s;\n", name('v', i));
+  printf("  int n;\n  int larr[%d];\n", arraySize);
+  for (i = 0; i < idents; i++)
+    printf("  %s = x + %d;\n", name('v', i), i);
+  printf("  n = 0;\n");
+  printf("  while (n < %d) {\n    larr[n] = n;\n    n = n + 1;\n  }\n",
+         arraySize);
+  for (i = 0; i < statements; i++)
+    statement(f, i);
+  printf("  return %s;\n}\n", name('v', 0));
+}
+
+static void usage(char * prog)
+{
+  fprintf(stderr, "usage: %s [-f functions] [-s statements] [-d depth]"
+          " [-e expression depth] [-i identifiers] [-a array size]"
+          " [-r seed]\n", prog);
+  exit(1);
+}
+
+int main(int argc, char * argv[])
+{
+  int i;
+  for (i = 1; i < argc; i++)
+  { int * opt;
+    if (argv[i][0] != '-' || strlen(argv[i]) != 2 || i + 1 == argc)
+      usage(argv[0]);
+    switch (argv[i][1])
+    { case 'f': opt = &functions; break;
+      case 's': opt = &statements; break;
+      case 'd': opt = &depth; break;
+      case 'e': opt = &exprDepth; break;
+      case 'i': opt = &idents; break;
+      case 'a': opt = &arraySize; break;
+      case 'r': opt = &seed; break;
+      default: usage(argv[0]);
+    }
+    *opt = atoi(argv[++i]);
+  }
+  if (functions < 1 || statements < 0 || depth < 0 || exprDepth < 0 ||
+      idents < 1 || arraySize < 1)
+    usage(argv[0]);
+
+  printf("/* generated by bench/gen -f %d -s %d -d %d -e %d -i %d -a %d */\n",
+         functions, statements, depth, exprDepth, idents, arraySize);
+  printf("int garr[%d];\n", arraySize);
+  for (i = 0; i < functions; i++)
+    function(i);
+  printf("\nvoid main(void)\n{\n  int x;\n  input(x);\n");
+  for (i = 0; i < functions; i++)
+    printf("  output(%s(x + %d));\n", name('f', i), i);
+  printf("}\n");
+  return 0;
+}
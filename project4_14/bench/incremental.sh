@@ -0,0 +1,68 @@
+#!/bin/sh
+#####################################################
+# File: incremental.sh                              #
+# Edit-compile benchmark of --incremental: a full   #
+# compile of a generated program against the       #
+# incremental compiles before and after an edit of  #
+# one function, whose code must be the same         #
+#####################################################
+#
+# usage: bench/incremental.sh [compiler]
+#   FUNCS   functions of the program (300)
+#   STMTS   statements of each function (60)
+
+COMPILER=${1:-./project4_14}
+GEN=${GEN:-bench/gen}
+FUNCS=${FUNCS:-300}
+STMTS=${STMTS:-60}
+
+for f in "$COMPILER" "$GEN"; do
+  if [ ! -x "$f" ]; then
+    echo "$f not found (run make bench-incremental)" >&2
+    exit 1
+  fi
+done
+case $COMPILER in /*) ;; *) COMPILER=$(pwd)/$COMPILER ;; esac
+
+dir=$(mktemp -d) || exit 1
+trap 'rm -rf "$dir"' EXIT INT TERM
+mkdir "$dir/full"
+"$GEN" -f $FUNCS -s $STMTS > "$dir/bench.c"
+
+# run NAME DIR [OPTIONS]: compile bench.c in DIR and
+# print the wall time and the functions reused
+run() {
+  name=$1 d=$2
+  shift 2
+  if ! (cd "$d" && "$COMPILER" --time-passes "$@" bench.c > listing 2> stats); then
+    echo "compiling ($name) failed" >&2
+    exit 1
+  fi
+  awk -v name="$name" '
+    / functions is unchanged$/ { reused = $4 " of " $6 }
+    $1 == "total" { ms = $2 }
+    END { printf "%-24s %10.1f %12s\n", name, ms, reused == "" ? "-" : reused }
+  ' "$d/listing" "$d/stats"
+}
+
+echo "$(wc -l < "$dir/bench.c") lines, $FUNCS functions"
+printf "%-24s %10s %12s\n" "compile" "wall ms" "reused"
+cp "$dir/bench.c" "$dir/full"
+run "full" "$dir/full"
+run "incremental, first" "$dir" --incremental
+run "incremental, unchanged" "$dir" --incremental
+
+# a statement more in the second function
+awk '/^int / { f++ } { print } f == 2 && !done && /^  [a-z]+ = / { print "  x = x + 1;"; done = 1 }' \
+  "$dir/bench.c" > "$dir/edited.c"
+mv "$dir/edited.c" "$dir/bench.c"
+cp "$dir/bench.c" "$dir/full"
+run "full, edited" "$dir/full"
+run "incremental, edited" "$dir" --incremental
+
+if cmp -s "$dir/bench.tm" "$dir/full/bench.tm"; then
+  echo "the incremental code is the same as the full compile's"
+else
+  echo "the incremental code differs from the full compile's" >&2
+  exit 1
+fi
@@ -0,0 +1,113 @@
+#!/bin/sh
+#####################################################
+# File: kernels.sh                                  #
+# Execution benchmark: compiles each program in     #
+# kernels/, runs it in tm on its fixed input and    #
+# compares the output and the number of executed    #
+# instructions with the stored baseline             #
+#####################################################
+#
+# usage: bench/kernels.sh [-u] [compiler]
+#   -u         write this run as the new baseline
+#   TM         the simulator (./tm)
+#   COPTS      extra compiler options, e.g. --format=bin
+#   PGO        if 1, each kernel is first compiled with
+#              --pg and run, and then compiled with
+#              --pgo on the profile of that run
+#   TOLERANCE  percent of extra instructions allowed
+#              before a kernel counts as slower (0)
+#
+# For kernels/NAME.c the input is NAME.in and the
+# expected output NAME.out; kernels/baseline holds,
+# per kernel, the instructions, loads and stores
+# executed and the cksum of the output. A wrong
+# output or a slower kernel makes the exit status 1
+
+UPDATE=0
+if [ "$1" = "-u" ]; then
+  UPDATE=1
+  shift
+fi
+COMPILER=${1:-./project4_14}
+TM=${TM:-./tm}
+TOLERANCE=${TOLERANCE:-0}
+KERNELS=$(dirname "$0")/kernels
+BASELINE=$KERNELS/baseline
+
+for f in "$COMPILER" "$TM"; do
+  if [ ! -x "$f" ]; then
+    echo "$f not found (run make)" >&2
+    exit 1
+  fi
+done
+case $COMPILER in /*) ;; *) COMPILER=$(pwd)/$COMPILER ;; esac
+case $TM in /*) ;; *) TM=$(pwd)/$TM ;; esac
+case $KERNELS in /*) ;; *) KERNELS=$(pwd)/$KERNELS; BASELINE=$KERNELS/baseline ;; esac
+
+dir=$(mktemp -d) || exit 1
+trap 'rm -rf "$dir"' EXIT INT TERM
+
+# name instructions loads stores checksum status
+for src in "$KERNELS"/*.c; do
+  name=$(basename "$src" .c)
+  cp "$src" "$dir/$name.c"
+  popts=""
+  if [ "${PGO:-0}" = 1 ]; then
+    if (cd "$dir" && "$COMPILER" --no-prompts --pg "$name.c" > /dev/null); then
+      "$TM" "$dir/$name.tm" < "$KERNELS/$name.in" > "$dir/$name.prof"
+      popts="--pgo=$name.prof"
+    fi
+  fi
+  if ! (cd "$dir" && "$COMPILER" --no-prompts $popts $COPTS "$name.c" > /dev/null); then
+    echo "$name 0 0 0 0 BROKEN"
+    continue
+  fi
+  image=$(ls "$dir/$name".tm "$dir/$name".bin 2> /dev/null | head -1)
+  "$TM" -s "$image" < "$KERNELS/$name.in" > "$dir/out" 2> "$dir/stats"
+  sum=$(cksum < "$dir/out" | awk '{ print $1 }')
+  if cmp -s "$dir/out" "$KERNELS/$name.out"; then status=ok; else status=WRONG; fi
+  awk -v name=$name -v sum=$sum -v status=$status '
+    $1 == "Instructions" { insts = $3 }
+    $1 == "Loads:" { loads = $2; stores = $4 }
+    END { print name, insts + 0, loads + 0, stores + 0, sum, status }
+  ' "$dir/stats"
+done > "$dir/run"
+
+if [ $UPDATE -eq 1 ]; then
+  if grep -qv ' ok$' "$dir/run"; then
+    echo "not updating the baseline: some kernels fail" >&2
+    grep -v ' ok$' "$dir/run" >&2
+    exit 1
+  fi
+  { echo "# kernel instructions loads stores checksum"
+    awk '{ print $1, $2, $3, $4, $5 }' "$dir/run"
+  } > "$BASELINE"
+  echo "wrote $BASELINE"
+  exit 0
+fi
+
+awk -v tolerance=$TOLERANCE -v baseline="$BASELINE" '
+  BEGIN {
+    while ((getline line < baseline) > 0)
+      if (split(line, f) >= 2 && f[1] !~ /^#/) base[f[1]] = f[2]
+    printf "%-10s %12s %12s %8s %10s %10s %11s  %s\n", "kernel", "instructions",
+           "baseline", "change", "loads", "stores", "checksum", "status"
+  }
+  { status = $6
+    if (!($1 in base)) { change = "new"; if (status == "ok") status = "new" }
+    else {
+      change = base[$1] ? sprintf("%+.2f%%", 100 * ($2 - base[$1]) / base[$1]) : "-"
+      if (status == "ok" && $2 > base[$1] * (1 + tolerance / 100)) status = "SLOWER"
+      else if (status == "ok" && $2 < base[$1]) status = "faster"
+    }
+    printf "%-10s %12d %12s %8s %10d %10d %11s  %s\n", $1, $2,
+           ($1 in base) ? base[$1] : "-", change, $3, $4, $5, status
+    total += $2; if ($1 in base) baseTotal += base[$1]
+    if (status != "ok" && status != "faster" && status != "new") bad++
+  }
+  END {
+    printf "%-10s %12d %12d %8s\n", "total", total, baseTotal,
+           baseTotal ? sprintf("%+.2f%%", 100 * (total - baseTotal) / baseTotal) : "-"
+    exit (bad > 0)
+  }
+' "$dir/run"
@@ -0,0 +1,50 @@
+/* assignments used as values: chained, as operands,
+   subscripts and arguments, and in if and while tests */
+int a[100];
+
+int mix(int x, int y)
+{
+  return x * 3 + y;
+}
+
+void main(void)
+{
+  int n;
+  int i;
+  int j;
+  int s;
+  int t;
+  int k;
+  input(n);
+  s = t = 0;
+  i = 0;
+  while ((j = i + 1) <= n) {
+    a[i] = (t = t + j) * 2;
+    if (s = a[i] - s / 2)
+      s = s + 1;
+    i = j;
+  }
+  output(t);
+  output(s);
+  k = 0;
+  while (k < 200) {
+    i = 1;
+    while ((i < n) * ((t = a[i - 1] / 4) < (s = a[i] - i)))
+      a[j = i] = a[i] / 2 + (i = i + 1) - t;
+    k = k + 1;
+  }
+  s = 0;
+  i = 0;
+  while (i < n)
+    s = s + (a[i] = a[i] / 3) * (i = i + 1);
+  output(s);
+  output(j);
+  s = 0;
+  i = 0;
+  while (i < n) {
+    s = s + mix(a[i] = i, j = a[i] + 1);
+    i = i + 1;
+  }
+  output(s);
+  output(mix(k = mix(1, 2), k) + mix(t = 7, t));
+}
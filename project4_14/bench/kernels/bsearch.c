@@ -0,0 +1,52 @@
+/* binary search for every value in a sorted table */
+int table[1000];
+
+int find(int v[], int n, int key)
+{
+  int lo;
+  int hi;
+  int mid;
+  lo = 0;
+  hi = n - 1;
+  while (lo <= hi) {
+    mid = (lo + hi) / 2;
+    if (v[mid] == key)
+      return mid;
+    if (v[mid] < key)
+      lo = mid + 1;
+    else
+      hi = mid - 1;
+  }
+  return 0 - 1;
+}
+
+void main(void)
+{
+  int n;
+  int i;
+  int found;
+  int missing;
+  int s;
+  input(n);
+  i = 0;
+  while (i < n) {
+    table[i] = 3 * i + 1;
+    i = i + 1;
+  }
+  found = 0;
+  missing = 0;
+  s = 0;
+  i = 0;
+  while (i < 3 * n) {
+    if (find(table, n, i) < 0)
+      missing = missing + 1;
+    else {
+      found = found + 1;
+      s = s + find(table, n, i);
+    }
+    i = i + 1;
+  }
+  output(found);
+  output(missing);
+  output(s);
+}
@@ -0,0 +1,49 @@
+/* bubble sort of n pseudo-random values */
+int a[1000];
+
+int next(int x)
+{
+  x = x * 75 + 74;
+  return x - x / 65537 * 65537;
+}
+
+void main(void)
+{
+  int n;
+  int i;
+  int j;
+  int t;
+  int x;
+  int check;
+  input(n);
+  input(x);
+  i = 0;
+  while (i < n) {
+    x = next(x);
+    a[i] = x;
+    i = i + 1;
+  }
+  i = 0;
+  while (i < n - 1) {
+    j = 0;
+    while (j < n - 1 - i) {
+      if (a[j] > a[j + 1]) {
+        t = a[j];
+        a[j] = a[j + 1];
+        a[j + 1] = t;
+      }
+      j = j + 1;
+    }
+    i = i + 1;
+  }
+  check = 0;
+  i = 0;
+  while (i < n) {
+    check = check * 31 + a[i];
+    i = i + 1;
+  }
+  output(a[0]);
+  output(a[n / 2]);
+  output(a[n - 1]);
+  output(check);
+}
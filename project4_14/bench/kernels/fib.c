@@ -0,0 +1,32 @@
+/* recursive Fibonacci numbers and greatest common
+   divisors */
+int fib(int n)
+{
+  if (n < 2)
+    return n;
+  return fib(n - 1) + fib(n - 2);
+}
+
+int gcd(int u, int v)
+{
+  if (v == 0)
+    return u;
+  return gcd(v, u - u / v * v);
+}
+
+void main(void)
+{
+  int n;
+  int i;
+  int s;
+  input(n);
+  output(fib(n));
+  s = 0;
+  i = 1;
+  while (i <= 200) {
+    s = s + gcd(i * 391, 7429);
+    i = i + 1;
+  }
+  output(s);
+  output(gcd(fib(n), fib(n - 3)));
+}
@@ -0,0 +1,60 @@
+/* insertion sort of n pseudo-random values */
+int a[1000];
+
+int next(int x)
+{
+  x = x * 75 + 74;
+  return x - x / 65537 * 65537;
+}
+
+void sort(int v[], int n)
+{
+  int i;
+  int j;
+  int key;
+  int more;
+  i = 1;
+  while (i < n) {
+    key = v[i];
+    j = i;
+    more = 1;
+    while (more == 1) {
+      if (j == 0)
+        more = 0;
+      else if (v[j - 1] > key) {
+        v[j] = v[j - 1];
+        j = j - 1;
+      } else
+        more = 0;
+    }
+    v[j] = key;
+    i = i + 1;
+  }
+}
+
+void main(void)
+{
+  int n;
+  int i;
+  int x;
+  int check;
+  input(n);
+  input(x);
+  i = 0;
+  while (i < n) {
+    x = next(x);
+    a[i] = x;
+    i = i + 1;
+  }
+  sort(a, n);
+  check = 0;
+  i = 0;
+  while (i < n) {
+    check = check * 31 + a[i];
+    i = i + 1;
+  }
+  output(a[0]);
+  output(a[n / 2]);
+  output(a[n - 1]);
+  output(check);
+}
@@ -0,0 +1,60 @@
+/* n x n matrix product on arrays flattened row by
+   row */
+int a[400];
+int b[400];
+int c[400];
+
+void multiply(int x[], int y[], int z[], int n)
+{
+  int i;
+  int j;
+  int k;
+  int s;
+  i = 0;
+  while (i < n) {
+    j = 0;
+    while (j < n) {
+      s = 0;
+      k = 0;
+      while (k < n) {
+        s = s + x[i * n + k] * y[k * n + j];
+        k = k + 1;
+      }
+      z[i * n + j] = s;
+      j = j + 1;
+    }
+    i = i + 1;
+  }
+}
+
+void main(void)
+{
+  int n;
+  int i;
+  int trace;
+  int check;
+  input(n);
+  i = 0;
+  while (i < n * n) {
+    a[i] = i / n + 1;
+    b[i] = i - i / n * n - 2;
+    i = i + 1;
+  }
+  multiply(a, b, c, n);
+  trace = 0;
+  i = 0;
+  while (i < n) {
+    trace = trace + c[i * n + i];
+    i = i + 1;
+  }
+  check = 0;
+  i = 0;
+  while (i < n * n) {
+    check = check * 7 + c[i];
+    i = i + 1;
+  }
+  output(c[0]);
+  output(c[n * n - 1]);
+  output(trace);
+  output(check);
+}
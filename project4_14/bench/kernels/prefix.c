@@ -0,0 +1,43 @@
+/* prefix sums, then the largest sum of any run of
+   m consecutive values */
+int v[5000];
+int sum[5001];
+
+void main(void)
+{
+  int n;
+  int m;
+  int i;
+  int x;
+  int best;
+  int at;
+  input(n);
+  input(m);
+  x = 5;
+  i = 0;
+  while (i < n) {
+    x = x * 75 + 74;
+    x = x - x / 65537 * 65537;
+    v[i] = x / 1000 - 32;
+    i = i + 1;
+  }
+  sum[0] = 0;
+  i = 0;
+  while (i < n) {
+    sum[i + 1] = sum[i] + v[i];
+    i = i + 1;
+  }
+  best = sum[m];
+  at = 0;
+  i = 1;
+  while (i + m <= n) {
+    if (sum[i + m] - sum[i] > best) {
+      best = sum[i + m] - sum[i];
+      at = i;
+    }
+    i = i + 1;
+  }
+  output(sum[n]);
+  output(best);
+  output(at);
+}
@@ -0,0 +1,66 @@
+/* recursive quicksort of n pseudo-random values */
+int a[2000];
+
+int next(int x)
+{
+  x = x * 75 + 74;
+  return x - x / 65537 * 65537;
+}
+
+void swap(int i, int j)
+{
+  int t;
+  t = a[i];
+  a[i] = a[j];
+  a[j] = t;
+}
+
+void quick(int lo, int hi)
+{
+  int pivot;
+  int i;
+  int j;
+  if (lo < hi) {
+    pivot = a[(lo + hi) / 2];
+    swap((lo + hi) / 2, hi);
+    i = lo;
+    j = lo;
+    while (j < hi) {
+      if (a[j] < pivot) {
+        swap(i, j);
+        i = i + 1;
+      }
+      j = j + 1;
+    }
+    swap(i, hi);
+    quick(lo, i - 1);
+    quick(i + 1, hi);
+  }
+}
+
+void main(void)
+{
+  int n;
+  int i;
+  int x;
+  int check;
+  input(n);
+  input(x);
+  i = 0;
+  while (i < n) {
+    x = next(x);
+    a[i] = x;
+    i = i + 1;
+  }
+  quick(0, n - 1);
+  check = 0;
+  i = 0;
+  while (i < n) {
+    check = check * 31 + a[i];
+    i = i + 1;
+  }
+  output(a[0]);
+  output(a[n / 2]);
+  output(a[n - 1]);
+  output(check);
+}
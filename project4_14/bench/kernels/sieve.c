@@ -0,0 +1,39 @@
+/* sieve of Eratosthenes: the number of primes up to
+   n, their sum and the largest one */
+int composite[10001];
+
+void main(void)
+{
+  int n;
+  int i;
+  int j;
+  int count;
+  int sum;
+  int last;
+  input(n);
+  i = 2;
+  while (i <= n) {
+    composite[i] = 0;
+    i = i + 1;
+  }
+  count = 0;
+  sum = 0;
+  last = 0;
+  i = 2;
+  while (i <= n) {
+    if (composite[i] == 0) {
+      count = count + 1;
+      sum = sum + i;
+      last = i;
+      j = i * i;
+      while (j <= n) {
+        composite[j] = 1;
+        j = j + i;
+      }
+    }
+    i = i + 1;
+  }
+  output(count);
+  output(sum);
+  output(last);
+}
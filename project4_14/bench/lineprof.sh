@@ -0,0 +1,77 @@
+#!/bin/sh
+#####################################################
+# File: lineprof.sh                                 #
+# Per-line and per-function hot spots of a C-       #
+# program: joins the compiler's --line-map table    #
+# with the execution counts of tm -c                #
+#####################################################
+#
+# usage: bench/lineprof.sh prog.c prog.map counts
+#   TOP  hottest lines listed at the end (10)
+#
+#   ./project4_14 --line-map prog.c
+#   ./tm -c counts prog.tm
+#   sh bench/lineprof.sh prog.c prog.map counts
+#
+# Every executed line is listed in source order with
+# the instructions it executed, its share of the
+# total and the instructions generated for it; the
+# runtime (input and output) is line 0
+
+if [ $# -ne 3 ]; then
+  echo "usage: $0 prog.c prog.map counts" >&2
+  exit 1
+fi
+for f in "$1" "$2" "$3"; do
+  if [ ! -r "$f" ]; then
+    echo "$0: cannot read $f" >&2
+    exit 1
+  fi
+done
+
+awk -v top=${TOP:-10} '
+  function source(l,  s) {
+    s = l == 0 ? "(runtime)" : text[l]
+    sub(/^[ \t]+/, "", s)
+    return s
+  }
+  FILENAME == ARGV[1] { text[FNR] = $0; next }
+  FILENAME == ARGV[2] { line[$1] = $2; inFunc[$1] = $3
+                        insts[$2]++; funcOf[$2] = $3; next }
+  { if (!($1 in line)) { unmapped += $2; total += $2; next }
+    runs[line[$1]] += $2; funcRuns[inFunc[$1]] += $2; total += $2
+    if (line[$1] > last) last = line[$1] }
+  END {
+    printf "%6s %12s %7s %6s  %s\n", "line", "executed", "%", "insts", "source"
+    for (l = 0; l <= last; l++) {
+      if (!(l in runs)) continue
+      printf "%6d %12d %6.2f%% %6d  %s\n", l, runs[l],
+             total ? 100 * runs[l] / total : 0, insts[l], source(l)
+      hot[n++] = l
+    }
+    if (unmapped) printf "%6s %12d  (not in the map)\n", "?", unmapped
+    printf "%6s %12d\n", "total", total
+
+    # the hottest lines, by insertion into a sorted list
+    for (i = 1; i < n; i++)
+      for (j = i; j > 0 && runs[hot[j]] > runs[hot[j - 1]]; j--) {
+        t = hot[j]; hot[j] = hot[j - 1]; hot[j - 1] = t
+      }
+    printf "\nhottest lines\n"
+    for (i = 0; i < n && i < top; i++)
+      printf "%6d %12d %6.2f%%  %-12s %s\n", hot[i], runs[hot[i]],
+             total ? 100 * runs[hot[i]] / total : 0, funcOf[hot[i]],
+             source(hot[i])
+
+    printf "\n%-16s %12s %7s\n", "function", "executed", "%"
+    m = 0
+    for (f in funcRuns) fn[m++] = f
+    for (i = 1; i < m; i++)
+      for (j = i; j > 0 && funcRuns[fn[j]] > funcRuns[fn[j - 1]]; j--) {
+        t = fn[j]; fn[j] = fn[j - 1]; fn[j - 1] = t
+      }
+    for (i = 0; i < m; i++)
+      printf "%-16s %12d %6.2f%%\n", fn[i], funcRuns[fn[i]],
+             total ? 100 * funcRuns[fn[i]] / total : 0
+  }
+' "$1" "$2" "$3"
@@ -0,0 +1,90 @@
+#!/bin/sh
+#####################################################
+# File: pgreport.sh                                 #
+# Call counts, the call graph and the branches of  #
+# a program compiled with --pg or --pg-cycles, from #
+# the table it prints when main returns             #
+#####################################################
+#
+# usage: bench/pgreport.sh [output]
+#
+#   ./project4_14 --pg-cycles prog.c
+#   ./tm prog.tm < input > output
+#   sh bench/pgreport.sh output
+#
+# The table follows a "#pg" line in the output, one
+# record per line: "f name calls cycles" for each
+# function, "a caller callee site calls 0" for each
+# call site and "b function site tests taken" for
+# each if or while; the same file is the profile
+# --pgo reads. Cycles include the callees and, under
+# recursion, only the outermost call is timed, so
+# the % column is the share of main's time spent in
+# each function; in tm a cycle is one instruction
+
+awk '
+  function unsigned(v) { return v < 0 ? v + 4294967296 : v }
+  BEGIN { n = m = b = 0 }
+  /#pg$/ { inTable = 1; next }
+  !inTable { next }
+  $1 == "f" && NF == 4 {
+    if (!($2 in calls)) names[n++] = $2
+    calls[$2] += $3; cycles[$2] += unsigned($4); timed += ($4 != 0)
+  }
+  $1 == "a" && NF == 6 {
+    if (!(($2, $3) in arcs)) { arcFrom[m] = $2; arcTo[m++] = $3 }
+    arcs[$2, $3] += unsigned($5)
+  }
+  $1 == "b" && NF == 5 {
+    if (!(($2, $3) in tests)) { branch[b++] = $2 SUBSEP $3 }
+    tests[$2, $3] += unsigned($4); taken[$2, $3] += unsigned($5)
+  }
+  END {
+    if (!inTable) { print "no #pg table in the output" > "/dev/stderr"; exit 1 }
+    # functions by cycles, or by calls without them
+    for (i = 0; i < n; i++) key[names[i]] = timed ? cycles[names[i]] : calls[names[i]]
+    for (i = 1; i < n; i++)
+      for (j = i; j > 0 && key[names[j]] > key[names[j - 1]]; j--) {
+        t = names[j]; names[j] = names[j - 1]; names[j - 1] = t
+      }
+    total = cycles["main"]
+
+    printf "%-16s %10s", "function", "calls"
+    if (timed) printf " %14s %7s %12s", "cycles", "%", "cycles/call"
+    printf "\n"
+    for (i = 0; i < n; i++) {
+      f = names[i]
+      printf "%-16s %10d", f, calls[f]
+      if (timed)
+        printf " %14.0f %6.2f%% %12.1f", cycles[f], total ? 100 * cycles[f] / total : 0,
+               calls[f] ? cycles[f] / calls[f] : 0
+      printf "\n"
+    }
+
+    # callers above and callees below each function
+    printf "\ncall graph\n"
+    for (i = 0; i < n; i++) {
+      f = names[i]
+      for (k = 0; k < m; k++)
+        if (arcTo[k] == f)
+          printf "    %10d  %s\n", arcs[arcFrom[k], f], arcFrom[k]
+      printf "%-16s %10d calls\n", f, calls[f]
+      for (k = 0; k < m; k++)
+        if (arcFrom[k] == f)
+          printf "    %10d    -> %s\n", arcs[f, arcTo[k]], arcTo[k]
+      printf "\n"
+    }
+
+    # if and while statements by the runs of their tests
+    for (i = 1; i < b; i++)
+      for (j = i; j > 0 && tests[branch[j]] > tests[branch[j - 1]]; j--) {
+        t = branch[j]; branch[j] = branch[j - 1]; branch[j - 1] = t
+      }
+    if (b > 0) printf "%-16s %5s %12s %12s %7s\n", "branch", "site", "tests", "taken", "%"
+    for (i = 0; i < b; i++) {
+      split(branch[i], w, SUBSEP)
+      printf "%-16s %5d %12d %12d %6.2f%%\n", w[1], w[2], tests[branch[i]],
+             taken[branch[i]], tests[branch[i]] ? 100 * taken[branch[i]] / tests[branch[i]] : 0
+    }
+  }
+' "${1:--}"
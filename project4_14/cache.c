@@ -0,0 +1,453 @@
+/****************************************************/
+/* File: cache.c                                    */
+/* Content-addressed compile cache: the listing and */
+/* outputs of a compilation stored under a hash of  */
+/* its inputs; see cache.h                          */
+/****************************************************/
+
+#include <stdint.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <utime.h>
+#include <sys/stat.h>
+#include <sys/file.h>
+#include "globals.h"
+#include "cache.h"
+#include "stats.h"
+
+/* bumped when the entry format changes */
+#define CACHE_FORMAT "cmcache 1"
+
+#define MAX_OUTPUTS 8
+
+/* two 64-bit FNV-1a hashes with different starting
+ * values make the 128-bit key
+ */
+#define FNV_PRIME 0x100000001b3ULL
+static uint64_t keyA = 0xcbf29ce484222325ULL;
+static uint64_t keyB = 0x84222325cbf29ce4ULL;
+
+static char *cacheDir = NULL;
+static long cacheMax = 0;
+static char entryPath[1024];
+static char *outputs[MAX_OUTPUTS];
+static int outputCount = 0;
+static FILE *listingFile = NULL;
+
+/* what this compilation did, for printCacheStats */
+static char *outcome = "not used";
+
+/* the counters kept in dir/stats */
+typedef struct
+{
+  long hits, misses, stores, evictions;
+} CacheStats;
+
+void cacheKey(const void *data, size_t size)
+{
+  const unsigned char *p = data;
+  size_t i;
+  for (i = 0; i < size; i++)
+  {
+    keyA = (keyA ^ p[i]) * FNV_PRIME;
+    keyB = (keyB ^ p[i] ^ 0x5c) * FNV_PRIME;
+  }
+}
+
+void cacheKeyFile(char *file)
+{
+  char buf[65536];
+  size_t n;
+  FILE *in = fopen(file, "rb");
+  /* a missing file and an empty one differ */
+  cacheKey(in == NULL ? "-" : "+", 1);
+  if (in == NULL)
+    return;
+  while ((n = fread(buf, 1, sizeof buf, in)) > 0)
+    cacheKey(buf, n);
+  fclose(in);
+}
+
+static void path(char *out, char *name)
+{
+  snprintf(out, 1024, "%s/%s", cacheDir, name);
+}
+
+/* Function lockCache takes the cache's lock file;
+ * with wait FALSE it gives up if another compiler
+ * holds it. Returns the descriptor to unlockCache,
+ * or -1
+ */
+static int lockCache(int wait)
+{
+  char p[1024];
+  int fd;
+  path(p, "lock");
+  fd = open(p, O_RDWR | O_CREAT, 0644);
+  if (fd < 0)
+    return -1;
+  if (flock(fd, wait ? LOCK_EX : LOCK_EX | LOCK_NB) < 0)
+  {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+static void unlockCache(int fd)
+{
+  if (fd >= 0)
+    close(fd);
+}
+
+static void readStats(CacheStats *s)
+{
+  char p[1024];
+  FILE *in;
+  memset(s, 0, sizeof *s);
+  path(p, "stats");
+  if ((in = fopen(p, "r")) == NULL)
+    return;
+  if (fscanf(in, "%ld %ld %ld %ld", &s->hits, &s->misses, &s->stores,
+             &s->evictions) != 4)
+    memset(s, 0, sizeof *s);
+  fclose(in);
+}
+
+static void addStats(long hits, long misses, long stores, long evictions)
+{
+  char p[1024];
+  CacheStats s;
+  FILE *out;
+  int fd = lockCache(TRUE);
+  if (fd < 0)
+    return;
+  readStats(&s);
+  s.hits += hits;
+  s.misses += misses;
+  s.stores += stores;
+  s.evictions += evictions;
+  path(p, "stats");
+  if ((out = fopen(p, "w")) != NULL)
+  {
+    fprintf(out, "%ld %ld %ld %ld\n", s.hits, s.misses, s.stores, s.evictions);
+    fclose(out);
+  }
+  unlockCache(fd);
+}
+
+int cacheOpen(char *dir, long maxBytes)
+{
+  char *home;
+  struct stat st;
+  if (dir == NULL && (dir = getenv("CM_CACHE_DIR")) == NULL)
+  {
+    if ((home = getenv("HOME")) == NULL)
+      return FALSE;
+    dir = (char *)allocate(AllocString, strlen(home) + 16);
+    sprintf(dir, "%s/.cache", home);
+    mkdir(dir, 0755);
+    strcat(dir, "/cminus");
+  }
+  if (mkdir(dir, 0755) < 0 && (stat(dir, &st) < 0 || !S_ISDIR(st.st_mode)))
+    return FALSE;
+  cacheDir = dir;
+  cacheMax = maxBytes;
+  /* a rebuilt compiler may generate other code */
+  if (stat("/proc/self/exe", &st) == 0)
+  {
+    cacheKey(&st.st_size, sizeof st.st_size);
+    cacheKey(&st.st_mtime, sizeof st.st_mtime);
+    cacheKey(&st.st_ino, sizeof st.st_ino);
+  }
+  cacheKey(CACHE_FORMAT, sizeof CACHE_FORMAT);
+  return TRUE;
+}
+
+static void entryName(void)
+{
+  char name[64];
+  snprintf(name, sizeof name, "%016llx%016llx.cmc",
+           (unsigned long long)keyA, (unsigned long long)keyB);
+  path(entryPath, name);
+}
+
+/* Function readEntry reads the entry at entryPath:
+ * its size in *size, or NULL if it is missing or
+ * damaged
+ */
+static char *readEntry(long *size)
+{
+  struct stat st;
+  char *data;
+  FILE *in = fopen(entryPath, "rb");
+  if (in == NULL)
+    return NULL;
+  if (fstat(fileno(in), &st) < 0 || st.st_size < (long)sizeof CACHE_FORMAT)
+  {
+    fclose(in);
+    return NULL;
+  }
+  data = (char *)allocate(AllocCodegen, st.st_size + 1);
+  if (fread(data, 1, st.st_size, in) != (size_t)st.st_size ||
+      memcmp(data, CACHE_FORMAT "\n", sizeof CACHE_FORMAT) != 0)
+  {
+    release(data);
+    data = NULL;
+  }
+  fclose(in);
+  *size = st.st_size;
+  return data;
+}
+
+/* an entry is CACHE_FORMAT, then for each file
+ * "namelength size\n", the name and the contents;
+ * the name of the listing is "-"
+ */
+int cacheFetch(void)
+{
+  char *data, *p, *end, *name;
+  long size, n, len;
+  int pass;
+  if (cacheDir == NULL)
+    return FALSE;
+  entryName();
+  if ((data = readEntry(&size)) == NULL)
+  {
+    outcome = "miss";
+    addStats(0, 1, 0, 0);
+    return FALSE;
+  }
+  end = data + size;
+  /* the first pass checks the entry, the second writes it */
+  for (pass = 0; pass < 2; pass++)
+    for (p = data + sizeof CACHE_FORMAT; p < end; p += len + n)
+    {
+      int used;
+      if (sscanf(p, "%ld %ld\n%n", &len, &n, &used) != 2 || len <= 0 || n < 0 ||
+          (p += used) + len + n > end)
+      {
+        release(data);
+        outcome = "miss";
+        addStats(0, 1, 0, 0);
+        return FALSE;
+      }
+      if (pass == 0)
+        continue;
+      if (len == 1 && *p == '-')
+        fwrite(p + 1, 1, n, stdout);
+      else
+      {
+        FILE *out;
+        name = (char *)allocate(AllocString, len + 1);
+        memcpy(name, p, len);
+        name[len] = '\0';
+        if ((out = fopen(name, "wb")) != NULL)
+        {
+          fwrite(p + len, 1, n, out);
+          fclose(out);
+        }
+        release(name);
+      }
+    }
+  release(data);
+  /* the entry was used: it is the last to be evicted */
+  utime(entryPath, NULL);
+  outcome = "hit";
+  addStats(1, 0, 0, 0);
+  return TRUE;
+}
+
+static void dumpListing(void)
+{
+  char buf[8192];
+  size_t n;
+  fflush(listingFile);
+  rewind(listingFile);
+  while ((n = fread(buf, 1, sizeof buf, listingFile)) > 0)
+    fwrite(buf, 1, n, stdout);
+  fclose(listingFile);
+}
+
+FILE *cacheListing(void)
+{
+  listingFile = tmpfile();
+  if (listingFile == NULL)
+    return stdout;
+  atexit(dumpListing);
+  return listingFile;
+}
+
+void cacheOutput(char *file)
+{
+  if (outputCount < MAX_OUTPUTS)
+    outputs[outputCount++] = file;
+}
+
+/* Function copyInto appends the file in (from the
+ * start) to out as name; FALSE on an error
+ */
+static int copyInto(FILE *out, char *name, FILE *in)
+{
+  char buf[8192];
+  struct stat st;
+  size_t n;
+  long total = 0;
+  if (fflush(in) != 0 || fstat(fileno(in), &st) < 0)
+    return FALSE;
+  rewind(in);
+  fprintf(out, "%ld %ld\n%s", (long)strlen(name), (long)st.st_size, name);
+  while ((n = fread(buf, 1, sizeof buf, in)) > 0)
+  {
+    fwrite(buf, 1, n, out);
+    total += n;
+  }
+  return total == st.st_size;
+}
+
+typedef struct
+{
+  char name[64];
+  time_t used;
+  long size;
+} Entry;
+
+static int olderFirst(const void *a, const void *b)
+{
+  time_t x = ((Entry *)a)->used, y = ((Entry *)b)->used;
+  return x < y ? -1 : x > y;
+}
+
+/* Function scanEntries lists the entries of the cache
+ * in *list (if list is not NULL), and returns their
+ * number and in *bytes their total size
+ */
+static int scanEntries(Entry **list, long *bytes)
+{
+  DIR *d = opendir(cacheDir);
+  struct dirent *e;
+  struct stat st;
+  char p[1024];
+  int n = 0, size = 0;
+  *bytes = 0;
+  if (d == NULL)
+    return 0;
+  while ((e = readdir(d)) != NULL)
+  {
+    int len = strlen(e->d_name);
+    if (len < 5 || len >= 64 || strcmp(e->d_name + len - 4, ".cmc") != 0)
+      continue;
+    path(p, e->d_name);
+    if (stat(p, &st) < 0)
+      continue;
+    *bytes += st.st_size;
+    if (list != NULL)
+    {
+      if (n == size)
+      {
+        size = size ? 2 * size : 64;
+        *list = (Entry *)reallocate(AllocCodegen, *list, size * sizeof(Entry));
+      }
+      strcpy((*list)[n].name, e->d_name);
+      (*list)[n].used = st.st_mtime;
+      (*list)[n].size = st.st_size;
+    }
+    n++;
+  }
+  closedir(d);
+  return n;
+}
+
+/* Function evict removes the least recently used
+ * entries until the cache is under 90% of its limit;
+ * only one compiler evicts at a time. Returns the
+ * number of entries removed
+ */
+static int evict(void)
+{
+  Entry *list = NULL;
+  long bytes;
+  char p[1024];
+  int n, i, removed = 0;
+  int fd = lockCache(FALSE);
+  if (fd < 0)
+    return 0;
+  n = scanEntries(&list, &bytes);
+  if (bytes > cacheMax)
+  {
+    qsort(list, n, sizeof(Entry), olderFirst);
+    for (i = 0; i < n && bytes > cacheMax / 10 * 9; i++)
+    {
+      path(p, list[i].name);
+      /* another compiler may have removed it already */
+      if (unlink(p) == 0)
+        removed++;
+      bytes -= list[i].size;
+    }
+  }
+  if (list != NULL)
+    release(list);
+  unlockCache(fd);
+  return removed;
+}
+
+void cacheStore(void)
+{
+  char tmp[1024];
+  FILE *out, *in;
+  int fd, i, ok;
+  if (cacheDir == NULL || listingFile == NULL)
+    return;
+  entryName();
+  path(tmp, "tmp.XXXXXX");
+  if ((fd = mkstemp(tmp)) < 0)
+    return;
+  /* mkstemp makes the file private */
+  fchmod(fd, 0644);
+  out = fdopen(fd, "wb");
+  fprintf(out, "%s\n", CACHE_FORMAT);
+  ok = copyInto(out, "-", listingFile);
+  for (i = 0; ok && i < outputCount; i++)
+  {
+    if ((in = fopen(outputs[i], "rb")) == NULL)
+      ok = FALSE;
+    else
+    {
+      ok = copyInto(out, outputs[i], in);
+      fclose(in);
+    }
+  }
+  /* the listing goes on after the end of the entry */
+  fseek(listingFile, 0, SEEK_END);
+  if (fclose(out) != 0 || !ok || rename(tmp, entryPath) != 0)
+  {
+    unlink(tmp);
+    return;
+  }
+  addStats(0, 0, 1, evict());
+}
+
+void printCacheStats(FILE *out)
+{
+  CacheStats s;
+  long bytes;
+  int n;
+  if (cacheDir == NULL)
+  {
+    fprintf(out, "\ncache            not in use\n");
+    return;
+  }
+  readStats(&s);
+  n = scanEntries(NULL, &bytes);
+  fprintf(out, "\ncache            %s\n", cacheDir);
+  fprintf(out, "this compile     %10s\n", outcome);
+  fprintf(out, "hits             %10ld\n", s.hits);
+  fprintf(out, "misses           %10ld\n", s.misses);
+  fprintf(out, "hit rate         %9.1f%%\n",
+          s.hits + s.misses ? 100.0 * s.hits / (s.hits + s.misses) : 0.0);
+  fprintf(out, "stores           %10ld\n", s.stores);
+  fprintf(out, "evictions        %10ld\n", s.evictions);
+  fprintf(out, "entries          %10d\n", n);
+  fprintf(out, "bytes            %10ld of %ld\n", bytes, cacheMax);
+}
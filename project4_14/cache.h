@@ -0,0 +1,57 @@
+/****************************************************/
+/* File: cache.h                                    */
+/* Content-addressed compile cache (--cache)        */
+/****************************************************/
+
+#ifndef _CACHE_H_
+#define _CACHE_H_
+
+/* An entry holds the listing and the output files of
+ * one compilation, under a hash of everything that
+ * decides them: the compiler binary, the options, the
+ * file name, the source and the profile. Entries are
+ * written to a temporary file and renamed, so parallel
+ * compilers never see half an entry; a hit marks its
+ * entry used, and a store that takes the cache over
+ * its size evicts the least recently used entries
+ */
+
+/* Function cacheOpen uses the cache in dir (NULL: the
+ * default, $CM_CACHE_DIR or ~/.cache/cminus), made
+ * if missing, of at most maxBytes. Returns FALSE if
+ * the cache cannot be used
+ */
+int cacheOpen(char *dir, long maxBytes);
+
+/* Procedures cacheKey and cacheKeyFile add bytes,
+ * or the contents of a file, to the key
+ */
+void cacheKey(const void *data, size_t size);
+void cacheKeyFile(char *file);
+
+/* Function cacheFetch looks the key up; on a hit it
+ * writes the stored files and the listing (to
+ * stdout) and returns TRUE
+ */
+int cacheFetch(void);
+
+/* Function cacheListing returns a file that collects
+ * the listing of a compilation that missed; it is
+ * copied to stdout when the compiler exits
+ */
+FILE *cacheListing(void);
+
+/* Procedure cacheOutput names an output file for
+ * cacheStore, which stores the listing and the
+ * outputs under the key
+ */
+void cacheOutput(char *file);
+void cacheStore(void);
+
+/* Procedure printCacheStats writes the hits, misses,
+ * stores and evictions so far and the size of the
+ * cache
+ */
+void printCacheStats(FILE *out);
+
+#endif
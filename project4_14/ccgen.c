@@ -0,0 +1,545 @@
+/****************************************************/
+/* File: ccgen.c                                    */
+/* The C code generator implementation              */
+/* Lowers the analyzed syntax tree to standalone    */
+/* C99 for a native compiler (gcc -O2). Source      */
+/* names get a u_ prefix, arithmetic wraps like the */
+/* MIPS code, and operands are hoisted into         */
+/* temporaries where C would leave their order of   */
+/* evaluation open                                  */
+/****************************************************/
+
+#include <stdarg.h>
+#include <limits.h>
+#include "globals.h"
+#include "symtab.h"
+#include "stats.h"
+#include "ccgen.h"
+
+/* a growing string */
+typedef struct
+{
+  char *s;
+  int len, size;
+} Str;
+
+static Str pending;      /* hoisted statements for the current statement */
+static int indent;
+static int tempNum;
+
+static void put(Str *b, const char *fmt, ...)
+{
+  va_list ap;
+  int n;
+  for (;;)
+  {
+    va_start(ap, fmt);
+    n = vsnprintf(b->s + b->len, b->size - b->len, fmt, ap);
+    va_end(ap);
+    if (b->s != NULL && b->len + n < b->size)
+      break;
+    b->size = 2 * (b->len + n + 1);
+    b->s = (char *)reallocate(AllocCodegen, b->s, b->size);
+  }
+  b->len += n;
+}
+
+static void clear(Str *b)
+{
+  b->len = 0;
+  if (b->s != NULL)
+    b->s[0] = '\0';
+}
+
+/* Procedure line writes one indented line */
+static void line(const char *fmt, ...)
+{
+  va_list ap;
+  fprintf(code, "%*s", 2 * indent, "");
+  va_start(ap, fmt);
+  vfprintf(code, fmt, ap);
+  va_end(ap);
+  fputc('\n', code);
+}
+
+static void flushPending(void)
+{
+  if (pending.len > 0)
+    fputs(pending.s, code);
+  clear(&pending);
+}
+
+static int containsCall(TreeNode *t)
+{
+  int i;
+  for (; t != NULL; t = t->sibling)
+  {
+    if (t->nodekind == ExpK && t->kind.exp == FuncCallK)
+      return TRUE;
+    for (i = 0; i < MAXCHILDREN; i++)
+      if (containsCall(t->child[i]))
+        return TRUE;
+  }
+  return FALSE;
+}
+
+static int containsAssign(TreeNode *t)
+{
+  int i;
+  for (; t != NULL; t = t->sibling)
+  {
+    if (t->nodekind == StmtK && t->kind.stmt == AssignK)
+      return TRUE;
+    for (i = 0; i < MAXCHILDREN; i++)
+      if (containsAssign(t->child[i]))
+        return TRUE;
+  }
+  return FALSE;
+}
+
+/* Function isStable returns TRUE if no call can change
+ * the value of t: constants, local scalars and array
+ * addresses
+ */
+static int isStable(TreeNode *t)
+{
+  if (t->nodekind != ExpK)
+    return FALSE;
+  if (t->kind.exp == ConstK)
+    return TRUE;
+  if (t->kind.exp != IdK || t->child[0] != NULL)
+    return FALSE;
+  return t->info->isArray || !t->info->isGlobal;
+}
+
+/* Function mustHoist returns TRUE if operand i has to
+ * be evaluated before the statement so it happens
+ * before the later operands, as in the MIPS code. A
+ * later assignment can change even a local scalar
+ */
+static int mustHoist(TreeNode **ops, int i, int n)
+{
+  int j;
+  /* an assignment's value is already a temporary */
+  if (ops[i]->nodekind != ExpK || ops[i]->kind.exp == ConstK)
+    return FALSE;
+  for (j = i + 1; j < n; j++)
+    if (containsAssign(ops[j]))
+      return TRUE;
+  if (isStable(ops[i]))
+    return FALSE;
+  for (j = i + 1; j < n; j++)
+    if (containsCall(ops[j]) ||
+        (containsCall(ops[i]) && !isStable(ops[j])))
+      return TRUE;
+  return FALSE;
+}
+
+static void genExp(Str *out, TreeNode *t);
+
+/* Procedure genOperands formats n operands in order,
+ * hoisting the ones that must be evaluated first
+ */
+static void genOperands(TreeNode **ops, int n, Str *res)
+{
+  int i;
+  for (i = 0; i < n; i++)
+  {
+    clear(&res[i]);
+    genExp(&res[i], ops[i]);
+    if (mustHoist(ops, i, n))
+    {
+      put(&pending, "%*sint t%d = %s;\n", 2 * indent, "", tempNum, res[i].s);
+      clear(&res[i]);
+      put(&res[i], "t%d", tempNum++);
+    }
+  }
+}
+
+static void genConst(Str *out, int v)
+{
+  if (v == INT_MIN)
+    put(out, "(-2147483647 - 1)");
+  else if (v < 0)
+    put(out, "(%d)", v);
+  else
+    put(out, "%d", v);
+}
+
+static void genOp(Str *out, TreeNode *t)
+{
+  Str s[2] = { { NULL, 0, 0 }, { NULL, 0, 0 } };
+  TreeNode *r = t->child[1];
+
+  genOperands(t->child, 2, s);
+  switch (t->attr.op)
+  {
+  case PLUS:  put(out, "CM_ADD(%s, %s)", s[0].s, s[1].s); break;
+  case MINUS: put(out, "CM_SUB(%s, %s)", s[0].s, s[1].s); break;
+  case TIMES: put(out, "CM_MUL(%s, %s)", s[0].s, s[1].s); break;
+  case OVER:
+    if (r->nodekind == ExpK && r->kind.exp == ConstK &&
+        r->val != 0 && r->val != -1)
+      put(out, "(%s / %s)", s[0].s, s[1].s);
+    else
+      put(out, "cm_div(%s, %s)", s[0].s, s[1].s);
+    break;
+  case LT:    put(out, "(%s < %s)", s[0].s, s[1].s); break;
+  case LTET:  put(out, "(%s <= %s)", s[0].s, s[1].s); break;
+  case GT:    put(out, "(%s > %s)", s[0].s, s[1].s); break;
+  case GTET:  put(out, "(%s >= %s)", s[0].s, s[1].s); break;
+  case EQ:    put(out, "(%s == %s)", s[0].s, s[1].s); break;
+  case NOTEQ: put(out, "(%s != %s)", s[0].s, s[1].s); break;
+  default:    break;
+  }
+  release(s[0].s);
+  release(s[1].s);
+}
+
+static void genCall(Str *out, TreeNode *t)
+{
+  TreeNode *a, **ops;
+  Str *s;
+  int n = 0, i;
+
+  for (a = t->child[0]; a != NULL; a = a->sibling)
+    n++;
+  ops = (TreeNode **)allocate(AllocCodegen, (n + 1) * sizeof(TreeNode *));
+  s = (Str *)allocate(AllocCodegen, (n + 1) * sizeof(Str));
+  memset(s, 0, (n + 1) * sizeof(Str));
+  for (a = t->child[0], i = 0; a != NULL; a = a->sibling, i++)
+    ops[i] = a;
+  genOperands(ops, n, s);
+  put(out, "u_%s(", t->attr.name);
+  for (i = 0; i < n; i++)
+  {
+    put(out, "%s%s", i > 0 ? ", " : "", s[i].s);
+    release(s[i].s);
+  }
+  put(out, ")");
+  release(ops);
+  release(s);
+}
+
+static void genTarget(Str *out, TreeNode *lhs, TreeNode *value);
+
+/* Procedure genExp formats expression t. An assignment
+ * used as a value is hoisted with its operands, and
+ * its value is read from a temporary
+ */
+static void genExp(Str *out, TreeNode *t)
+{
+  Str idx = { NULL, 0, 0 };
+  if (t->nodekind == StmtK)
+  {
+    if (t->kind.stmt == AssignK)
+    {
+      genTarget(&idx, t->child[0], t->child[1]);
+      put(&pending, "%*sint t%d = (%s);\n", 2 * indent, "", tempNum, idx.s);
+      put(out, "t%d", tempNum++);
+      release(idx.s);
+    }
+    return;
+  }
+  switch (t->kind.exp)
+  {
+  case ConstK:
+    genConst(out, t->val);
+    break;
+  case IdK:
+    if (t->child[0] == NULL)
+      put(out, "u_%s", t->attr.name);
+    else
+    {
+      genExp(&idx, t->child[0]);
+      put(out, "u_%s[%s]", t->attr.name, idx.s);
+      release(idx.s);
+    }
+    break;
+  case OpK:
+    genOp(out, t);
+    break;
+  case FuncCallK:
+    genCall(out, t);
+    break;
+  default:
+    break;
+  }
+}
+
+/* Procedure genTarget formats the variable or array
+ * element an assignment or input stores to; its
+ * subscript is evaluated before value
+ */
+static void genTarget(Str *out, TreeNode *lhs, TreeNode *value)
+{
+  TreeNode *ops[2];
+  Str s[2] = { { NULL, 0, 0 }, { NULL, 0, 0 } };
+
+  if (lhs->child[0] == NULL)
+  {
+    put(out, "u_%s", lhs->attr.name);
+    if (value != NULL)
+      genExp(&s[1], value);
+  }
+  else
+  {
+    ops[0] = lhs->child[0];
+    ops[1] = value;
+    genOperands(ops, value != NULL ? 2 : 1, s);
+    put(out, "u_%s[%s]", lhs->attr.name, s[0].s);
+  }
+  if (value != NULL)
+    put(out, " = %s", s[1].s);
+  release(s[0].s);
+  release(s[1].s);
+}
+
+static void genStmt(TreeNode *t);
+
+static void genDecls(TreeNode *t)
+{
+  for (; t != NULL; t = t->sibling)
+    if (t->nodekind == DeclarationK && t->kind.dec == SimpleK)
+      line("int u_%s;", t->attr.name);
+    else if (t->nodekind == DeclarationK && t->kind.dec == ArrayK)
+      line("int u_%s[%d];", t->attr.name, t->info->ArraySize);
+}
+
+/* Procedure genBlock writes the statements of t inside
+ * braces already written; a compound statement does
+ * not get a second pair
+ */
+static void genBlock(TreeNode *t)
+{
+  indent++;
+  if (t != NULL && t->nodekind == StmtK && t->kind.stmt == CompoundK &&
+      t->sibling == NULL)
+  {
+    genDecls(t->child[0]);
+    genStmt(t->child[1]);
+  }
+  else
+    genStmt(t);
+  indent--;
+}
+
+static void genStmt(TreeNode *t)
+{
+  Str s = { NULL, 0, 0 };
+  for (; t != NULL; t = t->sibling)
+  {
+    clear(&s);
+    if (t->nodekind == ExpK)
+    {
+      switch (t->kind.exp)
+      {
+      case InputCallK:
+        genTarget(&s, t->child[0], NULL);
+        flushPending();
+        line("%s = cm_input();", s.s);
+        break;
+      case OutputCallK:
+        genExp(&s, t->child[0]);
+        flushPending();
+        line("cm_output(%s);", s.s);
+        break;
+      default:
+        genExp(&s, t);
+        flushPending();
+        line("%s;", s.s);
+        break;
+      }
+      continue;
+    }
+    if (t->nodekind != StmtK)
+      continue;
+    switch (t->kind.stmt)
+    {
+    case AssignK:
+      genTarget(&s, t->child[0], t->child[1]);
+      flushPending();
+      line("%s;", s.s);
+      break;
+    case IfK:
+      genExp(&s, t->child[0]);
+      flushPending();
+      line("if (%s) {", s.s);
+      genBlock(t->child[1]);
+      if (t->child[2] != NULL)
+      {
+        line("} else {");
+        genBlock(t->child[2]);
+      }
+      line("}");
+      break;
+    case WhileK:
+      /* a test that needs hoisted statements is
+         evaluated inside the loop */
+      indent++;
+      genExp(&s, t->child[0]);
+      indent--;
+      if (pending.len == 0)
+        line("while (%s) {", s.s);
+      else
+      {
+        line("for (;;) {");
+        flushPending();
+        line("  if (!%s) break;", s.s);
+      }
+      genBlock(t->child[1]);
+      line("}");
+      break;
+    case ReturnK:
+      if (t->child[0] == NULL)
+        line("return;");
+      else
+      {
+        genExp(&s, t->child[0]);
+        flushPending();
+        line("return %s;", s.s);
+      }
+      break;
+    case CompoundK:
+      line("{");
+      indent++;
+      genDecls(t->child[0]);
+      genStmt(t->child[1]);
+      indent--;
+      line("}");
+      break;
+    default:
+      break;
+    }
+  }
+  release(s.s);
+}
+
+/* Procedure genHeader writes the declarator of
+ * function f
+ */
+static void genHeader(TreeNode *f)
+{
+  TreeNode *p;
+  fprintf(code, "static %s u_%s(", f->info->expType == Void ? "void" : "int",
+          f->attr.name);
+  if (f->child[0] == NULL)
+    fprintf(code, "void");
+  for (p = f->child[0]; p != NULL; p = p->sibling)
+    fprintf(code, "%sint %su_%s", p == f->child[0] ? "" : ", ",
+            p->isArray ? "*" : "", p->attr.name);
+  fprintf(code, ")");
+}
+
+/* the runtime: input parses integers from stdin by
+ * hand and output formats its line into one fwrite,
+ * both on top of the stdio buffers
+ */
+static const char *runtime[] =
+{
+  "#include <stdio.h>",
+  "#include <stdlib.h>",
+  "",
+  "/* arithmetic wraps around like 32-bit registers */",
+  "#define CM_ADD(a, b) ((int)((unsigned)(a) + (unsigned)(b)))",
+  "#define CM_SUB(a, b) ((int)((unsigned)(a) - (unsigned)(b)))",
+  "#define CM_MUL(a, b) ((int)((unsigned)(a) * (unsigned)(b)))",
+  "",
+  "static inline int cm_div(int a, int b)",
+  "{",
+  "  if (b == 0) {",
+  "    fflush(stdout);",
+  "    fputs(\"runtime error: division by zero\\n\", stderr);",
+  "    exit(1);",
+  "  }",
+  "  return b == -1 ? (int)(0u - (unsigned)a) : a / b;",
+  "}",
+  "",
+  "static inline int cm_input(void)",
+  "{",
+  "  int c, neg = 0;",
+  "  unsigned v = 0;",
+  "  if (CM_PROMPTS)",
+  "    fputs(\"Enter value for input instruction: \", stdout);",
+  "  do",
+  "    c = getchar();",
+  "  while (c == ' ' || c == '\\t' || c == '\\n' || c == '\\r');",
+  "  if (c == '-' || c == '+') {",
+  "    neg = c == '-';",
+  "    c = getchar();",
+  "  }",
+  "  for (; c >= '0' && c <= '9'; c = getchar())",
+  "    v = 10 * v + (unsigned)(c - '0');",
+  "  if (c != EOF)",
+  "    ungetc(c, stdin);",
+  "  return (int)(neg ? 0u - v : v);",
+  "}",
+  "",
+  "static inline void cm_output(int v)",
+  "{",
+  "  static const char prefix[] = \"output instruction prints: \";",
+  "  char line[48], digits[12];",
+  "  unsigned u = v < 0 ? 0u - (unsigned)v : (unsigned)v;",
+  "  int n = CM_PROMPTS ? sizeof prefix - 1 : 0, k = 0;",
+  "  do {",
+  "    digits[k++] = (char)('0' + u % 10);",
+  "    u /= 10;",
+  "  } while (u != 0);",
+  "  memcpy(line, prefix, n);",
+  "  if (v < 0)",
+  "    line[n++] = '-';",
+  "  while (k > 0)",
+  "    line[n++] = digits[--k];",
+  "  line[n++] = '\\n';",
+  "  fwrite(line, 1, n, stdout);",
+  "}",
+  NULL
+};
+
+/**********************************************/
+/* the primary function of the code generator */
+/**********************************************/
+/* Procedure cCodeGen translates the syntax tree to a
+ * standalone C99 program in the code file, with a
+ * runtime for input and output. The second parameter
+ * (codefile) is the file name of the code file, and
+ * is printed as a comment
+ */
+void cCodeGen(TreeNode *syntaxTree, char *codefile)
+{
+  TreeNode *t;
+  int i;
+
+  fprintf(code, "/* C- Compilation to C99 */\n");
+  fprintf(code, "/* File: %s */\n", codefile);
+  fprintf(code, "#include <string.h>\n");
+  fprintf(code, "#define CM_PROMPTS %d\n\n", Prompts);
+  for (i = 0; runtime[i] != NULL; i++)
+    fprintf(code, "%s\n", runtime[i]);
+
+  fprintf(code, "\n");
+  for (t = syntaxTree; t != NULL; t = t->sibling)
+    if (t->nodekind == DeclarationK && t->kind.dec == SimpleK)
+      fprintf(code, "static int u_%s;\n", t->attr.name);
+    else if (t->nodekind == DeclarationK && t->kind.dec == ArrayK)
+      fprintf(code, "static int u_%s[%d];\n", t->attr.name, t->info->ArraySize);
+    else if (t->nodekind == DeclarationK && t->kind.dec == FunctionK)
+    {
+      genHeader(t);
+      fprintf(code, ";\n");
+    }
+
+  indent = 0;
+  for (t = syntaxTree; t != NULL; t = t->sibling)
+    if (t->nodekind == DeclarationK && t->kind.dec == FunctionK)
+    {
+      fprintf(code, "\n");
+      genHeader(t);
+      fprintf(code, "\n{\n");
+      tempNum = 0;
+      genBlock(t->child[1]);
+      fprintf(code, "}\n");
+    }
+
+  fprintf(code, "\nint main(void)\n{\n  u_main();\n  return 0;\n}\n");
+}
@@ -0,0 +1,18 @@
+/****************************************************/
+/* File: ccgen.h                                    */
+/* The C code generator interface                   */
+/* (lowers C- to standalone C99)                    */
+/****************************************************/
+
+#ifndef _CCGEN_H_
+#define _CCGEN_H_
+
+/* Procedure cCodeGen translates the syntax tree to a
+ * standalone C99 program in the code file, with a
+ * runtime for input and output. The second parameter
+ * (codefile) is the file name of the code file, and
+ * is printed as a comment
+ */
+void cCodeGen(TreeNode * syntaxTree, char * codefile);
+
+#endif
@@ -2,15 +2,20 @@
 /* File: cgen.c                                     */
 /* The code generator implementation                */
 /* for the TINY compiler                            */
-/* (generates code for the TM machine)              */
+/* (walks the tree for an accumulator machine;      */
+/* the target selects instructions, see target.h)   */
 /* Compiler Construction: Principles and Practice   */
 /* Kenneth C. Louden                                */
 /****************************************************/
 
 #include "globals.h"
 #include "symtab.h"
-#include "code.h"
+#include "target.h"
 #include "cgen.h"
+#include "optimize.h"
+#include "stats.h"
+#include "report.h"
+#include "incr.h"
 #include "string.h"
 #include "stdlib.h"
 #include "stdbool.h"
@@ -20,114 +25,321 @@
    stored, and incremeted when loaded again
 */
 static int tmpOffset = 0;
-static int gsize=0; // global area size
 static int returnLocLabel = 0;
+/* bytes of saved value registers between the current
+   frame and the caller's argument area */
+static int frameExtra = 0;
+
+/* the target code is generated for */
+static Target *target;
+
+/* Function _units converts a byte offset in memloc
+ * units (4 per word) to address units of the target
+ */
+static int _units(int bytes)
+{
+   return bytes / 4 * target->wordSize;
+}
 
 /* prototype for internal recursive code generator */
 static void cGen(TreeNode *tree);
 
 int _getLabelNumber();
 
+/* the next label number */
+static int labelNum = 0;
+
+/* the source line of the code being generated */
+static int sourceLine = 0;
+
+static int _isConst(TreeNode *tree)
+{
+   return tree != NULL && tree->nodekind == ExpK && tree->kind.exp == ConstK;
+}
+
+/* Function _swapOp returns the operator that gives the
+ * same result with the operands exchanged, or -1
+ */
+static TokenType _swapOp(TokenType op)
+{
+   switch (op)
+   {
+   case PLUS: case TIMES: case EQ: case NOTEQ:
+      return op;
+   case LT:   return GT;
+   case GT:   return LT;
+   case LTET: return GTET;
+   case GTET: return LTET;
+   default:   return -1;
+   }
+}
+
+/* Function _vnRegsUsed returns how many registers
+ * the value numbering marks in a subtree use
+ */
+static int _vnRegsUsed(TreeNode *tree)
+{
+   int i, n = 0, m;
+   for (; tree != NULL; tree = tree->sibling)
+   {
+      if (tree->vnReg >= n)
+         n = tree->vnReg + 1;
+      if (tree->vnAddrReg >= n)
+         n = tree->vnAddrReg + 1;
+      for (i = 0; i < MAXCHILDREN; i++)
+         if ((m = _vnRegsUsed(tree->child[i])) > n)
+            n = m;
+   }
+   return n;
+}
+
+/* Function _fpOffset returns the offset from the frame
+ * pointer of a local variable or parameter, in address
+ * units
+ */
+static int _fpOffset(SymbolInfo info)
+{
+   int i;
+   if (info->decKind != ParamK)
+      return _units(info->memloc);
+   if (info->memloc < PARAM_STACK_BASE)
+      i = (info->memloc - PARAM_REG_BASE) / 4;
+   else
+      i = (info->memloc - PARAM_STACK_BASE) / 4;
+   /* without an argument register the argument stays in
+      the caller's area */
+   if (i < target->numArgRegs)
+      return _units(info->memloc);
+   return _units(PARAM_STACK_BASE + 4 * i + frameExtra);
+}
+
+/* Function _varOffset returns the offset of a local
+ * or global variable (element 0 of an array) from its
+ * base register, RegFp or RegGp, in address units
+ */
+static int _varOffset(SymbolInfo info, Reg *base)
+{
+   if (info->isGlobal)
+   {
+      /* memloc is the end of the variable in the global area */
+      *base = RegGp;
+      return _units(info->memloc - 4 * (info->isArray ? info->ArraySize : 1));
+   }
+   *base = RegFp;
+   return _fpOffset(info);
+}
+
+/* Function _containsCall returns TRUE if evaluating the
+ * subtree may jump to a function or a runtime routine,
+ * which overwrites the argument registers
+ */
+static int _containsCall(TreeNode *tree)
+{
+   int i;
+   for (; tree != NULL; tree = tree->sibling)
+   {
+      if (tree->nodekind == ExpK &&
+          (tree->kind.exp == FuncCallK || tree->kind.exp == InputCallK ||
+           tree->kind.exp == OutputCallK))
+         return TRUE;
+      for (i = 0; i < MAXCHILDREN; i++)
+         if (_containsCall(tree->child[i]))
+            return TRUE;
+   }
+   return FALSE;
+}
+
+/* Function _isAssigned returns TRUE if the scalar
+ * described by info is the target of an assignment
+ */
+static int _isAssigned(TreeNode *tree, SymbolInfo info)
+{
+   int i;
+   for (; tree != NULL; tree = tree->sibling)
+   {
+      if (tree->nodekind == StmtK && tree->kind.stmt == AssignK &&
+          tree->child[0]->info == info && tree->child[0]->child[0] == NULL)
+         return TRUE;
+      for (i = 0; i < MAXCHILDREN; i++)
+         if (_isAssigned(tree->child[i], info))
+            return TRUE;
+   }
+   return FALSE;
+}
+
+/* Procedure _push pushes register r on the stack */
+static void _push(Reg r)
+{
+   target->addConst(RegSp, RegSp, -target->wordSize);
+   target->store(r, 0, RegSp);
+}
+
+/* Procedure _pop pops the top of the stack into r */
+static void _pop(Reg r)
+{
+   target->load(r, 0, RegSp);
+   target->addConst(RegSp, RegSp, target->wordSize);
+}
+
+/* the cold parts of if statements (PGO_COLD_THEN,
+ * PGO_COLD_ELSE) are generated after the function's
+ * return, from label back to label back
+ */
+typedef struct ColdRec
+{
+   TreeNode *tree;
+   int label, back;
+   int site;    /* counted as a taken branch, or -1 */
+   struct ColdRec *next;
+} Cold;
+
+static Cold *coldFirst = NULL, *coldLast = NULL;
+
+static void _defer(TreeNode *tree, int label, int back, int site)
+{
+   Cold *c = (Cold *)allocate(AllocCodegen, sizeof(Cold));
+   c->tree = tree;
+   c->label = label;
+   c->back = back;
+   c->site = site;
+   c->next = NULL;
+   if (coldLast == NULL)
+      coldFirst = c;
+   else
+      coldLast->next = c;
+   coldLast = c;
+}
+
+/* Procedure _genCold generates the deferred parts,
+ * including those they defer in turn
+ */
+static void _genCold(void)
+{
+   Cold *c;
+   while ((c = coldFirst) != NULL)
+   {
+      target->comment("cold");
+      target->label(c->label);
+      target->countBranch(c->site, TRUE);
+      cGen(c->tree);
+      target->jump(c->back);
+      coldFirst = c->next;
+      if (coldFirst == NULL)
+         coldLast = NULL;
+      release(c);
+   }
+}
+
 /* Procedure genStmt generates code at a statement node */
 static void genStmt(TreeNode *tree)
 {
-   TreeNode *p1, *p2, *p3;
-   int savedLoc1, savedLoc2, currentLoc;
-   int loc;
    switch (tree->kind.stmt)
    {
    case IfK :
       {
          int label1 = _getLabelNumber();
          int label2 = _getLabelNumber();
-         char lab1[10] = {0};
-         char lab2[10] = {0};
-         sprintf(lab1, "L%d", label1);
-         sprintf(lab2, "L%d", label2);
 
          cGen(tree->child[0]);  // expr
-         emitInst2param("beqz", "$v0", lab1);
+         target->countBranch(tree->site, FALSE);
+         if (tree->pgoFlags & PGO_COLD_THEN)
+         {
+            /* the else part, if any, falls through */
+            target->jumpIfNonZero(RegAcc, label1);
+            _defer(tree->child[1], label1, label2, tree->site);
+            cGen(tree->child[2]);
+            target->label(label2);
+            break;
+         }
+         target->jumpIfZero(RegAcc, label1);
+         target->countBranch(tree->site, TRUE);
          cGen(tree->child[1]);  // compound1
-         if(tree->child[2])
+         if(tree->child[2] && (tree->pgoFlags & PGO_COLD_ELSE))
+         {
+            _defer(tree->child[2], label1, label2, -1);
+            target->label(label2);
+         }
+         else if(tree->child[2])
          {
-            emitInst1param("j", lab2);
-            emitLabel(lab1);
+            target->jump(label2);
+            target->label(label1);
             cGen(tree->child[2]);  // else compound
-            emitLabel(lab2);
+            target->label(label2);
          }
          else
          {
-            emitLabel(lab1);
+            target->label(label1);
          }
       }
       break; /* if_k */
    
    case WhileK:
       {
-      emitComment("WhileK");
       int label1 = _getLabelNumber();
       int label2 = _getLabelNumber();
-      char lab1[10] = {0};
-      char lab2[10] = {0};
-      sprintf(lab1, "L%d", label1);
-      sprintf(lab2, "L%d", label2);
+      target->comment("WhileK");
 
-      emitLabel(lab1);
-      cGen(tree->child[0]);
-      emitInst2param("beqz", "$v0", lab2);
+      if ((tree->pgoFlags & PGO_ROTATE) && !_isConst(tree->child[0]))
+      {
+         /* rotated: the test is repeated after the body,
+            which saves the jump back of every iteration */
+         cGen(tree->child[0]);
+         target->countBranch(tree->site, FALSE);
+         target->jumpIfZero(RegAcc, label2);
+         target->label(label1);
+         target->countBranch(tree->site, TRUE);
+         cGen(tree->child[1]);
+         cGen(tree->child[0]);
+         target->countBranch(tree->site, FALSE);
+         target->jumpIfNonZero(RegAcc, label1);
+         target->label(label2);
+         break;
+      }
+      target->label(label1);
+      /* a constant true condition needs no test */
+      if (!_isConst(tree->child[0]))
+      {
+         cGen(tree->child[0]);
+         target->countBranch(tree->site, FALSE);
+         target->jumpIfZero(RegAcc, label2);
+      }
+      target->countBranch(tree->site, TRUE);
       cGen(tree->child[1]);
-      emitInst1param("j", lab1);
-      emitLabel(lab2);
+      target->jump(label1);
+      target->label(label2);
       }
       break; /* while */
    
    case AssignK:
       {
       /*mem[v0] = v1;*/
-      emitComment("AssignK");
+      target->comment("AssignK");
       cGen(tree->child[0]);
-      emitInst3param("subu", "$sp", "$sp", "4"); 
-      emitInst2param("sw", "$v1", "0($sp)");    
-       
+      if (tree->child[0]->vnFlags & (VN_KEEPADDR | VN_REUSEADDR))
+      {
+         /* the target address stays in its value register */
+         cGen(tree->child[1]);
+         target->store(RegAcc, 0, RegValue + tree->child[0]->vnAddrReg);
+         break;
+      }
+      _push(RegAddr);
+      reportSpill(TRUE);
       cGen(tree->child[1]);
-      emitInst2param("lw", "$t1", "0($sp)");
-//      emitInst2param("lw", "$v1", "0($sp)");
-      emitInst3param("addu", "$sp", "$sp", "4"); 
-      emitInst2param("sw", "$v0", "0($t1)"); 
-      emitComment("");    
+      _pop(RegSecond);
+      target->store(RegAcc, 0, RegSecond);
+      target->comment("");
       }
       break; /* assign_k */
    
    case ReturnK:
-      {
-      char returnLocLab[10] = {0};
-      sprintf(returnLocLab, "RET%d", returnLocLabel);
       cGen(tree->child[0]);
-      emitInst1param("j", returnLocLab);
-      /* 함수 마지막으로 점프 시켜줘야함 */
-      //emitInst2param("move", "$sp", "$fp");
-      //emitInst2param("lw", "$ra", "-8($sp)");
-      //emitInst2param("lw", "$fp", "0($sp)");
-      //emitInst3param("subu", "$sp", "$sp", "24"); 
-      
-      //emitInst1param("jr", "$ra");
-
-      }
+      /* the epilogue is at the end of the function */
+      target->jump(returnLocLabel);
       break;
-   
 
    case CompoundK:
-      {
-      char addedMem[10]={0};
-      int statementsize=0;
-      /* generate code for expression to write */
       cGen(tree->child[0]);
-      statementsize=getdeclsize();
       cGen(tree->child[1]);
-      //sprintf(addedMem, "%d", statementsize);
-      //emitInst3param("subu", "$sp", "$sp", addedMem);
-      /* now output it */
-      }
       break;
 
    default:
@@ -135,129 +347,138 @@ static void genStmt(TreeNode *tree)
    /* genStmt */
    }
 }
+
+/* Procedure genElement generates code that loads the
+ * array element tree into the accumulator and its
+ * address into RegAddr
+ */
+static void genElement(TreeNode *tree)
+{
+   SymbolInfo info = tree->info;
+   TreeNode *index = tree->child[0];
+   Reg base;
+   int off;
+
+   if(tree->vnFlags & VN_REUSEADDR){
+      target->move(RegAddr, RegValue + tree->vnAddrReg);
+      target->load(RegAcc, 0, RegAddr);
+   }
+   else if(info->decKind == ParamK){
+      /* an array parameter holds the address of element 0 */
+      base = RegAddr;
+      if(info->argReg >= 0)
+         base = RegArg + info->argReg;
+      else if(_isConst(index))
+         target->load(RegAddr, _fpOffset(info), RegFp);
+      if(_isConst(index)){
+         off = _units(4*index->val);
+         target->load(RegAcc, off, base);
+         target->loadAddr(RegAddr, off, base);
+      }
+      else{
+         cGen(index); // index -> acc
+         target->scale(RegAcc);
+         if(info->argReg < 0)
+            target->load(RegAddr, _fpOffset(info), RegFp);
+         target->add(RegAddr, base, RegAcc);
+         target->load(RegAcc, 0, RegAddr);
+      }
+   }
+   else if(_isConst(index)){
+      /* constant subscript: the element address is a fixed offset */
+      off = _varOffset(info, &base) + _units(4*index->val);
+      target->load(RegAcc, off, base);
+      target->loadAddr(RegAddr, off, base);
+   }
+   else{
+      /* the base is a constant offset from the frame or
+         global pointer, so it is formed after the index
+         instead of being saved across it */
+      cGen(index); // index -> acc
+      off = _varOffset(info, &base);
+      target->loadAddr(RegAddr, off, base);
+      target->scale(RegAcc);
+      target->add(RegAddr, RegAddr, RegAcc);
+      target->load(RegAcc, 0, RegAddr);
+   }
+}
+
 /* Procedure genExp generates code at an expression node */
 static void genExp(TreeNode *tree)
 {
-   int loc;
    TreeNode *p1, *p2;
+   TokenType op;
+   if (tree->vnFlags & VN_REUSE)
+   {
+      target->comment("reused value");
+      target->move(RegAcc, RegValue + tree->vnReg);
+      if (tree->vnFlags & VN_REUSEADDR)
+         target->move(RegAddr, RegValue + tree->vnAddrReg);
+      return;
+   }
    switch (tree->kind.exp)
    {
    case OpK:
       {
-      emitComment("OpK");
-      cGen(tree->child[0]);
-      emitInst3param("subu", "$sp", "$sp", "4");
-      emitInst2param("sw", "$v0", "0($sp)");     
-      //emitInst2param("move", "$t1", "$v0");
-      cGen(tree->child[1]);
-      emitInst2param("lw", "$t1", "0($sp)");     
-      emitInst3param("addu", "$sp", "$sp", "4");
-
-      switch(tree->attr.op)
+      target->comment("OpK");
+      op = tree->attr.op;
+      p1 = tree->child[0];
+      p2 = tree->child[1];
+      /* keep a constant operand on the right where it can become an immediate */
+      if (_isConst(p1) && !_isConst(p2) && _swapOp(op) != -1)
       {
-         case PLUS:
-         emitInst3param("add", "$v0", "$t1", "$v0"); 
-         break;
-         case MINUS:
-         emitInst3param("sub", "$v0", "$t1", "$v0"); 
-         break;
-         case TIMES:
-         emitInst3param("mul", "$v0", "$t1", "$v0"); 
-         break;
-         case OVER:
-         emitInst3param("div", "$v0", "$t1", "$v0"); 
-         break;
-         case LTET:
-         emitInst3param("sle", "$v0", "$t1", "$v0");       
-         break;
-         case LT:
-         emitInst3param("slt", "$v0", "$t1", "$v0");
-         break;
-         case GTET:
-         emitInst3param("sge", "$v0", "$t1", "$v0");
-         break;
-         case GT:
-         emitInst3param("sgt", "$v0", "$t1", "$v0");
-         break;
-         case EQ:
-         emitInst3param("seq", "$v0", "$t1", "$v0");
-         break;
-         case NOTEQ:
-         emitInst3param("sne", "$v0", "$t1", "$v0");
-         break;         
-      } 
+         p1 = tree->child[1];
+         p2 = tree->child[0];
+         op = _swapOp(op);
+      }
+      cGen(p1);
+      if (_isConst(p2))
+      {
+         if (target->opConst(op, p2->val))
+            break;
+         target->move(RegSecond, RegAcc);
+         cGen(p2);
+      }
+      else
+      {
+         _push(RegAcc);
+         reportSpill(FALSE);
+         cGen(p2);
+         _pop(RegSecond);
+      }
+      target->op(op);
       }
       break; /* OpK */
    
    case ConstK:
-   {
-      char val[10]={0};
-      emitComment("ConstK");
-      sprintf(val, "%d", tree->val);
-      emitInst2param("li", "$v0", val);
-   } 
+      target->comment("ConstK");
+      target->loadConst(RegAcc, tree->val);
       break; /* ConstK */
    
    case IdK:
    {
-      char offset[10]={0};
-      emitComment("IdK");
+      SymbolInfo info = tree->info;
+      Reg base;
+      int off;
+      target->comment("IdK");
       if(tree->child[0])
+         genElement(tree);
+      else if(info->isArray && info->decKind != ParamK)
       {
-         if(!(tree->info->isGlobal)){
-            sprintf(offset, "%d($fp)",tree->info->memloc);
-            emitInst2param("lw", "$v0", offset);
-            emitInst2param("la", "$v1", offset);
-
-            emitInst3param("subu", "$sp", "$sp", "$8");
-             emitInst2param("sd", "$v1", "0($sp)");
-             cGen(tree->child[0]); // index -> $v0
-             emitInst2param("ld", "$v1","0($sp)" );
-             emitInst3param("addu", "$sp", "$sp", "$8");
-
-             emitInst3param("mulou", "$v0", "$v0", "4");
-             
-             emitInst3param("add", "$v1", "$v1", "$v0");
-             emitInst2param("lw", "$v0", "0($v1)");
-            //emitInst2param("li", "$t0", "4");
-            //emitInst3param("add", "$t0", "$t0", "4");
-            //emitInst2param("move", "$v1", "$t0");
-            //emitInst2param("lw", "$v0", "0($v1)");
-         }
-         else{
-            sprintf(offset, "%d($gp)",tree->info->memloc);
-            emitInst2param("lw", "$v0", offset);
-            emitInst2param("la", "$v1", offset);
-
-            sprintf(offset, "%d($gp)",(gsize+4));
-            emitInst3param("subu", "$sp", "$sp", "$8");
-            emitInst2param("sd", "$v1", offset);
-            cGen(tree->child[0]); // index -> $v0
-            emitInst2param("ld", "$v1",offset);
-            emitInst3param("addu", "$sp", "$sp", "$8");
-
-             sprintf(offset, "%d",tree->info->ArraySize-1);
-              emitInst3param("addu", "$t0", "$0", offset);
-              emitInst3param("subu", "$t0", "$t0", "$v0");
-              emitInst3param("mulou", "$t0", "$t0", "4");
-             
-              emitInst3param("sub", "$v1", "$v1", "$t0");
-              emitInst2param("lw", "$v0", "0($v1)");            
-         }
+         /* an array argument passes the address of element 0 */
+         off = _varOffset(info, &base);
+         target->loadAddr(RegAcc, off, base);
+      }
+      else if(info->argReg >= 0)
+      {
+         /* parameters kept in registers are never assigned */
+         target->move(RegAcc, RegArg + info->argReg);
       }
       else
       {
-         if(!(tree->info->isGlobal))
-         {
-               sprintf(offset, "%d($fp)",tree->info->memloc);
-               emitInst2param("lw", "$v0", offset);
-               emitInst2param("la", "$v1", offset);
-
-         } else {
-            sprintf(offset, "%d($gp)",tree->info->memloc);
-            emitInst2param("lw", "$v0", offset);
-            emitInst2param("la", "$v1", offset);
-         }
+         off = _varOffset(info, &base);
+         target->load(RegAcc, off, base);
+         target->loadAddr(RegAddr, off, base);
       }
    }
       break; /* IdK */
@@ -265,57 +486,63 @@ static void genExp(TreeNode *tree)
    case FuncCallK:
       {
          TreeNode *par;
-         int parcount=0;
-         char siz[10]={0};
-         emitComment("FuncCallK");
+         int parcount=0, lastCall=-1, i, size=0;
+         int nregs = target->numArgRegs;
+         target->comment("FuncCallK");
+         /* argument i goes to word i of the argument area; an
+            argument in a register is spilled there only if a
+            later argument contains a call that would overwrite it */
          for(par=tree->child[0];par!=NULL;par=par->sibling)
          {
-            char param[10]={0};
-             //emitInst3param("subu", "$sp", "$sp", "$4");
-             genExp(par);
-             //emitInst2param("sw", "$v0", "0($sp)");
-             sprintf(param, "$a%d", parcount);
-             emitInst2param("move", param, "$v0");
-             parcount++;
+            if(_containsCall(par))
+               lastCall = parcount;
+            parcount++;
+         }
+         if(parcount > nregs || lastCall > 0)
+         {
+            size = parcount * target->wordSize;
+            target->addConst(RegSp, RegSp, -size);
+         }
+         for(par=tree->child[0],i=0;par!=NULL;par=par->sibling,i++)
+         {
+             /* an assignment leaves its value in RegAcc */
+             if(par->nodekind == StmtK)
+                genStmt(par);
+             else
+                genExp(par);
+             if(i < nregs && i >= lastCall)
+                target->move(RegArg + i, RegAcc);
+             else
+                target->store(RegAcc, i * target->wordSize, RegSp);
          }
-         emitInst1param("jal", tree->attr.name);
-         //if( parcount != 0 ){
-          //  sprintf(siz, "%d", parcount*4);
-          //  emitInst3param("addu", "$sp", "$sp", siz);
-         //}
+         for(i=0;i<lastCall && i<nregs;i++)
+            target->load(RegArg + i, i * target->wordSize, RegSp);
+         target->countCall(tree->site, tree->attr.name);
+         reportCall();
+         target->call(tree->attr.name);
+         if(size > 0)
+            target->addConst(RegSp, RegSp, size);
       }
       
       break; /* FuncCallK */
       
    case InputCallK:
-   {
-      char regi[10]={0};
-      // if( tree->child[0]->info->memloc < 0 )
-      //    sprintf(regi, "%d($fp)", tree->child[0]->info->memloc);
-      // else
-      //    sprintf(regi, "%d($gp)", tree->child[0]->info->memloc);
       cGen(tree->child[0]);
-      emitInst1param("jal", "RD_INT");
-      emitInst2param("sw", "$a0", "0($v1)"); //"sw", "$a0", "-4($fp)"
-   }
-         break; /* InputCallK */
-   
+      target->input();
+      break; /* InputCallK */
 
    case OutputCallK:
-   {
-      char regi[10]={0};
-      // if( tree->child[0]->info->memloc < 0 )
-      //    sprintf(regi, "%d($fp)", tree->child[0]->info->memloc);
-      // else
-      //    sprintf(regi, "%d($gp)", tree->child[0]->info->memloc);
       cGen(tree->child[0]);
-      emitInst2param("move", "$a0", "$v0");
-      emitInst1param("jal", "WR_INT");
+      target->output();
       break; /* OutputCallK */
-   }
+
    default:
       break;
    }
+   if (tree->vnFlags & VN_KEEP)
+      target->move(RegValue + tree->vnReg, RegAcc);
+   if (tree->vnFlags & VN_KEEPADDR)
+      target->move(RegValue + tree->vnAddrReg, RegAddr);
 } /* genExp */
 
 static int addedMemLoc = 0;
@@ -329,115 +556,120 @@ static void genDec(TreeNode *tree)
       {
       case FunctionK:
       {
-         char addedMem[10]={0};
-         char returnLocLab[10] = {0};
+         int savedRegs, i, leaf, labels;
+         int w = target->wordSize;
+         long firstInst = counters.instructions;
+         int firstLocal = addedMemLoc;
          TreeNode *par=NULL;
-         returnLocLabel = _getLabelNumber();
-         sprintf(returnLocLab, "RET%d", returnLocLabel);
 
-         emitComment("#Function Dec");
-         emitLabel(tree->attr.name);
+         if (CodeReport)
+            reportFunction(tree->attr.name);
+
+         target->comment("#Function Dec");
+         target->funcLabel(tree->attr.name);
 
-         emitComment("\t#Save registers");
-         emitInst3param("subu", "$sp", "$sp", "24"); //Stack frame is 32 bytes long
-         emitInst2param("sw", "$ra", "0($sp)");     //Save retrun address
-         emitInst2param("sw", "$fp", "4($sp)");     //Save frame pointer(control link)
-         emitInst3param("addu", "$fp", "$sp", "4"); //Set up frame pointer
+         /* --incremental: the code of an unchanged function
+            is copied from the last compilation */
+         labels = incrSplice(tree, labelNum);
+         if (labels >= 0)
+         {
+            labelNum += labels;
+            statFunction(tree->attr.name, counters.instructions - firstInst);
+            break;
+         }
+         incrBegin(tree, labelNum);
+         returnLocLabel = _getLabelNumber();
+
+         target->comment("\t#Save registers");
+         /* value registers holding numbered values are callee-saved */
+         savedRegs = _vnRegsUsed(tree->child[1]);
+         if (savedRegs > 0)
+         {
+            target->addConst(RegSp, RegSp, -savedRegs * w);
+            for (i = 0; i < savedRegs; i++)
+               target->store(RegValue + i, i * w, RegSp);
+         }
+         /* frame link: return address, control link and
+            the save slots of the argument registers */
+         target->addConst(RegSp, RegSp, -_units(FRAME_LINK_SIZE));
+         target->store(RegRa, 0, RegSp);
+         target->store(RegFp, w, RegSp);
+         target->addConst(RegFp, RegSp, w);
          
-         emitComment("");
+         target->comment("");
 
+         frameExtra = 4*savedRegs;
          paramNum = 0;
          paramCount = 0;
+         /* a leaf function reads its register parameters
+            in place unless it assigns to them */
+         leaf = !_containsCall(tree->child[1]);
          for(par=tree->child[0];par!=NULL;par=par->sibling)
+         {
+            if(leaf && paramCount < target->numArgRegs &&
+               !_isAssigned(tree->child[1], par->info))
+               par->info->argReg = paramCount;
             paramCount++;
+         }
          
          cGen(tree->child[0]); // Parameter decl.
          cGen(tree->child[1]); // Compound Stmt.
 
-         /* print single integer
-         emitInst2param("la", "$a0", "10");
-         emitInst1param("jal", "WR_INT"); */
-
-         emitLabel(returnLocLab);
-         //sprintf(addedMem, "%d", addedMemLoc);
-         //emitInst3param("addu", "$sp", "$sp", addedMem);
-         emitInst2param("move", "$sp", "$fp");
-         emitInst3param("subu", "$sp", "$sp", "4");
-         emitComment("");
-         emitComment("\t#Restore registers");
-         emitInst2param("lw", "$ra", "0($sp)");     // Restore return address
-         emitInst2param("lw", "$fp", "4($sp)");     // Restore frame pointer
-         emitInst3param("addu", "$sp", "$sp", "24"); // Pop stack frame
-         emitInst1param("jr", "$ra");                 // Return to caller
+         /* the prologue is on the line of the header, the
+            epilogue on that of the closing brace */
+         if (tree->child[1] != NULL && tree->child[1]->lineno > 0)
+            target->line(sourceLine = tree->child[1]->lineno);
+         target->label(returnLocLabel);
+         target->move(RegSp, RegFp);
+         target->addConst(RegSp, RegSp, -w);
+         target->comment("");
+         target->comment("\t#Restore registers");
+         target->load(RegRa, 0, RegSp);   // Restore return address
+         target->load(RegFp, w, RegSp);   // Restore frame pointer
+         target->addConst(RegSp, RegSp, _units(FRAME_LINK_SIZE)); // Pop stack frame
+         if (savedRegs > 0)
+         {
+            for (i = 0; i < savedRegs; i++)
+               target->load(RegValue + i, i * w, RegSp);
+            target->addConst(RegSp, RegSp, savedRegs * w);
+         }
+         target->ret();                   // Return to caller
+         _genCold();
+         incrEnd(tree, labelNum);
+         reportFrame(FRAME_LINK_SIZE + 4*savedRegs + addedMemLoc - firstLocal);
+         reportFunction(NULL);
+         statFunction(tree->attr.name, counters.instructions - firstInst);
       }
         break;
       
 
       case SimpleK:
-      {
-         //char regi[10]={0};
-         //sprintf(regi, "%d", tree->info->memloc);
          if( tree->info->memloc < 0 ){
             /* local variable */
             addedMemLoc += 4;
-            // emitInst2param("sw", "$0", regi);
-            emitInst3param("subu", "$sp", "$sp", "4");
+            target->addConst(RegSp, RegSp, -_units(4));
          } else {
             /* global variable */
          }
-      }
          break;
       case ArrayK:
-      {
-         char s[10]={0};
-         int size;
-         size = 4 * tree->val;
          if( tree->info->memloc < 0 ){
             /* local variable */
-            addedMemLoc += size;
-            sprintf(s, "%d", size);
-            emitInst3param("subu", "$sp", "$sp", s);
+            addedMemLoc += 4 * tree->val;
+            target->addConst(RegSp, RegSp, -_units(4 * tree->val));
          } else {
             /* global variable */
          }
-      }
          break;
       
-      case ParamK:{
-         char args[10]={0};
-         char dest[10]={0};
-         emitComment("#PARAM Dec");
-         sprintf(args, "$a%d", paramNum);
-         sprintf(dest, "%d($fp)", (paramCount*4)-(paramNum*4));
-         emitInst2param("sw", args, dest);     //Save arg0
-         //cGen(tree->sibling);
+      case ParamK:
+         target->comment("#PARAM Dec");
+         /* stack arguments are already in the caller's area */
+         if(paramNum < target->numArgRegs && tree->info->argReg < 0)
+            target->store(RegArg + paramNum, _units(tree->info->memloc), RegFp);
          paramNum++;
          break;
-      }
-/*         TreeNode *param;
-         for(param=tree; param!=NULL; param= param->next)
-         {
-               switch(param->expType)
-               {
-                  case Integer:
-                  declsize=4;
-                  break;
-                  case Array:
-                  declsize=4;
-               }
-            
 
-         }
-         int base = 8;
-         char regi[10]={0};
-         char pos[10] = {0};
-         sprintf(regi, "$a%d", paramCount);
-         sprintf(pos, "%d($fp)", base+tree->info->memloc);
-         emitInst2param("sw", regi, pos);
-         paramCount++;
-         break;
-      
-*/
       default:
          break;
       }
@@ -451,6 +683,11 @@ static void cGen(TreeNode *tree)
 {
    if (tree != NULL)
    {
+      /* the code a node emits after its children
+         belongs to its own line again */
+      int saved = sourceLine;
+      if (tree->lineno > 0)
+         target->line(sourceLine = tree->lineno);
       switch (tree->nodekind)
       {
       case StmtK:
@@ -465,6 +702,8 @@ static void cGen(TreeNode *tree)
       default:
          break;
       }
+      if (sourceLine != saved)
+         target->line(sourceLine = saved);
       cGen(tree->sibling);
    }
 }
@@ -472,58 +711,29 @@ static void cGen(TreeNode *tree)
 /**********************************************/
 /* the primary function of the code generator */
 /**********************************************/
-/* Procedure codeGen generates code to a code
- * file by traversal of the syntax tree. The
+/* Procedure codeGen generates code for target to a
+ * code file by traversal of the syntax tree. The
  * second parameter (codefile) is the file name
  * of the code file, and is used to print the
  * file name as a comment in the code file
  */
-void codeGen(TreeNode *syntaxTree, char *codefile)
+void codeGen(TreeNode *syntaxTree, char *codefile, Target *t)
 {
-   char *s = malloc(strlen(codefile) + 7);
-   char si[10]={0};         
-   TreeNode* t;
-   
-   strcpy(s, "File: ");
-   strcat(s, codefile);
-   emitComment("C- Compilation to TM Code");
-   emitComment(s);
-   emitComment("##########################################");
-   
-   emitDirective(".data");
-   emitDataDec("inStr", ".asciiz", "\"Enter value for input instruction: \"");
-   emitDataDec("outStr", ".asciiz", "\"output instruction prints: \"");
-   emitDataDec("crlfz", ".ascii", "\"\\n\"");
-   emitDirective(".text");
-   emitDirective(".globl main\n");
-
-   emitInputOutputFuncs();
-
-   for(t=syntaxTree; t!=NULL;t=t->sibling)
-   {
-      if(t->info->memloc>0)
-      {
-         if(t->kind.dec==SimpleK)
-         {
-            gsize+=4;
-         }
-         else if(t->kind.dec == ArrayK)
-         {
-            gsize+=4*(t->val);
-         }  
-      }
-   }
-   
-   sprintf(si, "%d", gsize);
-   emitInst3param("subu", "$gp", "$gp", si);
-   emitInst3param("subu", "$sp", "$gp", "0");
-   emitInst3param("subu", "$fp", "$gp", "0");
-
+   TreeNode* p;
+   Reg base;
+
+   target = t;
+   target->begin(codefile);
+   /* the global area, in the order of the memlocs */
+   for(p=syntaxTree; p!=NULL;p=p->sibling)
+      if(p->kind.dec != FunctionK && p->info != NULL)
+         target->global(p->attr.name, _varOffset(p->info, &base),
+                        _units(4 * (p->info->isArray ? p->info->ArraySize : 1)));
    cGen(syntaxTree);
+   target->end();
 }
 
 int _getLabelNumber(){
-   static int labelNum = 0;
    return labelNum++;
 }
 int getdeclsize()
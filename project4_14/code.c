@@ -8,6 +8,8 @@
 
 #include "globals.h"
 #include "code.h"
+#include "stats.h"
+#include "report.h"
 
 /* TM location number for current instruction emission */
 static int emitLoc = 0;
@@ -36,6 +38,7 @@ void emitComment(char *c)
  */
 void emitRO(char *op, int r, int s, int t, char *c)
 {
+  counters.instructions++;
   fprintf(code, "%3d:  %5s  %d,%d,%d ", emitLoc++, op, r, s, t);
   if (TraceCode)
     fprintf(code, "\t%s", c);
@@ -54,6 +57,7 @@ void emitRO(char *op, int r, int s, int t, char *c)
  */
 void emitRM(char *op, int r, int d, int s, char *c)
 {
+  counters.instructions++;
   fprintf(code, "%3d:  %5s  %d,%d(%d) ", emitLoc++, op, r, d, s);
   if (TraceCode)
     fprintf(code, "\t%s", c);
@@ -104,6 +108,7 @@ void emitRestore(void)
  */
 void emitRM_Abs(char *op, int r, int a, char *c)
 {
+  counters.instructions++;
   fprintf(code, "%3d:  %5s  %d,%d(%d) ",
           emitLoc, op, r, a - (emitLoc + 1), pc);
   ++emitLoc;
@@ -115,6 +120,7 @@ void emitRM_Abs(char *op, int r, int a, char *c)
 } /* emitRM_Abs */
 
 void emitLabel(char *lab){
+  reportLabel();
   fprintf(code, "%s:\n", lab);
 }
 
@@ -126,71 +132,300 @@ void emitDataDec(char* name, char* type, char* data){
   fprintf(code, "%s:\t%s\t%s\n", name, type, data);
 }
 
+/* The I/O runtime buffers both directions: WR_INT
+ * formats the value into outBuf, which is printed
+ * with one syscall when it fills up and when main
+ * returns (OUT_FLUSH); RD_INT reads a line into inBuf
+ * with one syscall and parses the integers in it one
+ * at a time. A line longer than inBuf is read in
+ * pieces, and a number split between two of them is
+ * read on into the next. Like the code that calls them the
+ * routines may use $a0-$a3, $v0, $t0 and $t2 but
+ * preserve $v1, the address RD_INT's value goes to.
+ */
+#define OUT_BUF_SIZE 4096
+#define OUT_BUF_SLACK 128  /* room for a prompt and a line past the limit */
+#define IN_BUF_SIZE 1024
+
+static void _emitIOData(){
+  char s[16];
+  emitDirective(".data");
+  if (Prompts)
+  { emitDataDec("inStr", ".asciiz", "\"Enter value for input instruction: \"");
+    emitDataDec("outStr", ".asciiz", "\"output instruction prints: \"");
+  }
+  emitDirective(".align 2");
+  emitDataDec("outPos", ".word", "0");
+  emitDataDec("inPos", ".word", "0");
+  sprintf(s, "%d", OUT_BUF_SIZE + OUT_BUF_SLACK);
+  emitDataDec("outBuf", ".space", s);
+  sprintf(s, "%d", IN_BUF_SIZE);
+  emitDataDec("inBuf", ".space", s);
+  emitDataDec("digBuf", ".space", "12");
+  emitLabel("digEnd");
+  emitDirective(".text");
+}
+
+/* Procedure _emitAppendStr appends the string at
+ * label str to outBuf at $a1
+ */
+static void _emitAppendStr(char *str, char *loop, char *done){
+  emitInst2param("la", "$a3", str);
+  emitLabel(loop);
+  emitInst2param("lbu", "$t0", "0($a3)");
+  emitInst2param("beqz", "$t0", done);
+  emitInst2param("sb", "$t0", "0($a1)");
+  emitInst3param("addu", "$a1", "$a1", "1");
+  emitInst3param("addu", "$a3", "$a3", "1");
+  emitInst1param("b", loop);
+  emitLabel(done);
+}
+
+/* Procedure _emitOutEnd stores the end of the output
+ * at $a1 back to outPos and leaves outBuf's length
+ * in $a2
+ */
+static void _emitOutEnd(){
+  emitInst2param("la", "$t0", "outBuf");
+  emitInst3param("subu", "$a2", "$a1", "$t0");
+  emitInst2param("sw", "$a2", "outPos");
+}
+
+/* Procedure _emitCallFlush calls OUT_FLUSH from a
+ * runtime routine, keeping its return address in $t2
+ */
+static void _emitCallFlush(){
+  emitInst2param("move", "$t2", "$ra");
+  emitInst1param("jal", "OUT_FLUSH");
+  emitInst2param("move", "$ra", "$t2");
+}
+
+static void _emitFlushFunc(){
+  emitLabel("OUT_FLUSH");
+  emitInst2param("la", "$a0", "outBuf");
+  emitInst2param("lw", "$a1", "outPos");
+  emitInst2param("beqz", "$a1", "OUT_FLUSH_RET");
+  emitInst3param("addu", "$a1", "$a0", "$a1");
+  emitInst2param("sb", "$0", "0($a1)");
+  emitInst3param("addi", "$v0", "$0", "4");
+  emitInst0param("syscall");
+  emitInst2param("sw", "$0", "outPos");
+  emitLabel("OUT_FLUSH_RET");
+  emitInst1param("jr", "$ra");
+}
+
 void _emitWriteIntFunc(){
+  char s[16];
   emitLabel("WR_INT");
-  //emitInst2param("la", "$a0", "outStr");
-  //emitInst1param("jal", "WR_STR");
-  /* Print Input message */
-  emitInst2param("move", "$t0", "$a0");
-  emitInst2param("la", "$a0", "outStr");
-  emitInst3param("addi", "$v0", "$0", "4");
-  fprintf(code, "\t%s\n", "syscall");
-  emitInst2param("move", "$a0", "$t0");
-  /***********************/
-  fprintf(code, "\t%s\t%s,%s,%d ", "addi", "$v0", "$0", 1);
-  emitComment("Print integer");
-  fprintf(code, "\t%s\n", "syscall");
-  emitInst2param("la", "$a0", "crlfz");
-  emitInst3param("addi", "$v0", "$0", "4");
-  fprintf(code, "\t%s\n", "syscall");
-  fprintf(code, "\t%s\t%s ", "jr", "$ra");
-  emitComment("Return");
+  emitInst2param("la", "$a1", "outBuf");
+  emitInst2param("lw", "$a2", "outPos");
+  emitInst3param("addu", "$a1", "$a1", "$a2");
+  if (Prompts)
+    _emitAppendStr("outStr", "WR_INT_PREFIX", "WR_INT_VALUE");
+  emitInst2param("bgez", "$a0", "WR_INT_ABS");
+  emitInst2param("li", "$t0", "45");
+  emitInst2param("sb", "$t0", "0($a1)");
+  emitInst3param("addu", "$a1", "$a1", "1");
+  emitInst2param("negu", "$a0", "$a0");
+  emitLabel("WR_INT_ABS");
+  /* the digits go backwards into digBuf; dividing
+     unsigned handles -2^31 */
+  emitInst2param("la", "$a3", "digEnd");
+  emitInst2param("li", "$t2", "10");
+  emitLabel("WR_INT_DIGIT");
+  emitInst2param("divu", "$a0", "$t2");
+  emitInst1param("mfhi", "$t0");
+  emitInst1param("mflo", "$a0");
+  emitInst3param("addu", "$t0", "$t0", "48");
+  emitInst3param("subu", "$a3", "$a3", "1");
+  emitInst2param("sb", "$t0", "0($a3)");
+  emitInst2param("bnez", "$a0", "WR_INT_DIGIT");
+  emitInst2param("la", "$a2", "digEnd");
+  emitLabel("WR_INT_COPY");
+  emitInst2param("lbu", "$t0", "0($a3)");
+  emitInst2param("sb", "$t0", "0($a1)");
+  emitInst3param("addu", "$a1", "$a1", "1");
+  emitInst3param("addu", "$a3", "$a3", "1");
+  emitInst3param("bne", "$a3", "$a2", "WR_INT_COPY");
+  emitInst2param("li", "$t0", "10");
+  emitInst2param("sb", "$t0", "0($a1)");
+  emitInst3param("addu", "$a1", "$a1", "1");
+  _emitOutEnd();
+  sprintf(s, "%d", OUT_BUF_SIZE);
+  emitInst3param("bge", "$a2", s, "OUT_FLUSH");
+  emitInst1param("jr", "$ra");
 }
 
 void _emitWriteStrFunc(){
   emitLabel("WR_STR");
   emitInst3param("addi", "$v0", "$0", "4");
-  fprintf(code, "\t%s\n", "syscall");
+  emitInst0param("syscall");
   emitInst1param("jr", "$ra");
 }
 
+/* Procedure _emitReadLine reads the next line, or
+ * the next IN_BUF_SIZE - 1 bytes of it, into inBuf;
+ * $a1 points to its first byte, which is in $t0 (0
+ * at the end of the input)
+ */
+static void _emitReadLine(){
+  char s[16];
+  emitInst2param("la", "$a0", "inBuf");
+  sprintf(s, "%d", IN_BUF_SIZE);
+  emitInst2param("li", "$a1", s);
+  emitComment("Read a line");
+  emitInst3param("addi", "$v0", "$0", "8");
+  emitInst0param("syscall");
+  emitInst2param("la", "$a1", "inBuf");
+  emitInst2param("lbu", "$t0", "0($a1)");
+}
+
 void _emitReadFunc(){
+  char s[16];
   emitLabel("RD_INT");
-  /* Print Input message */
-  emitInst2param("la", "$a0", "inStr");
-  emitInst3param("addi", "$v0", "$0", "4");
-  fprintf(code, "\t%s\n", "syscall");
-  /***********************/
-  fprintf(code, "\t%s\t%s,%s,%d ", "addi", "$v0", "$0", 5);
-  emitComment("Read integer");
-  fprintf(code, "\t%s\n", "syscall");
-  fprintf(code, "\t%s\t%s,%s,%s ", "add", "$a0", "$v0", "$0");
-  emitComment("Move Integer into $a0");
-  fprintf(code, "\t%s\t%s ", "jr", "$ra");
-  emitComment("Return");
+  if (Prompts)
+  { emitInst2param("la", "$a1", "outBuf");
+    emitInst2param("lw", "$a2", "outPos");
+    emitInst3param("addu", "$a1", "$a1", "$a2");
+    _emitAppendStr("inStr", "RD_INT_PROMPT", "RD_INT_PROMPTED");
+    _emitOutEnd();
+    sprintf(s, "%d", OUT_BUF_SIZE);
+    emitInst3param("blt", "$a2", s, "RD_INT_LINE");
+    _emitCallFlush();
+    emitLabel("RD_INT_LINE");
+  }
+  emitInst2param("la", "$a1", "inBuf");
+  emitInst2param("lw", "$a2", "inPos");
+  emitInst3param("addu", "$a1", "$a1", "$a2");
+  emitLabel("RD_INT_SKIP");
+  emitInst2param("lbu", "$t0", "0($a1)");
+  emitInst2param("bnez", "$t0", "RD_INT_SPACE");
+  /* the line is used up: print what is buffered (the
+     prompt) and read the next line */
+  _emitCallFlush();
+  _emitReadLine();
+  /* nothing left: the value is 0 */
+  emitInst2param("li", "$a0", "0");
+  emitInst2param("beqz", "$t0", "RD_INT_END");
+  emitLabel("RD_INT_SPACE");
+  emitInst3param("bgt", "$t0", "32", "RD_INT_SIGN");
+  emitInst3param("addu", "$a1", "$a1", "1");
+  emitInst1param("b", "RD_INT_SKIP");
+  emitLabel("RD_INT_SIGN");
+  emitInst2param("li", "$a3", "0");
+  emitInst3param("bne", "$t0", "45", "RD_INT_FIRST");
+  emitInst2param("li", "$a3", "1");
+  emitInst3param("addu", "$a1", "$a1", "1");
+  emitInst2param("lbu", "$t0", "0($a1)");
+  emitInst2param("bnez", "$t0", "RD_INT_FIRST");
+  _emitReadLine();
+  emitLabel("RD_INT_FIRST");
+  emitInst3param("subu", "$t2", "$t0", "48");
+  emitInst3param("sltu", "$t2", "$t2", "10");
+  emitInst2param("beqz", "$t2", "RD_INT_BAD");
+  emitInst2param("li", "$a0", "0");
+  emitLabel("RD_INT_DIGIT");
+  emitInst3param("subu", "$t0", "$t0", "48");
+  emitInst3param("sltu", "$t2", "$t0", "10");
+  emitInst2param("beqz", "$t2", "RD_INT_MORE");
+  emitInst3param("mul", "$a0", "$a0", "10");
+  emitInst3param("addu", "$a0", "$a0", "$t0");
+  emitInst3param("addu", "$a1", "$a1", "1");
+  emitInst2param("lbu", "$t0", "0($a1)");
+  emitInst1param("b", "RD_INT_DIGIT");
+  emitLabel("RD_INT_MORE");
+  /* the end of inBuf (a 0 byte) is not the end of the
+     number: read on in the next piece of the line */
+  emitInst3param("bne", "$t0", "-48", "RD_INT_NEG");
+  emitInst2param("move", "$a2", "$a0");
+  _emitReadLine();
+  emitInst2param("move", "$a0", "$a2");
+  emitInst2param("bnez", "$t0", "RD_INT_DIGIT");
+  emitLabel("RD_INT_NEG");
+  emitInst2param("beqz", "$a3", "RD_INT_END");
+  emitInst2param("negu", "$a0", "$a0");
+  emitInst1param("b", "RD_INT_END");
+  /* not a number: skip the token, so the next input
+     does not stop at it again, and read 0 */
+  emitLabel("RD_INT_BAD");
+  emitInst3param("bgt", "$t0", "32", "RD_INT_BAD_NEXT");
+  emitInst2param("bnez", "$t0", "RD_INT_ZERO");
+  _emitReadLine();
+  emitInst2param("bnez", "$t0", "RD_INT_BAD");
+  emitInst1param("b", "RD_INT_ZERO");
+  emitLabel("RD_INT_BAD_NEXT");
+  emitInst3param("addu", "$a1", "$a1", "1");
+  emitInst2param("lbu", "$t0", "0($a1)");
+  emitInst1param("b", "RD_INT_BAD");
+  emitLabel("RD_INT_ZERO");
+  emitInst2param("li", "$a0", "0");
+  emitLabel("RD_INT_END");
+  emitInst2param("la", "$t0", "inBuf");
+  emitInst3param("subu", "$a2", "$a1", "$t0");
+  emitInst2param("sw", "$a2", "inPos");
+  emitInst1param("jr", "$ra");
 }
 
 void emitInputOutputFuncs(){
+  _emitIOData();
   emitComment("##########################################");
-  emitComment("FUNCTIONS: WR_STR, WR_INT, RD_INT");
+  emitComment("FUNCTIONS: WR_STR, WR_INT, RD_INT, OUT_FLUSH");
   emitComment("WR_STR: print string");
-  emitComment("WR_INT: print single integer");
+  emitComment("WR_INT: buffer single integer");
   emitComment("RD_INT: read single integer");
+  emitComment("OUT_FLUSH: print the buffered output");
   _emitWriteStrFunc();
   _emitWriteIntFunc();
   _emitReadFunc();
+  _emitFlushFunc();
   emitComment("##########################################\n");
 }
 
 
+/* the source line and function of the instructions
+ * emitted next, and the number of the next one as tm
+ * counts them (see emitSourceLine in code.h)
+ */
+static int sourceLine = 0;
+static int commentedLine = 0;
+static char *sourceFunc = "";
+static int instNum = 0;
+
+void emitSourceLine(int lineno){
+  sourceLine = lineno;
+}
+
+void emitSourceFunc(char *name){
+  sourceFunc = name;
+}
+
+static void _mapInst(char *op, int operands){
+  if (LineComments && sourceLine != commentedLine && sourceLine > 0)
+    fprintf(code, "# line %d\n", sourceLine);
+  commentedLine = sourceLine;
+  if (lineMap != NULL)
+    fprintf(lineMap, "%d %d %s\n", instNum, sourceLine, sourceFunc);
+  instNum++;
+  counters.instructions++;
+  reportInst(op, operands);
+}
+
 void emitInst3param(char* op, char* r, char* s, char* t){
+  _mapInst(op, 3);
   fprintf(code, "\t%s\t%s,%s,%s\n", op, r, s, t);
 }
 
 void emitInst2param(char* op, char* r, char* s){
+  _mapInst(op, 2);
   fprintf(code, "\t%s\t%s,%s\n", op, r, s);
 }
 
 void emitInst1param(char* op, char* r){
+  _mapInst(op, 1);
   fprintf(code, "\t%s\t%s\n", op, r);
+}
+
+void emitInst0param(char* op){
+  _mapInst(op, 0);
+  fprintf(code, "\t%s\n", op);
 }
\ No newline at end of file
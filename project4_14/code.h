@@ -90,5 +90,17 @@ void emitLabel(char *lab);
 void emitInst3param(char* op, char* r, char* s, char* t);
 void emitInst2param(char* op, char* r, char* s);
 void emitInst1param(char* op, char* r);
+void emitInst0param(char* op);
+
+/* Procedures emitSourceLine and emitSourceFunc set
+ * the source line and the function of the MIPS
+ * instructions emitted next. With --line-comments a
+ * "# line N" comment precedes each change of line,
+ * and with --line-map every instruction writes
+ * "number line function" to lineMap, numbered from 0
+ * in the order tm loads them (line 0: the runtime)
+ */
+void emitSourceLine(int lineno);
+void emitSourceFunc(char *name);
 
 #endif
@@ -46,6 +46,7 @@ typedef int TokenType;
 extern FILE* source; /* source code text file */
 extern FILE* listing; /* listing output text file */
 extern FILE* code; /* code text file for TM simulator */
+extern FILE* lineMap; /* instruction to source line table, or NULL */
 
 extern int lineno; /* source line number for listing */
 
@@ -75,8 +76,28 @@ typedef struct treeNode
      int isArray;
      ExpType expType; /* for type checking of exps */
      struct SymbolInfoRec *info;
+     int vnFlags;   /* VN_* bits set by numberValues */
+     int vnReg;     /* $s register holding this value */
+     int vnAddrReg; /* $s register holding this array element's address */
+     int site;      /* if, while or call site in its function, or -1 */
+     int pgoFlags;  /* PGO_* bits set by applyProfile */
    } TreeNode;
 
+/* vnFlags tell the code generator what to do with
+ * vnReg / vnAddrReg of an expression node
+ */
+#define VN_KEEP      1 /* copy the computed value into vnReg */
+#define VN_REUSE     2 /* the value is already in vnReg */
+#define VN_KEEPADDR  4 /* copy the computed address into vnAddrReg */
+#define VN_REUSEADDR 8 /* the address is already in vnAddrReg */
+
+/* pgoFlags tell the code generator how to lay out an
+ * if or while statement the profile found skewed
+ */
+#define PGO_COLD_THEN 1 /* the then part goes after the function */
+#define PGO_COLD_ELSE 2 /* the else part goes after the function */
+#define PGO_ROTATE    4 /* the loop tests at the bottom */
+
 /**************************************************/
 /***********   Flags for tracing       ************/
 /**************************************************/
@@ -104,11 +125,46 @@ extern int TraceParse;
  */
 extern int TraceAnalyze;
 
+/* TraceOptimize = TRUE causes the syntax tree
+ * optimizations to report what they changed
+ * to the listing file
+ */
+extern int TraceOptimize;
+
 /* TraceCode = TRUE causes comments to be written
  * to the TM code file as code is generated
  */
 extern int TraceCode;
 
+/* Prompts = TRUE causes the programs to print the
+ * input prompt and the prefix of output values
+ * (cleared by --no-prompts)
+ */
+extern int Prompts;
+
+/* LineComments = TRUE writes a "# line N" comment to
+ * the MIPS code before the instructions of each new
+ * source line (set by --line-comments)
+ */
+extern int LineComments;
+
+/* Profiling = PROFILE_COUNTS makes the MIPS code count
+ * the calls of each function and of each call site,
+ * and the runs of each if and while test and branch,
+ * and print the counts when main returns (--pg);
+ * PROFILE_CYCLES also adds up the cycles spent in
+ * each function, read with rdhwr (--pg-cycles)
+ */
+#define PROFILE_COUNTS 1
+#define PROFILE_CYCLES 2
+extern int Profiling;
+
+/* CodeReport = TRUE makes the code generator record
+ * the instruction mix, frame, spills, calls and basic
+ * blocks of each function (--code-report, report.h)
+ */
+extern int CodeReport;
+
 /* Error = TRUE prevents further passes if an error occurs */
 extern int Error; 
 
@@ -0,0 +1,39 @@
+/****************************************************/
+/* File: image.h                                    */
+/* Layout of the binary MIPS32 image written by     */
+/* mipsasm.c and loaded by tm                       */
+/****************************************************/
+
+#ifndef _IMAGE_H_
+#define _IMAGE_H_
+
+/* The image is a header of IMAGE_HEADER_WORDS 32-bit
+ * words, then the text words, the data bytes, the
+ * symbols (IMAGE_SYMBOL_WORDS words each) and the
+ * symbol names as NUL-terminated strings. Every word
+ * is little-endian.
+ *
+ *   word 0  IMAGE_MAGIC
+ *   word 1  entry address (main)
+ *   word 2  text base address
+ *   word 3  text size in bytes
+ *   word 4  data base address
+ *   word 5  data size in bytes
+ *   word 6  number of symbols
+ *   word 7  size of the names in bytes
+ *
+ * a symbol is: offset of its name, address, flags
+ */
+#define IMAGE_MAGIC 0x31494d43u   /* "CMI1" */
+#define IMAGE_HEADER_WORDS 8
+#define IMAGE_SYMBOL_WORDS 3
+
+/* symbol flags */
+#define IMAGE_SYM_TEXT 1   /* in the text segment */
+#define IMAGE_SYM_FUNC 2   /* a function: main or the target of a jal */
+
+/* segment addresses, as SPIM lays out a program */
+#define IMAGE_TEXT_BASE 0x00400000u
+#define IMAGE_DATA_BASE 0x10000000u
+
+#endif
@@ -0,0 +1,420 @@
+/****************************************************/
+/* File: incr.c                                     */
+/* Function-granular incremental compilation: the   */
+/* code of unchanged functions is copied from the   */
+/* last compilation; see incr.h                     */
+/****************************************************/
+
+#include <stdint.h>
+#include <ctype.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "globals.h"
+#include "util.h"
+#include "incr.h"
+#include "stats.h"
+
+/* bumped when the file format or the fingerprint changes */
+#define INCR_FORMAT "cminc 1"
+
+/* 64-bit FNV-1a */
+#define FNV_START 0xcbf29ce484222325ULL
+#define FNV_PRIME 0x100000001b3ULL
+
+/* a function of the last compilation or of this one */
+typedef struct FuncRec
+{
+  char *name;
+  TreeNode *node;    /* its declaration in this compilation */
+  int declared;      /* incrPrune has passed its declaration */
+  uint64_t sig;      /* fingerprint of its type and parameters */
+  uint64_t key;      /* fingerprint in this compilation */
+  uint64_t oldKey;   /* in the last one, if it has code */
+  TreeNode *body;    /* set aside: the code is copied */
+  char *code;        /* the code after the function label */
+  size_t size;
+  int firstLabel;    /* the L labels code uses */
+  int labels;
+  long insts;
+  int current;       /* code is this compilation's */
+  struct FuncRec *next;
+} Func;
+
+#define FUNC_SIZE 1021
+
+static Func *funcTab[FUNC_SIZE];
+static char *incrFile = NULL;
+static uint64_t envKey = FNV_START;
+
+/* the code file while incrBegin captures a function */
+static FILE *savedCode = NULL;
+static char *captured = NULL;
+static size_t capturedSize = 0;
+static long firstInst = 0;
+
+static uint64_t hashBytes(uint64_t h, const void *data, size_t size)
+{
+  const unsigned char *p = data;
+  size_t i;
+  for (i = 0; i < size; i++)
+    h = (h ^ p[i]) * FNV_PRIME;
+  return h;
+}
+
+static uint64_t hashInt(uint64_t h, int v)
+{
+  return hashBytes(h, &v, sizeof v);
+}
+
+static uint64_t hashName(uint64_t h, char *name)
+{
+  return hashBytes(h, name, strlen(name) + 1);
+}
+
+static int hasName(TreeNode *t)
+{
+  return t->nodekind == DeclarationK ||
+         (t->nodekind == ExpK && t->kind.exp != OpK && t->kind.exp != ConstK);
+}
+
+static uint64_t hashTree(uint64_t h, TreeNode *t);
+
+/* Function hashNode adds the node t and its children
+ * to h, without the line numbers; hashTree adds t and
+ * its siblings
+ */
+static uint64_t hashNode(uint64_t h, TreeNode *t)
+{
+  int i;
+  h = hashInt(h, t->nodekind);
+  h = hashInt(h, t->nodekind == StmtK ? (int)t->kind.stmt :
+                 t->nodekind == ExpK ? (int)t->kind.exp : (int)t->kind.dec);
+  if (hasName(t) && t->attr.name != NULL)
+    h = hashName(h, t->attr.name);
+  else if (t->nodekind == ExpK && t->kind.exp == OpK)
+    h = hashInt(h, t->attr.op);
+  h = hashInt(h, t->val);
+  h = hashInt(h, t->isArray);
+  if (t->nodekind == DeclarationK)
+    h = hashInt(h, t->expType);
+  for (i = 0; i < MAXCHILDREN; i++)
+    h = hashTree(h, t->child[i]);
+  return h;
+}
+
+static uint64_t hashTree(uint64_t h, TreeNode *t)
+{
+  for (; t != NULL; t = t->sibling)
+    h = hashNode(h, t);
+  /* the end of a list */
+  return hashInt(h, -1);
+}
+
+static int funcHash(char *name)
+{
+  unsigned int h = 0;
+  for (; *name != '\0'; name++)
+    h = (h << 4) + *name;
+  return h % FUNC_SIZE;
+}
+
+static Func *findFunc(char *name, int create)
+{
+  Func *p;
+  int h = funcHash(name);
+  for (p = funcTab[h]; p != NULL; p = p->next)
+    if (strcmp(p->name, name) == 0)
+      return p;
+  if (!create)
+    return NULL;
+  p = (Func *)allocate(AllocCodegen, sizeof(Func));
+  memset(p, 0, sizeof(Func));
+  p->name = copyString(name);
+  p->next = funcTab[h];
+  funcTab[h] = p;
+  return p;
+}
+
+void incrKey(const void *data, size_t size)
+{
+  envKey = hashBytes(envKey, data, size);
+}
+
+/* the file holds INCR_FORMAT, then for each function
+ * "name key firstLabel labels instructions size\n"
+ * and size bytes of code
+ */
+void incrOpen(char *file)
+{
+  struct stat st;
+  char *data, *p, *q, *end, line[1024];
+  unsigned long long key;
+  long insts;
+  unsigned long size;
+  int first, labels, len;
+  FILE *in;
+  Func *f;
+
+  incrFile = file;
+  /* a rebuilt compiler may generate other code */
+  if (stat("/proc/self/exe", &st) == 0)
+  {
+    incrKey(&st.st_size, sizeof st.st_size);
+    incrKey(&st.st_mtime, sizeof st.st_mtime);
+    incrKey(&st.st_ino, sizeof st.st_ino);
+  }
+  incrKey(INCR_FORMAT, sizeof INCR_FORMAT);
+  if ((in = fopen(file, "rb")) == NULL)
+    return;
+  if (fstat(fileno(in), &st) < 0 || st.st_size < (long)sizeof INCR_FORMAT)
+  {
+    fclose(in);
+    return;
+  }
+  data = (char *)allocate(AllocCodegen, st.st_size + 1);
+  data[st.st_size] = '\0';
+  if (fread(data, 1, st.st_size, in) != (size_t)st.st_size ||
+      memcmp(data, INCR_FORMAT "\n", sizeof INCR_FORMAT) != 0)
+    st.st_size = 0;
+  fclose(in);
+  end = data + st.st_size;
+  for (p = data + sizeof INCR_FORMAT; p < end; p += size)
+  {
+    /* the header is copied out: sscanf would scan to
+       the end of the data */
+    if ((q = memchr(p, '\n', end - p)) == NULL || q - p >= (long)sizeof line)
+      break;
+    memcpy(line, p, q - p);
+    line[q - p] = '\0';
+    /* a damaged entry ends the file */
+    if (sscanf(line, "%*s%n %llx %d %d %ld %lu", &len, &key, &first, &labels,
+               &insts, &size) != 5 || q + 1 + size > end)
+      break;
+    line[len] = '\0';
+    p = q + 1;
+    f = findFunc(line, TRUE);
+    f->oldKey = key;
+    f->firstLabel = first;
+    f->labels = labels;
+    f->insts = insts;
+    f->size = size;
+    f->code = (char *)allocate(AllocCodegen, size + 1);
+    memcpy(f->code, p, size);
+  }
+  release(data);
+}
+
+/* Function namesKey adds to h the signature of each
+ * function declared so far that the names in t (with
+ * its children, and siblings if all is TRUE) may
+ * refer to
+ */
+static uint64_t namesKey(uint64_t h, TreeNode *t, int all)
+{
+  Func *f;
+  int i;
+  for (; t != NULL; t = all ? t->sibling : NULL)
+  {
+    if (hasName(t) && t->attr.name != NULL &&
+        (f = findFunc(t->attr.name, FALSE)) != NULL && f->declared)
+    {
+      h = hashName(h, f->name);
+      h = hashBytes(h, &f->sig, sizeof f->sig);
+    }
+    for (i = 0; i < MAXCHILDREN; i++)
+      h = namesKey(h, t->child[i], TRUE);
+  }
+  return h;
+}
+
+/* Function stubBody returns the body the analysis
+ * sees for function f set aside: empty, or "return 0;"
+ * if f returns an int
+ */
+static TreeNode *stubBody(TreeNode *f)
+{
+  TreeNode *stub = newStmtNode(CompoundK), *ret;
+  stub->lineno = f->child[1]->lineno;
+  if ((int)f->expType != VOID)
+  {
+    ret = newStmtNode(ReturnK);
+    ret->lineno = stub->lineno;
+    ret->child[0] = newExpNode(ConstK);
+    ret->child[0]->lineno = stub->lineno;
+    stub->child[1] = ret;
+  }
+  return stub;
+}
+
+int incrPrune(TreeNode *syntaxTree)
+{
+  TreeNode *t;
+  uint64_t globals = FNV_START;
+  int functions = 0, reused = 0;
+  Func *f;
+
+  for (t = syntaxTree; t != NULL; t = t->sibling)
+  {
+    if (t->nodekind != DeclarationK)
+      continue;
+    if (t->kind.dec != FunctionK)
+    {
+      /* the global variables before a function decide
+         the addresses it uses */
+      globals = hashName(globals, t->attr.name);
+      globals = hashInt(globals, t->kind.dec);
+      globals = hashInt(globals, t->val);
+      globals = hashInt(globals, t->expType);
+      continue;
+    }
+    functions++;
+    f = findFunc(t->attr.name, TRUE);
+    /* a second declaration is an error the analysis reports */
+    if (f->declared)
+      continue;
+    f->node = t;
+    f->declared = TRUE;
+    f->sig = hashTree(hashInt(FNV_START, t->expType), t->child[0]);
+    f->key = hashBytes(envKey, &globals, sizeof globals);
+    f->key = hashNode(f->key, t);
+    f->key = namesKey(f->key, t, FALSE);
+    if (f->code == NULL || f->oldKey != f->key || t->child[1] == NULL)
+      continue;
+    f->body = t->child[1];
+    t->child[1] = stubBody(t);
+    reused++;
+  }
+  if (TraceAnalyze)
+    fprintf(listing, "The code of %d of %d functions is unchanged\n",
+            reused, functions);
+  return reused;
+}
+
+TreeNode *incrBody(TreeNode *f)
+{
+  Func *p;
+  if (incrFile == NULL || (p = findFunc(f->attr.name, FALSE)) == NULL ||
+      p->node != f || p->body == NULL)
+    return f->child[1];
+  return p->body;
+}
+
+/* Procedure renumber writes the code of f to out,
+ * its labels moved to start at firstLabel
+ */
+static void renumber(Func *f, int firstLabel, FILE *out)
+{
+  char *p = f->code, *end = f->code + f->size, *q, *last = p;
+  long n;
+  for (; p < end; p++)
+  {
+    if (*p != 'L' || !isdigit((unsigned char)p[1]) ||
+        (p > f->code && (isalnum((unsigned char)p[-1]) || p[-1] == '_')))
+      continue;
+    n = strtol(p + 1, &q, 10);
+    if (q < end && (isalnum((unsigned char)*q) || *q == '_'))
+      continue;
+    if (n < f->firstLabel || n >= f->firstLabel + f->labels)
+      continue;
+    fwrite(last, 1, p - last, out);
+    fprintf(out, "L%ld", n - f->firstLabel + firstLabel);
+    last = p = q;
+    p--;
+  }
+  fwrite(last, 1, end - last, out);
+}
+
+int incrSplice(TreeNode *f, int firstLabel)
+{
+  Func *p;
+  char *buf = NULL;
+  size_t size = 0;
+  FILE *out;
+  if (incrFile == NULL || (p = findFunc(f->attr.name, FALSE)) == NULL ||
+      p->node != f || p->body == NULL)
+    return -1;
+  if (firstLabel == p->firstLabel)
+    fwrite(p->code, 1, p->size, code);
+  else
+  {
+    /* the code is kept as it is written this time */
+    out = open_memstream(&buf, &size);
+    renumber(p, firstLabel, out);
+    fclose(out);
+    fwrite(buf, 1, size, code);
+    release(p->code);
+    p->code = (char *)allocate(AllocCodegen, size + 1);
+    memcpy(p->code, buf, size);
+    p->size = size;
+    p->firstLabel = firstLabel;
+    free(buf);
+  }
+  counters.instructions += p->insts;
+  p->current = TRUE;
+  return p->labels;
+}
+
+void incrBegin(TreeNode *f, int firstLabel)
+{
+  Func *p;
+  if (incrFile == NULL || (p = findFunc(f->attr.name, FALSE)) == NULL || p->node != f)
+    return;
+  savedCode = code;
+  code = open_memstream(&captured, &capturedSize);
+  firstInst = counters.instructions;
+  p->firstLabel = firstLabel;
+}
+
+void incrEnd(TreeNode *f, int nextLabel)
+{
+  Func *p;
+  if (savedCode == NULL)
+    return;
+  fclose(code);
+  code = savedCode;
+  savedCode = NULL;
+  fwrite(captured, 1, capturedSize, code);
+  p = findFunc(f->attr.name, FALSE);
+  if (p->code != NULL)
+    release(p->code);
+  p->code = (char *)allocate(AllocCodegen, capturedSize + 1);
+  memcpy(p->code, captured, capturedSize);
+  p->size = capturedSize;
+  p->labels = nextLabel - p->firstLabel;
+  p->insts = counters.instructions - firstInst;
+  p->current = TRUE;
+  free(captured);
+  captured = NULL;
+}
+
+void incrSave(void)
+{
+  char *tmp;
+  FILE *out;
+  Func *p;
+  int fd, h, ok = TRUE;
+  if (incrFile == NULL)
+    return;
+  tmp = (char *)allocate(AllocString, strlen(incrFile) + 8);
+  sprintf(tmp, "%s.XXXXXX", incrFile);
+  /* renamed into place whole */
+  if ((fd = mkstemp(tmp)) < 0)
+  {
+    release(tmp);
+    return;
+  }
+  fchmod(fd, 0644);
+  out = fdopen(fd, "wb");
+  fprintf(out, "%s\n", INCR_FORMAT);
+  for (h = 0; h < FUNC_SIZE; h++)
+    for (p = funcTab[h]; p != NULL; p = p->next)
+      if (p->current)
+      {
+        fprintf(out, "%s %016llx %d %d %ld %lu\n", p->name, (unsigned long long)p->key,
+                p->firstLabel, p->labels, p->insts, (unsigned long)p->size);
+        ok = ok && fwrite(p->code, 1, p->size, out) == p->size;
+      }
+  if (fclose(out) != 0 || !ok || rename(tmp, incrFile) != 0)
+    unlink(tmp);
+  release(tmp);
+}
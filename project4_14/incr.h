@@ -0,0 +1,55 @@
+/****************************************************/
+/* File: incr.h                                     */
+/* Function-granular incremental compilation        */
+/* (--incremental)                                  */
+/****************************************************/
+
+#ifndef _INCR_H_
+#define _INCR_H_
+
+/* The code of every function a compilation generates
+ * is kept, with the range of L labels it used and a
+ * fingerprint of what decides it: the function's
+ * syntax tree, the global variables and the
+ * signatures of the functions it names declared before
+ * it, and the options. The next compilation sets the
+ * body of a function whose fingerprint is unchanged
+ * aside before the analysis, so only the changed
+ * functions are analyzed, optimized and generated,
+ * and copies its code back with the labels renumbered
+ */
+
+/* Procedure incrOpen reads the functions kept in file
+ * by the last compilation; incrKey adds bytes to the
+ * fingerprint of every function (the options)
+ */
+void incrOpen(char *file);
+void incrKey(const void *data, size_t size);
+
+/* Function incrPrune fingerprints the functions of the
+ * parsed syntaxTree and sets aside the bodies of those
+ * that are unchanged. Returns their number
+ */
+int incrPrune(TreeNode *syntaxTree);
+
+/* Function incrBody returns the body of function f,
+ * also when incrPrune set it aside
+ */
+TreeNode *incrBody(TreeNode *f);
+
+/* Function incrSplice writes the kept code of function
+ * f, whose labels now start at firstLabel, and
+ * returns the number of labels it uses; -1 if f must
+ * be generated. incrBegin and incrEnd then enclose
+ * the code generated for f
+ */
+int incrSplice(TreeNode *f, int firstLabel);
+void incrBegin(TreeNode *f, int firstLabel);
+void incrEnd(TreeNode *f, int nextLabel);
+
+/* Procedure incrSave writes the functions of this
+ * compilation to the file given to incrOpen
+ */
+void incrSave(void);
+
+#endif
@@ -0,0 +1,1255 @@
+/****************************************************/
+/* File: jit.c                                      */
+/* In-process x86-64 compiler for C-                */
+/* Each function is encoded straight to machine     */
+/* code, the code is mapped executable and main is  */
+/* called in the compiler's own process. The code   */
+/* follows the x86-64 backend (xgen.c): values in   */
+/* a stack of callee-saved registers, System V      */
+/* calls, and the same frame layout                 */
+/****************************************************/
+
+#include "globals.h"
+#include "symtab.h"
+#include "stats.h"
+#include "jit.h"
+
+#if defined(__x86_64__) && defined(__linux__)
+
+#include <signal.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+enum { RAX, RCX, RDX, RBX, RSP, RBP, RSI, RDI,
+       R8, R9, R10, R11, R12, R13, R14, R15 };
+
+/* condition codes */
+enum { ccE = 0x4, ccNE = 0x5, ccL = 0xc, ccGE = 0xd, ccLE = 0xe, ccG = 0xf };
+
+#define NPOOL 5
+static const int pool[NPOOL] = { RBX, R12, R13, R14, R15 };
+
+#define NARGREGS 6
+static const int argRegs[NARGREGS] = { RDI, RSI, RDX, RCX, R8, R9 };
+
+#define NOINDEX (-1)
+#define RIPREL  (-1)
+
+#define PAGESIZE 4096
+
+/* a memory operand base + 4*index + disp; with base
+ * RIPREL, disp is the target's offset from the start
+ * of the code
+ */
+typedef struct
+{
+  int base;
+  int index;
+  int disp;
+} Mem;
+
+/* an instruction operand */
+typedef enum { opImm, opReg, opMem } OpndKind;
+
+typedef struct
+{
+  OpndKind kind;
+  int val;          /* immediate or register */
+  Mem m;
+} Opnd;
+
+/* a rel32 field to fill in: a label of the current
+ * function, or the entry of function target
+ */
+typedef struct
+{
+  int pos;
+  int target;
+} Fixup;
+
+/* functions already compiled, by hash of their tree */
+typedef struct
+{
+  unsigned int hash;
+  TreeNode *tree;
+  int entry;
+} CacheEntry;
+
+static unsigned char *buf = NULL;
+static int bufSize = 0, pos = 0;
+
+static int *labelPos = NULL;
+static int labelSize = 0, labelCount = 0;
+static Fixup *jumps = NULL, *calls = NULL;
+static int jumpSize = 0, jumpCount = 0, callSize = 0, callCount = 0;
+
+static CacheEntry *cache = NULL;
+static int cacheCount = 0, cacheHits = 0;
+
+static int *funcEntry = NULL;
+static int funcCount = 0;
+static int codeBase;     /* size of the data area before the code */
+
+/* per-function state */
+static int poolUsed;
+static int pushed;
+static int paramBase;
+static int returnLabel;
+
+/* pending %rip-relative displacement of the current instruction */
+static int ripPos = -1, ripTarget;
+
+/**************************************************/
+/***********   Encoding instructions   ************/
+/**************************************************/
+
+static void byte(int b)
+{
+  if (pos == bufSize)
+  {
+    bufSize = bufSize ? 2 * bufSize : 65536;
+    buf = (unsigned char *)reallocate(AllocCodegen, buf, bufSize);
+  }
+  buf[pos++] = (unsigned char)b;
+}
+
+static void put32(int at, int v)
+{
+  buf[at] = v & 0xff;
+  buf[at + 1] = (v >> 8) & 0xff;
+  buf[at + 2] = (v >> 16) & 0xff;
+  buf[at + 3] = (v >> 24) & 0xff;
+}
+
+static void imm32(int v)
+{
+  byte(0);
+  byte(0);
+  byte(0);
+  byte(0);
+  put32(pos - 4, v);
+}
+
+/* Procedure endInst fills in the %rip-relative
+ * displacement once the instruction's length is known
+ */
+static void endInst(void)
+{
+  if (ripPos >= 0)
+    put32(ripPos, ripTarget - pos);
+  ripPos = -1;
+}
+
+/* Procedure encode emits REX, the opcode (up to two
+ * bytes) and ModRM with register field reg, and
+ * register rm or memory operand m as the other
+ * operand. w selects 64-bit operands
+ */
+static void encode(int w, int op, int reg, int rm, Mem *m)
+{
+  int rex = 0x40 | (w ? 8 : 0) | ((reg & 8) ? 4 : 0);
+  if (m == NULL)
+    rex |= (rm & 8) ? 1 : 0;
+  else
+  {
+    if (m->index != NOINDEX && (m->index & 8))
+      rex |= 2;
+    if (m->base != RIPREL && (m->base & 8))
+      rex |= 1;
+  }
+  if (rex != 0x40)
+    byte(rex);
+  if (op > 0xff)
+    byte(op >> 8);
+  byte(op & 0xff);
+  reg &= 7;
+  if (m == NULL)
+    byte(0xc0 | reg << 3 | (rm & 7));
+  else if (m->base == RIPREL)
+  {
+    byte(reg << 3 | 5);
+    ripPos = pos;
+    ripTarget = m->disp;
+    imm32(0);
+  }
+  else
+  {
+    /* always a 32-bit displacement */
+    if (m->index != NOINDEX)
+    {
+      byte(0x80 | reg << 3 | 4);
+      byte(2 << 6 | (m->index & 7) << 3 | (m->base & 7));
+    }
+    else if ((m->base & 7) == RSP)
+    {
+      byte(0x80 | reg << 3 | 4);
+      byte(0x24);
+    }
+    else
+      byte(0x80 | reg << 3 | (m->base & 7));
+    imm32(m->disp);
+  }
+}
+
+static Mem mem(int base, int index, int disp)
+{
+  Mem m;
+  m.base = base;
+  m.index = index;
+  m.disp = disp;
+  return m;
+}
+
+/* movl $v, r */
+static void movRI(int r, int v)
+{
+  if (r & 8)
+    byte(0x41);
+  byte(0xb8 + (r & 7));
+  imm32(v);
+}
+
+/* movabsq $v, r */
+static void movRI64(int r, void *v)
+{
+  unsigned long long x = (unsigned long long)(size_t)v;
+  int i;
+  byte(0x48 | ((r & 8) ? 1 : 0));
+  byte(0xb8 + (r & 7));
+  for (i = 0; i < 8; i++)
+    byte((int)(x >> (8 * i)) & 0xff);
+}
+
+static void movRR(int d, int s)
+{
+  encode(0, 0x8b, d, s, NULL);
+}
+
+static void movRR64(int d, int s)
+{
+  encode(1, 0x8b, d, s, NULL);
+}
+
+static void loadM(int w, int r, Mem m)
+{
+  encode(w, 0x8b, r, 0, &m);
+  endInst();
+}
+
+static void storeM(int w, Mem m, int r)
+{
+  encode(w, 0x89, r, 0, &m);
+  endInst();
+}
+
+static void leaM(int w, int r, Mem m)
+{
+  encode(w, 0x8d, r, 0, &m);
+  endInst();
+}
+
+static void pushR(int r)
+{
+  if (r & 8)
+    byte(0x41);
+  byte(0x50 + (r & 7));
+}
+
+static void popR(int r)
+{
+  if (r & 8)
+    byte(0x41);
+  byte(0x58 + (r & 7));
+}
+
+/* subq/addq $n, %rsp */
+static void adjustSp(int n)
+{
+  if (n == 0)
+    return;
+  encode(1, 0x81, n > 0 ? 5 : 0, RSP, NULL);
+  imm32(n > 0 ? n : -n);
+}
+
+static int newLabel(void)
+{
+  if (labelCount == labelSize)
+  {
+    labelSize = labelSize ? 2 * labelSize : 64;
+    labelPos = (int *)reallocate(AllocCodegen, labelPos, labelSize * sizeof(int));
+  }
+  labelPos[labelCount] = -1;
+  return labelCount++;
+}
+
+static void placeLabel(int lab)
+{
+  labelPos[lab] = pos;
+}
+
+static void addFixup(Fixup **list, int *count, int *size, int target)
+{
+  if (*count == *size)
+  {
+    *size = *size ? 2 * *size : 64;
+    *list = (Fixup *)reallocate(AllocCodegen, *list, *size * sizeof(Fixup));
+  }
+  (*list)[*count].pos = pos;
+  (*list)[*count].target = target;
+  (*count)++;
+  imm32(0);
+}
+
+static void jump(int lab)
+{
+  byte(0xe9);
+  addFixup(&jumps, &jumpCount, &jumpSize, lab);
+}
+
+static void jumpIf(int cc, int lab)
+{
+  byte(0x0f);
+  byte(0x80 + cc);
+  addFixup(&jumps, &jumpCount, &jumpSize, lab);
+}
+
+/* Procedure aluOp emits "op src, r" for op 0 (add),
+ * 5 (sub) or 7 (cmp), the ModRM extensions of 0x81
+ */
+static void aluOp(int op, int r, Opnd *src)
+{
+  static const int rmForm[8] = { 0x03, 0, 0, 0, 0, 0x2b, 0, 0x3b };
+  if (src->kind == opImm)
+  {
+    encode(0, 0x81, op, r, NULL);
+    imm32(src->val);
+  }
+  else if (src->kind == opReg)
+    encode(0, rmForm[op], r, src->val, NULL);
+  else
+  {
+    encode(0, rmForm[op], r, 0, &src->m);
+    endInst();
+  }
+}
+
+/* Procedure unaryOp emits an 0xf7 group instruction
+ * (ext 3 = neg, 7 = idiv) on a register or memory
+ */
+static void unaryOp(int ext, Opnd *src)
+{
+  if (src->kind == opReg)
+    encode(0, 0xf7, ext, src->val, NULL);
+  else
+  {
+    encode(0, 0xf7, ext, 0, &src->m);
+    endInst();
+  }
+}
+
+/**************************************************/
+/***********   Selecting instructions   ***********/
+/**************************************************/
+
+static int isConst(TreeNode *t)
+{
+  return t != NULL && t->nodekind == ExpK && t->kind.exp == ConstK;
+}
+
+static int isScalar(TreeNode *t)
+{
+  return t->nodekind == ExpK && t->kind.exp == IdK &&
+         t->child[0] == NULL && !t->info->isArray;
+}
+
+/* Function containsCall returns TRUE if expression t
+ * calls a function or assigns, so it can change what
+ * another operand reads
+ */
+static int containsCall(TreeNode *t)
+{
+  int i;
+  if (t == NULL)
+    return FALSE;
+  if ((t->nodekind == ExpK && t->kind.exp == FuncCallK) ||
+      (t->nodekind == StmtK && t->kind.stmt == AssignK))
+    return TRUE;
+  for (i = 0; i < MAXCHILDREN; i++)
+    if (containsCall(t->child[i]))
+      return TRUE;
+  return FALSE;
+}
+
+/* returns k if c == 2^k, otherwise -1 */
+static int log2Of(int c)
+{
+  int k = 0;
+  if (c <= 0 || (c & (c - 1)) != 0)
+    return -1;
+  while ((c >> k) != 1)
+    k++;
+  return k;
+}
+
+static int condCode(TokenType op)
+{
+  switch (op)
+  {
+  case LT:    return ccL;
+  case LTET:  return ccLE;
+  case GT:    return ccG;
+  case GTET:  return ccGE;
+  case EQ:    return ccE;
+  case NOTEQ: return ccNE;
+  default:    return -1;
+  }
+}
+
+static TokenType swapOp(TokenType op)
+{
+  switch (op)
+  {
+  case PLUS: case TIMES: case EQ: case NOTEQ:
+    return op;
+  case LT:   return GT;
+  case GT:   return LT;
+  case LTET: return GTET;
+  case GTET: return LTET;
+  default:   return -1;
+  }
+}
+
+static void usePool(int d)
+{
+  if (d + 1 > poolUsed)
+    poolUsed = d + 1;
+}
+
+static int paramOffset(SymbolInfo info)
+{
+  int i;
+  if (info->memloc < PARAM_STACK_BASE)
+    i = (info->memloc - PARAM_REG_BASE) / 4;
+  else
+    i = (info->memloc - PARAM_STACK_BASE) / 4;
+  if (i < NARGREGS)
+    return paramBase - 8 * (i + 1);
+  return 16 + 8 * (i - NARGREGS);
+}
+
+/* Function globalOffset returns the offset from the
+ * start of the code of a global scalar, or of element
+ * 0 of a global array
+ */
+static int globalOffset(SymbolInfo info)
+{
+  int cell = info->memloc / 4;
+  if (info->isArray)
+    cell -= info->ArraySize - 1;
+  return 4 * cell - codeBase;
+}
+
+/* Function varMem returns the memory operand of a
+ * scalar, or of element k of an array that is not a
+ * parameter
+ */
+static Mem varMem(SymbolInfo info, int k)
+{
+  if (info->decKind == ParamK)
+    return mem(RBP, NOINDEX, paramOffset(info));
+  if (info->isGlobal)
+    return mem(RIPREL, NOINDEX, globalOffset(info) + 4 * k);
+  return mem(RBP, NOINDEX, info->memloc + 4 * k);
+}
+
+static void genExp(TreeNode *t, int d);
+
+/* Function indexMem returns the memory operand of
+ * the array element t whose subscript is already in
+ * pool register d
+ */
+static Mem indexMem(TreeNode *t, int d)
+{
+  SymbolInfo info = t->info;
+  int r = pool[d];
+
+  encode(1, 0x63, r, r, NULL);            /* movslq */
+  if (info->decKind == ParamK)
+  {
+    loadM(1, RCX, mem(RBP, NOINDEX, paramOffset(info)));
+    return mem(RCX, r, 0);
+  }
+  if (info->isGlobal)
+  {
+    leaM(1, RCX, varMem(info, 0));
+    return mem(RCX, r, 0);
+  }
+  return mem(RBP, r, info->memloc);
+}
+
+/* Function elemMem returns the memory operand of
+ * array element t; a variable subscript is computed
+ * into pool register d and a base address into %rcx
+ */
+static Mem elemMem(TreeNode *t, int d)
+{
+  SymbolInfo info = t->info;
+  TreeNode *idx = t->child[0];
+
+  if (isConst(idx) && info->decKind == ParamK)
+  {
+    loadM(1, RCX, mem(RBP, NOINDEX, paramOffset(info)));
+    return mem(RCX, NOINDEX, 4 * idx->val);
+  }
+  if (isConst(idx))
+    return varMem(info, idx->val);
+  genExp(idx, d);
+  return indexMem(t, d);
+}
+
+/* Function genRight makes the right operand of a
+ * binary operator available while the left one is in
+ * pool register d
+ */
+static Opnd genRight(TreeNode *r, int d)
+{
+  Opnd o;
+  if (isConst(r))
+  {
+    o.kind = opImm;
+    o.val = r->val;
+  }
+  else if (isScalar(r))
+  {
+    o.kind = opMem;
+    o.m = varMem(r->info, 0);
+  }
+  else if (d + 1 < NPOOL)
+  {
+    genExp(r, d + 1);
+    o.kind = opReg;
+    o.val = pool[d + 1];
+  }
+  else
+  {
+    pushR(pool[d]);
+    pushed += 8;
+    genExp(r, d);
+    movRR(RCX, pool[d]);
+    popR(pool[d]);
+    pushed -= 8;
+    o.kind = opReg;
+    o.val = RCX;
+  }
+  return o;
+}
+
+/* Procedure genDiv divides pool register d by r. A
+ * divisor of -1 negates, so INT_MIN / -1 wraps like
+ * MIPS, and only a zero divisor traps (divideError)
+ */
+static void genDiv(TreeNode *r, int d)
+{
+  Opnd src;
+  int k, lab1, lab2, reg = pool[d];
+
+  if (isConst(r) && (k = log2Of(r->val)) >= 0)
+  {
+    if (k == 0)
+      return;
+    leaM(0, RAX, mem(reg, NOINDEX, r->val - 1));
+    encode(0, 0x85, reg, reg, NULL);        /* test */
+    encode(0, 0x0f48, reg, RAX, NULL);      /* cmovs */
+    encode(0, 0xc1, 7, reg, NULL);          /* sar */
+    byte(k);
+    return;
+  }
+  if (isConst(r) && r->val == -1)
+  {
+    encode(0, 0xf7, 3, reg, NULL);          /* neg */
+    return;
+  }
+  if (isConst(r))
+  {
+    movRI(RCX, r->val);
+    src.kind = opReg;
+    src.val = RCX;
+    movRR(RAX, reg);
+    byte(0x99);                             /* cltd */
+    unaryOp(7, &src);
+    movRR(reg, RAX);
+    return;
+  }
+  src = genRight(r, d);
+  lab1 = newLabel();
+  lab2 = newLabel();
+  movRR(RAX, reg);
+  if (src.kind == opReg)
+    encode(0, 0x81, 7, src.val, NULL);      /* cmp $-1 */
+  else
+    encode(0, 0x81, 7, 0, &src.m);
+  imm32(-1);
+  if (src.kind != opReg)
+    endInst();
+  jumpIf(ccNE, lab1);
+  encode(0, 0xf7, 3, RAX, NULL);            /* neg */
+  jump(lab2);
+  placeLabel(lab1);
+  byte(0x99);                               /* cltd */
+  unaryOp(7, &src);
+  placeLabel(lab2);
+  movRR(reg, RAX);
+}
+
+static void genOp(TreeNode *t, int d)
+{
+  TreeNode *l = t->child[0], *r = t->child[1];
+  TokenType op = t->attr.op;
+  Opnd src;
+  int reg = pool[d], cc;
+
+  if (isConst(l) && !isConst(r) && swapOp(op) != -1)
+  {
+    l = t->child[1];
+    r = t->child[0];
+    op = swapOp(op);
+  }
+  if (isConst(l) && op == MINUS)
+  {
+    genExp(r, d);
+    encode(0, 0xf7, 3, reg, NULL);          /* neg */
+    if (l->val != 0)
+    {
+      encode(0, 0x81, 0, reg, NULL);
+      imm32(l->val);
+    }
+    return;
+  }
+  genExp(l, d);
+  if (op == OVER)
+  {
+    genDiv(r, d);
+    return;
+  }
+  if (isConst(r) && r->val == 0 && (op == PLUS || op == MINUS))
+    return;
+  src = genRight(r, d);
+  switch (op)
+  {
+  case PLUS:
+    aluOp(0, reg, &src);
+    break;
+  case MINUS:
+    aluOp(5, reg, &src);
+    break;
+  case TIMES:
+    if (src.kind == opImm)
+    {
+      encode(0, 0x69, reg, reg, NULL);
+      imm32(src.val);
+    }
+    else if (src.kind == opReg)
+      encode(0, 0x0faf, reg, src.val, NULL);
+    else
+    {
+      encode(0, 0x0faf, reg, 0, &src.m);
+      endInst();
+    }
+    break;
+  default:
+    if ((cc = condCode(op)) < 0)
+      break;
+    aluOp(7, reg, &src);
+    encode(0, 0x0f90 | cc, 0, RAX, NULL);   /* setcc %al */
+    encode(0, 0x0fb6, reg, RAX, NULL);      /* movzbl %al */
+    break;
+  }
+}
+
+static void genArg(TreeNode *t, int d)
+{
+  if (t->nodekind == ExpK && t->kind.exp == IdK &&
+      t->child[0] == NULL && t->info->isArray)
+  {
+    usePool(d);
+    if (t->info->decKind == ParamK)
+      loadM(1, pool[d], mem(RBP, NOINDEX, paramOffset(t->info)));
+    else
+      leaM(1, pool[d], varMem(t->info, 0));
+  }
+  else
+    genExp(t, d);
+}
+
+/* Procedure callRuntime calls a C function with the
+ * stack 16-byte aligned
+ */
+static void callRuntime(void *fn)
+{
+  if (pushed % 16 != 0)
+    adjustSp(8);
+  movRI64(RAX, fn);
+  encode(0, 0xff, 2, RAX, NULL);            /* call *%rax */
+  if (pushed % 16 != 0)
+    adjustSp(-8);
+}
+
+static void callFunction(TreeNode *t)
+{
+  byte(0xe8);
+  addFixup(&calls, &callCount, &callSize, t->info->memloc);
+}
+
+static void genCall(TreeNode *t, int d)
+{
+  TreeNode *a;
+  int n = 0, i, nreg, nstack, pad;
+
+  for (a = t->child[0]; a != NULL; a = a->sibling)
+    n++;
+  if (d + n <= NPOOL)
+  {
+    for (a = t->child[0], i = 0; a != NULL; a = a->sibling, i++)
+      genArg(a, d + i);
+    for (i = 0; i < n; i++)
+      movRR64(argRegs[i], pool[d + i]);
+    if (pushed % 16 != 0)
+      adjustSp(8);
+    callFunction(t);
+    if (pushed % 16 != 0)
+      adjustSp(-8);
+  }
+  else
+  {
+    nreg = n < NARGREGS ? n : NARGREGS;
+    nstack = n - nreg;
+    pad = (pushed + 8 * nstack) % 16 != 0 ? 8 : 0;
+    adjustSp(8 * n + pad);
+    pushed += 8 * n + pad;
+    for (a = t->child[0], i = 0; a != NULL; a = a->sibling, i++)
+    {
+      genArg(a, d);
+      storeM(1, mem(RSP, NOINDEX, 8 * i), pool[d]);
+    }
+    for (i = 0; i < nreg; i++)
+      loadM(1, argRegs[i], mem(RSP, NOINDEX, 8 * i));
+    adjustSp(-8 * nreg);
+    pushed -= 8 * nreg;
+    callFunction(t);
+    adjustSp(-(8 * nstack + pad));
+    pushed -= 8 * nstack + pad;
+  }
+  usePool(d);
+  movRR(pool[d], RAX);
+}
+
+static void genStore(TreeNode *t, int d)
+{
+  Mem m;
+  if (t->child[0] == NULL)
+    m = varMem(t->info, 0);
+  else
+    m = elemMem(t, d + 1);
+  storeM(0, m, pool[d]);
+}
+
+/* the runtime, called from the generated code */
+static int jitInput(void)
+{
+  int v;
+  if (Prompts)
+    printf("Enter value for input instruction: ");
+  if (scanf("%d", &v) != 1)
+    v = 0;
+  return v;
+}
+
+static void jitOutput(int v)
+{
+  printf(Prompts ? "output instruction prints: %d\n" : "%d\n", v);
+}
+
+/* Procedure genAssignExp generates the assignment t
+ * used as an expression, leaving the value in pool
+ * register d; a variable subscript is computed first
+ */
+static void genAssignExp(TreeNode *t, int d)
+{
+  TreeNode *lhs = t->child[0], *rhs = t->child[1];
+  Mem m;
+
+  if (lhs->child[0] == NULL || isConst(lhs->child[0]))
+  {
+    genExp(rhs, d);
+    genStore(lhs, d);
+    return;
+  }
+  genExp(lhs->child[0], d);
+  if (d + 1 < NPOOL)
+  {
+    genExp(rhs, d + 1);
+    movRR(RAX, pool[d + 1]);
+  }
+  else
+  {
+    pushR(pool[d]);
+    pushed += 8;
+    genExp(rhs, d);
+    movRR(RAX, pool[d]);
+    popR(pool[d]);
+    pushed -= 8;
+  }
+  m = indexMem(lhs, d);
+  storeM(0, m, RAX);
+  movRR(pool[d], RAX);
+}
+
+static void genExp(TreeNode *t, int d)
+{
+  int reg = pool[d];
+  usePool(d);
+  if (t->nodekind == StmtK)
+  {
+    if (t->kind.stmt == AssignK)
+      genAssignExp(t, d);
+    return;
+  }
+  switch (t->kind.exp)
+  {
+  case ConstK:
+    if (t->val == 0)
+      encode(0, 0x31, reg, reg, NULL);      /* xor */
+    else
+      movRI(reg, t->val);
+    break;
+  case IdK:
+    loadM(0, reg, t->child[0] != NULL ? elemMem(t, d) : varMem(t->info, 0));
+    break;
+  case OpK:
+    genOp(t, d);
+    break;
+  case FuncCallK:
+    genCall(t, d);
+    break;
+  case InputCallK:
+    callRuntime((void *)jitInput);
+    movRR(reg, RAX);
+    genStore(t->child[0], d);
+    break;
+  case OutputCallK:
+    genExp(t->child[0], d);
+    movRR(RDI, reg);
+    callRuntime((void *)jitOutput);
+    break;
+  default:
+    break;
+  }
+}
+
+static void genCond(TreeNode *t, int lab, int sense)
+{
+  TreeNode *l, *r;
+  TokenType op;
+  Opnd src;
+
+  if (isConst(t))
+  {
+    if ((t->val != 0) == sense)
+      jump(lab);
+    return;
+  }
+  if (t->nodekind == ExpK && t->kind.exp == OpK &&
+      condCode(t->attr.op) >= 0)
+  {
+    l = t->child[0];
+    r = t->child[1];
+    op = t->attr.op;
+    if (isConst(l) && !isConst(r))
+    {
+      l = t->child[1];
+      r = t->child[0];
+      op = swapOp(op);
+    }
+    genExp(l, 0);
+    src = genRight(r, 0);
+    aluOp(7, pool[0], &src);
+    /* the negated condition code differs in bit 0 */
+    jumpIf(condCode(op) ^ (sense ? 0 : 1), lab);
+    return;
+  }
+  genExp(t, 0);
+  encode(0, 0x85, pool[0], pool[0], NULL);
+  jumpIf(sense ? ccNE : ccE, lab);
+}
+
+static void genAssign(TreeNode *t)
+{
+  TreeNode *lhs = t->child[0], *rhs = t->child[1];
+  Mem m;
+
+  if (lhs->child[0] == NULL)
+  {
+    m = varMem(lhs->info, 0);
+    if (isConst(rhs))
+    {
+      encode(0, 0xc7, 0, 0, &m);
+      imm32(rhs->val);
+      endInst();
+      return;
+    }
+    if (rhs->nodekind == ExpK && rhs->kind.exp == OpK &&
+        (rhs->attr.op == PLUS || rhs->attr.op == MINUS) &&
+        isScalar(rhs->child[0]) && rhs->child[0]->info == lhs->info &&
+        isConst(rhs->child[1]))
+    {
+      encode(0, 0x81, rhs->attr.op == PLUS ? 0 : 5, 0, &m);
+      imm32(rhs->child[1]->val);
+      endInst();
+      return;
+    }
+  }
+  if (lhs->child[0] != NULL && !isConst(lhs->child[0]) && containsCall(rhs))
+  {
+    /* the subscript is computed before a call or an
+       assignment in the value can change what it
+       reads, as on MIPS */
+    genExp(lhs->child[0], 0);
+    genExp(rhs, 1);
+    m = indexMem(lhs, 0);
+    storeM(0, m, pool[1]);
+    return;
+  }
+  genExp(rhs, 0);
+  genStore(lhs, 0);
+}
+
+static void genStmt(TreeNode *t)
+{
+  int lab1, lab2;
+  for (; t != NULL; t = t->sibling)
+  {
+    if (t->nodekind == ExpK)
+    {
+      genExp(t, 0);
+      continue;
+    }
+    if (t->nodekind != StmtK)
+      continue;
+    switch (t->kind.stmt)
+    {
+    case AssignK:
+      genAssign(t);
+      break;
+    case IfK:
+      lab1 = newLabel();
+      genCond(t->child[0], lab1, FALSE);
+      genStmt(t->child[1]);
+      if (t->child[2] != NULL)
+      {
+        lab2 = newLabel();
+        jump(lab2);
+        placeLabel(lab1);
+        genStmt(t->child[2]);
+        placeLabel(lab2);
+      }
+      else
+        placeLabel(lab1);
+      break;
+    case WhileK:
+      lab1 = newLabel();
+      lab2 = newLabel();
+      jump(lab2);
+      placeLabel(lab1);
+      genStmt(t->child[1]);
+      placeLabel(lab2);
+      genCond(t->child[0], lab1, TRUE);
+      break;
+    case ReturnK:
+      if (t->child[0] != NULL)
+      {
+        genExp(t->child[0], 0);
+        movRR(RAX, pool[0]);
+      }
+      jump(returnLabel);
+      break;
+    case CompoundK:
+      genStmt(t->child[1]);
+      break;
+    default:
+      break;
+    }
+  }
+}
+
+static void scanLocals(TreeNode *t, int *lowest)
+{
+  int i;
+  for (; t != NULL; t = t->sibling)
+  {
+    if (t->nodekind == DeclarationK &&
+        (t->kind.dec == SimpleK || t->kind.dec == ArrayK) &&
+        t->info != NULL && t->info->memloc < *lowest)
+      *lowest = t->info->memloc;
+    for (i = 0; i < MAXCHILDREN; i++)
+      scanLocals(t->child[i], lowest);
+  }
+}
+
+/**************************************************/
+/***********   Caching compiled functions   *******/
+/**************************************************/
+
+static unsigned int hashString(const char *s)
+{
+  unsigned int h = 5381;
+  while (*s)
+    h = h * 33 + (unsigned char)*s++;
+  return h;
+}
+
+/* Function nameOf returns the name a node carries, or
+ * NULL; other nodes may keep an operator in attr
+ */
+static char *nameOf(TreeNode *t)
+{
+  if (t->nodekind == DeclarationK ||
+      (t->nodekind == ExpK &&
+       (t->kind.exp == IdK || t->kind.exp == FuncCallK)))
+    return t->attr.name;
+  return NULL;
+}
+
+/* Function hashTree hashes everything the generated
+ * code depends on: shape, operators, constants, names
+ * and storage locations (a return's info is its own
+ * function, which does not matter)
+ */
+static unsigned int hashTree(TreeNode *t)
+{
+  unsigned int h = 17;
+  int i;
+  for (; t != NULL; t = t->sibling)
+  {
+    h = h * 31 + t->nodekind;
+    h = h * 31 + t->kind.exp;
+    h = h * 31 + (unsigned int)t->val;
+    h = h * 31 + t->isArray;
+    if (t->nodekind == ExpK && t->kind.exp == OpK)
+      h = h * 31 + t->attr.op;
+    else if (nameOf(t) != NULL)
+      h = h * 31 + hashString(nameOf(t));
+    if (t->nodekind != StmtK && t->info != NULL)
+      h = h * 31 + (unsigned int)t->info->memloc * 2 + t->info->isGlobal;
+    for (i = 0; i < MAXCHILDREN; i++)
+      h = h * 31 + hashTree(t->child[i]);
+  }
+  return h;
+}
+
+static int sameTree(TreeNode *a, TreeNode *b)
+{
+  int i;
+  for (; a != NULL && b != NULL; a = a->sibling, b = b->sibling)
+  {
+    if (a->nodekind != b->nodekind || a->kind.exp != b->kind.exp ||
+        a->val != b->val || a->isArray != b->isArray)
+      return FALSE;
+    if (a->nodekind == ExpK && a->kind.exp == OpK)
+    {
+      if (a->attr.op != b->attr.op)
+        return FALSE;
+    }
+    else if ((nameOf(a) == NULL) != (nameOf(b) == NULL) ||
+             (nameOf(a) != NULL && strcmp(nameOf(a), nameOf(b)) != 0))
+      return FALSE;
+    if (a->nodekind != StmtK &&
+        ((a->info == NULL) != (b->info == NULL) ||
+         (a->info != NULL && (a->info->memloc != b->info->memloc ||
+                              a->info->isGlobal != b->info->isGlobal))))
+      return FALSE;
+    for (i = 0; i < MAXCHILDREN; i++)
+      if (!sameTree(a->child[i], b->child[i]))
+        return FALSE;
+  }
+  return a == NULL && b == NULL;
+}
+
+/* Function lookupCache returns the entry of a function
+ * compiled earlier with the same parameters and body,
+ * or -1
+ */
+static int lookupCache(TreeNode *f, unsigned int h)
+{
+  int i;
+  for (i = 0; i < cacheCount; i++)
+    if (cache[i].hash == h &&
+        sameTree(cache[i].tree->child[0], f->child[0]) &&
+        sameTree(cache[i].tree->child[1], f->child[1]))
+      return cache[i].entry;
+  return -1;
+}
+
+/**************************************************/
+/***********   Functions and the program   ********/
+/**************************************************/
+
+/* Procedure genBody generates the prologue, body and
+ * epilogue of f at the current position, saving
+ * the first used pool registers
+ */
+static void genBody(TreeNode *f, int nsaved, int used)
+{
+  int frame, i, save;
+
+  poolUsed = used;
+  pushed = 0;
+  returnLabel = newLabel();
+  frame = -(paramBase - 8 * nsaved - 8 * poolUsed);
+  frame = (frame + 15) & ~15;
+  save = paramBase - 8 * nsaved;
+
+  pushR(RBP);
+  movRR64(RBP, RSP);
+  adjustSp(frame);
+  for (i = 0; i < poolUsed; i++)
+    storeM(1, mem(RBP, NOINDEX, save - 8 * (i + 1)), pool[i]);
+  for (i = 0; i < nsaved; i++)
+    storeM(1, mem(RBP, NOINDEX, paramBase - 8 * (i + 1)), argRegs[i]);
+  genStmt(f->child[1]);
+  placeLabel(returnLabel);
+  for (i = 0; i < poolUsed; i++)
+    loadM(1, pool[i], mem(RBP, NOINDEX, save - 8 * (i + 1)));
+  byte(0xc9);                               /* leave */
+  byte(0xc3);                               /* ret */
+}
+
+/* Procedure genFunction compiles f, unless the cache
+ * has an identical function. The body is generated
+ * twice: the first pass finds how many pool registers
+ * the prologue has to save
+ */
+static void genFunction(TreeNode *f)
+{
+  TreeNode *p;
+  unsigned int h = hashTree(f->child[0]) * 31 + hashTree(f->child[1]);
+  int lowest = 0, nparams = 0, nsaved, start = pos, calls0 = callCount, used, i;
+
+  if ((funcEntry[f->info->memloc] = lookupCache(f, h)) >= 0)
+  {
+    cacheHits++;
+    return;
+  }
+  for (p = f->child[0]; p != NULL; p = p->sibling)
+    nparams++;
+  nsaved = nparams < NARGREGS ? nparams : NARGREGS;
+  scanLocals(f->child[1], &lowest);
+  paramBase = lowest & ~7;
+
+  /* first pass: find the pool registers the body uses */
+  poolUsed = 0;
+  pushed = 0;
+  labelCount = jumpCount = 0;
+  genStmt(f->child[1]);
+  used = poolUsed;
+  pos = start;
+  callCount = calls0;
+  labelCount = jumpCount = 0;
+  genBody(f, nsaved, used);
+
+  for (i = 0; i < jumpCount; i++)
+    put32(jumps[i].pos, labelPos[jumps[i].target] - (jumps[i].pos + 4));
+  funcEntry[f->info->memloc] = start;
+
+  cache = (CacheEntry *)reallocate(AllocCodegen, cache, (cacheCount + 1) * sizeof(CacheEntry));
+  cache[cacheCount].hash = h;
+  cache[cacheCount].tree = f;
+  cache[cacheCount].entry = start;
+  cacheCount++;
+}
+
+/* the generated code checks a divisor of -1, so only
+   a zero divisor gets here */
+static void divideError(int sig)
+{
+  (void)sig;
+  fflush(stdout);
+  fprintf(stderr, "jit: runtime error: division by zero\n");
+  _exit(1);
+}
+
+/* Function jitRun compiles the analyzed syntax tree to
+ * x86-64 machine code and runs main in this process.
+ * Returns 0, or 1 if the program could not be run
+ */
+int jitRun(TreeNode *syntaxTree)
+{
+  TreeNode *t;
+  unsigned char *region;
+  int dataSize = 0, top, mainFunc = -1, codeSize, i;
+  void (*entry)(void);
+
+  for (t = syntaxTree; t != NULL; t = t->sibling)
+  {
+    if (t->nodekind != DeclarationK || t->info == NULL)
+      continue;
+    if (t->kind.dec == FunctionK)
+    {
+      if (t->info->memloc >= funcCount)
+        funcCount = t->info->memloc + 1;
+      if (strcmp(t->attr.name, "main") == 0)
+        mainFunc = t->info->memloc;
+    }
+    else if ((top = t->info->memloc + 4) > dataSize)
+      dataSize = top;
+  }
+  if (mainFunc < 0)
+  {
+    fprintf(stderr, "jit: no main function\n");
+    return 1;
+  }
+  /* globals first, then the code, in one mapping so
+     globals are in reach of %rip-relative operands */
+  codeBase = (dataSize + PAGESIZE - 1) & ~(PAGESIZE - 1);
+  funcEntry = (int *)allocate(AllocCodegen, funcCount * sizeof(int));
+  pos = 0;
+  for (t = syntaxTree; t != NULL; t = t->sibling)
+    if (t->nodekind == DeclarationK && t->kind.dec == FunctionK)
+      genFunction(t);
+  for (i = 0; i < callCount; i++)
+    put32(calls[i].pos, funcEntry[calls[i].target] - (calls[i].pos + 4));
+  if (TraceCode)
+    fprintf(listing, "\nJIT: %d bytes of code, %d functions shared\n",
+            pos, cacheHits);
+
+  codeSize = (pos + PAGESIZE - 1) & ~(PAGESIZE - 1);
+  region = (unsigned char *)mmap(NULL, codeBase + codeSize,
+                                 PROT_READ | PROT_WRITE,
+                                 MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (region == MAP_FAILED)
+  {
+    fprintf(stderr, "jit: cannot map code\n");
+    return 1;
+  }
+  memcpy(region + codeBase, buf, pos);
+  if (mprotect(region + codeBase, codeSize, PROT_READ | PROT_EXEC) != 0)
+  {
+    fprintf(stderr, "jit: cannot make code executable\n");
+    return 1;
+  }
+  signal(SIGFPE, divideError);
+  entry = (void (*)(void))(region + codeBase + funcEntry[mainFunc]);
+  entry();
+  fflush(stdout);
+  munmap(region, codeBase + codeSize);
+  return 0;
+}
+
+#else
+
+int jitRun(TreeNode *syntaxTree)
+{
+  fprintf(stderr, "jit: only x86-64 Linux is supported\n");
+  return 1;
+}
+
+#endif
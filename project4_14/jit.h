@@ -0,0 +1,18 @@
+/****************************************************/
+/* File: jit.h                                      */
+/* In-process x86-64 compiler for C-                */
+/* (runs a program as native code without an        */
+/* assembler, linker or simulator)                  */
+/****************************************************/
+
+#ifndef _JIT_H_
+#define _JIT_H_
+
+/* Function jitRun compiles the analyzed syntax tree to
+ * x86-64 machine code and runs main in this process.
+ * Functions with identical trees share one copy of
+ * code. Returns 0, or 1 if the program could not be run
+ */
+int jitRun(TreeNode *);
+
+#endif
@@ -0,0 +1,218 @@
+/****************************************************/
+/* File: ltm.c                                      */
+/* Simulator for the TM machine of Louden's book,   */
+/* which runs the .tmc files of --target=tm (tm.c   */
+/* simulates the MIPS code)                         */
+/****************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#ifndef TRUE
+#define TRUE 1
+#endif
+#ifndef FALSE
+#define FALSE 0
+#endif
+
+/******* const *******/
+#define LINESIZE 1024
+#define DADDR_SIZE (1 << 20)
+#define NO_REGS 8
+#define PC_REG  7
+
+/******* type  *******/
+typedef enum {
+   /* RR instructions: r, s, t */
+   opHALT, opIN, opOUT, opADD, opSUB, opMUL, opDIV,
+   /* RM instructions: r, d(s) */
+   opLD, opST,
+   /* RA instructions: r, d(s) is an address */
+   opLDA, opLDC, opJLT, opJLE, opJGT, opJGE, opJEQ, opJNE
+} OPCODE;
+
+typedef struct {
+   OPCODE iop;
+   int iarg1;
+   int iarg2;
+   int iarg3;
+} INSTRUCTION;
+
+/******** vars ********/
+static char *opCodeTab[] =
+{
+   "HALT", "IN", "OUT", "ADD", "SUB", "MUL", "DIV",
+   "LD", "ST",
+   "LDA", "LDC", "JLT", "JLE", "JGT", "JGE", "JEQ", "JNE"
+};
+
+static INSTRUCTION *iMem = NULL;
+static int iMemSize = 0;
+static int dMem[DADDR_SIZE];
+static int reg[NO_REGS];
+static long executed = 0;
+static int prompts = FALSE;
+
+static char *pgmName;
+
+/* Procedure runError reports an error of the program
+ * at instruction loc and stops
+ */
+static void runError(char *msg, int loc)
+{
+   fflush(stdout);
+   fprintf(stderr, "ltm: %s at %d\n", msg, loc);
+   exit(1);
+}
+
+/* Procedure loadProgram reads the instructions of the
+ * code file: "loc: OP r,s,t" or "loc: OP r,d(s)";
+ * lines starting with * are comments. Unwritten
+ * locations hold HALT
+ */
+static void loadProgram(FILE *pgm)
+{
+   char line[LINESIZE], op[8];
+   int lineNo = 0, loc, a, b, c, n, i;
+   OPCODE iop;
+
+   while (fgets(line, LINESIZE, pgm) != NULL)
+   {
+      char *p = line;
+      lineNo++;
+      while (isspace((unsigned char)*p))
+         p++;
+      if (*p == '*' || *p == '\0')
+         continue;
+      if (sscanf(p, "%d: %7s %d,%d(%d)", &loc, op, &a, &b, &c) != 5 &&
+          sscanf(p, "%d: %7s %d,%d,%d", &loc, op, &a, &b, &c) != 5)
+      {
+         fprintf(stderr, "ltm: %s:%d: bad instruction\n", pgmName, lineNo);
+         exit(1);
+      }
+      for (iop = opHALT; iop <= opJNE; iop++)
+         if (strcmp(op, opCodeTab[iop]) == 0)
+            break;
+      if (iop > opJNE || loc < 0 || a < 0 || a >= NO_REGS ||
+          (iop <= opDIV && (b < 0 || b >= NO_REGS)) || c < 0 || c >= NO_REGS)
+      {
+         fprintf(stderr, "ltm: %s:%d: bad instruction\n", pgmName, lineNo);
+         exit(1);
+      }
+      if (loc >= iMemSize)
+      {
+         n = iMemSize;
+         iMemSize = 2 * loc + 1024;
+         iMem = (INSTRUCTION *)realloc(iMem, iMemSize * sizeof(INSTRUCTION));
+         for (i = n; i < iMemSize; i++)
+         {
+            iMem[i].iop = opHALT;
+            iMem[i].iarg1 = iMem[i].iarg2 = iMem[i].iarg3 = 0;
+         }
+      }
+      iMem[loc].iop = iop;
+      iMem[loc].iarg1 = a;
+      iMem[loc].iarg2 = b;
+      iMem[loc].iarg3 = c;
+   }
+}
+
+/* Procedure run executes from location 0 until HALT.
+ * Arithmetic wraps around like 32-bit registers
+ */
+static void run(void)
+{
+   INSTRUCTION *in;
+   int loc, r, s, t, m;
+
+   dMem[0] = DADDR_SIZE - 1;
+   for (;;)
+   {
+      loc = reg[PC_REG];
+      if (loc < 0 || loc >= iMemSize)
+         runError("instruction memory fault", loc);
+      in = &iMem[loc];
+      reg[PC_REG] = loc + 1;
+      executed++;
+      r = in->iarg1;
+      s = in->iarg2;
+      t = in->iarg3;
+      m = 0;
+      if (in->iop >= opLD)
+      {
+         m = (int)((unsigned)s + (unsigned)reg[t]);
+         if (in->iop <= opST && (m < 0 || m >= DADDR_SIZE))
+            runError("data memory fault", loc);
+      }
+      switch (in->iop)
+      {
+      case opHALT:
+         return;
+      case opIN:
+         if (prompts)
+            printf("Enter value for IN instruction: ");
+         if (scanf("%d", &reg[r]) != 1)
+            reg[r] = 0;
+         break;
+      case opOUT:
+         printf(prompts ? "OUT instruction prints: %d\n" : "%d\n", reg[r]);
+         break;
+      case opADD: reg[r] = (int)((unsigned)reg[s] + (unsigned)reg[t]); break;
+      case opSUB: reg[r] = (int)((unsigned)reg[s] - (unsigned)reg[t]); break;
+      case opMUL: reg[r] = (int)((unsigned)reg[s] * (unsigned)reg[t]); break;
+      case opDIV:
+         if (reg[t] == 0)
+            runError("division by zero", loc);
+         /* INT_MIN / -1 wraps like the MIPS code */
+         reg[r] = reg[t] == -1 ? (int)(0u - (unsigned)reg[s]) : reg[s] / reg[t];
+         break;
+      case opLD:  reg[r] = dMem[m]; break;
+      case opST:  dMem[m] = reg[r]; break;
+      case opLDA: reg[r] = m; break;
+      case opLDC: reg[r] = s; break;
+      case opJLT: if (reg[r] <  0) reg[PC_REG] = m; break;
+      case opJLE: if (reg[r] <= 0) reg[PC_REG] = m; break;
+      case opJGT: if (reg[r] >  0) reg[PC_REG] = m; break;
+      case opJGE: if (reg[r] >= 0) reg[PC_REG] = m; break;
+      case opJEQ: if (reg[r] == 0) reg[PC_REG] = m; break;
+      case opJNE: if (reg[r] != 0) reg[PC_REG] = m; break;
+      }
+   }
+}
+
+int main(int argc, char *argv[])
+{
+   int stats = FALSE, i;
+   FILE *pgm;
+
+   for (i = 1; i < argc - 1; i++)
+   {
+      if (strcmp(argv[i], "-s") == 0)
+         stats = TRUE;
+      else if (strcmp(argv[i], "-p") == 0)
+         prompts = TRUE;
+      else
+         break;
+   }
+   if (i != argc - 1)
+   {
+      fprintf(stderr, "usage: %s [-s] [-p] <filename>.tmc\n", argv[0]);
+      exit(1);
+   }
+   pgmName = argv[i];
+   pgm = fopen(pgmName, "r");
+   if (pgm == NULL)
+   {
+      fprintf(stderr, "ltm: file '%s' not found\n", pgmName);
+      exit(1);
+   }
+   loadProgram(pgm);
+   fclose(pgm);
+   run();
+   fflush(stdout);
+   if (stats)
+      fprintf(stderr, "Instructions executed: %ld\n", executed);
+   return 0;
+}
@@ -11,6 +11,10 @@
 #define NO_PARSE TRUE
 /* set NO_ANALYZE to TRUE to get a parser-only compiler */
 #define NO_ANALYZE FALSE
+/* set NO_OPTIMIZE to TRUE to skip the syntax tree
+ * optimizations between analysis and code generation
+ */
+#define NO_OPTIMIZE FALSE
 
 /* set NO_CODE to TRUE to get a compiler that does not
  * generate code
@@ -25,9 +29,22 @@
 #if !NO_ANALYZE
 #include "analyze.h"
 #endif
+#if !NO_OPTIMIZE
+#include "optimize.h"
+#include "pgo.h"
+#endif
 #if !NO_CODE
 #include "cgen.h"
+#include "xgen.h"
+#include "ccgen.h"
+#include "mipsasm.h"
+#include "report.h"
 #endif
+#include "vm.h"
+#include "jit.h"
+#include "stats.h"
+#include "cache.h"
+#include "incr.h"
 
 
 /* allocate global variables */
@@ -35,27 +52,224 @@ int lineno = 0;
 FILE * source;
 FILE * listing;
 FILE * code;
+FILE * lineMap = NULL;
 
 /* allocate and set tracing flags */
 int EchoSource = FALSE;
 int TraceScan = FALSE;
 int TraceParse = FALSE;
 int TraceAnalyze = TRUE;
+int TraceOptimize = TRUE;
 int TraceCode = TRUE;
 
+int Prompts = TRUE;
+int LineComments = FALSE;
+int Profiling = FALSE;
+int CodeReport = FALSE;
+
 int Error = FALSE;
 
+/* --run: execute the program in the bytecode VM
+ * instead of writing a .tm file
+ */
+static int RunProgram = FALSE;
+
+/* --jit: compile to x86-64 machine code in memory
+ * and run it in this process
+ */
+static int JitProgram = FALSE;
+
+/* --target=: the code generator used when neither
+ * --run nor --jit is given. mips and tm are targets
+ * of cgen.c (see target.h) and write MIPS code (.tm)
+ * or TM machine code (.tmc); x86-64 writes assembly
+ * (.s) and c writes a C99 program (.gen.c)
+ */
+typedef enum { BackendCgen, BackendX86, BackendC } Backend;
+static Backend backend = BackendCgen;
+static Target * target = &mipsTarget;
+
+/* --format=: for the mips target, asm writes the
+ * assembly (.tm); bin and elf encode it into a binary
+ * image (.bin, which tm loads) or an ELF32 executable
+ * (.elf), see mipsasm.h
+ */
+#define FORMAT_ASM (-1)
+static int format = FORMAT_ASM;
+
+/* --line-map: for the mips assembly, write the source
+ * line and function of every instruction to a .map
+ * file (see emitSourceLine in code.h)
+ */
+static int LineMap = FALSE;
+
+/* --time-passes prints the time and peak memory of
+ * each phase, --stats the counters of stats.h, and
+ * --stats-json=FILE writes both as JSON; all but the
+ * JSON go to stderr
+ */
+static int TimePasses = FALSE;
+static int Stats = FALSE;
+
+/* --alloc-stats prints the heap usage of each
+ * subsystem (see allocate in stats.h); without it
+ * or --stats-json the allocations are not accounted
+ */
+static int AllocStats = FALSE;
+static char * statsJson = NULL;
+
+/* --pgo=FILE: optimize by the profile a --pg build of
+ * the same source printed to FILE (see pgo.h)
+ */
+static char * profileFile = NULL;
+
+/* --cache[=DIR]: reuse the listing and outputs of an
+ * identical earlier compilation (see cache.h), in a
+ * cache of at most --cache-size=MB megabytes;
+ * --cache-stats prints its hits and misses to stderr
+ */
+static int UseCache = FALSE;
+static char * cacheDir = NULL;
+static long cacheSize = 64;
+static int CacheStats = FALSE;
+
+/* --incremental: keep the code of each function in a
+ * .inc file and copy that of the unchanged ones in
+ * the next compilation (see incr.h)
+ */
+static int Incremental = FALSE;
+
+/* Function codeOption returns FALSE for the options
+ * that do not change the generated code
+ */
+static int codeOption( char * opt )
+{
+	return strncmp(opt,"--cache",7) != 0 && strncmp(opt,"--stats",7) != 0 &&
+	       strcmp(opt,"--time-passes") != 0 && strcmp(opt,"--alloc-stats") != 0 &&
+	       strcmp(opt,"--incremental") != 0;
+}
+
+static void report( void )
+{
+	if (AllocStats)
+		printAllocs(stderr);
+	if (TimePasses)
+		printTimes(stderr);
+	if (Stats)
+		printCounters(stderr);
+	if (CacheStats)
+		printCacheStats(stderr);
+	if (statsJson != NULL)
+	{	FILE * out = fopen(statsJson,"w");
+		if (out == NULL)
+		{	fprintf(stderr,"Unable to open %s\n",statsJson);
+			return;
+		}
+		writeStatsJson(out);
+		fclose(out);
+	}
+}
+
+static void usage( char * prog )
+{
+	fprintf(stderr,"usage: %s [--run | --jit] [--target=mips|tm|x86-64|c] [--format=asm|bin|elf] [--no-prompts] [--line-map] [--line-comments] [--pg | --pg-cycles] [--pgo=FILE] [--code-report] [--cache[=DIR]] [--cache-size=MB] [--cache-stats] [--incremental] [--time-passes] [--stats] [--alloc-stats] [--stats-json=FILE] <filename>\n",prog);
+	exit(1);
+}
+
 int main( int argc, char * argv[] )
 { 
 	TreeNode * syntaxTree;
 	char pgm[120]; /* source code file name */
+	int i;
   
-	if (argc != 2)
-	{ 
-		fprintf(stderr,"usage: %s <filename>\n",argv[0]);
+	for (i = 1; i < argc && argv[i][0] == '-'; i++)
+	{
+		if (strcmp(argv[i],"--run") == 0)
+			RunProgram = TRUE;
+		else if (strcmp(argv[i],"--jit") == 0)
+			JitProgram = TRUE;
+		else if (strcmp(argv[i],"--target=mips") == 0)
+		{	backend = BackendCgen;
+			target = &mipsTarget;
+		}
+		else if (strcmp(argv[i],"--target=tm") == 0)
+		{	backend = BackendCgen;
+			target = &tmTarget;
+		}
+		else if (strcmp(argv[i],"--target=x86-64") == 0)
+			backend = BackendX86;
+		else if (strcmp(argv[i],"--target=c") == 0)
+			backend = BackendC;
+		else if (strcmp(argv[i],"--no-prompts") == 0)
+			Prompts = FALSE;
+		else if (strcmp(argv[i],"--line-map") == 0)
+			LineMap = TRUE;
+		else if (strcmp(argv[i],"--line-comments") == 0)
+			LineComments = TRUE;
+		else if (strcmp(argv[i],"--pg") == 0)
+			Profiling = PROFILE_COUNTS;
+		else if (strcmp(argv[i],"--pg-cycles") == 0)
+			Profiling = PROFILE_CYCLES;
+		else if (strcmp(argv[i],"--code-report") == 0)
+			CodeReport = TRUE;
+		else if (strncmp(argv[i],"--pgo=",6) == 0 && argv[i][6] != '\0')
+			profileFile = argv[i] + 6;
+		else if (strcmp(argv[i],"--cache") == 0)
+			UseCache = TRUE;
+		else if (strncmp(argv[i],"--cache=",8) == 0 && argv[i][8] != '\0')
+		{	UseCache = TRUE;
+			cacheDir = argv[i] + 8;
+		}
+		else if (strncmp(argv[i],"--cache-size=",13) == 0 && atol(argv[i] + 13) > 0)
+			cacheSize = atol(argv[i] + 13);
+		else if (strcmp(argv[i],"--cache-stats") == 0)
+			CacheStats = TRUE;
+		else if (strcmp(argv[i],"--incremental") == 0)
+			Incremental = TRUE;
+		else if (strcmp(argv[i],"--time-passes") == 0)
+			TimePasses = TRUE;
+		else if (strcmp(argv[i],"--stats") == 0)
+			Stats = TRUE;
+		else if (strcmp(argv[i],"--alloc-stats") == 0)
+			AllocStats = TRUE;
+		else if (strncmp(argv[i],"--stats-json=",13) == 0 && argv[i][13] != '\0')
+			statsJson = argv[i] + 13;
+		else if (strcmp(argv[i],"--format=asm") == 0)
+			format = FORMAT_ASM;
+		else if (strcmp(argv[i],"--format=bin") == 0)
+			format = IMAGE_BIN;
+		else if (strcmp(argv[i],"--format=elf") == 0)
+			format = IMAGE_ELF;
+		else
+			usage(argv[0]);
+	}
+	/* only pay for the block headers when they are reported */
+	accountAllocs = AllocStats || statsJson != NULL;
+	if (i != argc - 1)
+		usage(argv[0]);
+	if (format != FORMAT_ASM && (backend != BackendCgen || target != &mipsTarget))
+	{	fprintf(stderr,"--format=bin and elf need --target=mips\n");
+		exit(1);
+	}
+	if ((LineMap || LineComments || Profiling || CodeReport) &&
+	    (backend != BackendCgen || target != &mipsTarget || RunProgram || JitProgram))
+	{	fprintf(stderr,"--line-map, --line-comments, --pg and --code-report need --target=mips\n");
+		exit(1);
+	}
+	/* the kept code is MIPS assembly without per-instruction
+	   line, profile or report records; --pgo may inline the
+	   bodies incrPrune sets aside */
+	if (Incremental && (backend != BackendCgen || target != &mipsTarget ||
+	    RunProgram || JitProgram || LineMap || LineComments || Profiling ||
+	    profileFile != NULL || CodeReport))
+	{	fprintf(stderr,"--incremental needs --target=mips, without --line-map, --line-comments, --pg, --pgo and --code-report\n");
+		exit(1);
+	}
+	if (LineMap && format != FORMAT_ASM)
+	{	fprintf(stderr,"--line-map needs --format=asm\n");
 		exit(1);
 	}
-	strcpy(pgm,argv[1]) ;
+	strcpy(pgm,argv[i]) ;
 	if (strchr (pgm, '.') == NULL)
 		strcat(pgm,".tny");
 	source = fopen(pgm,"r");
@@ -66,45 +280,204 @@ int main( int argc, char * argv[] )
 		exit(1);
 	}
 	listing = stdout; /* send listing to screen */
+	/* the program's own output goes to stdout when running */
+	if (RunProgram || JitProgram)
+		listing = stderr;
+	/* a program that runs is not compiled to a file */
+	else if (UseCache && cacheOpen(cacheDir, cacheSize << 20))
+	{	int j;
+		for (j = 1; j < i; j++)
+			if (strncmp(argv[j],"--cache",7) != 0)
+				cacheKey(argv[j], strlen(argv[j]) + 1);
+		cacheKey(pgm, strlen(pgm) + 1);
+		cacheKeyFile(pgm);
+		if (profileFile != NULL)
+			cacheKeyFile(profileFile);
+		phaseBegin("cache");
+		if (cacheFetch())
+		{	phaseEnd();
+			fclose(source);
+			report();
+			return 0;
+		}
+		phaseEnd();
+		listing = cacheListing();
+	}
 	//fprintf(listing,"\nTINY COMPILATION: %s\n",pgm);
 	//printf("   line Number\t\ttoken\t\tlexeme\n");
 	//printf("-------------------------------------------------------\n");
 //#if NO_PARSE
   //while (getToken()!=ENDFILE);
 //#else
+  phaseBegin("parse");
   syntaxTree = parse();
+  phaseEnd();
   if (TraceParse) {
     fprintf(listing,"\nSyntax tree:\n");
     printTree(syntaxTree);
   }
+  if (! Error && Incremental)
+  { int fnlen = strcspn(pgm,".");
+    char * incfile = (char *) allocate(AllocString, fnlen+5);
+    int j;
+    strncpy(incfile,pgm,fnlen);
+    strcpy(incfile+fnlen,".inc");
+    if (TraceAnalyze) fprintf(listing,"\nComparing with the Last Compilation...\n");
+    phaseBegin("incremental");
+    incrOpen(incfile);
+    for (j = 1; j < i; j++)
+      if (codeOption(argv[j]))
+        incrKey(argv[j], strlen(argv[j]) + 1);
+    incrPrune(syntaxTree);
+    phaseEnd();
+  }
 #if !NO_ANALYZE
   if (! Error)
   { if (TraceAnalyze) fprintf(listing,"\nBuilding Symbol Table...\n");
+    phaseBegin("symtab");
     buildSymtab(syntaxTree);
+    phaseEnd();
     if( !Error ){
       if (TraceAnalyze) fprintf(listing,"\nChecking Types...\n");
+      phaseBegin("typecheck");
       typeCheck(syntaxTree);
+      phaseEnd();
       if (TraceAnalyze) fprintf(listing,"\nType Checking Finished\n");
     }
   }
 #endif
+#if !NO_OPTIMIZE
+  if (! Error)
+  { if (TraceOptimize) fprintf(listing,"\nFolding Constants...\n");
+    phaseBegin("fold");
+    foldConstants(syntaxTree);
+    phaseEnd();
+    if (TraceOptimize) fprintf(listing,"\nEliminating Dead Code...\n");
+    phaseBegin("dce");
+    syntaxTree = eliminateDeadCode(syntaxTree);
+    phaseEnd();
+    /* the sites are numbered after the same passes in
+       the --pg build and the --pgo build */
+    if (Profiling || profileFile != NULL)
+    { phaseBegin("pgo");
+      numberSites(syntaxTree);
+      if (profileFile != NULL)
+      { int records = readProfile(profileFile);
+        if (records <= 0)
+        { fprintf(stderr,records < 0 ? "Unable to open %s\n" :
+                                       "%s holds no --pg profile\n",profileFile);
+          exit(1);
+        }
+        if (TraceOptimize) fprintf(listing,"\nApplying the Profile...\n");
+        applyProfile(syntaxTree);
+      }
+      phaseEnd();
+    }
+    if (TraceOptimize) fprintf(listing,"\nNumbering Values...\n");
+    /* only the targets of cgen.c use the numbered values */
+    phaseBegin("values");
+    numberValues(syntaxTree, backend == BackendCgen && ! RunProgram &&
+                             ! JitProgram ? target->numValueRegs : 0);
+    phaseEnd();
+  }
+#endif
+  if (! Error && RunProgram)
+  { int status;
+    fclose(source);
+    phaseBegin("run");
+    status = vmRun(syntaxTree);
+    phaseEnd();
+    report();
+    return status;
+  }
+  if (! Error && JitProgram)
+  { int status;
+    fclose(source);
+    phaseBegin("jit");
+    status = jitRun(syntaxTree);
+    phaseEnd();
+    report();
+    return status;
+  }
 #if !NO_CODE
   if (! Error)
   { char * codefile;
     int fnlen = strcspn(pgm,".");
-    codefile = (char *) calloc(fnlen+4, sizeof(char));
+    codefile = (char *) allocate(AllocString, fnlen+8);
+    memset(codefile,0,fnlen+8);
     strncpy(codefile,pgm,fnlen);
-    strcat(codefile,".tm");
-    code = fopen(codefile,"w");
+    strcat(codefile,backend == BackendX86 ? ".s" :
+                    backend == BackendC ? ".gen.c" :
+                    format == IMAGE_BIN ? ".bin" :
+                    format == IMAGE_ELF ? ".elf" : target->suffix);
+    /* an image is encoded from the assembly, which
+       goes to a temporary file */
+    code = format == FORMAT_ASM ? fopen(codefile,"w") : tmpfile();
+    cacheOutput(codefile);
     if (code == NULL)
     { printf("Unable to open %s\n",codefile);
       exit(1);
     }
-    codeGen(syntaxTree,codefile);
+    if (LineMap)
+    { char * mapfile = (char *) allocate(AllocString, fnlen+5);
+      strncpy(mapfile,pgm,fnlen);
+      strcpy(mapfile+fnlen,".map");
+      lineMap = fopen(mapfile,"w");
+      cacheOutput(mapfile);
+      if (lineMap == NULL)
+      { printf("Unable to open %s\n",mapfile);
+        exit(1);
+      }
+    }
+    phaseBegin("codegen");
+    if (backend == BackendX86)
+      x86CodeGen(syntaxTree,codefile);
+    else if (backend == BackendC)
+      cCodeGen(syntaxTree,codefile);
+    else
+      codeGen(syntaxTree,codefile,target);
+    phaseEnd();
+    if (lineMap != NULL)
+      fclose(lineMap);
+    if (CodeReport)
+    { char * reportfile = (char *) allocate(AllocString, fnlen+8);
+      FILE * report;
+      strncpy(reportfile,pgm,fnlen);
+      strcpy(reportfile+fnlen,".report");
+      report = fopen(reportfile,"w");
+      cacheOutput(reportfile);
+      if (report == NULL)
+      { printf("Unable to open %s\n",reportfile);
+        exit(1);
+      }
+      writeCodeReport(report,pgm);
+      fclose(report);
+    }
+    if (format != FORMAT_ASM)
+    { FILE * image = fopen(codefile,"wb");
+      if (image == NULL)
+      { printf("Unable to open %s\n",codefile);
+        exit(1);
+      }
+      rewind(code);
+      phaseBegin("assemble");
+      if (! mipsAssemble(code,image,format))
+      { fclose(image);
+        remove(codefile);
+        exit(1);
+      }
+      phaseEnd();
+      fclose(image);
+    }
     fclose(code);
   }
 #endif
   fclose(source);
+  if (! Error)
+  { incrSave();
+    cacheStore();
+  }
+  report();
   return 0;
 }
 
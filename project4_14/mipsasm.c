@@ -0,0 +1,1104 @@
+/****************************************************/
+/* File: mipsasm.c                                  */
+/* MIPS32 encoder for the code the C- compiler      */
+/* emits: two passes over the assembly (addresses,  */
+/* then words) and a binary or ELF32 image          */
+/****************************************************/
+
+#include <limits.h>
+#include "globals.h"
+#include "util.h"
+#include "stats.h"
+#include "image.h"
+#include "mipsasm.h"
+
+#define LINESIZE 1024
+#define MAXOPS 8
+#define AT 1          /* $at, the assembler temporary */
+#define RA 31
+
+typedef struct {
+   char *name;
+   int inText;
+   unsigned int addr;
+   int isFunc;        /* main or the target of a jal */
+} SYMBOL;
+
+typedef struct {
+   unsigned char *b;
+   int size, cap;
+} BUFFER;
+
+static char **lines = NULL;
+static int lineCount = 0;
+static int lineNo;
+static int pass;             /* 1: addresses, 2: words */
+static int failed;
+
+static SYMBOL *syms = NULL;
+static int symCount = 0, symSize = 0;
+
+static BUFFER text, data;
+
+static char *regNames[32] = {
+   "zero", "at", "v0", "v1", "a0", "a1", "a2", "a3",
+   "t0", "t1", "t2", "t3", "t4", "t5", "t6", "t7",
+   "s0", "s1", "s2", "s3", "s4", "s5", "s6", "s7",
+   "t8", "t9", "k0", "k1", "gp", "sp", "fp", "ra"
+};
+
+/********************************************/
+static void error(char *msg, char *arg)
+{
+   if (pass == 2 || arg == NULL || strcmp(msg, "undefined label") != 0)
+   {
+      fprintf(listing, "mipsasm: line %d: %s%s%s\n", lineNo, msg,
+              arg ? " " : "", arg ? arg : "");
+      failed = TRUE;
+   }
+}
+
+static char *trim(char *s)
+{
+   char *e;
+   while (isspace((unsigned char)*s))
+      s++;
+   e = s + strlen(s);
+   while (e > s && isspace((unsigned char)e[-1]))
+      *--e = '\0';
+   return s;
+}
+
+static void put(BUFFER *b, int size, unsigned int v)
+{
+   int i;
+   if (b->size + size > b->cap)
+   {
+      b->cap = 2 * (b->size + size) + 1024;
+      b->b = (unsigned char *)reallocate(AllocCodegen, b->b, b->cap);
+   }
+   for (i = 0; i < size; i++)
+      b->b[b->size++] = (unsigned char)(v >> (8 * i));
+}
+
+static SYMBOL *findSym(char *name)
+{
+   int i;
+   for (i = 0; i < symCount; i++)
+      if (strcmp(syms[i].name, name) == 0)
+         return &syms[i];
+   return NULL;
+}
+
+static void addSym(char *name, int inText, unsigned int addr)
+{
+   if (findSym(name) != NULL)
+   {
+      error("duplicate label", name);
+      return;
+   }
+   if (symCount == symSize)
+   {
+      symSize = symSize ? 2 * symSize : 64;
+      syms = (SYMBOL *)reallocate(AllocCodegen, syms, symSize * sizeof(SYMBOL));
+   }
+   syms[symCount].name = copyString(name);
+   syms[symCount].inText = inText;
+   syms[symCount].addr = addr;
+   syms[symCount].isFunc = FALSE;
+   symCount++;
+}
+
+/********************************************/
+static int getReg(char *s)
+{
+   int i;
+   s = trim(s);
+   if (*s != '$')
+   {
+      error("register expected:", s);
+      return 0;
+   }
+   s++;
+   if (isdigit((unsigned char)*s))
+   {
+      i = atoi(s);
+      if (i >= 0 && i < 32)
+         return i;
+   }
+   else
+      for (i = 0; i < 32; i++)
+         if (strcmp(s, regNames[i]) == 0)
+            return i;
+   if (strcmp(s, "s8") == 0)
+      return 30;
+   error("unknown register", s - 1);
+   return 0;
+}
+
+static int isReg(char *s)
+{
+   return *trim(s) == '$';
+}
+
+/* Function getValue evaluates a sum of numbers,
+ * character literals and labels. hasLabel is set if
+ * a label is used: its value is unknown in pass 1,
+ * so the encoding must not depend on it
+ */
+static int getValue(char *s, int *hasLabel)
+{
+   char term[LINESIZE];
+   SYMBOL *l;
+   int sign = 1, n, v, val = 0;
+   if (hasLabel != NULL)
+      *hasLabel = FALSE;
+   for (s = trim(s); *s; )
+   {
+      if (*s == '+' || *s == '-')
+      {
+         if (*s++ == '-')
+            sign = -sign;
+         continue;
+      }
+      if (isspace((unsigned char)*s))
+      {
+         s++;
+         continue;
+      }
+      if (*s == '\'')
+      {
+         v = (unsigned char)s[1];
+         if (s[1] == '\\')
+         {
+            v = s[2] == 'n' ? '\n' : s[2] == 't' ? '\t' : s[2] == '0' ? 0 : s[2];
+            s++;
+         }
+         if (s[2] != '\'')
+         {
+            error("bad character literal", NULL);
+            return 0;
+         }
+         s += 3;
+      }
+      else if (isdigit((unsigned char)*s))
+         v = (int)strtoul(s, &s, 0);
+      else if (isalpha((unsigned char)*s) || *s == '_' || *s == '.')
+      {
+         n = 0;
+         while (isalnum((unsigned char)*s) || *s == '_' || *s == '.')
+            term[n++] = *s++;
+         term[n] = '\0';
+         if (hasLabel == NULL)
+         {
+            error("number expected:", term);
+            return 0;
+         }
+         *hasLabel = TRUE;
+         v = 0;
+         if ((l = findSym(term)) != NULL)
+            v = (int)l->addr;
+         else
+            error("undefined label", term);
+      }
+      else
+      {
+         error("bad operand", s);
+         return 0;
+      }
+      val += sign * v;
+      sign = 1;
+   }
+   return val;
+}
+
+/* Function splitOperands splits s at the commas that
+ * are outside quotes and parentheses
+ */
+static int splitOperands(char *s, char **ops)
+{
+   int n = 0, depth = 0, quote = FALSE, i;
+   if (*trim(s) == '\0')
+      return 0;
+   ops[n++] = s;
+   for (; *s; s++)
+   {
+      if (*s == '\'')
+         quote = !quote;
+      else if (quote)
+         continue;
+      else if (*s == '(')
+         depth++;
+      else if (*s == ')')
+         depth--;
+      else if (*s == ',' && depth == 0)
+      {
+         *s = '\0';
+         if (n == MAXOPS)
+         {
+            error("too many operands", NULL);
+            break;
+         }
+         ops[n++] = s + 1;
+      }
+   }
+   for (i = 0; i < n; i++)
+      ops[i] = trim(ops[i]);
+   return n;
+}
+
+/********************************************/
+/* instruction formats */
+static unsigned int textAddr(void)
+{
+   return IMAGE_TEXT_BASE + (unsigned int)text.size;
+}
+
+static void word(unsigned int w)
+{
+   put(&text, 4, w);
+}
+
+static void rType(int rs, int rt, int rd, int sh, int funct)
+{
+   word((unsigned int)rs << 21 | (unsigned int)rt << 16 |
+        (unsigned int)rd << 11 | (unsigned int)(sh & 31) << 6 | funct);
+}
+
+static void iType(int op, int rs, int rt, int imm)
+{
+   word((unsigned int)op << 26 | (unsigned int)rs << 21 |
+        (unsigned int)rt << 16 | ((unsigned int)imm & 0xffff));
+}
+
+static int fitsSigned(int v)
+{
+   return v >= -32768 && v <= 32767;
+}
+
+/* Procedure li loads v into rd in one or two words;
+ * a value with a label always takes lui/ori
+ */
+static void li(int rd, int v, int hasLabel)
+{
+   unsigned int u = (unsigned int)v;
+   if (!hasLabel && fitsSigned(v))
+      iType(0x09, 0, rd, v);                    /* addiu */
+   else if (!hasLabel && u <= 0xffff)
+      iType(0x0d, 0, rd, v);                    /* ori */
+   else
+   {
+      iType(0x0f, 0, rd, (int)(u >> 16));       /* lui */
+      if ((u & 0xffff) != 0 || hasLabel)
+         iType(0x0d, rd, rd, (int)(u & 0xffff));
+   }
+}
+
+/* Function operandReg returns the register of the
+ * last operand s, loading a value into $at first
+ */
+static int operandReg(char *s)
+{
+   int v, hasLabel;
+   if (isReg(s))
+      return getReg(s);
+   v = getValue(s, &hasLabel);
+   if (!hasLabel && v == 0)
+      return 0;
+   li(AT, v, hasLabel);
+   return AT;
+}
+
+/* Procedure delaySlot fills the delay slot after a
+ * jump or branch
+ */
+static void delaySlot(void)
+{
+   word(0);
+}
+
+static void branch(int op, int rs, int rt, char *label)
+{
+   int off, hasLabel;
+   unsigned int target = (unsigned int)getValue(label, &hasLabel);
+   off = (int)(target - (textAddr() + 4)) / 4;
+   if (pass == 2 && !fitsSigned(off))
+      error("branch out of range:", label);
+   iType(op, rs, rt, off);
+   delaySlot();
+}
+
+static void jump(int op, char *label)
+{
+   int hasLabel;
+   unsigned int target = (unsigned int)getValue(label, &hasLabel);
+   SYMBOL *l;
+   if (pass == 2 && ((target ^ textAddr()) & 0xf0000000u) != 0)
+      error("jump out of range:", label);
+   if (op == 3 && (l = findSym(trim(label))) != NULL)
+      l->isFunc = TRUE;
+   word((unsigned int)op << 26 | ((target >> 2) & 0x3ffffff));
+   delaySlot();
+}
+
+/********************************************/
+/* instruction handlers; arg selects the variant */
+typedef struct {
+   char *name;
+   void (*fn)(char **ops, int n, int arg, int arg2);
+   int arg, arg2;
+} OPENTRY;
+
+#define IMM_SIGNED 1
+#define IMM_UNSIGNED 2
+#define IMM_NEGATED 3
+#define IMM_NONE 4
+
+/* funct of the register form, and opcode and kind
+ * of the immediate form
+ */
+static void alu(char **ops, int n, int funct, int imm)
+{
+   int rd, rs, v, hasLabel, immOp = imm >> 8, kind = imm & 0xff;
+   char *last;
+   if (n != 2 && n != 3)
+   {
+      error("two or three operands expected", NULL);
+      return;
+   }
+   rd = getReg(ops[0]);
+   rs = getReg(ops[n - 2]);
+   last = ops[n - 1];
+   if (isReg(last))
+   {
+      rType(rs, getReg(last), rd, 0, funct);
+      return;
+   }
+   v = getValue(last, &hasLabel);
+   if (!hasLabel && kind == IMM_SIGNED && fitsSigned(v))
+      iType(immOp, rs, rd, v);
+   else if (!hasLabel && kind == IMM_NEGATED && v != INT_MIN && fitsSigned(-v))
+      iType(immOp, rs, rd, -v);
+   else if (!hasLabel && kind == IMM_UNSIGNED && (unsigned int)v <= 0xffff)
+      iType(immOp, rs, rd, v);
+   else
+   {
+      li(AT, v, hasLabel);
+      rType(rs, AT, rd, 0, funct);
+   }
+}
+
+static void shift(char **ops, int n, int funct, int vfunct)
+{
+   int rd, rt;
+   if (n != 3)
+   {
+      error("three operands expected", NULL);
+      return;
+   }
+   rd = getReg(ops[0]);
+   rt = getReg(ops[1]);
+   if (isReg(ops[2]))
+      rType(getReg(ops[2]), rt, rd, 0, vfunct);
+   else
+      rType(0, rt, rd, getValue(ops[2], NULL), funct);
+}
+
+static void mul(char **ops, int n, int arg, int arg2)
+{
+   int rd, rs, rt;
+   if (n != 3)
+   {
+      error("three operands expected", NULL);
+      return;
+   }
+   rd = getReg(ops[0]);
+   rs = getReg(ops[1]);
+   rt = operandReg(ops[2]);
+   word(0x1cu << 26 | (unsigned int)rs << 21 | (unsigned int)rt << 16 |
+        (unsigned int)rd << 11 | 0x02);
+}
+
+/* div and divu, and with three operands the pseudo-op
+ * that also moves the quotient (mflo) or the
+ * remainder (mfhi, for rem and remu)
+ */
+static void divide(char **ops, int n, int funct, int mf)
+{
+   int rd, rs, rt;
+   if (n == 2 && mf == 0x12)
+   {
+      rType(getReg(ops[0]), getReg(ops[1]), 0, 0, funct);
+      return;
+   }
+   if (n != 3)
+   {
+      error("three operands expected", NULL);
+      return;
+   }
+   rd = getReg(ops[0]);
+   rs = getReg(ops[1]);
+   rt = operandReg(ops[2]);
+   rType(rs, rt, 0, 0, funct);
+   rType(0, 0, rd, 0, mf);
+}
+
+static void hilo(char **ops, int n, int funct, int arg2)
+{
+   if (funct == 0x10 || funct == 0x12)          /* mfhi, mflo */
+   {
+      if (n != 1)
+         error("one register expected", NULL);
+      else
+         rType(0, 0, getReg(ops[0]), 0, funct);
+   }
+   else if (n != 2)
+      error("two registers expected", NULL);
+   else
+      rType(getReg(ops[0]), getReg(ops[1]), 0, 0, funct);
+}
+
+/* the set pseudo-ops, from slt, xor and xori */
+static void set(char **ops, int n, int which, int arg2)
+{
+   int rd, rs, rt;
+   if (n != 3)
+   {
+      error("three operands expected", NULL);
+      return;
+   }
+   rd = getReg(ops[0]);
+   rs = getReg(ops[1]);
+   rt = operandReg(ops[2]);
+   switch (which)
+   {
+   case 0:                                  /* sgt */
+      rType(rt, rs, rd, 0, 0x2a);
+      break;
+   case 1:                                  /* sle */
+      rType(rt, rs, rd, 0, 0x2a);
+      iType(0x0e, rd, rd, 1);
+      break;
+   case 2:                                  /* sge */
+      rType(rs, rt, rd, 0, 0x2a);
+      iType(0x0e, rd, rd, 1);
+      break;
+   case 3:                                  /* seq */
+      rType(rs, rt, rd, 0, 0x26);
+      iType(0x0b, rd, rd, 1);
+      break;
+   default:                                 /* sne */
+      rType(rs, rt, rd, 0, 0x26);
+      rType(0, rd, rd, 0, 0x2b);
+      break;
+   }
+}
+
+/* move, li, lui, neg, not and abs */
+static void unary(char **ops, int n, int which, int arg2)
+{
+   int rd, rs, v, hasLabel;
+   if (n != 2)
+   {
+      error("two operands expected", NULL);
+      return;
+   }
+   rd = getReg(ops[0]);
+   if (which == 1 || which == 2)
+   {
+      v = getValue(ops[1], &hasLabel);
+      if (which == 1)
+         li(rd, v, hasLabel);
+      else
+         iType(0x0f, 0, rd, v);
+      return;
+   }
+   rs = getReg(ops[1]);
+   switch (which)
+   {
+   case 0: rType(rs, 0, rd, 0, 0x21); break;   /* addu rd,rs,$0 */
+   case 3: rType(0, rs, rd, 0, 0x23); break;   /* subu rd,$0,rs */
+   case 4: rType(rs, 0, rd, 0, 0x27); break;   /* nor rd,rs,$0 */
+   default:
+      rType(0, rs, AT, 31, 0x03);              /* sra $at,rs,31 */
+      rType(rs, AT, rd, 0, 0x26);
+      rType(rd, AT, rd, 0, 0x23);
+      break;
+   }
+}
+
+/* Procedure memOperand splits "expr(reg)" */
+static void memOperand(char *s, int *v, int *hasLabel, int *base)
+{
+   char buf[LINESIZE], *paren, *close;
+   strncpy(buf, s, LINESIZE - 1);
+   buf[LINESIZE - 1] = '\0';
+   *base = 0;
+   if ((paren = strchr(buf, '(')) != NULL)
+   {
+      *paren = '\0';
+      if ((close = strchr(paren + 1, ')')) == NULL)
+         error("')' expected", NULL);
+      else
+         *close = '\0';
+      *base = getReg(paren + 1);
+   }
+   *v = getValue(buf, hasLabel);
+}
+
+/* Procedure access emits a load or store of rt at
+ * v(base); offsets beyond 16 bits and labels go
+ * through $at
+ */
+static void access(int op, int rt, int v, int hasLabel, int base)
+{
+   if (!hasLabel && fitsSigned(v))
+   {
+      iType(op, base, rt, v);
+      return;
+   }
+   iType(0x0f, 0, AT, (int)(((unsigned int)v + 0x8000u) >> 16));
+   if (base != 0)
+      rType(AT, base, AT, 0, 0x21);
+   iType(op, AT, rt, v);
+}
+
+/* loads and stores; ld and sd move two words */
+static void memory(char **ops, int n, int op, int twoWords)
+{
+   int rt, v, hasLabel, base;
+   if (n != 2)
+   {
+      error("two operands expected", NULL);
+      return;
+   }
+   rt = getReg(ops[0]);
+   memOperand(ops[1], &v, &hasLabel, &base);
+   access(op, rt, v, hasLabel, base);
+   if (twoWords)
+      access(op, (rt + 1) & 31, v + 4, hasLabel, base);
+}
+
+static void la(char **ops, int n, int arg, int arg2)
+{
+   int rd, v, hasLabel, base;
+   if (n != 2)
+   {
+      error("two operands expected", NULL);
+      return;
+   }
+   rd = getReg(ops[0]);
+   memOperand(ops[1], &v, &hasLabel, &base);
+   if (!hasLabel && fitsSigned(v))
+      iType(0x09, base, rd, v);                 /* addiu */
+   else if (base == 0)
+      li(rd, v, TRUE);
+   else
+   {
+      li(AT, v, TRUE);
+      rType(AT, base, rd, 0, 0x21);
+   }
+}
+
+static void jumps(char **ops, int n, int which, int arg2)
+{
+   int rd = RA;
+   if (n < 1 || n > 2 || (which < 2 && n != 1))
+   {
+      error("wrong number of operands", NULL);
+      return;
+   }
+   switch (which)
+   {
+   case 0: jump(2, ops[0]); break;             /* j, b */
+   case 1: jump(3, ops[0]); break;             /* jal */
+   case 2:                                     /* jr */
+      rType(getReg(ops[0]), 0, 0, 0, 0x08);
+      delaySlot();
+      break;
+   default:                                    /* jalr */
+      if (n == 2)
+         rd = getReg(ops[0]);
+      rType(getReg(ops[n - 1]), 0, rd, 0, 0x09);
+      delaySlot();
+      break;
+   }
+}
+
+/* beq and bne, and the compare-with-zero forms */
+static void branches(char **ops, int n, int op, int rt)
+{
+   int rs;
+   if (rt >= 0)                     /* beqz rs,L  bltz rs,L ... */
+   {
+      if (n != 2)
+         error("two operands expected", NULL);
+      else if (op == 1)
+         branch(1, getReg(ops[0]), rt, ops[1]);   /* REGIMM */
+      else
+         branch(op, getReg(ops[0]), 0, ops[1]);
+      return;
+   }
+   if (n != 3)
+   {
+      error("three operands expected", NULL);
+      return;
+   }
+   rs = getReg(ops[0]);
+   branch(op, rs, operandReg(ops[1]), ops[2]);
+}
+
+/* blt, bge, ble and bgt: slt into $at, then bne/beq */
+static void compareBranch(char **ops, int n, int swap, int op)
+{
+   int rs, rt, v, hasLabel;
+   if (n != 3)
+   {
+      error("three operands expected", NULL);
+      return;
+   }
+   rs = getReg(ops[0]);
+   if (isReg(ops[1]))
+      rt = getReg(ops[1]);
+   else
+   {
+      v = getValue(ops[1], &hasLabel);
+      if (!swap && !hasLabel && fitsSigned(v))
+      {
+         iType(0x0a, rs, AT, v);                /* slti */
+         branch(op, AT, 0, ops[2]);
+         return;
+      }
+      li(AT, v, hasLabel);
+      rt = AT;
+   }
+   if (swap)
+      rType(rt, rs, AT, 0, 0x2a);
+   else
+      rType(rs, rt, AT, 0, 0x2a);
+   branch(op, AT, 0, ops[2]);
+}
+
+static void plain(char **ops, int n, int w, int arg2)
+{
+   if (n != 0)
+      error("no operands expected", NULL);
+   word((unsigned int)w);
+}
+
+/* rdhwr rt,rd: MIPS32r2 SPECIAL3 */
+static void hwReg(char **ops, int n, int arg, int arg2)
+{
+   if (n != 2)
+      error("two registers expected", NULL);
+   else
+      word(0x1fu << 26 | getReg(ops[0]) << 16 | getReg(ops[1]) << 11 | 0x3b);
+}
+
+#define ALU(f, op, k) alu, f, (op) << 8 | (k)
+static OPENTRY opTab[] = {
+   {"add", ALU(0x20, 0x08, IMM_SIGNED)}, {"addi", ALU(0x20, 0x08, IMM_SIGNED)},
+   {"addu", ALU(0x21, 0x09, IMM_SIGNED)}, {"addiu", ALU(0x21, 0x09, IMM_SIGNED)},
+   {"sub", ALU(0x22, 0x08, IMM_NEGATED)}, {"subu", ALU(0x23, 0x09, IMM_NEGATED)},
+   {"and", ALU(0x24, 0x0c, IMM_UNSIGNED)}, {"andi", ALU(0x24, 0x0c, IMM_UNSIGNED)},
+   {"or", ALU(0x25, 0x0d, IMM_UNSIGNED)}, {"ori", ALU(0x25, 0x0d, IMM_UNSIGNED)},
+   {"xor", ALU(0x26, 0x0e, IMM_UNSIGNED)}, {"xori", ALU(0x26, 0x0e, IMM_UNSIGNED)},
+   {"nor", ALU(0x27, 0, IMM_NONE)},
+   {"slt", ALU(0x2a, 0x0a, IMM_SIGNED)}, {"slti", ALU(0x2a, 0x0a, IMM_SIGNED)},
+   {"sltu", ALU(0x2b, 0x0b, IMM_SIGNED)}, {"sltiu", ALU(0x2b, 0x0b, IMM_SIGNED)},
+   {"sll", shift, 0x00, 0x04}, {"sllv", shift, 0x00, 0x04},
+   {"srl", shift, 0x02, 0x06}, {"srlv", shift, 0x02, 0x06},
+   {"sra", shift, 0x03, 0x07}, {"srav", shift, 0x03, 0x07},
+   {"mul", mul, 0, 0}, {"mulo", mul, 0, 0}, {"mulou", mul, 0, 0},
+   {"div", divide, 0x1a, 0x12}, {"divu", divide, 0x1b, 0x12},
+   {"rem", divide, 0x1a, 0x10}, {"remu", divide, 0x1b, 0x10},
+   {"mult", hilo, 0x18, 0}, {"multu", hilo, 0x19, 0},
+   {"mfhi", hilo, 0x10, 0}, {"mflo", hilo, 0x12, 0},
+   {"sgt", set, 0, 0}, {"sle", set, 1, 0}, {"sge", set, 2, 0},
+   {"seq", set, 3, 0}, {"sne", set, 4, 0},
+   {"move", unary, 0, 0}, {"li", unary, 1, 0}, {"lui", unary, 2, 0},
+   {"neg", unary, 3, 0}, {"negu", unary, 3, 0}, {"not", unary, 4, 0},
+   {"abs", unary, 5, 0},
+   {"lw", memory, 0x23, 0}, {"sw", memory, 0x2b, 0},
+   {"lb", memory, 0x20, 0}, {"lbu", memory, 0x24, 0}, {"sb", memory, 0x28, 0},
+   {"lh", memory, 0x21, 0}, {"lhu", memory, 0x25, 0}, {"sh", memory, 0x29, 0},
+   {"ld", memory, 0x23, 1}, {"sd", memory, 0x2b, 1},
+   {"la", la, 0, 0},
+   {"j", jumps, 0, 0}, {"b", jumps, 0, 0}, {"jal", jumps, 1, 0},
+   {"jr", jumps, 2, 0}, {"jalr", jumps, 3, 0},
+   {"beq", branches, 0x04, -1}, {"bne", branches, 0x05, -1},
+   {"beqz", branches, 0x04, 0}, {"bnez", branches, 0x05, 0},
+   {"blez", branches, 0x06, 0}, {"bgtz", branches, 0x07, 0},
+   {"bltz", branches, 0x01, 0}, {"bgez", branches, 0x01, 1},
+   {"blt", compareBranch, 0, 0x05}, {"bge", compareBranch, 0, 0x04},
+   {"bgt", compareBranch, 1, 0x05}, {"ble", compareBranch, 1, 0x04},
+   {"syscall", plain, 0x0c, 0}, {"nop", plain, 0, 0},
+   {"rdhwr", hwReg, 0, 0},
+   {NULL, NULL, 0, 0}
+};
+
+/********************************************/
+static void putString(char *s, int zero)
+{
+   int c;
+   s = trim(s);
+   if (*s++ != '"')
+   {
+      error("string expected", NULL);
+      return;
+   }
+   while (*s && *s != '"')
+   {
+      c = *s++;
+      if (c == '\\')
+      {
+         c = *s++;
+         c = c == 'n' ? '\n' : c == 't' ? '\t' : c == '0' ? '\0' : c;
+      }
+      put(&data, 1, (unsigned int)c);
+   }
+   if (zero)
+      put(&data, 1, 0);
+}
+
+static void align(BUFFER *b, int n)
+{
+   while (b->size % n != 0)
+      put(b, 1, 0);
+}
+
+static void directive(char *dir, char *rest, int *inText)
+{
+   char *ops[MAXOPS];
+   int i, n, v, size, hasLabel;
+   if (strcmp(dir, ".data") == 0)
+      *inText = FALSE;
+   else if (strcmp(dir, ".text") == 0)
+      *inText = TRUE;
+   else if (strcmp(dir, ".asciiz") == 0 || strcmp(dir, ".ascii") == 0)
+      putString(rest, dir[6] == 'z');
+   else if (strcmp(dir, ".word") == 0 || strcmp(dir, ".half") == 0 ||
+            strcmp(dir, ".byte") == 0)
+   {
+      /* words and halfwords are aligned, as in SPIM */
+      size = dir[1] == 'w' ? 4 : dir[1] == 'h' ? 2 : 1;
+      align(&data, size);
+      n = splitOperands(rest, ops);
+      for (i = 0; i < n; i++)
+         put(&data, size, (unsigned int)getValue(ops[i], &hasLabel));
+   }
+   else if (strcmp(dir, ".space") == 0)
+   {
+      for (v = getValue(rest, NULL); v > 0; v--)
+         put(&data, 1, 0);
+   }
+   else if (strcmp(dir, ".align") == 0)
+      align(*inText ? &text : &data, 1 << getValue(rest, NULL));
+   /* .globl and others have no effect */
+}
+
+/* Function labelEnd returns the ':' ending a label at
+ * the start of s, or NULL if s does not start with one
+ */
+static char *labelEnd(char *s)
+{
+   if (!isalpha((unsigned char)*s) && *s != '_' && *s != '.')
+      return NULL;
+   while (isalnum((unsigned char)*s) || *s == '_' || *s == '.')
+      s++;
+   while (*s == ' ' || *s == '\t')
+      s++;
+   return *s == ':' ? s : NULL;
+}
+
+/* Procedure assembleLine handles one line; in pass 1
+ * it defines the labels
+ */
+static void assembleLine(char *src)
+{
+   char line[LINESIZE], word[LINESIZE], *s, *p, *colon, *ops[MAXOPS];
+   static int inText;
+   int inQuote = FALSE, k, n;
+   OPENTRY *o;
+
+   if (lineNo == 1)
+      inText = TRUE;
+   strncpy(line, src, LINESIZE - 1);
+   line[LINESIZE - 1] = '\0';
+   /* strip the comment, unless the '#' is quoted */
+   for (p = line; *p; p++)
+      if (*p == '"')
+         inQuote = !inQuote;
+      else if (*p == '#' && !inQuote)
+      {
+         *p = '\0';
+         break;
+      }
+   s = trim(line);
+   while ((colon = labelEnd(s)) != NULL)
+   {
+      *colon = '\0';
+      if (pass == 1)
+         addSym(trim(s), inText, inText ? textAddr() :
+                IMAGE_DATA_BASE + (unsigned int)data.size);
+      s = trim(colon + 1);
+   }
+   if (*s == '\0')
+      return;
+   for (k = 0; s[k] && !isspace((unsigned char)s[k]); k++)
+      word[k] = s[k];
+   word[k] = '\0';
+   s = trim(s + k);
+   if (word[0] == '.')
+   {
+      directive(word, s, &inText);
+      return;
+   }
+   if (!inText)
+   {
+      error("instruction in data segment:", word);
+      return;
+   }
+   for (o = opTab; o->name != NULL && strcmp(o->name, word) != 0; o++)
+      ;
+   if (o->name == NULL)
+   {
+      error("unknown instruction", word);
+      return;
+   }
+   n = splitOperands(s, ops);
+   o->fn(ops, n, o->arg, o->arg2);
+}
+
+/********************************************/
+static void put32(FILE *out, unsigned int v)
+{
+   fputc((int)(v & 0xff), out);
+   fputc((int)((v >> 8) & 0xff), out);
+   fputc((int)((v >> 16) & 0xff), out);
+   fputc((int)(v >> 24), out);
+}
+
+static void put16(FILE *out, unsigned int v)
+{
+   fputc((int)(v & 0xff), out);
+   fputc((int)((v >> 8) & 0xff), out);
+}
+
+static void padTo(FILE *out, long off)
+{
+   while (ftell(out) < off)
+      fputc(0, out);
+}
+
+static int nameSize(void)
+{
+   int i, n = 0;
+   for (i = 0; i < symCount; i++)
+      n += strlen(syms[i].name) + 1;
+   return n;
+}
+
+static void writeBin(FILE *out, unsigned int entry)
+{
+   int i, off = 0;
+   put32(out, IMAGE_MAGIC);
+   put32(out, entry);
+   put32(out, IMAGE_TEXT_BASE);
+   put32(out, (unsigned int)text.size);
+   put32(out, IMAGE_DATA_BASE);
+   put32(out, (unsigned int)data.size);
+   put32(out, (unsigned int)symCount);
+   put32(out, (unsigned int)nameSize());
+   fwrite(text.b, 1, text.size, out);
+   fwrite(data.b, 1, data.size, out);
+   for (i = 0; i < symCount; i++)
+   {
+      put32(out, (unsigned int)off);
+      put32(out, syms[i].addr);
+      put32(out, (syms[i].inText ? IMAGE_SYM_TEXT : 0) |
+                 (syms[i].isFunc ? IMAGE_SYM_FUNC : 0));
+      off += strlen(syms[i].name) + 1;
+   }
+   for (i = 0; i < symCount; i++)
+      fwrite(syms[i].name, 1, strlen(syms[i].name) + 1, out);
+}
+
+/* ELF32 constants */
+#define PAGE 0x1000
+#define EHSIZE 52
+#define PHSIZE 32
+#define SHSIZE 40
+#define EM_MIPS 8
+#define EF_MIPS_NOREORDER 0x1
+#define EF_MIPS_ARCH_32 0x50000000
+#define SHT_PROGBITS 1
+#define SHT_SYMTAB 2
+#define SHT_STRTAB 3
+#define SHF_WRITE 1
+#define SHF_ALLOC 2
+#define SHF_EXECINSTR 4
+
+static void sectionHeader(FILE *out, int name, int type, int flags,
+                          unsigned int addr, long off, int size,
+                          int link, int info, int align, int entsize)
+{
+   put32(out, (unsigned int)name);
+   put32(out, (unsigned int)type);
+   put32(out, (unsigned int)flags);
+   put32(out, addr);
+   put32(out, (unsigned int)off);
+   put32(out, (unsigned int)size);
+   put32(out, (unsigned int)link);
+   put32(out, (unsigned int)info);
+   put32(out, (unsigned int)align);
+   put32(out, (unsigned int)entsize);
+}
+
+/* Procedure writeElf writes an executable with a text
+ * and a data segment, and the symbols: labels are
+ * local, functions global
+ */
+static void writeElf(FILE *out, unsigned int entry)
+{
+   static const char shstr[] =
+      "\0.text\0.data\0.symtab\0.strtab\0.shstrtab";
+   long textOff = PAGE, dataOff, symOff, strOff, shstrOff, shOff;
+   int i, pass, nlocal = 1, k, name;
+
+   dataOff = textOff + (text.size + PAGE - 1) / PAGE * PAGE;
+   symOff = dataOff + data.size;
+   symOff = (symOff + 3) & ~3L;
+   strOff = symOff + 16 * (symCount + 1);
+   shstrOff = strOff + 1 + nameSize();
+   shOff = (shstrOff + sizeof shstr + 3) & ~3L;
+   for (i = 0; i < symCount; i++)
+      if (!syms[i].isFunc)
+         nlocal++;
+
+   /* ELF header */
+   fputc(0x7f, out);
+   fputs("ELF", out);
+   fputc(1, out);                  /* ELFCLASS32 */
+   fputc(1, out);                  /* ELFDATA2LSB */
+   fputc(1, out);                  /* EV_CURRENT */
+   padTo(out, 16);
+   put16(out, 2);                  /* ET_EXEC */
+   put16(out, EM_MIPS);
+   put32(out, 1);
+   put32(out, entry);
+   put32(out, EHSIZE);
+   put32(out, (unsigned int)shOff);
+   put32(out, EF_MIPS_ARCH_32 | EF_MIPS_NOREORDER);
+   put16(out, EHSIZE);
+   put16(out, PHSIZE);
+   put16(out, 2);
+   put16(out, SHSIZE);
+   put16(out, 6);
+   put16(out, 5);                  /* .shstrtab */
+
+   /* program headers: PT_LOAD text (r-x), data (rw-) */
+   put32(out, 1);
+   put32(out, (unsigned int)textOff);
+   put32(out, IMAGE_TEXT_BASE);
+   put32(out, IMAGE_TEXT_BASE);
+   put32(out, (unsigned int)text.size);
+   put32(out, (unsigned int)text.size);
+   put32(out, 5);
+   put32(out, PAGE);
+   put32(out, 1);
+   put32(out, (unsigned int)dataOff);
+   put32(out, IMAGE_DATA_BASE);
+   put32(out, IMAGE_DATA_BASE);
+   put32(out, (unsigned int)data.size);
+   put32(out, (unsigned int)data.size);
+   put32(out, 6);
+   put32(out, PAGE);
+
+   padTo(out, textOff);
+   fwrite(text.b, 1, text.size, out);
+   padTo(out, dataOff);
+   fwrite(data.b, 1, data.size, out);
+
+   /* symbols, the local ones first */
+   padTo(out, symOff);
+   for (k = 0; k < 16; k++)
+      fputc(0, out);
+   for (pass = 0; pass < 2; pass++)
+      for (i = 0, name = 1; i < symCount; name += strlen(syms[i].name) + 1, i++)
+      {
+         if (syms[i].isFunc != pass)
+            continue;
+         put32(out, (unsigned int)name);
+         put32(out, syms[i].addr);
+         put32(out, 0);
+         /* STB_GLOBAL/STT_FUNC, STB_LOCAL/STT_NOTYPE or STT_OBJECT */
+         fputc(syms[i].isFunc ? 0x12 : syms[i].inText ? 0x00 : 0x01, out);
+         fputc(0, out);
+         put16(out, syms[i].inText ? 1 : 2);
+      }
+   fputc(0, out);
+   for (i = 0; i < symCount; i++)
+      fwrite(syms[i].name, 1, strlen(syms[i].name) + 1, out);
+   fwrite(shstr, 1, sizeof shstr, out);
+
+   padTo(out, shOff);
+   sectionHeader(out, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+   sectionHeader(out, 1, SHT_PROGBITS, SHF_ALLOC | SHF_EXECINSTR,
+                 IMAGE_TEXT_BASE, textOff, text.size, 0, 0, 4, 0);
+   sectionHeader(out, 7, SHT_PROGBITS, SHF_ALLOC | SHF_WRITE,
+                 IMAGE_DATA_BASE, dataOff, data.size, 0, 0, 4, 0);
+   sectionHeader(out, 13, SHT_SYMTAB, 0, 0, symOff, 16 * (symCount + 1),
+                 4, nlocal, 4, 16);
+   sectionHeader(out, 21, SHT_STRTAB, 0, 0, strOff, 1 + nameSize(),
+                 0, 0, 1, 0);
+   sectionHeader(out, 29, SHT_STRTAB, 0, 0, shstrOff, sizeof shstr,
+                 0, 0, 1, 0);
+}
+
+/********************************************/
+/* Procedure readLines reads the assembly into lines */
+static void readLines(FILE *asmFile)
+{
+   char buf[LINESIZE];
+   int size = 0;
+   lineCount = 0;
+   while (fgets(buf, LINESIZE, asmFile) != NULL)
+   {
+      if (lineCount == size)
+      {
+         size = size ? 2 * size : 1024;
+         lines = (char **)reallocate(AllocCodegen, lines, size * sizeof(char *));
+      }
+      lines[lineCount++] = copyString(buf);
+   }
+}
+
+int mipsAssemble(FILE *asmFile, FILE *out, int format)
+{
+   SYMBOL *entry;
+   int textSize = 0;
+
+   failed = FALSE;
+   readLines(asmFile);
+   for (pass = 1; pass <= 2; pass++)
+   {
+      text.size = data.size = 0;
+      for (lineNo = 1; lineNo <= lineCount; lineNo++)
+         assembleLine(lines[lineNo - 1]);
+      /* pass 2 must lay out the code as pass 1 did */
+      if (pass == 2 && text.size != textSize)
+         error("code size changed between passes", NULL);
+      textSize = text.size;
+   }
+   if ((entry = findSym("main")) == NULL || !entry->inText)
+      error("no main label", NULL);
+   if (failed)
+      return FALSE;
+   entry->isFunc = TRUE;
+   if (format == IMAGE_ELF)
+      writeElf(out, entry->addr);
+   else
+      writeBin(out, entry->addr);
+   return TRUE;
+}
@@ -0,0 +1,25 @@
+/****************************************************/
+/* File: mipsasm.h                                  */
+/* MIPS32 encoder for the code the C- compiler      */
+/* emits: turns the assembly into a binary image    */
+/****************************************************/
+
+#ifndef _MIPSASM_H_
+#define _MIPSASM_H_
+
+/* image formats */
+#define IMAGE_BIN 0   /* the compact image of image.h */
+#define IMAGE_ELF 1   /* an ELF32 little-endian MIPS executable */
+
+/* Function mipsAssemble encodes the MIPS assembly in
+ * asmFile (as written by the MIPS target) into
+ * MIPS32 words and writes an image in the given
+ * format to out. Pseudo-ops expand to fixed
+ * sequences using $at, and every jump and branch is
+ * followed by a nop in its delay slot, so the image
+ * runs the same with or without delay slots.
+ * Returns FALSE after reporting an error to listing
+ */
+int mipsAssemble(FILE * asmFile, FILE * out, int format);
+
+#endif
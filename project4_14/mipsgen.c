@@ -0,0 +1,739 @@
+/****************************************************/
+/* File: mipsgen.c                                  */
+/* The MIPS target of the code generator            */
+/* (SPIM assembly; see target.h)                    */
+/****************************************************/
+
+#include "globals.h"
+#include "symtab.h"
+#include "code.h"
+#include "target.h"
+#include "optimize.h"
+#include "stats.h"
+
+/* register names, in the order of Reg */
+static char *regName[] =
+{
+   "$v0", "$v1", "$t1", "$t0", "$fp", "$gp", "$sp", "$ra",
+   "$a0", "$a1", "$a2", "$a3",
+   "$s0", "$s1", "$s2", "$s3", "$s4", "$s5", "$s6", "$s7"
+};
+
+/* immediate operands of addiu/slti must fit in 16 bits */
+#define IMM_MIN (-32768)
+#define IMM_MAX 32767
+
+static int _fitsImm(int c)
+{
+   return c >= IMM_MIN && c <= IMM_MAX;
+}
+
+/* returns k if c == 2^k, otherwise -1 */
+static int _log2(unsigned int c)
+{
+   int k = 0;
+   if (c == 0 || (c & (c - 1)) != 0)
+      return -1;
+   while ((c >> k) != 1)
+      k++;
+   return k;
+}
+
+/* Procedure _magicSigned computes the multiplier M and
+ * shift s such that n/d == mulhi(M,n) >> s (plus sign
+ * corrections) for every 32-bit n. |d| >= 2.
+ * (Hacker's Delight, 10-4)
+ */
+static void _magicSigned(int d, int *M, int *s)
+{
+   const unsigned int two31 = 0x80000000u;
+   unsigned int ad = d < 0 ? -(unsigned int)d : (unsigned int)d;
+   unsigned int t = two31 + ((unsigned int)d >> 31);
+   unsigned int anc = t - 1 - t % ad;
+   unsigned int q1 = two31 / anc, r1 = two31 - q1 * anc;
+   unsigned int q2 = two31 / ad, r2 = two31 - q2 * ad;
+   unsigned int delta;
+   int p = 31;
+   do
+   {
+      p++;
+      q1 = 2 * q1;
+      r1 = 2 * r1;
+      if (r1 >= anc) { q1++; r1 -= anc; }
+      q2 = 2 * q2;
+      r2 = 2 * r2;
+      if (r2 >= ad) { q2++; r2 -= ad; }
+      delta = ad - r2;
+   } while (q1 < delta || (q1 == delta && r1 == 0));
+   *M = (int)(q2 + 1);
+   if (d < 0)
+      *M = -*M;
+   *s = p - 32;
+}
+
+/* Procedure _emitMulConst emits $v0 = $v0 * c using
+ * shifts and adds where that is cheaper than mul
+ */
+static void _emitMulConst(int c)
+{
+   char s1[16] = {0}, s2[16] = {0};
+   unsigned int a = c < 0 ? -(unsigned int)c : (unsigned int)c;
+   int k, k2;
+
+   if (c == 0)
+   {
+      emitInst2param("move", "$v0", "$0");
+      return;
+   }
+   if ((k = _log2(a)) >= 0)
+   {
+      if (k > 0)
+      {
+         sprintf(s1, "%d", k);
+         emitInst3param("sll", "$v0", "$v0", s1);
+      }
+   }
+   else if ((k = _log2(a & (a - 1))) >= 0 && (k2 = _log2(a & -a)) >= 0)
+   {
+      /* two bits set: (x << k) + (x << k2) */
+      sprintf(s1, "%d", k);
+      emitInst3param("sll", "$t2", "$v0", s1);
+      if (k2 > 0)
+      {
+         sprintf(s2, "%d", k2);
+         emitInst3param("sll", "$v0", "$v0", s2);
+      }
+      emitInst3param("addu", "$v0", "$t2", "$v0");
+   }
+   else if ((k = _log2(a + 1)) >= 0)
+   {
+      /* 2^k - 1: (x << k) - x */
+      sprintf(s1, "%d", k);
+      emitInst3param("sll", "$t2", "$v0", s1);
+      emitInst3param("subu", "$v0", "$t2", "$v0");
+   }
+   else
+   {
+      sprintf(s1, "%d", c);
+      emitInst3param("mul", "$v0", "$v0", s1);
+      return;
+   }
+   if (c < 0)
+      emitInst3param("subu", "$v0", "$0", "$v0");
+}
+
+/* Procedure _emitDivConst emits $v0 = $v0 / c (truncating,
+ * like div) without a div instruction. c must not be 0.
+ */
+static void _emitDivConst(int c)
+{
+   char s1[16] = {0};
+   unsigned int a = c < 0 ? -(unsigned int)c : (unsigned int)c;
+   int k, M, s;
+
+   if (a == 1)
+   {
+      if (c < 0)
+         emitInst3param("subu", "$v0", "$0", "$v0");
+      return;
+   }
+   if ((k = _log2(a)) >= 0)
+   {
+      /* bias negative dividends by 2^k-1 so the shift truncates toward 0 */
+      if (k > 1)
+         emitInst3param("sra", "$t2", "$v0", "31");
+      sprintf(s1, "%d", 32 - k);
+      emitInst3param("srl", "$t2", k > 1 ? "$t2" : "$v0", s1);
+      emitInst3param("addu", "$t2", "$v0", "$t2");
+      sprintf(s1, "%d", k);
+      emitInst3param("sra", "$v0", "$t2", s1);
+      if (c < 0)
+         emitInst3param("subu", "$v0", "$0", "$v0");
+      return;
+   }
+   _magicSigned(c, &M, &s);
+   sprintf(s1, "%d", M);
+   emitInst2param("li", "$t2", s1);
+   emitInst2param("mult", "$v0", "$t2");
+   emitInst1param("mfhi", "$t2");
+   if (c > 0 && M < 0)
+      emitInst3param("addu", "$t2", "$t2", "$v0");
+   else if (c < 0 && M > 0)
+      emitInst3param("subu", "$t2", "$t2", "$v0");
+   if (s > 0)
+   {
+      sprintf(s1, "%d", s);
+      emitInst3param("sra", "$t2", "$t2", s1);
+   }
+   emitInst3param("srl", "$t3", "$t2", "31");
+   emitInst3param("addu", "$v0", "$t2", "$t3");
+}
+
+/* Function _emitOpConst emits $v0 = $v0 op c for a
+ * constant right operand. Returns FALSE when there
+ * is no cheaper form than the general sequence.
+ */
+static int _emitOpConst(TokenType op, int c)
+{
+   char s1[16] = {0};
+   switch (op)
+   {
+   case PLUS:
+   case MINUS:
+      if (op == MINUS)
+      {
+         if (c == IMM_MIN)
+            return FALSE;
+         c = -c;
+      }
+      if (!_fitsImm(c))
+         return FALSE;
+      if (c != 0)
+      {
+         sprintf(s1, "%d", c);
+         emitInst3param("addiu", "$v0", "$v0", s1);
+      }
+      return TRUE;
+   case TIMES:
+      _emitMulConst(c);
+      return TRUE;
+   case OVER:
+      if (c == 0)
+         return FALSE;
+      _emitDivConst(c);
+      return TRUE;
+   case LT:
+   case GTET:
+      if (!_fitsImm(c))
+         return FALSE;
+      sprintf(s1, "%d", c);
+      emitInst3param("slti", "$v0", "$v0", s1);
+      if (op == GTET)
+         emitInst3param("xori", "$v0", "$v0", "1");
+      return TRUE;
+   case LTET:
+   case GT:
+      /* x <= c  is  x < c+1 */
+      if (!_fitsImm(c) || c == IMM_MAX)
+         return FALSE;
+      sprintf(s1, "%d", c + 1);
+      emitInst3param("slti", "$v0", "$v0", s1);
+      if (op == GT)
+         emitInst3param("xori", "$v0", "$v0", "1");
+      return TRUE;
+   case EQ:
+   case NOTEQ:
+      if (c < 0 || c > 0xffff)
+         return FALSE;
+      if (c != 0)
+      {
+         sprintf(s1, "%d", c);
+         emitInst3param("xori", "$v0", "$v0", s1);
+      }
+      if (op == EQ)
+         emitInst3param("sltiu", "$v0", "$v0", "1");
+      else
+         emitInst3param("sltu", "$v0", "$0", "$v0");
+      return TRUE;
+   default:
+      return FALSE;
+   }
+}
+
+/* The global area starts the data segment, GP_BIAS
+ * bytes below where SPIM points $gp
+ */
+#define GP_BIAS 0x8000
+
+typedef struct
+{
+   char *label;   /* g_ and the source name */
+   int off, size;
+} Global;
+
+static Global *globals = NULL;
+static int globalCount = 0, globalSize = 0;
+
+/* TRUE from begin to the first function */
+static int inData = FALSE;
+
+/* Offsets from other registers that do not fit 16
+ * bits are split: the high half is added to the base
+ * register in FAR_BASE, and the instruction takes the
+ * low half. For the frame pointer FAR_BASE is kept
+ * until a label or a call, so the accesses to a large
+ * frame in straight-line code share one lui/addu;
+ * FAR_TEMP serves the other registers and the
+ * constants of addConst
+ */
+#define FAR_BASE "$t8"
+#define FAR_TEMP "$t9"
+
+static int farBias = 0;   /* FAR_BASE - $fp, 0 if not set */
+
+static void _farInvalidate(void)
+{
+   farBias = 0;
+}
+
+/* Procedure _emitLoadImm32 puts c into reg with lui and ori */
+static void _emitLoadImm32(char *reg, int c)
+{
+   char s[16];
+   sprintf(s, "%u", (unsigned int)c >> 16);
+   emitInst2param("lui", reg, s);
+   if ((c & 0xffff) != 0)
+   {
+      sprintf(s, "%d", c & 0xffff);
+      emitInst3param("ori", reg, reg, s);
+   }
+}
+
+/* Function _memOperand formats the operand for off
+ * from base, emitting what is needed to reach it. The
+ * global area is addressed $gp-relative where the
+ * offset fits 16 bits, otherwise through the label of
+ * the global it falls in
+ */
+static char *_memOperand(int off, Reg base)
+{
+   static char *s = NULL;
+   static int size = 0;
+   Global *g = NULL;
+   char hi[16], *reg;
+   int i, bias;
+
+   if (base != RegGp && !_fitsImm(off))
+   {
+      /* off = bias + a signed low half */
+      bias = (int)(((unsigned int)off + 0x8000u) & 0xffff0000u);
+      reg = base == RegFp ? FAR_BASE : FAR_TEMP;
+      if (base != RegFp || bias != farBias)
+      {
+         sprintf(hi, "%u", (unsigned int)bias >> 16);
+         emitInst2param("lui", reg, hi);
+         emitInst3param("addu", reg, reg, regName[base]);
+         if (base == RegFp)
+            farBias = bias;
+      }
+      if (size < 32)
+      {
+         size = 32;
+         s = reallocate(AllocCodegen, s, size);
+      }
+      sprintf(s, "%d(%s)", off - bias, reg);
+      return s;
+   }
+   for (i = 0; base == RegGp && !_fitsImm(off - GP_BIAS) && i < globalCount; i++)
+      if (off >= globals[i].off && off < globals[i].off + globals[i].size)
+         g = &globals[i];
+   if (size < (g ? (int)strlen(g->label) : 0) + 32)
+   {
+      size = (g ? strlen(g->label) : 0) + 32;
+      s = reallocate(AllocCodegen, s, size);
+   }
+   if (base != RegGp)
+      sprintf(s, "%d(%s)", off, regName[base]);
+   else if (g == NULL)
+      sprintf(s, "%d($gp)", off - GP_BIAS);
+   else if (off == g->off)
+      sprintf(s, "%s", g->label);
+   else
+      sprintf(s, "%s+%d", g->label, off - g->off);
+   return s;
+}
+
+static void mipsBegin(char *codefile)
+{
+   char *f = allocate(AllocCodegen, strlen(codefile) + 7);
+
+   strcpy(f, "File: ");
+   strcat(f, codefile);
+   emitComment("C- Compilation to MIPS Code");
+   emitComment(f);
+   emitComment("##########################################");
+   release(f);
+
+   /* the globals come first in the data segment */
+   emitDirective(".data");
+   inData = TRUE;
+}
+
+static void mipsGlobal(char *name, int off, int size)
+{
+   char s[16];
+   if (globalCount == globalSize)
+   {
+      globalSize = globalSize ? 2 * globalSize : 16;
+      globals = reallocate(AllocCodegen, globals, globalSize * sizeof(Global));
+   }
+   globals[globalCount].label = allocate(AllocCodegen, strlen(name) + 3);
+   sprintf(globals[globalCount].label, "g_%s", name);
+   globals[globalCount].off = off;
+   globals[globalCount].size = size;
+   sprintf(s, "%d", size);
+   emitDataDec(globals[globalCount].label, ".space", s);
+   globalCount++;
+}
+
+/* the profile (--pg): PROF_TAB holds two counts and
+ * a depth for each record, and PROF_NAMES their names
+ * in the same order. A function ("f name") has its
+ * calls and cycles, a call site ("a caller callee
+ * site") its calls and an if or while ("b function
+ * site") the runs of its test and of its then part
+ * or body. The updates use FAR_TEMP and FAR_BASE,
+ * which hold nothing across a call or a function
+ * boundary
+ */
+#define PROF_RECORD 12
+
+static char **profNames = NULL;
+static int profCount = 0, profSize = 0;
+static int profFunc = -1;   /* record of the current function */
+static int profLabel = 0;   /* PROF_SKIPn labels used */
+static char *curFunc = "";
+/* records of the current function's sites, or -1 */
+static int *profSites = NULL;
+static int profSiteSize = 0;
+
+static int _profRecord(char *kind, char *caller, char *callee, int site)
+{
+   char *s;
+   if (profCount == profSize)
+   {
+      profSize = profSize ? 2 * profSize : 32;
+      profNames = reallocate(AllocCodegen, profNames, profSize * sizeof(char *));
+   }
+   s = allocate(AllocCodegen, strlen(caller) + (callee ? strlen(callee) : 0) + 24);
+   if (site < 0)
+      sprintf(s, "%s %s ", kind, caller);
+   else if (callee)
+      sprintf(s, "%s %s %s %d ", kind, caller, callee, site);
+   else
+      sprintf(s, "%s %s %d ", kind, caller, site);
+   profNames[profCount] = s;
+   return profCount++;
+}
+
+/* Function _profSite returns the record of a site of
+ * the current function; a site reached twice (the
+ * test of a rotated loop) keeps its first record
+ */
+static int _profSite(int site, char *kind, char *callee)
+{
+   int n = profSiteSize;
+   if (site >= profSiteSize)
+   {
+      profSiteSize = 2 * site + 16;
+      profSites = reallocate(AllocCodegen, profSites, profSiteSize * sizeof(int));
+      for (; n < profSiteSize; n++)
+         profSites[n] = -1;
+   }
+   if (profSites[site] < 0)
+      profSites[site] = _profRecord(kind, curFunc, callee, site);
+   return profSites[site];
+}
+
+/* PROF_TAB+off of the count (field 0), the cycles
+ * (field 4) or the depth (field 8) of record k
+ */
+static char *_profSlot(int k, int field)
+{
+   static char s[32];
+   sprintf(s, "PROF_TAB+%d", PROF_RECORD * k + field);
+   return s;
+}
+
+static void _profCount(int k, int field)
+{
+   emitInst2param("lw", FAR_TEMP, _profSlot(k, field));
+   emitInst3param("addiu", FAR_TEMP, FAR_TEMP, "1");
+   emitInst2param("sw", FAR_TEMP, _profSlot(k, field));
+}
+
+/* Procedure _profCycles subtracts (entry) or adds
+ * (exit) the cycle counter to the function's cycles,
+ * which adds up the time between the two. The depth
+ * counts the active calls of the function; only the
+ * outermost one is timed, so a recursive function's
+ * time is not counted once per level
+ */
+static void _profCycles(int k, int entry)
+{
+   char skip[16];
+   sprintf(skip, "PROF_SKIP%d", profLabel++);
+   emitInst2param("lw", FAR_TEMP, _profSlot(k, 8));
+   emitInst3param("addiu", FAR_BASE, FAR_TEMP, entry ? "1" : "-1");
+   emitInst2param("sw", FAR_BASE, _profSlot(k, 8));
+   emitInst2param("bnez", entry ? FAR_TEMP : FAR_BASE, skip);
+   emitInst2param("rdhwr", FAR_TEMP, "$2");
+   emitInst2param("lw", FAR_BASE, _profSlot(k, 4));
+   emitInst3param(entry ? "subu" : "addu", FAR_BASE, FAR_BASE, FAR_TEMP);
+   emitInst2param("sw", FAR_BASE, _profSlot(k, 4));
+   emitLabel(skip);
+   _farInvalidate();
+}
+
+/* Procedure _emitProfDump emits the table and
+ * PROF_DUMP, which prints it after a "#pg" line,
+ * one record per line: its name, calls and cycles.
+ * Like the I/O routines it keeps $t0 and $v1
+ */
+static void _emitProfDump(void)
+{
+   char s[16];
+   int k;
+   emitDirective(".data");
+   emitDirective(".align 2");
+   sprintf(s, "%d", PROF_RECORD * profCount);
+   emitDataDec("PROF_TAB", ".space", s);
+   emitDataDec("PROF_HEAD", ".asciiz", "\"#pg\\n\"");
+   emitLabel("PROF_NAMES");
+   for (k = 0; k < profCount; k++)
+   {
+      char *q = allocate(AllocCodegen, strlen(profNames[k]) + 12);
+      sprintf(q, ".asciiz \"%s\"", profNames[k]);
+      emitDirective(q);
+      release(q);
+   }
+   emitDirective(".text");
+   emitLabel("PROF_DUMP");
+   emitInst2param("la", "$a0", "PROF_HEAD");
+   emitInst2param("li", "$v0", "4");
+   emitInst0param("syscall");
+   emitInst2param("la", "$a1", "PROF_NAMES");
+   emitInst2param("la", "$a2", "PROF_TAB");
+   sprintf(s, "%d", profCount);
+   emitInst2param("li", "$a3", s);
+   emitLabel("PROF_DUMP_NEXT");
+   emitInst2param("beqz", "$a3", "PROF_DUMP_END");
+   emitInst2param("move", "$a0", "$a1");
+   emitInst2param("li", "$v0", "4");
+   emitInst0param("syscall");
+   emitLabel("PROF_DUMP_SKIP");
+   emitInst2param("lbu", "$t2", "0($a1)");
+   emitInst3param("addu", "$a1", "$a1", "1");
+   emitInst2param("bnez", "$t2", "PROF_DUMP_SKIP");
+   emitInst2param("lw", "$a0", "0($a2)");
+   emitInst2param("li", "$v0", "1");
+   emitInst0param("syscall");
+   emitInst2param("li", "$a0", "32");
+   emitInst2param("li", "$v0", "11");
+   emitInst0param("syscall");
+   emitInst2param("lw", "$a0", "4($a2)");
+   emitInst2param("li", "$v0", "1");
+   emitInst0param("syscall");
+   emitInst2param("li", "$a0", "10");
+   emitInst2param("li", "$v0", "11");
+   emitInst0param("syscall");
+   sprintf(s, "%d", PROF_RECORD);
+   emitInst3param("addu", "$a2", "$a2", s);
+   emitInst3param("subu", "$a3", "$a3", "1");
+   emitInst1param("b", "PROF_DUMP_NEXT");
+   emitLabel("PROF_DUMP_END");
+   emitInst1param("jr", "$ra");
+}
+
+static void mipsEnd(void)
+{
+   emitSourceFunc("(runtime)");
+   emitSourceLine(0);
+   emitInputOutputFuncs();
+   if (Profiling)
+      _emitProfDump();
+}
+
+/* TRUE while generating main, whose returns flush
+ * the buffered output
+ */
+static int inMain = FALSE;
+
+static void mipsFuncLabel(char *name)
+{
+   if (inData)
+   {
+      emitDirective(".text");
+      emitDirective(".globl main\n");
+      inData = FALSE;
+   }
+   inMain = strcmp(name, "main") == 0;
+   curFunc = name;
+   emitSourceFunc(name);
+   _farInvalidate();
+   emitLabel(name);
+   if (Profiling)
+   {
+      int i;
+      for (i = 0; i < profSiteSize; i++)
+         profSites[i] = -1;
+      profFunc = _profRecord("f", name, NULL, -1);
+      _profCount(profFunc, 0);
+      if (Profiling == PROFILE_CYCLES)
+         _profCycles(profFunc, TRUE);
+   }
+}
+
+static void mipsLabel(int lab)
+{
+   _farInvalidate();
+   char s[16];
+   sprintf(s, "L%d", lab);
+   emitLabel(s);
+}
+
+static void mipsMove(Reg dst, Reg src)
+{
+   if (dst == RegFp)
+      _farInvalidate();
+   emitInst2param("move", regName[dst], regName[src]);
+}
+
+static void mipsLoadConst(Reg dst, int c)
+{
+   char s[16];
+   sprintf(s, "%d", c);
+   emitInst2param("li", regName[dst], s);
+}
+
+static void mipsLoad(Reg dst, int off, Reg base)
+{
+   emitInst2param("lw", regName[dst], _memOperand(off, base));
+}
+
+static void mipsStore(Reg src, int off, Reg base)
+{
+   emitInst2param("sw", regName[src], _memOperand(off, base));
+}
+
+static void mipsLoadAddr(Reg dst, int off, Reg base)
+{
+   emitInst2param("la", regName[dst], _memOperand(off, base));
+}
+
+static void mipsAddConst(Reg dst, Reg src, int c)
+{
+   char s[16];
+   if (dst == RegFp)
+      _farInvalidate();
+   if (!_fitsImm(c) || c == IMM_MIN)
+   {
+      _emitLoadImm32(FAR_TEMP, c);
+      emitInst3param("addu", regName[dst], regName[src], FAR_TEMP);
+      return;
+   }
+   sprintf(s, "%d", c < 0 ? -c : c);
+   emitInst3param(c < 0 ? "subu" : "addu", regName[dst], regName[src], s);
+}
+
+static void mipsAdd(Reg dst, Reg a, Reg b)
+{
+   emitInst3param("addu", regName[dst], regName[a], regName[b]);
+}
+
+static void mipsSub(Reg dst, Reg a, Reg b)
+{
+   emitInst3param("subu", regName[dst], regName[a], regName[b]);
+}
+
+static void mipsScale(Reg r)
+{
+   emitInst3param("sll", regName[r], regName[r], "2");
+}
+
+static void mipsOp(TokenType op)
+{
+   switch (op)
+   {
+   case PLUS:  emitInst3param("add", "$v0", "$t1", "$v0"); break;
+   case MINUS: emitInst3param("sub", "$v0", "$t1", "$v0"); break;
+   case TIMES: emitInst3param("mul", "$v0", "$t1", "$v0"); break;
+   case OVER:  emitInst3param("div", "$v0", "$t1", "$v0"); break;
+   case LTET:  emitInst3param("sle", "$v0", "$t1", "$v0"); break;
+   case LT:    emitInst3param("slt", "$v0", "$t1", "$v0"); break;
+   case GTET:  emitInst3param("sge", "$v0", "$t1", "$v0"); break;
+   case GT:    emitInst3param("sgt", "$v0", "$t1", "$v0"); break;
+   case EQ:    emitInst3param("seq", "$v0", "$t1", "$v0"); break;
+   case NOTEQ: emitInst3param("sne", "$v0", "$t1", "$v0"); break;
+   default:    break;
+   }
+}
+
+static void mipsJump(int lab)
+{
+   char s[16];
+   sprintf(s, "L%d", lab);
+   emitInst1param("j", s);
+}
+
+static void mipsJumpIfZero(Reg r, int lab)
+{
+   char s[16];
+   sprintf(s, "L%d", lab);
+   emitInst2param("beqz", regName[r], s);
+}
+
+static void mipsJumpIfNonZero(Reg r, int lab)
+{
+   char s[16];
+   sprintf(s, "L%d", lab);
+   emitInst2param("bnez", regName[r], s);
+}
+
+static void mipsCall(char *name)
+{
+   emitInst1param("jal", name);
+   /* the callee may have used FAR_BASE */
+   _farInvalidate();
+}
+
+static void mipsRet(void)
+{
+   if (Profiling == PROFILE_CYCLES)
+      _profCycles(profFunc, FALSE);
+   if (inMain)
+   {
+      /* OUT_FLUSH and PROF_DUMP keep $t0 */
+      emitInst2param("move", "$t0", "$ra");
+      emitInst1param("jal", "OUT_FLUSH");
+      if (Profiling)
+         emitInst1param("jal", "PROF_DUMP");
+      emitInst2param("move", "$ra", "$t0");
+   }
+   emitInst1param("jr", "$ra");
+}
+
+static void mipsInput(void)
+{
+   emitInst1param("jal", "RD_INT");
+   emitInst2param("sw", "$a0", "0($v1)");
+}
+
+static void mipsOutput(void)
+{
+   emitInst2param("move", "$a0", "$v0");
+   emitInst1param("jal", "WR_INT");
+}
+
+static void mipsCountBranch(int site, int taken)
+{
+   if (Profiling && site >= 0)
+      _profCount(_profSite(site, "b", NULL), taken ? 4 : 0);
+}
+
+static void mipsCountCall(int site, char *callee)
+{
+   if (Profiling && site >= 0)
+      _profCount(_profSite(site, "a", callee), 0);
+}
+
+Target mipsTarget =
+{
+   "mips", ".tm", 4, NUM_ARG_REGS, VN_MAXREGS,
+   mipsBegin, mipsGlobal, mipsEnd, emitComment, emitSourceLine,
+   mipsLabel, mipsFuncLabel,
+   mipsMove, mipsLoadConst, mipsLoad, mipsStore, mipsLoadAddr,
+   mipsAddConst, mipsAdd, mipsSub, mipsScale, mipsOp, _emitOpConst,
+   mipsJump, mipsJumpIfZero, mipsJumpIfNonZero, mipsCall, mipsRet,
+   mipsInput, mipsOutput, mipsCountBranch, mipsCountCall
+};
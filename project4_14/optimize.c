@@ -0,0 +1,1040 @@
+/****************************************************/
+/* File: optimize.c                                 */
+/* Syntax tree optimizations for the C- compiler    */
+/* Constant folding works on the typed tree, so it  */
+/* must run after typeCheck and before codeGen      */
+/****************************************************/
+
+#include <limits.h>
+#include "globals.h"
+#include "symtab.h"
+#include "optimize.h"
+#include "incr.h"
+#include "stats.h"
+
+/* number of tree nodes removed by foldConstants */
+static int removed = 0;
+
+static TreeNode *foldList(TreeNode *t);
+
+static int isConst(TreeNode *t)
+{
+  return t != NULL && t->nodekind == ExpK && t->kind.exp == ConstK;
+}
+
+/* Function countNodes returns the size of the subtree
+ * rooted at t (t's siblings are not counted)
+ */
+static int countNodes(TreeNode *t)
+{
+  TreeNode *c;
+  int i, n;
+  if (t == NULL)
+    return 0;
+  n = 1;
+  for (i = 0; i < MAXCHILDREN; i++)
+    for (c = t->child[i]; c != NULL; c = c->sibling)
+      n += countNodes(c);
+  return n;
+}
+
+/* Function isPure returns TRUE if evaluating t can be
+ * skipped without changing the program: no calls,
+ * no assignments, no input/output and no division
+ * by a constant zero
+ */
+static int isPure(TreeNode *t)
+{
+  TreeNode *c;
+  int i;
+  if (t == NULL)
+    return TRUE;
+  if (t->nodekind != ExpK)
+    return FALSE;
+  switch (t->kind.exp)
+  {
+  case FuncCallK:
+  case InputCallK:
+  case OutputCallK:
+    return FALSE;
+  case OpK:
+    if (t->attr.op == OVER && isConst(t->child[1]) && t->child[1]->val == 0)
+      return FALSE;
+    break;
+  default:
+    break;
+  }
+  for (i = 0; i < MAXCHILDREN; i++)
+    for (c = t->child[i]; c != NULL; c = c->sibling)
+      if (!isPure(c))
+        return FALSE;
+  return TRUE;
+}
+
+/* Function sameExp returns TRUE if a and b are the
+ * same expression (same variables, same operators)
+ */
+static int sameExp(TreeNode *a, TreeNode *b)
+{
+  if (a == NULL || b == NULL)
+    return a == b;
+  if (a->nodekind != ExpK || b->nodekind != ExpK || a->kind.exp != b->kind.exp)
+    return FALSE;
+  switch (a->kind.exp)
+  {
+  case ConstK:
+    return a->val == b->val;
+  case IdK:
+    return a->info == b->info && sameExp(a->child[0], b->child[0]);
+  case OpK:
+    return a->attr.op == b->attr.op &&
+           sameExp(a->child[0], b->child[0]) &&
+           sameExp(a->child[1], b->child[1]);
+  default:
+    return FALSE;
+  }
+}
+
+/* Function evalOp computes a op b with the wraparound
+ * of the target's 32-bit registers. Returns FALSE if
+ * the result is not defined at compile time
+ */
+static int evalOp(TokenType op, int a, int b, int *res)
+{
+  unsigned int ua = (unsigned int)a, ub = (unsigned int)b;
+  switch (op)
+  {
+  case PLUS:  *res = (int)(ua + ub); break;
+  case MINUS: *res = (int)(ua - ub); break;
+  case TIMES: *res = (int)(ua * ub); break;
+  case OVER:
+    if (b == 0 || (a == INT_MIN && b == -1))
+      return FALSE;
+    *res = a / b;
+    break;
+  case LT:    *res = a < b;  break;
+  case LTET:  *res = a <= b; break;
+  case GT:    *res = a > b;  break;
+  case GTET:  *res = a >= b; break;
+  case EQ:    *res = a == b; break;
+  case NOTEQ: *res = a != b; break;
+  default:
+    return FALSE;
+  }
+  return TRUE;
+}
+
+/* Function replaceBy drops t in favour of its
+ * subtree keep (which may be NULL)
+ */
+static TreeNode *replaceBy(TreeNode *t, TreeNode *keep)
+{
+  removed += countNodes(t) - countNodes(keep);
+  return keep;
+}
+
+/* Function makeConst turns t into a constant leaf */
+static TreeNode *makeConst(TreeNode *t, int val)
+{
+  int i;
+  removed += countNodes(t) - 1;
+  t->nodekind = ExpK;
+  t->kind.exp = ConstK;
+  t->val = val;
+  t->expType = Integer;
+  for (i = 0; i < MAXCHILDREN; i++)
+    t->child[i] = NULL;
+  return t;
+}
+
+static TreeNode *foldOp(TreeNode *t)
+{
+  TreeNode *l = t->child[0];
+  TreeNode *r = t->child[1];
+  int val;
+
+  if (t->attr.op == OVER && isConst(r) && r->val == 0)
+    fprintf(listing, "Warning at line %d: division by constant zero\n", t->lineno);
+
+  if (isConst(l) && isConst(r) && evalOp(t->attr.op, l->val, r->val, &val))
+    return makeConst(t, val);
+
+  switch (t->attr.op)
+  {
+  case PLUS:
+    if (isConst(r) && r->val == 0)
+      return replaceBy(t, l);
+    if (isConst(l) && l->val == 0)
+      return replaceBy(t, r);
+    break;
+  case MINUS:
+    if (isConst(r) && r->val == 0)
+      return replaceBy(t, l);
+    if (sameExp(l, r) && isPure(l))
+      return makeConst(t, 0);
+    break;
+  case TIMES:
+    if (isConst(r) && r->val == 1)
+      return replaceBy(t, l);
+    if (isConst(l) && l->val == 1)
+      return replaceBy(t, r);
+    if ((isConst(r) && r->val == 0 && isPure(l)) ||
+        (isConst(l) && l->val == 0 && isPure(r)))
+      return makeConst(t, 0);
+    break;
+  case OVER:
+    if (isConst(r) && r->val == 1)
+      return replaceBy(t, l);
+    break;
+  default:
+    break;
+  }
+  return t;
+}
+
+/* Function fold simplifies the subtree rooted at t
+ * and returns its replacement (NULL if it vanished)
+ */
+static TreeNode *fold(TreeNode *t)
+{
+  TreeNode *cond;
+  int i;
+
+  for (i = 0; i < MAXCHILDREN; i++)
+    t->child[i] = foldList(t->child[i]);
+
+  if (t->nodekind == ExpK && t->kind.exp == OpK)
+    return foldOp(t);
+
+  if (t->nodekind == StmtK)
+  {
+    cond = t->child[0];
+    switch (t->kind.stmt)
+    {
+    case IfK:
+      if (isConst(cond))
+        return replaceBy(t, cond->val ? t->child[1] : t->child[2]);
+      break;
+    case WhileK:
+      if (isConst(cond) && cond->val == 0)
+        return replaceBy(t, NULL);
+      break;
+    default:
+      break;
+    }
+  }
+  return t;
+}
+
+/* Function foldList folds every node of a sibling
+ * list and relinks the survivors
+ */
+static TreeNode *foldList(TreeNode *t)
+{
+  TreeNode *head = NULL, *tail = NULL;
+  TreeNode *next, *r;
+  while (t != NULL)
+  {
+    next = t->sibling;
+    r = fold(t);
+    if (r != NULL)
+    {
+      r->sibling = NULL;
+      if (tail == NULL)
+        head = r;
+      else
+        tail->sibling = r;
+      tail = r;
+    }
+    t = next;
+  }
+  return head;
+}
+
+/* Function foldConstants folds constant subtrees,
+ * applies algebraic identities and removes the dead
+ * arms of if/while statements with constant
+ * conditions. Returns the number of nodes removed.
+ */
+int foldConstants(TreeNode *syntaxTree)
+{
+  removed = 0;
+  foldList(syntaxTree);
+  if (TraceOptimize)
+    fprintf(listing, "Constant folding removed %d nodes\n", removed);
+  return removed;
+}
+
+/**************************************************/
+/**********   Dead code elimination   *************/
+/**************************************************/
+
+/* a node of a function's flow graph: one simple
+ * statement, or the condition of an if or while
+ */
+typedef struct
+{
+  TreeNode *exp;   /* the statement or condition */
+  int isStmt;      /* TRUE if exp may be deleted as a whole */
+  int succ[2];     /* successors, -1 for none (function exit) */
+  unsigned int *use, *def, *in, *out;
+} LvNode;
+
+static LvNode *lvNodes = NULL;
+static int lvCount = 0, lvSize = 0;
+static SymbolInfo *lvVars = NULL;
+static int lvVarCount = 0, lvVarSize = 0;
+static int lvWords = 0;
+static unsigned int *lvPool = NULL;
+
+static int deadStores = 0;
+static int deadNodes = 0;
+static int deadFuncs = 0;
+
+/* only local scalars are tracked; globals may be read
+ * by any callee and arrays are stored through
+ */
+static int isTracked(TreeNode *t)
+{
+  return t->info != NULL && !t->info->isGlobal && !t->info->isArray &&
+         t->child[0] == NULL;
+}
+
+/* Procedure lvCollect gives a liveness bit to every
+ * local scalar referenced in t
+ */
+static void lvCollect(TreeNode *t)
+{
+  int i;
+  for (; t != NULL; t = t->sibling)
+  {
+    if (t->nodekind == ExpK && t->kind.exp == IdK && isTracked(t) &&
+        t->info->lvIndex < 0)
+    {
+      if (lvVarCount == lvVarSize)
+      {
+        lvVarSize = lvVarSize ? 2 * lvVarSize : 16;
+        lvVars = (SymbolInfo *)reallocate(AllocOptimize, lvVars, lvVarSize * sizeof(SymbolInfo));
+      }
+      t->info->lvIndex = lvVarCount;
+      lvVars[lvVarCount++] = t->info;
+    }
+    for (i = 0; i < MAXCHILDREN; i++)
+      lvCollect(t->child[i]);
+  }
+}
+
+static int lvNewNode(TreeNode *exp, int isStmt)
+{
+  LvNode *n;
+  if (lvCount == lvSize)
+  {
+    lvSize = lvSize ? 2 * lvSize : 64;
+    lvNodes = (LvNode *)reallocate(AllocOptimize, lvNodes, lvSize * sizeof(LvNode));
+  }
+  n = &lvNodes[lvCount];
+  n->exp = exp;
+  n->isStmt = isStmt;
+  n->succ[0] = n->succ[1] = -1;
+  if (exp != NULL)
+  {
+    /* the condition's siblings are not part of it */
+    TreeNode *sib = exp->sibling;
+    exp->sibling = NULL;
+    lvCollect(exp);
+    exp->sibling = sib;
+  }
+  return lvCount++;
+}
+
+static int lvBuild(TreeNode *t, int next);
+
+static int lvBuildList(TreeNode *t, int next)
+{
+  if (t == NULL)
+    return next;
+  return lvBuild(t, lvBuildList(t->sibling, next));
+}
+
+/* Function lvBuild adds the flow graph of statement t
+ * whose successor is next and returns its entry node
+ */
+static int lvBuild(TreeNode *t, int next)
+{
+  int n, s;
+  if (t == NULL)
+    return next;
+  if (t->nodekind == ExpK)
+  {
+    n = lvNewNode(t, FALSE);
+    lvNodes[n].succ[0] = next;
+    return n;
+  }
+  switch (t->kind.stmt)
+  {
+  case AssignK:
+    n = lvNewNode(t, TRUE);
+    lvNodes[n].succ[0] = next;
+    return n;
+  case IfK:
+    n = lvNewNode(t->child[0], FALSE);
+    s = lvBuild(t->child[1], next);
+    lvNodes[n].succ[0] = s;
+    s = lvBuild(t->child[2], next);
+    lvNodes[n].succ[1] = s;
+    return n;
+  case WhileK:
+    n = lvNewNode(t->child[0], FALSE);
+    s = lvBuild(t->child[1], n);
+    lvNodes[n].succ[0] = s;
+    lvNodes[n].succ[1] = isConst(t->child[0]) ? -1 : next;
+    return n;
+  case ReturnK:
+    return lvNewNode(t->child[0], FALSE);
+  case CompoundK:
+    return lvBuildList(t->child[1], next);
+  default:
+    return next;
+  }
+}
+
+#define LV_SET(s, i) ((s)[(i) / 32] |= 1u << ((i) % 32))
+#define LV_HAS(s, i) (((s)[(i) / 32] >> ((i) % 32)) & 1u)
+
+/* Procedure lvRefs records the variables read and
+ * written by t. A read after a write in the same
+ * node counts as a read, which is safe
+ */
+static void lvRefs(TreeNode *t, LvNode *n)
+{
+  TreeNode *target;
+  int i;
+  for (; t != NULL; t = t->sibling)
+  {
+    target = NULL;
+    if (t->nodekind == StmtK && t->kind.stmt == AssignK)
+    {
+      target = t->child[0];
+      lvRefs(t->child[1], n);
+    }
+    else if (t->nodekind == ExpK && t->kind.exp == InputCallK)
+      target = t->child[0];
+    if (target != NULL)
+    {
+      if (isTracked(target))
+        LV_SET(n->def, target->info->lvIndex);
+      else
+        lvRefs(target->child[0], n);
+      continue;
+    }
+    if (t->nodekind == ExpK && t->kind.exp == IdK && isTracked(t))
+      LV_SET(n->use, t->info->lvIndex);
+    for (i = 0; i < MAXCHILDREN; i++)
+      lvRefs(t->child[i], n);
+  }
+}
+
+/* Procedure lvSolve computes the variables live into
+ * and out of every node. Successors are mostly built
+ * before their predecessors, so the forward sweep
+ * converges in few rounds
+ */
+static void lvSolve(void)
+{
+  unsigned int w;
+  size_t bytes = (4 * lvCount * lvWords + 1) * sizeof(unsigned int);
+  LvNode *n;
+  int i, j, k, changed;
+
+  lvPool = (unsigned int *)allocate(AllocOptimize, bytes);
+  memset(lvPool, 0, bytes);
+  for (i = 0; i < lvCount; i++)
+  {
+    n = &lvNodes[i];
+    n->use = lvPool + (4 * i) * lvWords;
+    n->def = n->use + lvWords;
+    n->in = n->def + lvWords;
+    n->out = n->in + lvWords;
+    if (n->exp != NULL)
+    {
+      TreeNode *sib = n->exp->sibling;
+      n->exp->sibling = NULL;
+      lvRefs(n->exp, n);
+      n->exp->sibling = sib;
+    }
+  }
+  do
+  {
+    changed = FALSE;
+    for (i = 0; i < lvCount; i++)
+    {
+      n = &lvNodes[i];
+      for (k = 0; k < lvWords; k++)
+      {
+        w = 0;
+        for (j = 0; j < 2; j++)
+          if (n->succ[j] >= 0)
+            w |= lvNodes[n->succ[j]].in[k];
+        n->out[k] = w;
+        w = n->use[k] | (w & ~n->def[k]);
+        if (w != n->in[k])
+        {
+          n->in[k] = w;
+          changed = TRUE;
+        }
+      }
+    }
+  } while (changed);
+}
+
+/* Function lvRemoveStores deletes the assignments
+ * whose target is dead on exit. An assignment whose
+ * right side has effects is replaced by that side.
+ * Returns the number of assignments removed
+ */
+static int lvRemoveStores(void)
+{
+  TreeNode *t, *rhs, *sib;
+  LvNode *n;
+  int i, count = 0;
+  for (i = 0; i < lvCount; i++)
+  {
+    n = &lvNodes[i];
+    t = n->exp;
+    if (!n->isStmt || !isTracked(t->child[0]) ||
+        LV_HAS(n->out, t->child[0]->info->lvIndex))
+      continue;
+    rhs = t->child[1];
+    sib = t->sibling;
+    if (isPure(rhs))
+    {
+      /* an empty compound statement is dropped by sweepList */
+      deadNodes += countNodes(t);
+      t->nodekind = StmtK;
+      t->kind.stmt = CompoundK;
+      t->child[0] = t->child[1] = NULL;
+    }
+    else
+    {
+      deadNodes += 2;
+      *t = *rhs;
+    }
+    t->sibling = sib;
+    count++;
+  }
+  return count;
+}
+
+/* Procedure removeDeadStores runs liveness analysis
+ * on function f until no more assignments die
+ */
+static void removeDeadStores(TreeNode *f)
+{
+  int i, n;
+  do
+  {
+    lvCount = 0;
+    lvVarCount = 0;
+    lvBuild(f->child[1], -1);
+    lvWords = (lvVarCount + 31) / 32;
+    lvSolve();
+    n = lvRemoveStores();
+    deadStores += n;
+    release(lvPool);
+    for (i = 0; i < lvVarCount; i++)
+      lvVars[i]->lvIndex = -1;
+  } while (n > 0);
+}
+
+static int sweepStmt(TreeNode *t);
+
+/* Function sweepList drops empty compound statements
+ * and the statements that follow one that never
+ * completes. *exits is set to TRUE if the list never
+ * completes either
+ */
+static TreeNode *sweepList(TreeNode *t, int *exits)
+{
+  TreeNode *head = NULL, *tail = NULL;
+  TreeNode *next;
+  *exits = FALSE;
+  while (t != NULL)
+  {
+    next = t->sibling;
+    t->sibling = NULL;
+    if (*exits)
+      deadNodes += countNodes(t);
+    else
+    {
+      *exits = sweepStmt(t);
+      if (!(t->nodekind == StmtK && t->kind.stmt == CompoundK &&
+            t->child[0] == NULL && t->child[1] == NULL))
+      {
+        if (tail == NULL)
+          head = t;
+        else
+          tail->sibling = t;
+        tail = t;
+      }
+    }
+    t = next;
+  }
+  return head;
+}
+
+/* Function sweepStmt removes unreachable code inside
+ * statement t and returns TRUE if control never flows
+ * past t: it returns, or loops forever (C- has no break)
+ */
+static int sweepStmt(TreeNode *t)
+{
+  int thenExits, elseExits;
+  if (t == NULL || t->nodekind != StmtK)
+    return FALSE;
+  switch (t->kind.stmt)
+  {
+  case CompoundK:
+    t->child[1] = sweepList(t->child[1], &thenExits);
+    return thenExits;
+  case IfK:
+    thenExits = sweepStmt(t->child[1]);
+    elseExits = sweepStmt(t->child[2]);
+    return thenExits && elseExits && t->child[2] != NULL;
+  case WhileK:
+    sweepStmt(t->child[1]);
+    return isConst(t->child[0]);
+  case ReturnK:
+    return TRUE;
+  default:
+    return FALSE;
+  }
+}
+
+static int isFunction(TreeNode *t)
+{
+  return t->nodekind == DeclarationK && t->kind.dec == FunctionK;
+}
+
+/* Procedure markCalls marks the functions called in t
+ * (they are found by name among the declarations)
+ */
+static void markCalls(TreeNode *t, TreeNode *decls, int *reached)
+{
+  TreeNode *d;
+  int i, k;
+  for (; t != NULL; t = t->sibling)
+  {
+    if (t->nodekind == ExpK && t->kind.exp == FuncCallK)
+      for (d = decls, k = 0; d != NULL; d = d->sibling, k++)
+        if (isFunction(d) && strcmp(d->attr.name, t->attr.name) == 0)
+          reached[k] = TRUE;
+    for (i = 0; i < MAXCHILDREN; i++)
+      markCalls(t->child[i], decls, reached);
+  }
+}
+
+/* Function removeDeadFunctions drops the functions
+ * that cannot be reached from main; the calls of a
+ * function whose code --incremental copies are in the
+ * body it set aside
+ */
+static TreeNode *removeDeadFunctions(TreeNode *syntaxTree)
+{
+  TreeNode *t, *head = NULL, *tail = NULL, *next;
+  int *reached, *walked;
+  int n, k, changed;
+
+  for (n = 0, t = syntaxTree; t != NULL; t = t->sibling)
+    n++;
+  reached = (int *)allocate(AllocOptimize, (n + 1) * sizeof(int));
+  walked = (int *)allocate(AllocOptimize, (n + 1) * sizeof(int));
+  memset(reached, 0, (n + 1) * sizeof(int));
+  memset(walked, 0, (n + 1) * sizeof(int));
+  for (k = 0, t = syntaxTree; t != NULL; t = t->sibling, k++)
+    if (isFunction(t) && strcmp(t->attr.name, "main") == 0)
+      reached[k] = TRUE;
+  do
+  {
+    changed = FALSE;
+    for (k = 0, t = syntaxTree; t != NULL; t = t->sibling, k++)
+      if (reached[k] && !walked[k])
+      {
+        markCalls(incrBody(t), syntaxTree, reached);
+        walked[k] = changed = TRUE;
+      }
+  } while (changed);
+
+  for (k = 0, t = syntaxTree; t != NULL; t = next, k++)
+  {
+    next = t->sibling;
+    if (isFunction(t) && !reached[k])
+    {
+      deadFuncs++;
+      continue;
+    }
+    t->sibling = NULL;
+    if (tail == NULL)
+      head = t;
+    else
+      tail->sibling = t;
+    tail = t;
+  }
+  release(reached);
+  release(walked);
+  return head;
+}
+
+/* Function eliminateDeadCode removes statements that
+ * can never execute, assignments to local variables
+ * that are not live afterwards (found by liveness
+ * analysis over each function's flow graph) and the
+ * functions main never calls, directly or not.
+ * Returns the new syntax tree.
+ */
+TreeNode *eliminateDeadCode(TreeNode *syntaxTree)
+{
+  TreeNode *t;
+  deadStores = deadNodes = deadFuncs = 0;
+  for (t = syntaxTree; t != NULL; t = t->sibling)
+    if (isFunction(t))
+    {
+      sweepStmt(t->child[1]);
+      removeDeadStores(t);
+      sweepStmt(t->child[1]);
+    }
+  syntaxTree = removeDeadFunctions(syntaxTree);
+  if (TraceOptimize)
+    fprintf(listing, "Dead code elimination removed %d stores, "
+                     "%d other nodes and %d functions\n",
+            deadStores, deadNodes, deadFuncs);
+  return syntaxTree;
+}
+
+/**************************************************/
+/***********   Local value numbering   ************/
+/**************************************************/
+
+/* kinds of value numbering keys */
+typedef enum {VnConst, VnVar, VnOp, VnAddr, VnElem} VnKind;
+
+/* a key names a value: a constant, a variable version,
+ * an operator applied to value numbers, an array
+ * element address or an array element loaded from
+ * a given version of memory
+ */
+typedef struct
+{
+  VnKind kind;
+  SymbolInfo sym;
+  int a, b, c;
+  int vn;          /* value number of the key */
+  TreeNode *node;  /* first node computing it, NULL if not reusable */
+} VnEntry;
+
+/* a later node that can take the value of an earlier one */
+typedef struct
+{
+  TreeNode *use;
+  TreeNode *def;
+  int addr;        /* TRUE: reuse the element address */
+  int withAddr;    /* TRUE: only valid if the previous address match is */
+} VnMatch;
+
+static VnEntry *vnTable = NULL;
+static int vnCount = 0, vnSize = 0;
+static VnMatch *vnMatches = NULL;
+static int vnMatchCount = 0, vnMatchSize = 0;
+static int nextVn = 0;
+static int regsUsed = 0;
+static int maxRegsUsed = VN_MAXREGS;
+static int reuses = 0;
+
+/* callEpoch changes at every call (globals and arrays
+ * may have been written), aliasEpoch also at every
+ * store through a global or parameter array, which
+ * may alias any other global or parameter array
+ */
+static int callEpoch = 0;
+static int aliasEpoch = 0;
+
+static int vnLookup(VnKind kind, SymbolInfo sym, int a, int b, int c,
+                    TreeNode *node, TreeNode **first)
+{
+  VnEntry *e;
+  int i;
+  for (i = vnCount - 1; i >= 0; i--)
+  {
+    e = &vnTable[i];
+    if (e->kind == kind && e->sym == sym && e->a == a && e->b == b && e->c == c)
+    {
+      *first = e->node;
+      return e->vn;
+    }
+  }
+  if (vnCount == vnSize)
+  {
+    vnSize = vnSize ? 2 * vnSize : 64;
+    vnTable = (VnEntry *)reallocate(AllocOptimize, vnTable, vnSize * sizeof(VnEntry));
+  }
+  e = &vnTable[vnCount++];
+  e->kind = kind;
+  e->sym = sym;
+  e->a = a;
+  e->b = b;
+  e->c = c;
+  e->vn = nextVn++;
+  e->node = node;
+  *first = NULL;
+  return e->vn;
+}
+
+static void vnMatch(TreeNode *use, TreeNode *def, int addr, int withAddr)
+{
+  if (vnMatchCount == vnMatchSize)
+  {
+    vnMatchSize = vnMatchSize ? 2 * vnMatchSize : 32;
+    vnMatches = (VnMatch *)reallocate(AllocOptimize, vnMatches, vnMatchSize * sizeof(VnMatch));
+  }
+  vnMatches[vnMatchCount].use = use;
+  vnMatches[vnMatchCount].def = def;
+  vnMatches[vnMatchCount].addr = addr;
+  vnMatches[vnMatchCount].withAddr = withAddr;
+  vnMatchCount++;
+}
+
+/* Procedure endBlock gives registers to the matches
+ * of the finished basic block and forgets its values
+ */
+static void endBlock(void)
+{
+  VnMatch *m;
+  int i, skipped = FALSE;
+  for (i = 0; i < vnMatchCount; i++)
+  {
+    m = &vnMatches[i];
+    if (m->withAddr && skipped)
+      continue;
+    skipped = FALSE;
+    if (m->addr)
+    {
+      if (m->def->vnAddrReg < 0)
+      {
+        if (regsUsed == maxRegsUsed)
+        {
+          skipped = TRUE;
+          continue;
+        }
+        m->def->vnAddrReg = regsUsed++;
+        m->def->vnFlags |= VN_KEEPADDR;
+      }
+      m->use->vnAddrReg = m->def->vnAddrReg;
+      m->use->vnFlags |= VN_REUSEADDR;
+    }
+    else
+    {
+      if (m->def->vnReg < 0)
+      {
+        if (regsUsed == maxRegsUsed)
+          continue;
+        m->def->vnReg = regsUsed++;
+        m->def->vnFlags |= VN_KEEP;
+      }
+      m->use->vnReg = m->def->vnReg;
+      m->use->vnFlags |= VN_REUSE;
+    }
+    reuses++;
+  }
+  vnMatchCount = 0;
+  vnCount = 0;
+  regsUsed = 0;
+}
+
+static int isParamOrGlobal(SymbolInfo sym)
+{
+  return sym->isGlobal || sym->decKind == ParamK;
+}
+
+/* Procedure vnKill records a store into the variable
+ * or array element named by the IdK node t
+ */
+static void vnKill(TreeNode *t)
+{
+  SymbolInfo sym = t->info;
+  if (t->child[0] == NULL)
+    sym->vnVersion++;
+  else
+  {
+    sym->vnMemVersion++;
+    if (isParamOrGlobal(sym))
+      aliasEpoch++;
+  }
+}
+
+static int vnExp(TreeNode *t, int isLval);
+
+static int vnAssign(TreeNode *t)
+{
+  int vn;
+  vnExp(t->child[0], TRUE);
+  vn = vnExp(t->child[1], FALSE);
+  vnKill(t->child[0]);
+  return vn;
+}
+
+/* Function vnExp numbers the expression t in the
+ * order the code generator evaluates it and returns
+ * its value number. isLval is TRUE when the address
+ * of t is needed too (assignment and input targets)
+ */
+static int vnExp(TreeNode *t, int isLval)
+{
+  TreeNode *first, *addrFirst, *p;
+  SymbolInfo sym;
+  int mark, l, r, idx, vn, pure;
+
+  if (t->nodekind == StmtK)
+    return t->kind.stmt == AssignK ? vnAssign(t) : nextVn++;
+
+  switch (t->kind.exp)
+  {
+  case ConstK:
+    return vnLookup(VnConst, NULL, t->val, 0, 0, NULL, &first);
+
+  case IdK:
+    sym = t->info;
+    if (t->child[0] == NULL)
+      return vnLookup(VnVar, sym, sym->vnVersion,
+                      sym->isGlobal ? callEpoch : 0, 0, NULL, &first);
+    mark = vnMatchCount;
+    idx = vnExp(t->child[0], FALSE);
+    addrFirst = NULL;
+    /* a constant subscript is addressed directly */
+    if (!isConst(t->child[0]))
+      vnLookup(VnAddr, sym, sym->vnVersion, idx, 0, t, &addrFirst);
+    vn = vnLookup(VnElem, sym, sym->vnMemVersion, idx,
+                  isParamOrGlobal(sym) ? aliasEpoch : callEpoch, t, &first);
+    /* the subscript is not evaluated again */
+    if (first != NULL || addrFirst != NULL)
+      vnMatchCount = mark;
+    /* an rvalue taken from a register needs no address */
+    if (addrFirst != NULL && (first == NULL || isLval))
+      vnMatch(t, addrFirst, TRUE, FALSE);
+    if (first != NULL && (addrFirst != NULL || !isLval))
+      vnMatch(t, first, FALSE, isLval);
+    return vn;
+
+  case OpK:
+    mark = vnMatchCount;
+    l = vnExp(t->child[0], FALSE);
+    r = vnExp(t->child[1], FALSE);
+    pure = !(t->attr.op == OVER && isConst(t->child[1]) && t->child[1]->val == 0);
+    if (t->attr.op == PLUS || t->attr.op == TIMES ||
+        t->attr.op == EQ || t->attr.op == NOTEQ)
+      if (l > r)
+      {
+        vn = l;
+        l = r;
+        r = vn;
+      }
+    vn = vnLookup(VnOp, NULL, t->attr.op, l, r, pure ? t : NULL, &first);
+    if (first != NULL)
+    {
+      vnMatchCount = mark;
+      vnMatch(t, first, FALSE, FALSE);
+    }
+    return vn;
+
+  case FuncCallK:
+    for (p = t->child[0]; p != NULL; p = p->sibling)
+      vnExp(p, FALSE);
+    callEpoch++;
+    aliasEpoch++;
+    return nextVn++;
+
+  case InputCallK:
+    vnExp(t->child[0], TRUE);
+    vnKill(t->child[0]);
+    return nextVn++;
+
+  case OutputCallK:
+    vnExp(t->child[0], FALSE);
+    return nextVn++;
+
+  default:
+    return nextVn++;
+  }
+}
+
+static void vnStmt(TreeNode *t)
+{
+  TreeNode *p;
+  if (t == NULL)
+    return;
+  if (t->nodekind == ExpK)
+  {
+    vnExp(t, FALSE);
+    return;
+  }
+  if (t->nodekind == DeclarationK)
+  {
+    if (t->kind.dec == FunctionK)
+    {
+      vnStmt(t->child[1]);
+      endBlock();
+    }
+    return;
+  }
+  switch (t->kind.stmt)
+  {
+  case AssignK:
+    vnAssign(t);
+    break;
+  case IfK:
+    vnExp(t->child[0], FALSE);
+    endBlock();
+    vnStmt(t->child[1]);
+    endBlock();
+    vnStmt(t->child[2]);
+    endBlock();
+    break;
+  case WhileK:
+    endBlock();
+    if (!isConst(t->child[0]))
+      vnExp(t->child[0], FALSE);
+    endBlock();
+    vnStmt(t->child[1]);
+    endBlock();
+    break;
+  case ReturnK:
+    if (t->child[0] != NULL)
+      vnExp(t->child[0], FALSE);
+    endBlock();
+    break;
+  case CompoundK:
+    for (p = t->child[1]; p != NULL; p = p->sibling)
+      vnStmt(p);
+    break;
+  default:
+    break;
+  }
+}
+
+/* Function numberValues performs local value
+ * numbering on every basic block and marks the
+ * expressions whose value or array element address
+ * can be reused from an earlier computation (see
+ * VN_* in globals.h), keeping at most maxRegs of
+ * them in registers at once. Returns the number of
+ * reuses.
+ */
+int numberValues(TreeNode *syntaxTree, int maxRegs)
+{
+  TreeNode *t;
+  reuses = 0;
+  maxRegsUsed = maxRegs < VN_MAXREGS ? maxRegs : VN_MAXREGS;
+  for (t = syntaxTree; t != NULL; t = t->sibling)
+    vnStmt(t);
+  if (TraceOptimize)
+    fprintf(listing, "Value numbering reused %d values\n", reuses);
+  return reuses;
+}
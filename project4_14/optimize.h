@@ -0,0 +1,41 @@
+/****************************************************/
+/* File: optimize.h                                 */
+/* Syntax tree optimizations for the C- compiler    */
+/* (run after type checking, before codeGen)        */
+/****************************************************/
+
+#ifndef _OPTIMIZE_H_
+#define _OPTIMIZE_H_
+
+/* Function foldConstants folds constant subtrees,
+ * applies algebraic identities and removes the dead
+ * arms of if/while statements with constant
+ * conditions. Returns the number of nodes removed.
+ */
+int foldConstants(TreeNode *);
+
+/* Function eliminateDeadCode removes statements that
+ * can never execute, assignments to local variables
+ * that are not live afterwards (found by liveness
+ * analysis over each function's flow graph) and the
+ * functions main never calls, directly or not.
+ * Returns the new syntax tree.
+ */
+TreeNode *eliminateDeadCode(TreeNode *);
+
+/* VN_MAXREGS is the largest number of registers that
+ * numberValues may use inside one basic block
+ */
+#define VN_MAXREGS 8
+
+/* Function numberValues performs local value
+ * numbering on every basic block and marks the
+ * expressions whose value or array element address
+ * can be reused from an earlier computation (see
+ * VN_* in globals.h), keeping at most maxRegs of
+ * them in registers at once. Returns the number of
+ * reuses.
+ */
+int numberValues(TreeNode *, int maxRegs);
+
+#endif
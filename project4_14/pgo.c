@@ -0,0 +1,348 @@
+/****************************************************/
+/* File: pgo.c                                      */
+/* Profile-guided optimization for the C- compiler  */
+/* The profile is the output of a program compiled  */
+/* with --pg; see pgo.h                             */
+/****************************************************/
+
+#include "globals.h"
+#include "symtab.h"
+#include "util.h"
+#include "pgo.h"
+#include "stats.h"
+
+/* an arm of an if statement is cold if it runs in
+ * fewer than 1 in COLD_RATIO of the tests
+ */
+#define COLD_RATIO 8
+
+/* largest loop test (in nodes) written twice by a
+ * rotation
+ */
+#define ROTATE_SIZE 16
+
+/* a call site is hot if it made at least 1 in
+ * HOT_RATIO of the calls; a function is inlined only
+ * if its expression has at most INLINE_SIZE nodes
+ */
+#define HOT_RATIO 100
+#define INLINE_SIZE 12
+
+/* a record of the profile: the runs of the test of
+ * an if or while and of its then part or body (kind
+ * 'b'), or the calls made at a call site ('a')
+ */
+typedef struct ProfRec
+{
+  char kind;
+  char *func;
+  int site;
+  char *callee;     /* of a call site */
+  double count;     /* tests, or calls */
+  double taken;     /* then parts or loop bodies */
+  struct ProfRec *next;
+} Prof;
+
+#define PROF_SIZE 211
+
+static Prof *profTab[PROF_SIZE];
+static double totalCalls = 0;
+
+/* the changes applyProfile made */
+static int coldParts = 0, rotated = 0, inlined = 0;
+
+static int profHash(char *func, int site)
+{
+  unsigned int h = site;
+  for (; *func != '\0'; func++)
+    h = (h << 4) + *func;
+  return h % PROF_SIZE;
+}
+
+static Prof *findProf(char kind, char *func, int site)
+{
+  Prof *p;
+  for (p = profTab[profHash(func, site)]; p != NULL; p = p->next)
+    if (p->kind == kind && p->site == site && strcmp(p->func, func) == 0)
+      return p;
+  return NULL;
+}
+
+/* the tables print counts as signed words */
+static double unsignedCount(double c)
+{
+  return c < 0 ? c + 4294967296.0 : c;
+}
+
+static void addProf(char kind, char *func, int site, char *callee,
+                    double count, double taken)
+{
+  Prof *p = findProf(kind, func, site);
+  if (p == NULL)
+  {
+    int h = profHash(func, site);
+    p = (Prof *)allocate(AllocOptimize, sizeof(Prof));
+    p->kind = kind;
+    p->func = copyString(func);
+    p->site = site;
+    p->callee = callee == NULL ? NULL : copyString(callee);
+    p->count = p->taken = 0;
+    p->next = profTab[h];
+    profTab[h] = p;
+  }
+  p->count += unsignedCount(count);
+  p->taken += unsignedCount(taken);
+}
+
+int readProfile(char *file)
+{
+  FILE *in = fopen(file, "r");
+  char line[512], func[200], callee[200];
+  int inTable = FALSE, records = 0, site, n;
+  double count, taken;
+  if (in == NULL)
+    return -1;
+  while (fgets(line, sizeof line, in) != NULL)
+  {
+    /* an input prompt may precede the "#pg" */
+    n = strlen(line);
+    if (n >= 4 && strcmp(line + n - 4, "#pg\n") == 0)
+      inTable = TRUE;
+    else if (!inTable)
+      continue;
+    else if (sscanf(line, "b %199s %d %lf %lf", func, &site, &count, &taken) == 4)
+    {
+      addProf('b', func, site, NULL, count, taken);
+      records++;
+    }
+    else if (sscanf(line, "a %199s %199s %d %lf", func, callee, &site, &count) == 4)
+    {
+      addProf('a', func, site, callee, count, 0);
+      totalCalls += unsignedCount(count);
+      records++;
+    }
+    else if (line[0] == 'f' && line[1] == ' ')
+      records++;
+    else
+      inTable = FALSE;
+  }
+  fclose(in);
+  return records;
+}
+
+/**************************************************/
+/***********   Site numbering          ************/
+/**************************************************/
+
+static void siteWalk(TreeNode *t, int *next)
+{
+  int i;
+  for (; t != NULL; t = t->sibling)
+  {
+    if ((t->nodekind == StmtK && (t->kind.stmt == IfK || t->kind.stmt == WhileK)) ||
+        (t->nodekind == ExpK && t->kind.exp == FuncCallK))
+      t->site = (*next)++;
+    for (i = 0; i < MAXCHILDREN; i++)
+      siteWalk(t->child[i], next);
+  }
+}
+
+void numberSites(TreeNode *syntaxTree)
+{
+  TreeNode *t;
+  int next;
+  for (t = syntaxTree; t != NULL; t = t->sibling)
+    if (t->nodekind == DeclarationK && t->kind.dec == FunctionK)
+    {
+      next = 0;
+      siteWalk(t->child[1], &next);
+    }
+}
+
+/**************************************************/
+/***********   Inlining                ************/
+/**************************************************/
+
+static TreeNode *functions;
+
+static int countNodes(TreeNode *t)
+{
+  int i, n = 0;
+  for (; t != NULL; t = t->sibling)
+  {
+    n++;
+    for (i = 0; i < MAXCHILDREN; i++)
+      n += countNodes(t->child[i]);
+  }
+  return n;
+}
+
+/* Function readsOnly returns TRUE if the expression
+ * t calls nothing and reads or writes no input or
+ * output, so it may be evaluated any number of times
+ * in any order
+ */
+static int readsOnly(TreeNode *t)
+{
+  int i;
+  for (; t != NULL; t = t->sibling)
+  {
+    if (t->nodekind != ExpK || t->kind.exp == FuncCallK ||
+        t->kind.exp == InputCallK || t->kind.exp == OutputCallK)
+      return FALSE;
+    for (i = 0; i < MAXCHILDREN; i++)
+      if (!readsOnly(t->child[i]))
+        return FALSE;
+  }
+  return TRUE;
+}
+
+static int uses(TreeNode *t, SymbolInfo info)
+{
+  int i, n = 0;
+  for (; t != NULL; t = t->sibling)
+  {
+    if (t->nodekind == ExpK && t->kind.exp == IdK && t->info == info)
+      n++;
+    for (i = 0; i < MAXCHILDREN; i++)
+      n += uses(t->child[i], info);
+  }
+  return n;
+}
+
+/* Function inlineBody returns the expression of
+ * function name if its body is "return expression;"
+ * and the expression only reads, otherwise NULL
+ */
+static TreeNode *inlineBody(char *name, TreeNode **params)
+{
+  TreeNode *f, *body, *p;
+  for (f = functions; f != NULL; f = f->sibling)
+    if (f->nodekind == DeclarationK && f->kind.dec == FunctionK &&
+        strcmp(f->attr.name, name) == 0)
+      break;
+  if (f == NULL || f->child[1] == NULL || f->child[1]->child[0] != NULL)
+    return NULL;
+  body = f->child[1]->child[1];
+  if (body == NULL || body->sibling != NULL || body->nodekind != StmtK ||
+      body->kind.stmt != ReturnK || body->child[0] == NULL ||
+      countNodes(body->child[0]) > INLINE_SIZE || !readsOnly(body->child[0]))
+    return NULL;
+  for (p = f->child[0]; p != NULL; p = p->sibling)
+    if (p->nodekind != DeclarationK || p->kind.dec != ParamK || p->info->isArray)
+      return NULL;
+  *params = f->child[0];
+  return body->child[0];
+}
+
+/* Function copyExp copies the expression t for line
+ * lineno, replacing the parameters in params by
+ * copies of the arguments in args
+ */
+static TreeNode *copyExp(TreeNode *t, TreeNode *params, TreeNode *args, int lineno)
+{
+  TreeNode *c, *p, *a;
+  int i;
+  if (t == NULL)
+    return NULL;
+  if (t->nodekind == ExpK && t->kind.exp == IdK)
+    for (p = params, a = args; p != NULL; p = p->sibling, a = a->sibling)
+      if (t->info == p->info)
+        return copyExp(a, NULL, NULL, lineno);
+  c = (TreeNode *)allocate(AllocAst, sizeof(TreeNode));
+  counters.nodes++;
+  *c = *t;
+  c->sibling = NULL;
+  c->lineno = lineno;
+  for (i = 0; i < MAXCHILDREN; i++)
+    c->child[i] = copyExp(t->child[i], params, args, lineno);
+  return c;
+}
+
+/* Procedure inlineCall replaces the call t by the
+ * expression its function returns if the arguments
+ * can be substituted for the parameters: they only
+ * read, and those used more than once are constants
+ * or variables
+ */
+static void inlineCall(TreeNode *t)
+{
+  TreeNode *params, *exp, *p, *a, *sibling;
+  int n;
+  exp = inlineBody(t->attr.name, &params);
+  if (exp == NULL)
+    return;
+  /* the arguments are evaluated where the parameters are used */
+  for (p = params, a = t->child[0]; p != NULL && a != NULL; p = p->sibling, a = a->sibling)
+  {
+    n = uses(exp, p->info);
+    if (!readsOnly(a) ||
+        (n > 1 && a->kind.exp != ConstK && (a->kind.exp != IdK || a->child[0] != NULL)))
+      return;
+  }
+  if (p != NULL || a != NULL)
+    return;
+  sibling = t->sibling;
+  exp = copyExp(exp, params, t->child[0], t->lineno);
+  *t = *exp;
+  t->sibling = sibling;
+  release(exp);
+  inlined++;
+}
+
+/**************************************************/
+/***********   Applying the profile    ************/
+/**************************************************/
+
+static void applyWalk(TreeNode *t, char *func)
+{
+  Prof *p;
+  int i;
+  for (; t != NULL; t = t->sibling)
+  {
+    for (i = 0; i < MAXCHILDREN; i++)
+      applyWalk(t->child[i], func);
+    if (t->site < 0)
+      continue;
+    if (t->nodekind == ExpK)
+    {
+      p = findProf('a', func, t->site);
+      if (p != NULL && p->count > 0 && strcmp(p->callee, t->attr.name) == 0 &&
+          p->count * HOT_RATIO >= totalCalls)
+        inlineCall(t);
+    }
+    else if ((p = findProf('b', func, t->site)) == NULL || p->count == 0)
+      continue;
+    else if (t->kind.stmt == IfK)
+    {
+      if (p->taken * COLD_RATIO < p->count)
+        t->pgoFlags |= PGO_COLD_THEN;
+      else if (t->child[2] != NULL && (p->count - p->taken) * COLD_RATIO < p->count)
+        t->pgoFlags |= PGO_COLD_ELSE;
+      else
+        continue;
+      coldParts++;
+    }
+    /* the body runs at least once for each entry */
+    else if (t->kind.stmt == WhileK && p->taken >= p->count - p->taken &&
+             countNodes(t->child[0]) <= ROTATE_SIZE)
+    {
+      t->pgoFlags |= PGO_ROTATE;
+      rotated++;
+    }
+  }
+}
+
+int applyProfile(TreeNode *syntaxTree)
+{
+  TreeNode *t;
+  functions = syntaxTree;
+  coldParts = rotated = inlined = 0;
+  for (t = syntaxTree; t != NULL; t = t->sibling)
+    if (t->nodekind == DeclarationK && t->kind.dec == FunctionK)
+      applyWalk(t->child[1], t->attr.name);
+  if (TraceOptimize)
+    fprintf(listing, "The profile moved %d parts out of line, rotated %d loops "
+                     "and inlined %d calls\n", coldParts, rotated, inlined);
+  return coldParts + rotated + inlined;
+}
@@ -0,0 +1,37 @@
+/****************************************************/
+/* File: pgo.h                                      */
+/* Profile-guided optimization for the C- compiler  */
+/* (run after dead code elimination, before value   */
+/* numbering)                                       */
+/****************************************************/
+
+#ifndef _PGO_H_
+#define _PGO_H_
+
+/* Procedure numberSites numbers the if, while and
+ * call sites of each function in preorder (the site
+ * field). A profile names a site by its function and
+ * this number, so it stays valid when other
+ * functions change, and --pg and --pgo builds of
+ * the same source agree on it
+ */
+void numberSites(TreeNode *);
+
+/* Function readProfile adds up the tables a program
+ * compiled with --pg printed after its "#pg" lines
+ * in file. Returns the number of records read, or
+ * -1 if the file cannot be opened
+ */
+int readProfile(char *file);
+
+/* Function applyProfile uses the profile read to
+ * move the cold part of skewed if statements out of
+ * line (PGO_COLD_THEN, PGO_COLD_ELSE in globals.h),
+ * to test the loops that usually iterate at the
+ * bottom (PGO_ROTATE) and to inline the hot calls
+ * of functions that only return an expression of
+ * their parameters. Returns the number of changes
+ */
+int applyProfile(TreeNode *);
+
+#endif
@@ -0,0 +1,152 @@
+/****************************************************/
+/* File: report.c                                   */
+/* Code quality report of the MIPS code generator:  */
+/* instruction mix, frame, spills, calls and basic  */
+/* blocks of each function (--code-report)          */
+/****************************************************/
+
+#include "globals.h"
+#include "report.h"
+#include "stats.h"
+
+typedef enum { ClassAlu, ClassLoadStore, ClassBranch, ClassPseudo, Classes } InstClass;
+
+typedef struct
+{
+  char *name;
+  long insts[Classes];
+  int frame;          /* bytes */
+  int opSpills;       /* push/pop pairs of OpK */
+  int assignSpills;   /* push/pop pairs of AssignK */
+  int calls;
+  int block;          /* instructions in the current basic block */
+  int maxBlock;
+} FuncReport;
+
+static FuncReport *reports = NULL;
+static int reportCount = 0, reportSize = 0;
+static FuncReport *current = NULL;
+
+/* assembler macros that are not branches; lw and sw
+ * of a label count as loads and stores
+ */
+static char *pseudoOps[] =
+{ "li", "la", "move", "neg", "negu", "not", "abs", "seq", "sne", "sle",
+  "sleu", "sgt", "sgtu", "sge", "sgeu", "rem", "remu", NULL };
+
+static InstClass classOf(char *op, int operands)
+{
+  int i;
+  if (op[0] == 'b' || op[0] == 'j')
+    return ClassBranch;
+  if (op[0] == 'l' || op[0] == 's')
+    if (strcmp(op, "lw") == 0 || strcmp(op, "sw") == 0 || strcmp(op, "lb") == 0 ||
+        strcmp(op, "lbu") == 0 || strcmp(op, "sb") == 0 || strcmp(op, "lh") == 0 ||
+        strcmp(op, "lhu") == 0 || strcmp(op, "sh") == 0)
+      return ClassLoadStore;
+  for (i = 0; pseudoOps[i] != NULL; i++)
+    if (strcmp(op, pseudoOps[i]) == 0)
+      return ClassPseudo;
+  /* the three-operand divisions check for zero */
+  if ((strcmp(op, "div") == 0 || strcmp(op, "divu") == 0) && operands == 3)
+    return ClassPseudo;
+  return ClassAlu;
+}
+
+void reportFunction(char *name)
+{
+  if (name == NULL)
+  {
+    current = NULL;
+    return;
+  }
+  if (reportCount == reportSize)
+  {
+    reportSize = reportSize ? 2 * reportSize : 32;
+    reports = (FuncReport *)reallocate(AllocCodegen, reports,
+                                       reportSize * sizeof(FuncReport));
+  }
+  current = &reports[reportCount++];
+  memset(current, 0, sizeof(FuncReport));
+  current->name = name;
+}
+
+void reportInst(char *op, int operands)
+{
+  InstClass c;
+  if (current == NULL)
+    return;
+  c = classOf(op, operands);
+  current->insts[c]++;
+  if (++current->block > current->maxBlock)
+    current->maxBlock = current->block;
+  if (c == ClassBranch)
+    current->block = 0;
+}
+
+void reportLabel(void)
+{
+  if (current != NULL)
+    current->block = 0;
+}
+
+void reportFrame(int bytes)
+{
+  if (current != NULL)
+    current->frame = bytes;
+}
+
+void reportSpill(int assign)
+{
+  if (current == NULL)
+    return;
+  if (assign)
+    current->assignSpills++;
+  else
+    current->opSpills++;
+}
+
+void reportCall(void)
+{
+  if (current != NULL)
+    current->calls++;
+}
+
+static void writeLine(FILE *out, FuncReport *r)
+{
+  long n = 0;
+  int c;
+  for (c = 0; c < Classes; c++)
+    n += r->insts[c];
+  fprintf(out, "%-16s %7ld %7ld %7ld %7ld %7ld %7d %8d %8d %7d %7d\n", r->name, n,
+          r->insts[ClassAlu], r->insts[ClassLoadStore], r->insts[ClassBranch],
+          r->insts[ClassPseudo], r->frame, r->opSpills, r->assignSpills,
+          r->calls, r->maxBlock);
+}
+
+void writeCodeReport(FILE *out, char *source)
+{
+  FuncReport total;
+  int i, c;
+  memset(&total, 0, sizeof total);
+  total.name = "total";
+  fprintf(out, "# code report for %s\n", source);
+  fprintf(out, "# insts by class, frame bytes, $sp push/pop pairs of operators\n");
+  fprintf(out, "# and assignments, calls, largest basic block (insts)\n");
+  fprintf(out, "%-16s %7s %7s %7s %7s %7s %7s %8s %8s %7s %7s\n", "function", "insts",
+          "alu", "ldst", "branch", "pseudo", "frame", "opspill", "asgspill",
+          "calls", "block");
+  for (i = 0; i < reportCount; i++)
+  {
+    writeLine(out, &reports[i]);
+    for (c = 0; c < Classes; c++)
+      total.insts[c] += reports[i].insts[c];
+    total.frame += reports[i].frame;
+    total.opSpills += reports[i].opSpills;
+    total.assignSpills += reports[i].assignSpills;
+    total.calls += reports[i].calls;
+    if (reports[i].maxBlock > total.maxBlock)
+      total.maxBlock = reports[i].maxBlock;
+  }
+  writeLine(out, &total);
+}
@@ -0,0 +1,38 @@
+/****************************************************/
+/* File: report.h                                   */
+/* Code quality report of the MIPS code generator   */
+/* for --code-report                                */
+/****************************************************/
+
+#ifndef _REPORT_H_
+#define _REPORT_H_
+
+/* Procedure reportFunction starts the record of the
+ * function name; the instructions emitted until the
+ * next call are counted for it. NULL stops counting
+ * (the runtime is not reported)
+ */
+void reportFunction(char *name);
+
+/* Procedure reportInst counts an instruction with
+ * its number of operands and reportLabel a label,
+ * which starts a basic block
+ */
+void reportInst(char *op, int operands);
+void reportLabel(void);
+
+/* Procedures reportFrame, reportSpill and reportCall
+ * record the frame bytes of the current function, a
+ * push/pop pair on $sp of an operator (assign FALSE)
+ * or an assignment (assign TRUE), and a call
+ */
+void reportFrame(int bytes);
+void reportSpill(int assign);
+void reportCall(void);
+
+/* Procedure writeCodeReport writes one line per
+ * function and the totals
+ */
+void writeCodeReport(FILE *out, char *source);
+
+#endif
@@ -0,0 +1,301 @@
+/****************************************************/
+/* File: stats.c                                    */
+/* Compiler instrumentation: per-phase timing and   */
+/* counters for --time-passes, --stats and          */
+/* --stats-json                                     */
+/****************************************************/
+
+#include <time.h>
+#include <sys/resource.h>
+#include "globals.h"
+#include "stats.h"
+
+#define MAXPHASES 32
+
+typedef struct
+{
+  char *name;
+  double wall, cpu;   /* seconds */
+  long peakRss;       /* kilobytes, at the end of the phase */
+  Counters delta;     /* what the phase counted */
+} Phase;
+
+typedef struct
+{
+  char *name;
+  long instructions;
+} FuncStat;
+
+Counters counters;
+
+static Phase phases[MAXPHASES];
+static int phaseCount = 0;
+static int current = -1;
+static double wallStart, cpuStart;
+static Counters countersStart;
+
+/* every accounted block starts with a header giving
+ * its size and kind, aligned for any type
+ */
+typedef union
+{
+  struct { size_t size; AllocKind kind; } h;
+  long double align;
+} AllocHeader;
+
+typedef struct
+{
+  long count;         /* blocks allocated */
+  long bytes;         /* bytes allocated, reallocations included */
+  long live, peak;    /* bytes not released, and their maximum */
+} AllocStat;
+
+static AllocStat allocs[AllocKinds];
+static long liveTotal = 0, peakTotal = 0;
+
+static char *allocName[AllocKinds] =
+{ "ast", "strings", "symtab", "lines", "optimize", "codegen" };
+
+int accountAllocs = FALSE;
+
+static FuncStat *funcs = NULL;
+static int funcCount = 0, funcSize = 0;
+
+static double wallClock(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static long peakRss(void)
+{
+  struct rusage ru;
+  if (getrusage(RUSAGE_SELF, &ru) != 0)
+    return 0;
+  return ru.ru_maxrss;
+}
+
+void phaseBegin(char *name)
+{
+  if (phaseCount == MAXPHASES)
+    return;
+  current = phaseCount++;
+  phases[current].name = name;
+  countersStart = counters;
+  cpuStart = (double)clock() / CLOCKS_PER_SEC;
+  wallStart = wallClock();
+}
+
+void phaseEnd(void)
+{
+  Phase *p;
+  if (current < 0)
+    return;
+  p = &phases[current];
+  p->wall = wallClock() - wallStart;
+  p->cpu = (double)clock() / CLOCKS_PER_SEC - cpuStart;
+  p->peakRss = peakRss();
+  p->delta.tokens = counters.tokens - countersStart.tokens;
+  p->delta.nodes = counters.nodes - countersStart.nodes;
+  p->delta.symbols = counters.symbols - countersStart.symbols;
+  p->delta.lookups = counters.lookups - countersStart.lookups;
+  p->delta.chainSteps = counters.chainSteps - countersStart.chainSteps;
+  p->delta.hashNodes = counters.hashNodes - countersStart.hashNodes;
+  p->delta.maxDepth = counters.maxDepth;
+  p->delta.instructions = counters.instructions - countersStart.instructions;
+  current = -1;
+}
+
+void statFunction(char *name, long instructions)
+{
+  if (funcCount == funcSize)
+  {
+    funcSize = funcSize ? 2 * funcSize : 32;
+    funcs = (FuncStat *)reallocate(AllocCodegen, funcs, funcSize * sizeof(FuncStat));
+  }
+  funcs[funcCount].name = name;
+  funcs[funcCount].instructions = instructions;
+  funcCount++;
+}
+
+static void account(AllocKind kind, long bytes)
+{
+  allocs[kind].live += bytes;
+  if (allocs[kind].live > allocs[kind].peak)
+    allocs[kind].peak = allocs[kind].live;
+  liveTotal += bytes;
+  if (liveTotal > peakTotal)
+    peakTotal = liveTotal;
+}
+
+void * allocate(AllocKind kind, size_t size)
+{
+  AllocHeader *h;
+  if (!accountAllocs)
+    return malloc(size);
+  h = (AllocHeader *)malloc(sizeof(AllocHeader) + size);
+  if (h == NULL)
+    return NULL;
+  h->h.size = size;
+  h->h.kind = kind;
+  allocs[kind].count++;
+  allocs[kind].bytes += size;
+  account(kind, size);
+  return h + 1;
+}
+
+void * reallocate(AllocKind kind, void * p, size_t size)
+{
+  AllocHeader *h;
+  size_t old;
+  if (!accountAllocs)
+    return realloc(p, size);
+  if (p == NULL)
+    return allocate(kind, size);
+  h = (AllocHeader *)p - 1;
+  old = h->h.size;
+  h = (AllocHeader *)realloc(h, sizeof(AllocHeader) + size);
+  if (h == NULL)
+    return NULL;
+  h->h.size = size;
+  if (size > old)
+    allocs[h->h.kind].bytes += size - old;
+  account(h->h.kind, (long)size - (long)old);
+  return h + 1;
+}
+
+void release(void * p)
+{
+  AllocHeader *h;
+  if (!accountAllocs)
+  {
+    free(p);
+    return;
+  }
+  if (p == NULL)
+    return;
+  h = (AllocHeader *)p - 1;
+  account(h->h.kind, -(long)h->h.size);
+  free(h);
+}
+
+static double avgChain(void)
+{
+  return counters.lookups ? (double)counters.chainSteps / counters.lookups : 0.0;
+}
+
+void printTimes(FILE *out)
+{
+  double wall = 0, cpu = 0;
+  int i;
+  fprintf(out, "\n%-12s %10s %10s %10s %8s %8s %8s\n", "phase", "wall ms",
+          "cpu ms", "peak KB", "tokens", "nodes", "symbols");
+  for (i = 0; i < phaseCount; i++)
+  {
+    Phase *p = &phases[i];
+    fprintf(out, "%-12s %10.3f %10.3f %10ld %8ld %8ld %8ld\n", p->name,
+            1e3 * p->wall, 1e3 * p->cpu, p->peakRss, p->delta.tokens,
+            p->delta.nodes, p->delta.symbols);
+    wall += p->wall;
+    cpu += p->cpu;
+  }
+  fprintf(out, "%-12s %10.3f %10.3f %10ld\n", "total", 1e3 * wall, 1e3 * cpu,
+          peakRss());
+}
+
+void printCounters(FILE *out)
+{
+  long sum = 0;
+  int i;
+  fprintf(out, "\ntokens           %10ld\n", counters.tokens);
+  fprintf(out, "tree nodes       %10ld\n", counters.nodes);
+  fprintf(out, "symbols          %10ld\n", counters.symbols);
+  fprintf(out, "lookups          %10ld\n", counters.lookups);
+  fprintf(out, "avg chain length %10.2f\n", avgChain());
+  fprintf(out, "max scope depth  %10d\n", counters.maxDepth);
+  fprintf(out, "scopes allocated %10ld\n", counters.hashNodes);
+  fprintf(out, "instructions     %10ld\n", counters.instructions);
+  if (funcCount == 0)
+    return;
+  fprintf(out, "\n%-16s %12s\n", "function", "instructions");
+  for (i = 0; i < funcCount; i++)
+  {
+    fprintf(out, "%-16s %12ld\n", funcs[i].name, funcs[i].instructions);
+    sum += funcs[i].instructions;
+  }
+  /* the rest is the runtime and the startup code */
+  fprintf(out, "%-16s %12ld\n", "(runtime)", counters.instructions - sum);
+}
+
+void printAllocs(FILE *out)
+{
+  long count = 0, bytes = 0;
+  int k;
+  fprintf(out, "\n%-10s %10s %12s %12s %12s\n", "heap", "blocks", "bytes",
+          "live", "peak");
+  for (k = 0; k < AllocKinds; k++)
+  {
+    fprintf(out, "%-10s %10ld %12ld %12ld %12ld\n", allocName[k],
+            allocs[k].count, allocs[k].bytes, allocs[k].live, allocs[k].peak);
+    count += allocs[k].count;
+    bytes += allocs[k].bytes;
+  }
+  fprintf(out, "%-10s %10ld %12ld %12ld %12ld\n", "total", count, bytes,
+          liveTotal, peakTotal);
+}
+
+/* Procedure jsonString writes s as a JSON string;
+ * source names are letters only, so only the quote
+ * and the backslash need escaping
+ */
+static void jsonString(FILE *out, char *s)
+{
+  fputc('"', out);
+  for (; *s; s++)
+  {
+    if (*s == '"' || *s == '\\')
+      fputc('\\', out);
+    fputc(*s, out);
+  }
+  fputc('"', out);
+}
+
+void writeStatsJson(FILE *out)
+{
+  int i, k;
+  fprintf(out, "{\n  \"phases\": [");
+  for (i = 0; i < phaseCount; i++)
+  {
+    Phase *p = &phases[i];
+    fprintf(out, "%s\n    {\"name\": ", i ? "," : "");
+    jsonString(out, p->name);
+    fprintf(out, ", \"wall_ms\": %.3f, \"cpu_ms\": %.3f, \"peak_rss_kb\": %ld,"
+            " \"tokens\": %ld, \"nodes\": %ld, \"symbols\": %ld,"
+            " \"lookups\": %ld, \"instructions\": %ld}",
+            1e3 * p->wall, 1e3 * p->cpu, p->peakRss, p->delta.tokens,
+            p->delta.nodes, p->delta.symbols, p->delta.lookups,
+            p->delta.instructions);
+  }
+  fprintf(out, "\n  ],\n  \"peak_rss_kb\": %ld,\n", peakRss());
+  fprintf(out, "  \"tokens\": %ld,\n  \"nodes\": %ld,\n  \"symbols\": %ld,\n",
+          counters.tokens, counters.nodes, counters.symbols);
+  fprintf(out, "  \"symtab\": {\"lookups\": %ld, \"chain_steps\": %ld,"
+          " \"avg_chain\": %.3f, \"max_depth\": %d, \"hash_nodes\": %ld},\n",
+          counters.lookups, counters.chainSteps, avgChain(),
+          counters.maxDepth, counters.hashNodes);
+  fprintf(out, "  \"heap\": {");
+  for (k = 0; k < AllocKinds; k++)
+    fprintf(out, "%s\n    \"%s\": {\"blocks\": %ld, \"bytes\": %ld,"
+            " \"live\": %ld, \"peak\": %ld}", k ? "," : "", allocName[k],
+            allocs[k].count, allocs[k].bytes, allocs[k].live, allocs[k].peak);
+  fprintf(out, ",\n    \"peak\": %ld\n  },\n", peakTotal);
+  fprintf(out, "  \"instructions\": %ld,\n  \"functions\": [", counters.instructions);
+  for (i = 0; i < funcCount; i++)
+  {
+    fprintf(out, "%s\n    {\"name\": ", i ? "," : "");
+    jsonString(out, funcs[i].name);
+    fprintf(out, ", \"instructions\": %ld}", funcs[i].instructions);
+  }
+  fprintf(out, "%s]\n}\n", funcCount ? "\n  " : "");
+}
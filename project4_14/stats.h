@@ -0,0 +1,75 @@
+/****************************************************/
+/* File: stats.h                                    */
+/* Compiler instrumentation: per-phase timing and   */
+/* counters for --time-passes, --stats and          */
+/* --stats-json                                     */
+/****************************************************/
+
+#ifndef _STATS_H_
+#define _STATS_H_
+
+/* counters the passes bump as they work */
+typedef struct
+{
+  long tokens;        /* returned by getToken */
+  long nodes;         /* syntax tree nodes created */
+  long symbols;       /* names entered by st_insert */
+  long lookups;       /* st_lookup, st_lookupInfo, st_lookupLineNo */
+  long chainSteps;    /* bucket entries the lookups compared */
+  long hashNodes;     /* scopes allocated by makeHashNode */
+  int maxDepth;       /* deepest scope entered */
+  long instructions;  /* emitted by the code generators */
+} Counters;
+
+extern Counters counters;
+
+/* the subsystems whose heap usage is accounted */
+typedef enum
+{ AllocAst, AllocString, AllocSymtab, AllocLines, AllocOptimize,
+  AllocCodegen, AllocKinds
+} AllocKind;
+
+/* Function allocate, reallocate and release work
+ * like malloc, realloc and free; what release is
+ * given must come from allocate or reallocate. When
+ * accountAllocs is set, before the first allocation,
+ * each block carries a header and is accounted to
+ * kind; otherwise they only call the libc functions
+ */
+extern int accountAllocs;
+
+void * allocate(AllocKind kind, size_t size);
+void * reallocate(AllocKind kind, void * p, size_t size);
+void release(void * p);
+
+/* Procedure phaseBegin starts timing the phase name;
+ * phaseEnd ends it and records its wall and CPU time,
+ * the peak RSS so far and the counters it changed
+ */
+void phaseBegin(char *name);
+void phaseEnd(void);
+
+/* Procedure statFunction records the instructions
+ * emitted for one function
+ */
+void statFunction(char *name, long instructions);
+
+/* Procedure printTimes writes the phase table and
+ * printCounters the counters and the functions, for
+ * reading
+ */
+void printTimes(FILE *out);
+void printCounters(FILE *out);
+
+/* Procedure printAllocs writes, per subsystem, the
+ * blocks and bytes allocated, the bytes still live
+ * and the peak of live bytes
+ */
+void printAllocs(FILE *out);
+
+/* Procedure writeStatsJson writes everything as one
+ * JSON object
+ */
+void writeStatsJson(FILE *out);
+
+#endif
@@ -12,6 +12,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include "symtab.h"
+#include "stats.h"
 //#include "globals.h"
 
 // /* SIZE is the size of the hash table */
@@ -67,7 +68,7 @@ BlockStructure getHashTableTop(){
 /* TODO
  */
 SymbolInfo _createSymbolInfo(){
-	SymbolInfo info = (SymbolInfo)malloc(sizeof(struct SymbolInfoRec));
+	SymbolInfo info = (SymbolInfo)allocate(AllocSymtab, sizeof(struct SymbolInfoRec));
 	info->nodekind = StmtK;
 	info->isArray = FALSE;
 	info->ArraySize = -1;
@@ -77,6 +78,10 @@ SymbolInfo _createSymbolInfo(){
 	info->retExpType = -1;
 	info->memloc = -1;
   info->isGlobal = 0;
+	info->vnVersion = 0;
+	info->vnMemVersion = 0;
+	info->lvIndex = -1;
+	info->argReg = -1;
 	return info;
 }
 
@@ -202,9 +207,10 @@ void st_insert(char *name, int lineno, int loc, SymbolInfo info)
 		if( info == NULL ){
 			fprintf(listing, "Hash insert Error\n");
 		}
-		l = (BucketList)malloc(sizeof(struct BucketListRec));
+		l = (BucketList)allocate(AllocSymtab, sizeof(struct BucketListRec));
+		counters.symbols++;
 		l->name = name;
-		l->lines = (LineList)malloc(sizeof(struct LineListRec));
+		l->lines = (LineList)allocate(AllocLines, sizeof(struct LineListRec));
 		l->lines->lineno = lineno;
 		l->lines->next = NULL;
 		l->memloc = loc;
@@ -230,7 +236,7 @@ void st_insert(char *name, int lineno, int loc, SymbolInfo info)
 			flag = 1;
 
 		if( flag == 0 ){
-			t->next = (LineList)malloc(sizeof(struct LineListRec));
+			t->next = (LineList)allocate(AllocLines, sizeof(struct LineListRec));
 			t->next->lineno = lineno;
 			t->next->next = NULL;
 		}
@@ -246,12 +252,14 @@ int st_lookup(char *name, SearchFlag flag)
 	BlockStructure cur = hashTableTop;
 	BucketList l = NULL;
 	int symbolFind = 0;
+	counters.lookups++;
 	
 	while (cur != NULL)
 	{
 		l = cur->hashTable[h];
 		while ((l != NULL))
 		{
+			counters.chainSteps++;
 			if (strcmp(name, l->name) == 0)
 			{
 				symbolFind = 1;
@@ -290,11 +298,13 @@ int st_lookupLineNo(char *name)
 	BlockStructure cur = hashTableTop;
 	BucketList l = NULL;
 	int symbolFind = 0;
+	counters.lookups++;
 	while (cur != NULL)
 	{
 		l = cur->hashTable[h];
 		while ((l != NULL))
 		{
+			counters.chainSteps++;
 			if (strcmp(name, l->name) == 0)
 			{
 				symbolFind = 1;
@@ -324,11 +334,13 @@ SymbolInfo st_lookupInfo(char *name)
 	BlockStructure cur = hashTableTop;
 	BucketList l = NULL;
 	int symbolFind = 0;
+	counters.lookups++;
 	while (cur != NULL)
 	{
 		l = cur->hashTable[h];
 		while ((l != NULL))
 		{
+			counters.chainSteps++;
 			if (strcmp(name, l->name) == 0)
 			{
 				symbolFind = 1;
@@ -408,7 +420,7 @@ void testing(){
                 pLine = pLine->next;
             }
             fprintf(listing, "%d", pLine->lineno);
-            printf("\n");
+            fprintf(listing, "\n");
         }
     }
     fprintf(listing, "\n");
@@ -451,7 +463,7 @@ void printSymTab(FILE *listing)
                 pLine = pLine->next;
             }
             fprintf(listing, "%d", pLine->lineno);
-            printf("\n");
+            fprintf(listing, "\n");
         }
     }
     fprintf(listing, "\n");
@@ -460,10 +472,12 @@ void printSymTab(FILE *listing)
 BlockStructure makeHashNode()
 {
 	int i=0;
-	BlockStructure tmp = (BlockStructure)malloc(sizeof(struct BlockStructureRec));
+	BlockStructure tmp = (BlockStructure)allocate(AllocSymtab, sizeof(struct BlockStructureRec));
+	counters.hashNodes++;
 	for(i=0; i<SIZE; i++){
 		tmp->hashTable[i] = NULL;
 	}
+	tmp->next = NULL;
 	tmp->depth = -1;
     tmp->memhigh = -4;
     tmp->memlow = 0;
@@ -476,10 +490,10 @@ void deleteHashNode(BlockStructure node){
         while( node->hashTable[i] != NULL ){
             BucketList tmp = node->hashTable[i];
             node->hashTable[i] = node->hashTable[i]->next;
-            free(tmp);
+            release(tmp);
         }
     }
-    free(node);
+    release(node);
 }
 
 void st_scopeIn(int withFunc)
@@ -535,6 +549,8 @@ void st_scopeIn(int withFunc)
         }
         hashTableTop = tmp;
     }
+    if (hashTableTop->depth > counters.maxDepth)
+        counters.maxDepth = hashTableTop->depth;
 }
 
 void st_scopeOut()
@@ -549,10 +565,11 @@ void st_scopeOut()
 }
 
 ParamInfo _createParamInfo(){
-	ParamInfo paInfo = (ParamInfo)malloc(sizeof(struct ParamInfoRec));
+	ParamInfo paInfo = (ParamInfo)allocate(AllocSymtab, sizeof(struct ParamInfoRec));
 	paInfo->expType = Dummy;
 	paInfo->name = NULL;
 	paInfo->next = NULL;
+	return paInfo;
 }
 
 void inssertParamlInfo(SymbolInfo info, char* name, ExpType expType){
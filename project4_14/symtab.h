@@ -15,6 +15,16 @@
 /* SIZE is the size of the hash table */
 #define SIZE 211
 
+/* Parameter layout: the first NUM_ARG_REGS arguments
+ * arrive in $a0-$a3 and are stored at PARAM_REG_BASE
+ * upwards in the callee's frame; argument i >= 4 stays
+ * in the caller's argument area, PARAM_STACK_BASE + 4*i
+ * bytes above the callee's $fp
+ */
+#define NUM_ARG_REGS 4
+#define PARAM_REG_BASE 4
+#define PARAM_STACK_BASE 20
+
 /* the list of line numbers of the source 
  * code in which a variable is referenced
  */
@@ -56,6 +66,10 @@ typedef struct SymbolInfoRec{
 	int retExpType;
 	int memloc;
 	int isGlobal;
+	int vnVersion; /* bumped by numberValues when the variable is assigned */
+	int vnMemVersion; /* bumped by numberValues when an array element is stored */
+	int lvIndex; /* bit of a local scalar in the liveness sets, -1 if none */
+	int argReg; /* $a register a parameter stays in, -1 if kept in memory */
 } * SymbolInfo;
 
 typedef struct BlockStructureRec
@@ -0,0 +1,100 @@
+/****************************************************/
+/* File: target.h                                   */
+/* The code generator target interface              */
+/* cgen.c walks the syntax tree for an accumulator  */
+/* machine; a target supplies its register file,    */
+/* instruction selection and emitter                */
+/****************************************************/
+
+#ifndef _TARGET_H_
+#define _TARGET_H_
+
+#include "symtab.h"
+
+/* the registers cgen.c refers to. A target maps them
+ * onto its own register file; RegArg + i is argument
+ * register i < numArgRegs and RegValue + i the i-th
+ * register for numbered values
+ */
+typedef enum
+{
+  RegAcc,      /* expression values */
+  RegAddr,     /* address of the last variable loaded */
+  RegSecond,   /* left operand of a binary operator */
+  RegTemp,     /* scratch */
+  RegFp,       /* frame pointer */
+  RegGp,       /* global pointer: RegGp + off addresses the global
+                  area at off, however the target reaches it */
+  RegSp,       /* stack pointer */
+  RegRa,       /* return address, saved by the prologue */
+  RegArg,
+  RegValue = RegArg + NUM_ARG_REGS
+} Reg;
+
+/* Frame conventions shared by all targets, in bytes
+ * of 4-byte words (symtab memloc units); cgen.c scales
+ * them by wordSize:
+ * the frame link holds the return address at -4 and
+ * the caller's frame pointer at 0 from the frame
+ * pointer, then the save slots of the argument
+ * registers; argument i >= numArgRegs is in the
+ * caller's argument area at PARAM_STACK_BASE + 4*i
+ */
+#define FRAME_LINK_SIZE 24
+
+typedef struct TargetRec
+{
+  char *name;          /* as given to --target= */
+  char *suffix;        /* of the code file */
+  int wordSize;        /* address units per word */
+  int numArgRegs;      /* arguments passed in registers */
+  int numValueRegs;    /* callee-saved registers numberValues may use */
+
+  /* emitter: begin starts the file and end finishes it
+     with the runtime. global lays out the global area,
+     one variable at a time in the order of off: size
+     address units at off from RegGp */
+  void (*begin)(char *codefile);
+  void (*global)(char *name, int off, int size);
+  void (*end)(void);
+  void (*comment)(char *c);
+  void (*line)(int lineno);  /* source line of the code that follows */
+  void (*label)(int lab);
+  void (*funcLabel)(char *name);
+
+  /* instructions; offsets are in address units */
+  void (*move)(Reg dst, Reg src);
+  void (*loadConst)(Reg dst, int c);
+  void (*load)(Reg dst, int off, Reg base);
+  void (*store)(Reg src, int off, Reg base);
+  void (*loadAddr)(Reg dst, int off, Reg base);
+  void (*addConst)(Reg dst, Reg src, int c);
+  void (*add)(Reg dst, Reg a, Reg b);
+  void (*sub)(Reg dst, Reg a, Reg b);
+  void (*scale)(Reg r);                 /* r = r * wordSize */
+  void (*op)(TokenType op);             /* acc = second op acc */
+  int (*opConst)(TokenType op, int c);  /* acc = acc op c; FALSE if the
+                                           general sequence is no worse */
+  void (*jump)(int lab);
+  void (*jumpIfZero)(Reg r, int lab);
+  void (*jumpIfNonZero)(Reg r, int lab);
+  void (*call)(char *name);
+  void (*ret)(void);
+  void (*input)(void);                  /* reads into the word at RegAddr */
+  void (*output)(void);                 /* prints acc */
+
+  /* profiling (--pg) of the sites numbered by
+     numberSites: a run of the test of an if or while
+     (taken FALSE), a run of its then part or loop body
+     (taken TRUE), and a call to callee */
+  void (*countBranch)(int site, int taken);
+  void (*countCall)(int site, char *callee);
+} Target;
+
+/* SPIM assembly (mipsgen.c) */
+extern Target mipsTarget;
+
+/* code for Louden's TM machine (tmgen.c) */
+extern Target tmTarget;
+
+#endif
@@ -11,17 +11,13 @@
 #include "util.h"
 #include "scan.h"
 #include "parse.h"
+#include "stats.h"
 
 #define YYSTYPE TreeNode *
 static char * savedName; /* for use in assignments */
-static char * savedFuncName;
-static char * savedFuncCallName;
 static int savedLineNo;  /* ditto */
 static char * savedValue; /* for use declaration ADD PRJ2 */
 static ExpType savedType; /* for use DataType ADd PRJ2 */
-static TokenType savedRelOp;
-static TokenType savedAddOp;
-static TokenType savedMulOp;
 static TreeNode * savedTree; /* stores syntax tree for later return */
 
 int yyerror(char * message);
@@ -36,7 +32,8 @@ static int yylex(void);
 }
 
 static int yylex(void)
-{ return getToken(); }
+{ counters.tokens++;
+  return getToken(); }
 
 TreeNode * parse(void)
 { yyparse();
@@ -92,12 +89,10 @@ var_declaration  : type_specifier ID { savedName = copyString(tokenStringNew);
 type_specifier	 : INT { savedType = INT;  $$ = newDecNode(DummyK); $$->expType = INT;}
 				 | VOID { savedType = VOID; $$ = newDecNode(DummyK); $$->expType = VOID;}
 				 ;
-fun_declaration	 : type_specifier ID { savedFuncName = copyString(tokenStringNew);
-				   						savedLineNo = lineno; }
+fun_declaration	 : type_specifier ID { $$ = newDecNode(FunctionK);
+				   						$$->attr.name = copyString(tokenStringNew); }
 					LPAREN params RPAREN compound_stmt
-					{ $$ = newDecNode(FunctionK);
-						$$->attr.name = savedFuncName;
-						$$->lineno = lineno;
+					{ $$ = $3;
 						$$->child[0] = $5;
 						$$->child[1] = $7;
 						$$->expType = $1->expType;
@@ -170,24 +165,31 @@ statement 			 : expression_stmt { $$ = $1; }
 expression_stmt		 : expression SEMI { $$ = $1; }
 					 | SEMI { $$ = NULL; }
 					 ;
-selection_stmt		 : IF LPAREN expression RPAREN statement
-						{ $$ = newStmtNode(IfK);
+selection_stmt		 : if_keyword LPAREN expression RPAREN statement
+						{ $$ = $1;
 							$$->child[0] = $3;
 							$$->child[1] = $5;
 						}
-					 | IF LPAREN expression RPAREN statement ELSE statement
-					 	{ $$ = newStmtNode(IfK);
+					 | if_keyword LPAREN expression RPAREN statement ELSE statement
+					 	{ $$ = $1;
 							$$->child[0] = $3;
 							$$->child[1] = $5;
 							$$->child[2] = $7;
 						}
 					 ;
-iteration_stmt		 : WHILE LPAREN expression RPAREN statement
-						{ $$ = newStmtNode(WhileK);
+iteration_stmt		 : while_keyword LPAREN expression RPAREN statement
+						{ $$ = $1;
 							$$->child[0] = $3;
 							$$->child[1] = $5;
 						}
 					 ;
+/* the node of a function, if or while is made at its
+   name or keyword, so it gets the line of the header
+   and not that of the end of its body */
+if_keyword			 : IF { $$ = newStmtNode(IfK); }
+					 ;
+while_keyword		 : WHILE { $$ = newStmtNode(WhileK); }
+					 ;
 return_stmt			 : RETURN SEMI
 						{ $$ = newStmtNode(ReturnK);
 						}
@@ -209,52 +211,50 @@ var					 : ID
 							$$->attr.name = copyString(tokenStringNew);
 							$$->lineno = lineno; 
 						}
-					 | ID { savedName = copyString(tokenStringNew);
-						 	savedLineNo = lineno; }
+					 | ID { $$ = newExpNode(IdK);
+							$$->attr.name = copyString(tokenStringNew);
+							$$->lineno = lineno; }
 						LSQBRACKET expression RSQBRACKET
-					 	{ $$ = newExpNode(IdK);
-							$$->attr.name = savedName;
-							$$->lineno = savedLineNo;
+					 	{ /* the node is made before the subscript,
+							   which may contain other names */
+							$$ = $2;
 							$$->child[0] = $4;
 							$$->isArray = 1;
 						}
 					 ;
 simple_expression	 : additive_expression relop additive_expression
-						{ $$ = newExpNode(OpK);
+						{ $$ = $2;
 							$$->child[0] = $1;
 							$$->child[1] = $3;
-							$$->attr.op = savedRelOp;
 						}
 					 | additive_expression { $$ = $1; }
 					 ;
-relop				 : LTET { savedRelOp = LTET; }
-					 | LT { savedRelOp = LT; }
-					 | GT { savedRelOp = GT; }
-					 | GTET { savedRelOp = GTET; }
-					 | EQ { savedRelOp = EQ; }
-					 | NOTEQ { savedRelOp = NOTEQ; }
+relop				 : LTET { $$ = newExpNode(OpK); $$->attr.op = LTET; }
+					 | LT { $$ = newExpNode(OpK); $$->attr.op = LT; }
+					 | GT { $$ = newExpNode(OpK); $$->attr.op = GT; }
+					 | GTET { $$ = newExpNode(OpK); $$->attr.op = GTET; }
+					 | EQ { $$ = newExpNode(OpK); $$->attr.op = EQ; }
+					 | NOTEQ { $$ = newExpNode(OpK); $$->attr.op = NOTEQ; }
 					 ;
 additive_expression	 : additive_expression addop term
-						{ $$ = newExpNode(OpK);
+						{ $$ = $2;
 							$$->child[0] = $1;
 							$$->child[1] = $3;
-							$$->attr.op = savedAddOp;
 						}
 					 | term { $$ = $1; }
 					 ;
-addop				 : PLUS { savedAddOp = PLUS; }
-					 | MINUS { savedAddOp = MINUS; }
+addop				 : PLUS { $$ = newExpNode(OpK); $$->attr.op = PLUS; }
+					 | MINUS { $$ = newExpNode(OpK); $$->attr.op = MINUS; }
 					 ;
 term				 : term mulop factor
-						{ $$ = newExpNode(OpK);
+						{ $$ = $2;
 							$$->child[0] = $1;
 							$$->child[1] = $3;
-							$$->attr.op = savedMulOp;
 						}
 					 | factor { $$ = $1; }
 					 ;
-mulop				 : TIMES { savedMulOp = TIMES; }
-					 | OVER { savedMulOp = OVER; }
+mulop				 : TIMES { $$ = newExpNode(OpK); $$->attr.op = TIMES; }
+					 | OVER { $$ = newExpNode(OpK); $$->attr.op = OVER; }
 					 ;
 factor				 : LPAREN expression RPAREN { $$ = $2; }
 					 | var { $$ = $1; }
@@ -264,12 +264,13 @@ factor				 : LPAREN expression RPAREN { $$ = $2; }
 							$$->val = atoi(tokenString);
 						}
 					 ;
-call				 : ID { savedFuncCallName = copyString(tokenStringNew); 
-						    savedLineNo = lineno; }
+call				 : ID { $$ = newExpNode(FuncCallK);
+							$$->attr.name = copyString(tokenStringNew);
+							$$->lineno = lineno; }
 						LPAREN args RPAREN
-						{ $$ = newExpNode(FuncCallK);
-							$$->attr.name = savedFuncCallName;
-							$$->lineno = savedLineNo;
+						{ /* made before the arguments, which may
+							   contain other calls */
+							$$ = $2;
 							$$->child[0] = $4;
 						}
 					 | inputcall { $$ = $1; }
@@ -317,7 +318,8 @@ int yyerror(char * message)
  * compatible with ealier versions of the TINY scanner
  */
 static int yylex(void)
-{ return getToken(); }
+{ counters.tokens++;
+  return getToken(); }
 
 TreeNode * parse(void)
 { yyparse();
@@ -0,0 +1,1350 @@
+/****************************************************/
+/* File: tm.c                                       */
+/* Simulator for the MIPS subset the C- compiler    */
+/* emits into .tm files or binary images (a         */
+/* stand-in for SPIM that also counts what the      */
+/* program executes)                                */
+/****************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include "image.h"
+
+#ifndef TRUE
+#define TRUE 1
+#endif
+#ifndef FALSE
+#define FALSE 0
+#endif
+
+/******* const *******/
+#define LINESIZE 1024
+#define TEXT_BASE  0x00400000u
+#define DATA_BASE  0x10000000u
+#define DATA_SIZE  (4 << 20)
+#define GP_INIT    0x10008000u
+#define STACK_TOP  0x80000000u
+#define STACK_SIZE (8 << 20)
+#define SP_INIT    0x7fffeffcu
+/* return address given to main; jumping there ends the run */
+#define RA_EXIT    0u
+
+/******* type  *******/
+typedef enum {
+   /* rd := rs op (rt or imm) */
+   opADD, opSUB, opMUL, opAND, opOR, opXOR, opNOR,
+   opSLL, opSRA, opSRL, opSLT, opSLTU, opSLE, opSGT, opSGE, opSEQ, opSNE,
+   opDIV3, opDIVU3, opREM, opREMU,
+   /* rd := f(rs) or f(imm) */
+   opMOVE, opLI, opLUI, opNEG, opNOT, opABS,
+   /* hi/lo */
+   opMULT, opMULTU, opDIV, opDIVU, opMFHI, opMFLO,
+   /* memory: rd <-> imm(rs) */
+   opLW, opSW, opLB, opLBU, opSB, opLH, opLHU, opSH, opLD, opSD, opLA,
+   /* control */
+   opJ, opJAL, opJR, opJALR,
+   opBEQ, opBNE, opBLT, opBGE, opBLE, opBGT,
+   opSYSCALL, opNOP,
+   /* rd := hardware register rt (2: the cycle counter) */
+   opRDHWR
+} OPCODE;
+
+typedef struct {
+   char *name;     /* mnemonic as written */
+   OPCODE op;
+   int nregs;      /* register operands before the last operand */
+} OPINFO;
+
+/* accepted mnemonics; pseudo-ops map onto the same
+ * opcode as the instruction they expand to
+ */
+static OPINFO opTab[] = {
+   {"add", opADD, 2}, {"addu", opADD, 2}, {"addi", opADD, 2}, {"addiu", opADD, 2},
+   {"sub", opSUB, 2}, {"subu", opSUB, 2},
+   {"mul", opMUL, 2}, {"mulo", opMUL, 2}, {"mulou", opMUL, 2},
+   {"and", opAND, 2}, {"andi", opAND, 2}, {"or", opOR, 2}, {"ori", opOR, 2},
+   {"xor", opXOR, 2}, {"xori", opXOR, 2}, {"nor", opNOR, 2},
+   {"sll", opSLL, 2}, {"sllv", opSLL, 2}, {"sra", opSRA, 2}, {"srav", opSRA, 2},
+   {"srl", opSRL, 2}, {"srlv", opSRL, 2},
+   {"slt", opSLT, 2}, {"slti", opSLT, 2}, {"sltu", opSLTU, 2}, {"sltiu", opSLTU, 2},
+   {"sle", opSLE, 2}, {"sgt", opSGT, 2}, {"sge", opSGE, 2},
+   {"seq", opSEQ, 2}, {"sne", opSNE, 2},
+   {"div", opDIV, 1}, {"divu", opDIVU, 1},
+   {"rem", opREM, 2}, {"remu", opREMU, 2},
+   {"move", opMOVE, 1}, {"li", opLI, 1}, {"lui", opLUI, 1},
+   {"neg", opNEG, 1}, {"negu", opNEG, 1}, {"not", opNOT, 1}, {"abs", opABS, 1},
+   {"mult", opMULT, 1}, {"multu", opMULTU, 1},
+   {"mfhi", opMFHI, 0}, {"mflo", opMFLO, 0},
+   {"lw", opLW, 1}, {"sw", opSW, 1}, {"lb", opLB, 1}, {"lbu", opLBU, 1},
+   {"sb", opSB, 1}, {"lh", opLH, 1}, {"lhu", opLHU, 1}, {"sh", opSH, 1},
+   {"ld", opLD, 1}, {"sd", opSD, 1}, {"la", opLA, 1},
+   {"j", opJ, 0}, {"b", opJ, 0}, {"jal", opJAL, 0}, {"jr", opJR, 0}, {"jalr", opJALR, 0},
+   {"beq", opBEQ, 1}, {"bne", opBNE, 1}, {"blt", opBLT, 1}, {"bge", opBGE, 1},
+   {"ble", opBLE, 1}, {"bgt", opBGT, 1},
+   {"beqz", opBEQ, 1}, {"bnez", opBNE, 1}, {"bltz", opBLT, 1}, {"bgez", opBGE, 1},
+   {"blez", opBLE, 1}, {"bgtz", opBGT, 1},
+   {"syscall", opSYSCALL, 0}, {"nop", opNOP, 0}, {"rdhwr", opRDHWR, 1},
+   {NULL, opNOP, 0}
+};
+
+/* a decoded instruction; operands that name labels
+ * are kept as text until every label is known
+ */
+typedef struct {
+   OPCODE op;
+   char *name;
+   int rd, rs, rt;     /* rt < 0: use imm */
+   int imm;
+   int target;         /* instruction index of a jump or branch */
+   char *operand;      /* unresolved label operand */
+   int lineno;
+   unsigned long count;
+} INSTRUCTION;
+
+typedef struct {
+   char *name;
+   int inText;
+   unsigned int value;  /* instruction index or data address */
+} LABEL;
+
+/* a function is a label reached by jal */
+typedef struct {
+   char *name;
+   unsigned long calls;
+   unsigned long inclusive;
+   unsigned long self;
+   int active;
+} FUNCTION;
+
+typedef struct {
+   int func;
+   unsigned int retAddr;
+   unsigned long entry;
+} FRAME;
+
+/******** vars ********/
+static INSTRUCTION *iMem = NULL;
+static int iCount = 0, iSize = 0;
+static LABEL *labels = NULL;
+static int labelCount = 0, labelSize = 0;
+static FUNCTION *funcs = NULL;
+static int funcCount = 0, funcSize = 0;
+static int *funcAt = NULL;  /* function starting at each instruction, or -1 */
+static FRAME *frames = NULL;
+static int frameCount = 0, frameSize = 0;
+
+static unsigned char *dMem;
+static unsigned char *sMem;
+static unsigned int dataTop = DATA_BASE;
+
+static int reg[32];
+static int hi, lo;
+static unsigned long steps = 0;
+
+static FILE *pgm;
+static char *pgmName;
+static int lineNo = 0;
+
+static char *regNames[32] = {
+   "zero", "at", "v0", "v1", "a0", "a1", "a2", "a3",
+   "t0", "t1", "t2", "t3", "t4", "t5", "t6", "t7",
+   "s0", "s1", "s2", "s3", "s4", "s5", "s6", "s7",
+   "t8", "t9", "k0", "k1", "gp", "sp", "fp", "ra"
+};
+
+/********************************************/
+static void error(char *msg, char *arg)
+{
+   fprintf(stderr, "tm: %s:%d: %s%s%s\n", pgmName, lineNo, msg,
+           arg ? " " : "", arg ? arg : "");
+   exit(1);
+}
+
+static void runError(char *msg, INSTRUCTION *ip, unsigned int addr)
+{
+   fprintf(stderr, "tm: %s:%d: %s 0x%08x in %s\n", pgmName, ip->lineno,
+           msg, addr, ip->name);
+   exit(1);
+}
+
+static char *copyStr(char *s)
+{
+   char *t = (char *)malloc(strlen(s) + 1);
+   strcpy(t, s);
+   return t;
+}
+
+static char *trim(char *s)
+{
+   char *e;
+   while (isspace((unsigned char)*s))
+      s++;
+   e = s + strlen(s);
+   while (e > s && isspace((unsigned char)e[-1]))
+      *--e = '\0';
+   return s;
+}
+
+/********************************************/
+/* Function memAddr returns the host address of size
+ * bytes at target address a, or NULL if a is not
+ * in the data segment or the stack
+ */
+static unsigned char *memAddr(unsigned int a, int size)
+{
+   if (a >= DATA_BASE && a - DATA_BASE <= (unsigned int)(DATA_SIZE - size))
+      return dMem + (a - DATA_BASE);
+   if (a >= STACK_TOP - STACK_SIZE && a <= STACK_TOP - size)
+      return sMem + (a - (STACK_TOP - STACK_SIZE));
+   return NULL;
+}
+
+static void putData(int size, int value)
+{
+   unsigned char *p = memAddr(dataTop, size);
+   int i;
+   if (p == NULL)
+      error("data segment full", NULL);
+   for (i = 0; i < size; i++)
+      p[i] = (unsigned char)(value >> (8 * i));
+   dataTop += size;
+}
+
+/********************************************/
+static LABEL *findLabel(char *name)
+{
+   int i;
+   for (i = 0; i < labelCount; i++)
+      if (strcmp(labels[i].name, name) == 0)
+         return &labels[i];
+   return NULL;
+}
+
+static void addLabel(char *name, int inText, unsigned int value)
+{
+   if (findLabel(name) != NULL)
+      error("duplicate label", name);
+   if (labelCount == labelSize)
+   {
+      labelSize = labelSize ? 2 * labelSize : 64;
+      labels = (LABEL *)realloc(labels, labelSize * sizeof(LABEL));
+   }
+   labels[labelCount].name = copyStr(name);
+   labels[labelCount].inText = inText;
+   labels[labelCount].value = value;
+   labelCount++;
+}
+
+static int labelValue(LABEL *l)
+{
+   return l->inText ? (int)(TEXT_BASE + 4 * l->value) : (int)l->value;
+}
+
+static int getReg(char *s)
+{
+   int i;
+   s = trim(s);
+   if (*s != '$')
+      error("register expected:", s);
+   s++;
+   if (isdigit((unsigned char)*s))
+   {
+      i = atoi(s);
+      if (i >= 0 && i < 32)
+         return i;
+   }
+   else
+      for (i = 0; i < 32; i++)
+         if (strcmp(s, regNames[i]) == 0)
+            return i;
+   if (strcmp(s, "s8") == 0)
+      return 30;
+   error("unknown register", s - 1);
+   return 0;
+}
+
+/* Function getExpr evaluates a sum of numbers,
+ * character literals and (if allowed) labels.
+ * Returns FALSE if s names an undefined label
+ */
+static int getExpr(char *s, int *val, int allowLabels)
+{
+   char term[LINESIZE];
+   LABEL *l;
+   int sign = 1, n, v;
+   s = trim(s);
+   *val = 0;
+   if (*s == '\0')
+      return TRUE;
+   while (*s)
+   {
+      if (*s == '+' || *s == '-')
+      {
+         if (*s == '-')
+            sign = -sign;
+         s++;
+         continue;
+      }
+      if (isspace((unsigned char)*s))
+      {
+         s++;
+         continue;
+      }
+      if (*s == '\'')
+      {
+         v = (unsigned char)s[1];
+         if (s[1] == '\\')
+         {
+            v = s[2] == 'n' ? '\n' : s[2] == 't' ? '\t' : s[2] == '0' ? 0 : s[2];
+            s++;
+         }
+         if (s[2] != '\'')
+            error("bad character literal", NULL);
+         s += 3;
+      }
+      else if (isdigit((unsigned char)*s))
+      {
+         v = (int)strtoul(s, &s, 0);
+      }
+      else if (isalpha((unsigned char)*s) || *s == '_' || *s == '.')
+      {
+         n = 0;
+         while (isalnum((unsigned char)*s) || *s == '_' || *s == '.')
+            term[n++] = *s++;
+         term[n] = '\0';
+         if (!allowLabels)
+            error("number expected:", term);
+         if ((l = findLabel(term)) == NULL)
+            return FALSE;
+         v = labelValue(l);
+      }
+      else
+      {
+         error("bad operand", s);
+         return FALSE;
+      }
+      *val += sign * v;
+      sign = 1;
+   }
+   return TRUE;
+}
+
+/* Function splitOperands splits s at the commas that
+ * are outside quotes and parentheses
+ */
+static int splitOperands(char *s, char **ops, int max)
+{
+   int n = 0, depth = 0, quote = FALSE;
+   if (*trim(s) == '\0')
+      return 0;
+   ops[n++] = s;
+   for (; *s; s++)
+   {
+      if (*s == '\'' && !quote)
+         quote = TRUE;
+      else if (*s == '\'' && quote)
+         quote = FALSE;
+      else if (quote)
+         continue;
+      else if (*s == '(')
+         depth++;
+      else if (*s == ')')
+         depth--;
+      else if (*s == ',' && depth == 0)
+      {
+         *s = '\0';
+         if (n == max)
+            error("too many operands", NULL);
+         ops[n++] = s + 1;
+      }
+   }
+   for (depth = 0; depth < n; depth++)
+      ops[depth] = trim(ops[depth]);
+   return n;
+}
+
+/********************************************/
+/* Procedure readString copies a quoted string with
+ * C escapes into the data segment
+ */
+static void readString(char *s, int zero)
+{
+   s = trim(s);
+   if (*s++ != '"')
+      error("string expected", NULL);
+   while (*s && *s != '"')
+   {
+      int c = *s++;
+      if (c == '\\')
+      {
+         c = *s++;
+         switch (c)
+         {
+         case 'n': c = '\n'; break;
+         case 't': c = '\t'; break;
+         case '0': c = '\0'; break;
+         default: break;
+         }
+      }
+      putData(1, c);
+   }
+   if (zero)
+      putData(1, 0);
+}
+
+static void doDirective(char *dir, char *rest, int *inText)
+{
+   char *ops[256];
+   int i, n, v;
+   if (strcmp(dir, ".data") == 0)
+      *inText = FALSE;
+   else if (strcmp(dir, ".text") == 0)
+      *inText = TRUE;
+   else if (strcmp(dir, ".asciiz") == 0 || strcmp(dir, ".ascii") == 0)
+      readString(rest, dir[6] == 'z');
+   else if (strcmp(dir, ".word") == 0 || strcmp(dir, ".byte") == 0 ||
+            strcmp(dir, ".half") == 0)
+   {
+      n = splitOperands(rest, ops, 256);
+      for (i = 0; i < n; i++)
+      {
+         getExpr(ops[i], &v, FALSE);
+         putData(dir[1] == 'w' ? 4 : dir[1] == 'h' ? 2 : 1, v);
+      }
+   }
+   else if (strcmp(dir, ".space") == 0)
+   {
+      getExpr(rest, &v, FALSE);
+      while (v-- > 0)
+         putData(1, 0);
+   }
+   else if (strcmp(dir, ".align") == 0)
+   {
+      getExpr(rest, &v, FALSE);
+      while (dataTop % (1u << v))
+         putData(1, 0);
+   }
+   /* .globl and others have no effect here */
+}
+
+/* Function labelEnd returns the ':' ending a label at
+ * the start of s, or NULL if s does not start with one
+ */
+static char *labelEnd(char *s)
+{
+   if (!isalpha((unsigned char)*s) && *s != '_' && *s != '.')
+      return NULL;
+   while (isalnum((unsigned char)*s) || *s == '_' || *s == '.')
+      s++;
+   while (*s == ' ' || *s == '\t')
+      s++;
+   return *s == ':' ? s : NULL;
+}
+
+static OPINFO *findOp(char *name)
+{
+   OPINFO *o;
+   for (o = opTab; o->name != NULL; o++)
+      if (strcmp(o->name, name) == 0)
+         return o;
+   return NULL;
+}
+
+/* Procedure decode fills ip from the operands of one
+ * instruction. Label operands are left in ip->operand
+ * for resolve
+ */
+static void decode(INSTRUCTION *ip, OPINFO *o, char **ops, int n)
+{
+   char *last, *paren;
+   ip->rd = ip->rs = 0;
+   ip->rt = -1;
+   ip->imm = 0;
+   ip->target = -1;
+   ip->operand = NULL;
+   switch (o->op)
+   {
+   case opMFHI: case opMFLO:
+      if (n != 1) error("one operand expected for", o->name);
+      ip->rd = getReg(ops[0]);
+      return;
+   case opJR: case opJALR:
+      if (n < 1) error("register expected for", o->name);
+      ip->rs = getReg(ops[n - 1]);
+      ip->rd = (o->op == opJALR && n == 2) ? getReg(ops[0]) : 31;
+      return;
+   case opJ: case opJAL:
+      if (n != 1) error("label expected for", o->name);
+      ip->operand = copyStr(ops[0]);
+      return;
+   case opSYSCALL: case opNOP:
+      return;
+   case opDIV: case opDIVU:
+      /* "div rd,rs,rt" is the pseudo-op for div and mflo */
+      if (n == 3)
+      {
+         ip->op = (o->op == opDIV) ? opDIV3 : opDIVU3;
+         ip->rd = getReg(ops[0]);
+         ip->rs = getReg(ops[1]);
+         if (*ops[2] == '$')
+            ip->rt = getReg(ops[2]);
+         else
+            ip->operand = copyStr(ops[2]);
+         return;
+      }
+      /* fall through */
+   case opMULT: case opMULTU:
+      if (n != 2) error("two registers expected for", o->name);
+      ip->rs = getReg(ops[0]);
+      ip->rt = getReg(ops[1]);
+      return;
+   case opLW: case opSW: case opLB: case opLBU: case opSB:
+   case opLH: case opLHU: case opSH: case opLD: case opSD: case opLA:
+      if (n != 2) error("two operands expected for", o->name);
+      ip->rd = getReg(ops[0]);
+      last = ops[1];
+      if ((paren = strchr(last, '(')) != NULL)
+      {
+         *paren = '\0';
+         if (strchr(paren + 1, ')') == NULL)
+            error("')' expected", NULL);
+         *strchr(paren + 1, ')') = '\0';
+         ip->rs = getReg(paren + 1);
+      }
+      ip->operand = copyStr(last);
+      return;
+   case opBEQ: case opBNE: case opBLT: case opBGE: case opBLE: case opBGT:
+      ip->rs = getReg(ops[0]);
+      if (n == 2)
+         ip->rt = 0;       /* beqz and friends compare with $zero */
+      else if (n != 3)
+         error("wrong number of operands for", o->name);
+      else if (*ops[1] == '$')
+         ip->rt = getReg(ops[1]);
+      else
+         getExpr(ops[1], &ip->imm, FALSE);
+      ip->operand = copyStr(ops[n - 1]);
+      return;
+   default:
+      break;
+   }
+   /* one or two registers, then a register or a value;
+      "addi $a0,-32" means "addi $a0,$a0,-32" */
+   if (n == o->nregs + 1)
+   {
+      ip->rd = getReg(ops[0]);
+      ip->rs = (o->nregs == 2) ? getReg(ops[1]) : 0;
+   }
+   else if (n == 2 && o->nregs == 2)
+      ip->rd = ip->rs = getReg(ops[0]);
+   else
+      error("wrong number of operands for", o->name);
+   last = ops[n - 1];
+   if (*last == '$')
+      ip->rt = getReg(last);
+   else if (o->op == opMOVE || o->op == opNEG || o->op == opNOT || o->op == opABS)
+      error("register expected for", o->name);
+   else
+      ip->operand = copyStr(last);
+}
+
+/* Procedure loadProgram reads the .tm file into
+ * instruction and data memory
+ */
+static void loadProgram(void)
+{
+   char line[LINESIZE], *s, *p, *colon, *ops[8];
+   char word[LINESIZE];
+   int inText = TRUE, inQuote, n, k;
+   INSTRUCTION *ip;
+   OPINFO *o;
+
+   while (fgets(line, LINESIZE, pgm) != NULL)
+   {
+      lineNo++;
+      /* strip the comment, unless the '#' is quoted */
+      inQuote = FALSE;
+      for (p = line; *p; p++)
+      {
+         if (*p == '"' || (*p == '\'' && p[1] && p[2] == '\''))
+         {
+            if (*p == '\'')
+            {
+               p += 2;
+               continue;
+            }
+            inQuote = !inQuote;
+         }
+         else if (*p == '#' && !inQuote)
+         {
+            *p = '\0';
+            break;
+         }
+      }
+      s = trim(line);
+      /* labels */
+      while ((colon = labelEnd(s)) != NULL)
+      {
+         *colon = '\0';
+         addLabel(trim(s), inText, inText ? (unsigned int)iCount : dataTop);
+         s = trim(colon + 1);
+      }
+      if (*s == '\0')
+         continue;
+      for (k = 0; s[k] && !isspace((unsigned char)s[k]); k++)
+         word[k] = s[k];
+      word[k] = '\0';
+      s = trim(s + k);
+      if (word[0] == '.')
+      {
+         doDirective(word, s, &inText);
+         continue;
+      }
+      if (!inText)
+         error("instruction in data segment:", word);
+      if ((o = findOp(word)) == NULL)
+         error("unknown instruction", word);
+      if (iCount == iSize)
+      {
+         iSize = iSize ? 2 * iSize : 1024;
+         iMem = (INSTRUCTION *)realloc(iMem, iSize * sizeof(INSTRUCTION));
+      }
+      ip = &iMem[iCount++];
+      ip->op = o->op;
+      ip->name = o->name;
+      ip->lineno = lineNo;
+      ip->count = 0;
+      n = splitOperands(s, ops, 8);
+      decode(ip, o, ops, n);
+   }
+}
+
+/* Function word32 reads the little-endian word at p */
+static unsigned int word32(unsigned char *p)
+{
+   return p[0] | (p[1] << 8) | (p[2] << 16) | ((unsigned int)p[3] << 24);
+}
+
+/* Procedure decodeWord fills ip from the MIPS32 word w
+ * at instruction index i of an image
+ */
+static void decodeWord(INSTRUCTION *ip, unsigned int w, int i)
+{
+   int op = w >> 26, rs = (w >> 21) & 31, rt = (w >> 16) & 31;
+   int rd = (w >> 11) & 31, sh = (w >> 6) & 31, funct = w & 63;
+   int imm = (short)(w & 0xffff), k;
+   unsigned int a;
+
+   ip->rd = ip->rs = 0;
+   ip->rt = -1;
+   ip->imm = 0;
+   ip->target = -1;
+   ip->operand = NULL;
+   ip->op = opNOP;
+   ip->name = "nop";
+   if (op == 0)
+   {
+      static const struct { int funct; OPCODE op; char *name; } rTab[] = {
+         {0x20, opADD, "add"}, {0x21, opADD, "addu"}, {0x22, opSUB, "sub"},
+         {0x23, opSUB, "subu"}, {0x24, opAND, "and"}, {0x25, opOR, "or"},
+         {0x26, opXOR, "xor"}, {0x27, opNOR, "nor"}, {0x2a, opSLT, "slt"},
+         {0x2b, opSLTU, "sltu"}, {0, opNOP, NULL}
+      };
+      switch (funct)
+      {
+      case 0x00: case 0x02: case 0x03:          /* sll, srl, sra */
+         if (w == 0)
+            return;
+         ip->op = funct == 0 ? opSLL : funct == 2 ? opSRL : opSRA;
+         ip->name = funct == 0 ? "sll" : funct == 2 ? "srl" : "sra";
+         ip->rd = rd;
+         ip->rs = rt;
+         ip->imm = sh;
+         return;
+      case 0x04: case 0x06: case 0x07:          /* sllv, srlv, srav */
+         ip->op = funct == 4 ? opSLL : funct == 6 ? opSRL : opSRA;
+         ip->name = funct == 4 ? "sllv" : funct == 6 ? "srlv" : "srav";
+         ip->rd = rd;
+         ip->rs = rt;
+         ip->rt = rs;
+         return;
+      case 0x08: case 0x09:
+         ip->op = funct == 8 ? opJR : opJALR;
+         ip->name = funct == 8 ? "jr" : "jalr";
+         ip->rs = rs;
+         ip->rd = funct == 8 ? 31 : rd;
+         return;
+      case 0x0c:
+         ip->op = opSYSCALL;
+         ip->name = "syscall";
+         return;
+      case 0x10: case 0x12:
+         ip->op = funct == 0x10 ? opMFHI : opMFLO;
+         ip->name = funct == 0x10 ? "mfhi" : "mflo";
+         ip->rd = rd;
+         return;
+      case 0x18: case 0x19: case 0x1a: case 0x1b:
+         ip->op = funct == 0x18 ? opMULT : funct == 0x19 ? opMULTU :
+                  funct == 0x1a ? opDIV : opDIVU;
+         ip->name = funct == 0x18 ? "mult" : funct == 0x19 ? "multu" :
+                    funct == 0x1a ? "div" : "divu";
+         ip->rs = rs;
+         ip->rt = rt;
+         return;
+      default:
+         for (k = 0; rTab[k].name != NULL; k++)
+            if (rTab[k].funct == funct)
+            {
+               ip->op = rTab[k].op;
+               ip->name = rTab[k].name;
+               ip->rd = rd;
+               ip->rs = rs;
+               ip->rt = rt;
+               return;
+            }
+         break;
+      }
+   }
+   else if (op == 0x1f && funct == 0x3b)
+   {
+      ip->op = opRDHWR;
+      ip->name = "rdhwr";
+      ip->rd = rt;
+      ip->rt = rd;
+      return;
+   }
+   else if (op == 0x1c && funct == 0x02)
+   {
+      ip->op = opMUL;
+      ip->name = "mul";
+      ip->rd = rd;
+      ip->rs = rs;
+      ip->rt = rt;
+      return;
+   }
+   else if (op == 2 || op == 3)
+   {
+      a = ((TEXT_BASE + 4 * (i + 1)) & 0xf0000000u) | ((w & 0x3ffffff) << 2);
+      ip->op = op == 2 ? opJ : opJAL;
+      ip->name = op == 2 ? "j" : "jal";
+      ip->target = (int)((a - TEXT_BASE) / 4);
+      return;
+   }
+   else if ((op >= 4 && op <= 7) || (op == 1 && rt <= 1))
+   {
+      static const OPCODE bOps[] = { opBLT, opBGE, opNOP, opNOP, opBEQ, opBNE, opBLE, opBGT };
+      static char *bNames[] = { "bltz", "bgez", "", "", "beq", "bne", "blez", "bgtz" };
+      k = op == 1 ? rt : op;
+      ip->op = bOps[k];
+      ip->name = bNames[k];
+      ip->rs = rs;
+      ip->rt = op == 4 || op == 5 ? rt : 0;
+      ip->target = i + 1 + imm;
+      return;
+   }
+   else
+   {
+      static const struct { int op; OPCODE code; char *name; } iTab[] = {
+         {0x08, opADD, "addi"}, {0x09, opADD, "addiu"}, {0x0a, opSLT, "slti"},
+         {0x0b, opSLTU, "sltiu"}, {0x0c, opAND, "andi"}, {0x0d, opOR, "ori"},
+         {0x0e, opXOR, "xori"}, {0x0f, opLUI, "lui"},
+         {0x20, opLB, "lb"}, {0x21, opLH, "lh"}, {0x23, opLW, "lw"},
+         {0x24, opLBU, "lbu"}, {0x25, opLHU, "lhu"}, {0x28, opSB, "sb"},
+         {0x29, opSH, "sh"}, {0x2b, opSW, "sw"}, {0, opNOP, NULL}
+      };
+      for (k = 0; iTab[k].name != NULL; k++)
+         if (iTab[k].op == op)
+         {
+            ip->op = iTab[k].code;
+            ip->name = iTab[k].name;
+            ip->rd = rt;
+            ip->rs = rs;
+            /* the logical immediates are zero-extended */
+            ip->imm = (op >= 0x0c && op <= 0x0f) ? (int)(w & 0xffff) : imm;
+            return;
+         }
+   }
+   fprintf(stderr, "tm: %s: unknown instruction word 0x%08x at 0x%08x\n",
+           pgmName, w, TEXT_BASE + 4 * i);
+   exit(1);
+}
+
+/* Procedure loadImage loads a binary image written by
+ * the compiler's --format=bin (see image.h)
+ */
+static void loadImage(void)
+{
+   unsigned char *img, *p, *names;
+   long size;
+   unsigned int textSize, dataSize, nsyms, namesSize, addr, flags;
+   int i;
+   INSTRUCTION *ip;
+
+   fseek(pgm, 0, SEEK_END);
+   size = ftell(pgm);
+   rewind(pgm);
+   img = (unsigned char *)malloc(size);
+   if (fread(img, 1, size, pgm) != (size_t)size ||
+       size < 4 * IMAGE_HEADER_WORDS)
+      error("truncated image", NULL);
+   textSize = word32(img + 12);
+   dataSize = word32(img + 20);
+   nsyms = word32(img + 24);
+   namesSize = word32(img + 28);
+   if (word32(img + 8) != TEXT_BASE || word32(img + 16) != DATA_BASE ||
+       textSize % 4 != 0 || dataSize > DATA_SIZE ||
+       (unsigned long)size != 4 * IMAGE_HEADER_WORDS + textSize + dataSize +
+       4 * IMAGE_SYMBOL_WORDS * nsyms + namesSize)
+      error("bad image header", NULL);
+
+   p = img + 4 * IMAGE_HEADER_WORDS;
+   iCount = iSize = textSize / 4;
+   iMem = (INSTRUCTION *)malloc((iSize + 1) * sizeof(INSTRUCTION));
+   for (i = 0; i < iCount; i++, p += 4)
+   {
+      ip = &iMem[i];
+      ip->lineno = i + 1;
+      ip->count = 0;
+      decodeWord(ip, word32(p), i);
+      if ((ip->target < -1 || ip->target > iCount) ||
+          (ip->target == -1 && (ip->op == opJ || ip->op == opJAL ||
+                                (ip->op >= opBEQ && ip->op <= opBGT))))
+         error("jump out of the text segment", ip->name);
+   }
+   memcpy(dMem, p, dataSize);
+   dataTop = DATA_BASE + dataSize;
+   p += dataSize;
+   names = p + 4 * IMAGE_SYMBOL_WORDS * nsyms;
+   for (i = 0; i < (int)nsyms; i++, p += 4 * IMAGE_SYMBOL_WORDS)
+   {
+      if (word32(p) >= namesSize || memchr(names + word32(p), 0,
+                                           namesSize - word32(p)) == NULL)
+         error("bad symbol name", NULL);
+      addr = word32(p + 4);
+      flags = word32(p + 8);
+      if (flags & IMAGE_SYM_TEXT)
+         addLabel((char *)names + word32(p), TRUE, (addr - TEXT_BASE) / 4);
+      else
+         addLabel((char *)names + word32(p), FALSE, addr);
+   }
+   free(img);
+}
+
+static int findFunc(char *name, int start)
+{
+   int i;
+   if (funcAt[start] >= 0)
+      return funcAt[start];
+   if (funcCount == funcSize)
+   {
+      funcSize = funcSize ? 2 * funcSize : 32;
+      funcs = (FUNCTION *)realloc(funcs, funcSize * sizeof(FUNCTION));
+   }
+   i = funcCount++;
+   funcs[i].name = name;
+   funcs[i].calls = funcs[i].inclusive = funcs[i].self = 0;
+   funcs[i].active = 0;
+   funcAt[start] = i;
+   return i;
+}
+
+/* Function textLabel names the instruction at index
+ * i by a label, for the profile
+ */
+static char *textLabel(int i)
+{
+   int k;
+   for (k = 0; k < labelCount; k++)
+      if (labels[k].inText && labels[k].value == (unsigned int)i)
+         return labels[k].name;
+   return "(unknown)";
+}
+
+/* Procedure resolve replaces label operands by
+ * instruction indices and addresses
+ */
+static void resolve(void)
+{
+   INSTRUCTION *ip;
+   LABEL *l;
+   int i;
+   funcAt = (int *)malloc((iCount + 1) * sizeof(int));
+   for (i = 0; i <= iCount; i++)
+      funcAt[i] = -1;
+   for (i = 0; i < iCount; i++)
+   {
+      ip = &iMem[i];
+      lineNo = ip->lineno;
+      if (ip->operand == NULL)
+      {
+         /* a jal loaded from an image has its target */
+         if (ip->op == opJAL)
+            findFunc(textLabel(ip->target), ip->target);
+         continue;
+      }
+      if (ip->op == opJ || ip->op == opJAL || (ip->op >= opBEQ && ip->op <= opBGT))
+      {
+         if ((l = findLabel(ip->operand)) == NULL || !l->inText)
+            error("undefined code label", ip->operand);
+         ip->target = l->value;
+         if (ip->op == opJAL)
+            findFunc(l->name, ip->target);
+      }
+      else if (!getExpr(ip->operand, &ip->imm, TRUE))
+         error("undefined label in", ip->operand);
+   }
+}
+
+/********************************************/
+static void pushFrame(int f, unsigned int retAddr)
+{
+   if (frameCount == frameSize)
+   {
+      frameSize = frameSize ? 2 * frameSize : 256;
+      frames = (FRAME *)realloc(frames, frameSize * sizeof(FRAME));
+   }
+   frames[frameCount].func = f;
+   frames[frameCount].retAddr = retAddr;
+   frames[frameCount].entry = steps;
+   frameCount++;
+   funcs[f].calls++;
+   funcs[f].active++;
+}
+
+/* Procedure popFrame ends the newest call; only the
+ * outermost activation of a recursive function adds
+ * to its inclusive count
+ */
+static void popFrame(void)
+{
+   FRAME *fr = &frames[--frameCount];
+   if (--funcs[fr->func].active == 0)
+      funcs[fr->func].inclusive += steps - fr->entry;
+}
+
+static int readInt(void)
+{
+   int v = 0;
+   fflush(stdout);
+   if (scanf("%d", &v) != 1)
+      v = 0;
+   return v;
+}
+
+/* Procedure run executes from label main until it
+ * returns or calls exit
+ */
+static void run(void)
+{
+   INSTRUCTION *ip;
+   unsigned char *p;
+   unsigned int a, u;
+   int pc, b, i, c;
+   LABEL *l;
+   long long prod;
+
+   if ((l = findLabel("main")) == NULL || !l->inText)
+      error("no main label", NULL);
+   memset(reg, 0, sizeof(reg));
+   reg[28] = (int)GP_INIT;
+   reg[29] = (int)SP_INIT;
+   reg[30] = (int)SP_INIT;
+   reg[31] = (int)RA_EXIT;
+   pc = l->value;
+   pushFrame(findFunc(l->name, pc), RA_EXIT);
+
+   while (pc >= 0 && pc < iCount)
+   {
+      ip = &iMem[pc++];
+      ip->count++;
+      steps++;
+      b = ip->rt >= 0 ? reg[ip->rt] : ip->imm;
+      switch (ip->op)
+      {
+      case opADD:  reg[ip->rd] = (int)((unsigned int)reg[ip->rs] + (unsigned int)b); break;
+      case opSUB:  reg[ip->rd] = (int)((unsigned int)reg[ip->rs] - (unsigned int)b); break;
+      case opMUL:  reg[ip->rd] = (int)((unsigned int)reg[ip->rs] * (unsigned int)b); break;
+      case opAND:  reg[ip->rd] = reg[ip->rs] & b; break;
+      case opOR:   reg[ip->rd] = reg[ip->rs] | b; break;
+      case opXOR:  reg[ip->rd] = reg[ip->rs] ^ b; break;
+      case opNOR:  reg[ip->rd] = ~(reg[ip->rs] | b); break;
+      case opSLL:  reg[ip->rd] = (int)((unsigned int)reg[ip->rs] << (b & 31)); break;
+      case opSRA:  reg[ip->rd] = reg[ip->rs] >> (b & 31); break;
+      case opSRL:  reg[ip->rd] = (int)((unsigned int)reg[ip->rs] >> (b & 31)); break;
+      case opSLT:  reg[ip->rd] = reg[ip->rs] < b; break;
+      case opSLTU: reg[ip->rd] = (unsigned int)reg[ip->rs] < (unsigned int)b; break;
+      case opSLE:  reg[ip->rd] = reg[ip->rs] <= b; break;
+      case opSGT:  reg[ip->rd] = reg[ip->rs] > b; break;
+      case opSGE:  reg[ip->rd] = reg[ip->rs] >= b; break;
+      case opSEQ:  reg[ip->rd] = reg[ip->rs] == b; break;
+      case opSNE:  reg[ip->rd] = reg[ip->rs] != b; break;
+      case opDIV3: case opREM: case opDIVU3: case opREMU:
+         if (b == 0)
+            runError("division by zero at", ip, TEXT_BASE + 4 * (pc - 1));
+         if (ip->op == opDIVU3)
+            reg[ip->rd] = (int)((unsigned int)reg[ip->rs] / (unsigned int)b);
+         else if (ip->op == opREMU)
+            reg[ip->rd] = (int)((unsigned int)reg[ip->rs] % (unsigned int)b);
+         else if (b == -1)
+            reg[ip->rd] = ip->op == opREM ? 0 : (int)(0u - (unsigned int)reg[ip->rs]);
+         else
+            reg[ip->rd] = ip->op == opREM ? reg[ip->rs] % b : reg[ip->rs] / b;
+         break;
+      case opMOVE: reg[ip->rd] = b; break;
+      case opLI:   reg[ip->rd] = b; break;
+      case opLUI:  reg[ip->rd] = (int)((unsigned int)b << 16); break;
+      case opNEG:  reg[ip->rd] = (int)(0u - (unsigned int)b); break;
+      case opNOT:  reg[ip->rd] = ~b; break;
+      case opABS:  reg[ip->rd] = b < 0 ? (int)(0u - (unsigned int)b) : b; break;
+      case opMULT:
+         prod = (long long)reg[ip->rs] * (long long)b;
+         lo = (int)prod;
+         hi = (int)(prod >> 32);
+         break;
+      case opMULTU:
+         prod = (long long)((unsigned long long)(unsigned int)reg[ip->rs] *
+                            (unsigned long long)(unsigned int)b);
+         lo = (int)prod;
+         hi = (int)((unsigned long long)prod >> 32);
+         break;
+      case opDIV: case opDIVU:
+         if (b == 0)
+            runError("division by zero at", ip, TEXT_BASE + 4 * (pc - 1));
+         if (ip->op == opDIVU)
+         {
+            lo = (int)((unsigned int)reg[ip->rs] / (unsigned int)b);
+            hi = (int)((unsigned int)reg[ip->rs] % (unsigned int)b);
+         }
+         else if (b == -1)
+         {
+            lo = (int)(0u - (unsigned int)reg[ip->rs]);
+            hi = 0;
+         }
+         else
+         {
+            lo = reg[ip->rs] / b;
+            hi = reg[ip->rs] % b;
+         }
+         break;
+      case opMFHI: reg[ip->rd] = hi; break;
+      case opMFLO: reg[ip->rd] = lo; break;
+
+      case opLA:
+         reg[ip->rd] = (int)((unsigned int)reg[ip->rs] + (unsigned int)ip->imm);
+         break;
+      case opLW: case opSW: case opLD: case opSD:
+         a = (unsigned int)reg[ip->rs] + (unsigned int)ip->imm;
+         c = (ip->op == opLD || ip->op == opSD) ? 8 : 4;
+         if ((a & 3) != 0 || (p = memAddr(a, c)) == NULL)
+            runError("bad word address", ip, a);
+         for (i = 0; i < c; i += 4)
+         {
+            if (ip->op == opLW || ip->op == opLD)
+            {
+               u = p[i] | (p[i + 1] << 8) | (p[i + 2] << 16) | ((unsigned int)p[i + 3] << 24);
+               reg[(ip->rd + i / 4) & 31] = (int)u;
+            }
+            else
+            {
+               u = (unsigned int)reg[(ip->rd + i / 4) & 31];
+               p[i] = (unsigned char)u;
+               p[i + 1] = (unsigned char)(u >> 8);
+               p[i + 2] = (unsigned char)(u >> 16);
+               p[i + 3] = (unsigned char)(u >> 24);
+            }
+         }
+         break;
+      case opLB: case opLBU: case opSB:
+         a = (unsigned int)reg[ip->rs] + (unsigned int)ip->imm;
+         if ((p = memAddr(a, 1)) == NULL)
+            runError("bad byte address", ip, a);
+         if (ip->op == opSB)
+            *p = (unsigned char)reg[ip->rd];
+         else
+            reg[ip->rd] = ip->op == opLB ? (signed char)*p : *p;
+         break;
+      case opLH: case opLHU: case opSH:
+         a = (unsigned int)reg[ip->rs] + (unsigned int)ip->imm;
+         if ((a & 1) != 0 || (p = memAddr(a, 2)) == NULL)
+            runError("bad halfword address", ip, a);
+         if (ip->op == opSH)
+         {
+            p[0] = (unsigned char)reg[ip->rd];
+            p[1] = (unsigned char)(reg[ip->rd] >> 8);
+         }
+         else
+         {
+            u = p[0] | (p[1] << 8);
+            reg[ip->rd] = ip->op == opLH ? (short)u : (int)u;
+         }
+         break;
+
+      case opJ:
+         pc = ip->target;
+         break;
+      case opJAL:
+         reg[31] = (int)(TEXT_BASE + 4 * pc);
+         pushFrame(funcAt[ip->target], (unsigned int)reg[31]);
+         pc = ip->target;
+         break;
+      case opJALR:
+         a = (unsigned int)reg[ip->rs];
+         reg[ip->rd] = (int)(TEXT_BASE + 4 * pc);
+         pc = (int)((a - TEXT_BASE) / 4);
+         if (a < TEXT_BASE || pc >= iCount)
+            runError("bad jump target", ip, a);
+         pushFrame(findFunc("(indirect)", pc), (unsigned int)reg[ip->rd]);
+         break;
+      case opJR:
+         a = (unsigned int)reg[ip->rs];
+         if (frameCount > 0 && a == frames[frameCount - 1].retAddr)
+            popFrame();
+         if (a == RA_EXIT)
+         {
+            pc = -1;
+            break;
+         }
+         if (a < TEXT_BASE || (a - TEXT_BASE) / 4 > (unsigned int)iCount)
+            runError("bad jump target", ip, a);
+         pc = (int)((a - TEXT_BASE) / 4);
+         break;
+      case opBEQ: if (reg[ip->rs] == b) pc = ip->target; break;
+      case opBNE: if (reg[ip->rs] != b) pc = ip->target; break;
+      case opBLT: if (reg[ip->rs] <  b) pc = ip->target; break;
+      case opBGE: if (reg[ip->rs] >= b) pc = ip->target; break;
+      case opBLE: if (reg[ip->rs] <= b) pc = ip->target; break;
+      case opBGT: if (reg[ip->rs] >  b) pc = ip->target; break;
+
+      case opSYSCALL:
+         switch (reg[2])
+         {
+         case 1:
+            printf("%d", reg[4]);
+            break;
+         case 4:
+            for (a = (unsigned int)reg[4]; (p = memAddr(a, 1)) != NULL && *p; a++)
+               putchar(*p);
+            break;
+         case 5:
+            reg[2] = readInt();
+            break;
+         case 8:
+            fflush(stdout);
+            a = (unsigned int)reg[4];
+            for (i = 0; i < reg[5] - 1 && (c = getchar()) != EOF; i++)
+            {
+               if ((p = memAddr(a + i, 1)) == NULL)
+                  runError("bad byte address", ip, a + i);
+               *p = (unsigned char)c;
+               if (c == '\n')
+               {
+                  i++;
+                  break;
+               }
+            }
+            if ((p = memAddr(a + i, 1)) != NULL)
+               *p = 0;
+            break;
+         case 10:
+            pc = -1;
+            break;
+         case 11:
+            putchar(reg[4] & 0xff);
+            break;
+         case 12:
+            fflush(stdout);
+            c = getchar();
+            reg[2] = c == EOF ? 0 : c;
+            break;
+         default:
+            runError("unknown syscall", ip, (unsigned int)reg[2]);
+         }
+         break;
+      case opNOP:
+         break;
+      case opRDHWR:
+         /* the cycle counter counts instructions here */
+         if (ip->rt != 2)
+            runError("unknown hardware register", ip, (unsigned int)ip->rt);
+         reg[ip->rd] = (int)steps;
+         break;
+      }
+      reg[0] = 0;
+   }
+   while (frameCount > 0)
+      popFrame();
+   fflush(stdout);
+}
+
+/********************************************/
+#define MAXOPNAMES 128
+static char *opNames[MAXOPNAMES];
+static unsigned long opCounts[MAXOPNAMES];
+
+static int cmpCount(const void *x, const void *y)
+{
+   unsigned long a = opCounts[*(const int *)x], b = opCounts[*(const int *)y];
+   return a < b ? 1 : a > b ? -1 : 0;
+}
+
+static int cmpFunc(const void *x, const void *y)
+{
+   const FUNCTION *a = (const FUNCTION *)x, *b = (const FUNCTION *)y;
+   return a->inclusive < b->inclusive ? 1 : a->inclusive > b->inclusive ? -1 : 0;
+}
+
+/* Procedure countSelf gives each instruction's count
+ * to the function whose code it lies in
+ */
+static void countSelf(void)
+{
+   int i, f = -1;
+   for (i = 0; i < iCount; i++)
+   {
+      if (funcAt[i] >= 0)
+         f = funcAt[i];
+      if (f >= 0)
+         funcs[f].self += iMem[i].count;
+   }
+}
+
+/* Procedure printStats writes the dynamic counts
+ * by opcode and by function
+ */
+static void printStats(FILE *out)
+{
+   int order[MAXOPNAMES], n = 0, i, j;
+   unsigned long loads = 0, stores = 0;
+   INSTRUCTION *ip;
+
+   for (i = 0; i < iCount; i++)
+   {
+      ip = &iMem[i];
+      if (ip->count == 0)
+         continue;
+      for (j = 0; j < n && strcmp(opNames[j], ip->name) != 0; j++)
+         ;
+      if (j == n)
+      {
+         if (n == MAXOPNAMES)
+            continue;
+         opNames[n] = ip->name;
+         opCounts[n] = 0;
+         n++;
+      }
+      opCounts[j] += ip->count;
+      switch (ip->op)
+      {
+      case opLW: case opLB: case opLBU: case opLH: case opLHU: loads += ip->count; break;
+      case opLD: loads += 2 * ip->count; break;
+      case opSW: case opSB: case opSH: stores += ip->count; break;
+      case opSD: stores += 2 * ip->count; break;
+      default: break;
+      }
+   }
+   for (i = 0; i < n; i++)
+      order[i] = i;
+   qsort(order, n, sizeof(int), cmpCount);
+
+   fprintf(out, "\nInstructions executed: %lu\n", steps);
+   fprintf(out, "Loads: %lu  Stores: %lu\n", loads, stores);
+   fprintf(out, "\n%-10s %12s %7s\n", "opcode", "count", "%");
+   for (i = 0; i < n; i++)
+      fprintf(out, "%-10s %12lu %6.2f%%\n", opNames[order[i]], opCounts[order[i]],
+              steps ? 100.0 * opCounts[order[i]] / steps : 0.0);
+   fprintf(out, "\n%-16s %10s %12s %12s\n", "function", "calls", "inclusive", "self");
+   qsort(funcs, funcCount, sizeof(FUNCTION), cmpFunc);
+   for (i = 0; i < funcCount; i++)
+      fprintf(out, "%-16s %10lu %12lu %12lu\n", funcs[i].name, funcs[i].calls,
+              funcs[i].inclusive, funcs[i].self);
+}
+
+/* Procedure writeProfile writes one line per function:
+ * name, calls, inclusive and self instruction counts
+ */
+static void writeProfile(char *fileName)
+{
+   FILE *f = fopen(fileName, "w");
+   int i;
+   if (f == NULL)
+   {
+      fprintf(stderr, "tm: cannot write %s\n", fileName);
+      exit(1);
+   }
+   for (i = 0; i < funcCount; i++)
+      fprintf(f, "%s %lu %lu %lu\n", funcs[i].name, funcs[i].calls,
+              funcs[i].inclusive, funcs[i].self);
+   fclose(f);
+}
+
+/* Procedure writeCounts writes the number and the
+ * execution count of every instruction executed, for
+ * the compiler's --line-map table
+ */
+static void writeCounts(char *fileName)
+{
+   FILE *f = fopen(fileName, "w");
+   int i;
+   if (f == NULL)
+   {
+      fprintf(stderr, "tm: cannot write %s\n", fileName);
+      exit(1);
+   }
+   for (i = 0; i < iCount; i++)
+      if (iMem[i].count > 0)
+         fprintf(f, "%d %lu\n", i, iMem[i].count);
+   fclose(f);
+}
+
+int main(int argc, char *argv[])
+{
+   int stats = FALSE, i;
+   char *profile = NULL, *counts = NULL;
+   unsigned char magic[4];
+
+   for (i = 1; i < argc - 1; i++)
+   {
+      if (strcmp(argv[i], "-s") == 0)
+         stats = TRUE;
+      else if (strcmp(argv[i], "-p") == 0 && i + 2 < argc)
+         profile = argv[++i];
+      else if (strcmp(argv[i], "-c") == 0 && i + 2 < argc)
+         counts = argv[++i];
+      else
+         break;
+   }
+   if (i != argc - 1)
+   {
+      fprintf(stderr, "usage: %s [-s] [-p profile] [-c counts] <filename>.tm|.bin\n", argv[0]);
+      exit(1);
+   }
+   pgmName = argv[i];
+   pgm = fopen(pgmName, "rb");
+   if (pgm == NULL)
+   {
+      fprintf(stderr, "tm: file '%s' not found\n", pgmName);
+      exit(1);
+   }
+   dMem = (unsigned char *)calloc(DATA_SIZE, 1);
+   sMem = (unsigned char *)calloc(STACK_SIZE, 1);
+   if (fread(magic, 1, 4, pgm) == 4 && word32(magic) == IMAGE_MAGIC)
+      loadImage();
+   else
+   {
+      rewind(pgm);
+      loadProgram();
+   }
+   fclose(pgm);
+   resolve();
+   run();
+   countSelf();
+   if (stats)
+      printStats(stderr);
+   if (profile != NULL)
+      writeProfile(profile);
+   if (counts != NULL)
+      writeCounts(counts);
+   return 0;
+}
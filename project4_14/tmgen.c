@@ -0,0 +1,311 @@
+/****************************************************/
+/* File: tmgen.c                                    */
+/* The TM target of the code generator              */
+/* (code for the TM machine of Louden's book; see   */
+/* target.h)                                        */
+/****************************************************/
+
+#include <limits.h>
+#include "globals.h"
+#include "symtab.h"
+#include "code.h"
+#include "target.h"
+#include "stats.h"
+
+/* TM registers of Reg, in its order. The return
+ * address shares a register with RegTemp: it is only
+ * live from a call to the callee's prologue and from
+ * the epilogue to the return
+ */
+static int regNum[] = { ac, 2, ac1, 3, 4, gp, mp, 3 };
+
+/* A fixup is a jump emitted before its target was
+ * known, to be written when the target is defined
+ */
+typedef struct FixupRec
+{
+  int loc;     /* of the jump */
+  char *op;    /* LDA, JEQ or JNE */
+  int reg;     /* tested by JEQ or JNE, or pc for LDA */
+  struct FixupRec *next;
+} Fixup;
+
+/* a label: its location once defined, the jumps to
+ * it before that
+ */
+typedef struct
+{
+  int loc;
+  Fixup *fixups;
+} Label;
+
+typedef struct FuncRec
+{
+  char *name;
+  Label lab;
+  struct FuncRec *next;
+} Func;
+
+static Label *labels = NULL;
+static int labelSize = 0;
+static Func *funcs = NULL;
+
+static Label *getLabel(int lab)
+{
+  int n = labelSize;
+  if (lab >= labelSize)
+  {
+    labelSize = 2 * lab + 16;
+    labels = (Label *)reallocate(AllocCodegen, labels, labelSize * sizeof(Label));
+    for (; n < labelSize; n++)
+    {
+      labels[n].loc = -1;
+      labels[n].fixups = NULL;
+    }
+  }
+  return &labels[lab];
+}
+
+static Label *getFunc(char *name)
+{
+  Func *f;
+  for (f = funcs; f != NULL; f = f->next)
+    if (strcmp(f->name, name) == 0)
+      return &f->lab;
+  f = (Func *)allocate(AllocCodegen, sizeof(Func));
+  f->name = name;
+  f->lab.loc = -1;
+  f->lab.fixups = NULL;
+  f->next = funcs;
+  funcs = f;
+  return &f->lab;
+}
+
+/* Procedure jumpTo emits op, a jump to l: LDA with
+ * reg pc is unconditional, JEQ and JNE test reg
+ */
+static void jumpTo(Label *l, char *op, int reg)
+{
+  Fixup *f;
+  if (l->loc >= 0)
+  {
+    emitRM_Abs(op, reg, l->loc, "");
+    return;
+  }
+  f = (Fixup *)allocate(AllocCodegen, sizeof(Fixup));
+  f->loc = emitSkip(1);
+  f->op = op;
+  f->reg = reg;
+  f->next = l->fixups;
+  l->fixups = f;
+}
+
+/* Procedure define places l at the current location
+ * and backpatches the jumps to it
+ */
+static void define(Label *l)
+{
+  Fixup *f, *next;
+  l->loc = emitSkip(0);
+  for (f = l->fixups; f != NULL; f = next)
+  {
+    next = f->next;
+    emitBackup(f->loc);
+    emitRM_Abs(f->op, f->reg, l->loc, "");
+    release(f);
+  }
+  l->fixups = NULL;
+  emitRestore();
+}
+
+static void tmComment(char *c)
+{
+  if (TraceCode)
+    fprintf(code, "* %s\n", c);
+}
+
+/* the line map (--line-map) is kept for the MIPS
+ * code only
+ */
+static void tmLine(int lineno)
+{
+}
+
+/* branches and calls are counted (--pg) in the MIPS
+ * code only
+ */
+static void tmCountBranch(int site, int taken)
+{
+}
+
+static void tmCountCall(int site, char *callee)
+{
+}
+
+static void tmCall(char *name)
+{
+  emitRM("LDA", regNum[RegRa], 1, pc, "return address");
+  jumpTo(getFunc(name), "LDA", pc);
+}
+
+static void tmBegin(char *codefile)
+{
+  tmComment("C- Compilation to TM Code");
+  fprintf(code, "* File: %s\n", codefile);
+  emitRM("LD", mp, 0, ac, "load maxaddress from location 0");
+  emitRM("ST", ac, 0, ac, "clear location 0");
+  /* globals start at location 0 (free once it is
+     cleared), the stack grows down from the top of
+     memory */
+  tmCall("main");
+  emitRO("HALT", 0, 0, 0, "");
+}
+
+/* global memory is zeroed and addressed off gp (0),
+ * so a global needs no code and no data directive
+ */
+static void tmGlobal(char *name, int off, int size)
+{
+}
+
+/* the code has no runtime to append: IN and OUT are
+ * instructions
+ */
+static void tmEnd(void)
+{
+}
+
+static void tmLabel(int lab)
+{
+  define(getLabel(lab));
+}
+
+static void tmFuncLabel(char *name)
+{
+  tmComment(name);
+  define(getFunc(name));
+}
+
+static void tmMove(Reg dst, Reg src)
+{
+  emitRM("LDA", regNum[dst], 0, regNum[src], "");
+}
+
+static void tmLoadConst(Reg dst, int c)
+{
+  emitRM("LDC", regNum[dst], c, 0, "");
+}
+
+static void tmLoad(Reg dst, int off, Reg base)
+{
+  emitRM("LD", regNum[dst], off, regNum[base], "");
+}
+
+static void tmStore(Reg src, int off, Reg base)
+{
+  emitRM("ST", regNum[src], off, regNum[base], "");
+}
+
+static void tmLoadAddr(Reg dst, int off, Reg base)
+{
+  emitRM("LDA", regNum[dst], off, regNum[base], "");
+}
+
+static void tmAddConst(Reg dst, Reg src, int c)
+{
+  emitRM("LDA", regNum[dst], c, regNum[src], "");
+}
+
+static void tmAdd(Reg dst, Reg a, Reg b)
+{
+  emitRO("ADD", regNum[dst], regNum[a], regNum[b], "");
+}
+
+static void tmSub(Reg dst, Reg a, Reg b)
+{
+  emitRO("SUB", regNum[dst], regNum[a], regNum[b], "");
+}
+
+/* memory is addressed by words, so an index needs
+ * no scaling to become an offset
+ */
+static void tmScale(Reg r)
+{
+}
+
+static void tmOp(TokenType op)
+{
+  char *jmp;
+  switch (op)
+  {
+  case PLUS:  emitRO("ADD", ac, ac1, ac, "op +"); return;
+  case MINUS: emitRO("SUB", ac, ac1, ac, "op -"); return;
+  case TIMES: emitRO("MUL", ac, ac1, ac, "op *"); return;
+  case OVER:  emitRO("DIV", ac, ac1, ac, "op /"); return;
+  case LT:    jmp = "JLT"; break;
+  case LTET:  jmp = "JLE"; break;
+  case GT:    jmp = "JGT"; break;
+  case GTET:  jmp = "JGE"; break;
+  case EQ:    jmp = "JEQ"; break;
+  case NOTEQ: jmp = "JNE"; break;
+  default:    return;
+  }
+  emitRO("SUB", ac, ac1, ac, "compare");
+  emitRM(jmp, ac, 2, pc, "br if true");
+  emitRM("LDC", ac, 0, ac, "false case");
+  emitRM("LDA", pc, 1, pc, "unconditional jmp");
+  emitRM("LDC", ac, 1, ac, "true case");
+}
+
+/* only additions have a cheaper form, LDA */
+static int tmOpConst(TokenType op, int c)
+{
+  if (op == MINUS && c != INT_MIN)
+    c = -c;
+  else if (op != PLUS)
+    return FALSE;
+  if (c != 0)
+    emitRM("LDA", ac, c, ac, "");
+  return TRUE;
+}
+
+static void tmJump(int lab)
+{
+  jumpTo(getLabel(lab), "LDA", pc);
+}
+
+static void tmJumpIfZero(Reg r, int lab)
+{
+  jumpTo(getLabel(lab), "JEQ", regNum[r]);
+}
+
+static void tmJumpIfNonZero(Reg r, int lab)
+{
+  jumpTo(getLabel(lab), "JNE", regNum[r]);
+}
+
+static void tmRet(void)
+{
+  emitRM("LDA", pc, 0, regNum[RegRa], "return");
+}
+
+static void tmInput(void)
+{
+  emitRO("IN", ac, 0, 0, "read integer value");
+  emitRM("ST", ac, 0, regNum[RegAddr], "");
+}
+
+static void tmOutput(void)
+{
+  emitRO("OUT", ac, 0, 0, "write ac");
+}
+
+Target tmTarget =
+{
+  "tm", ".tmc", 1, 0, 0,
+  tmBegin, tmGlobal, tmEnd, tmComment, tmLine, tmLabel, tmFuncLabel,
+  tmMove, tmLoadConst, tmLoad, tmStore, tmLoadAddr,
+  tmAddConst, tmAdd, tmSub, tmScale, tmOp, tmOpConst,
+  tmJump, tmJumpIfZero, tmJumpIfNonZero, tmCall, tmRet, tmInput, tmOutput,
+  tmCountBranch, tmCountCall
+};
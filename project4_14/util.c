@@ -9,6 +9,7 @@
 #include "tiny.tab.h"
 #include "globals.h"
 #include "util.h"
+#include "stats.h"
 
 extern int yylineno;
 /* Procedure printToken prints a token 
@@ -128,8 +129,9 @@ void printToken(TokenType token, const char *tokenString)
  */
 TreeNode *newStmtNode(StmtKind kind)
 {
-  TreeNode *t = (TreeNode *)malloc(sizeof(TreeNode));
+  TreeNode *t = (TreeNode *)allocate(AllocAst, sizeof(TreeNode));
   int i;
+  counters.nodes++;
   if (t == NULL)
     fprintf(listing, "Out of memory error at line %d\n", lineno);
   else
@@ -141,6 +143,14 @@ TreeNode *newStmtNode(StmtKind kind)
     t->kind.stmt = kind;
     t->lineno = lineno;
     t->isArray = FALSE;
+    t->attr.name = NULL;
+    t->val = 0;
+    t->info = NULL;
+    t->vnFlags = 0;
+    t->vnReg = -1;
+    t->vnAddrReg = -1;
+    t->site = -1;
+    t->pgoFlags = 0;
   }
   return t;
 }
@@ -150,8 +160,9 @@ TreeNode *newStmtNode(StmtKind kind)
  */
 TreeNode *newExpNode(ExpKind kind)
 {
-  TreeNode *t = (TreeNode *)malloc(sizeof(TreeNode));
+  TreeNode *t = (TreeNode *)allocate(AllocAst, sizeof(TreeNode));
   int i;
+  counters.nodes++;
   if (t == NULL)
     fprintf(listing, "Out of memory error at line %d\n", lineno);
   else
@@ -164,6 +175,14 @@ TreeNode *newExpNode(ExpKind kind)
     t->lineno = lineno;
     t->expType = Void;
     t->isArray = FALSE;
+    t->attr.name = NULL;
+    t->val = 0;
+    t->info = NULL;
+    t->vnFlags = 0;
+    t->vnReg = -1;
+    t->vnAddrReg = -1;
+    t->site = -1;
+    t->pgoFlags = 0;
   }
   return t;
 }
@@ -173,8 +192,9 @@ TreeNode *newExpNode(ExpKind kind)
  */
 TreeNode *newDecNode(DeclarationKind kind)
 {
-  TreeNode *t = (TreeNode *)malloc(sizeof(TreeNode));
+  TreeNode *t = (TreeNode *)allocate(AllocAst, sizeof(TreeNode));
   int i;
+  counters.nodes++;
   if (t == NULL)
     fprintf(listing, "Out of memory error at line %d\n", lineno);
   else
@@ -187,6 +207,14 @@ TreeNode *newDecNode(DeclarationKind kind)
     t->lineno = lineno;
     t->expType = Void;
     t->isArray = FALSE;
+    t->attr.name = NULL;
+    t->val = 0;
+    t->info = NULL;
+    t->vnFlags = 0;
+    t->vnReg = -1;
+    t->vnAddrReg = -1;
+    t->site = -1;
+    t->pgoFlags = 0;
   }
   return t;
 }
@@ -201,7 +229,7 @@ char *copyString(char *s)
   if (s == NULL)
     return NULL;
   n = strlen(s) + 1;
-  t = malloc(n);
+  t = allocate(AllocString, n);
   if (t == NULL)
     fprintf(listing, "Out of memory error at line %d\n", lineno);
   else
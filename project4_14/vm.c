@@ -0,0 +1,884 @@
+/****************************************************/
+/* File: vm.c                                       */
+/* Bytecode compiler and interpreter for C-         */
+/* The bytecode is register based: every scalar,    */
+/* local array element and temporary of a function  */
+/* is a slot of its frame, and a call's arguments   */
+/* are evaluated straight into the slots that       */
+/* become the callee's parameters                   */
+/****************************************************/
+
+#include <limits.h>
+#include "globals.h"
+#include "symtab.h"
+#include "stats.h"
+#include "vm.h"
+
+/* MEMSIZE is the number of int cells for globals
+ * and frames together
+ */
+#define MEMSIZE (1 << 22)
+
+/* MAXCALLDEPTH bounds the return stack */
+#define MAXCALLDEPTH (1 << 18)
+
+/* the interpreter is direct threaded where the
+ * compiler has labels as values (computed goto)
+ */
+#if defined(__GNUC__) && !defined(VM_NO_THREADING)
+#define VM_THREADED 1
+#else
+#define VM_THREADED 0
+#endif
+
+/* opcodes; R[x] is slot x of the current frame,
+ * M[x] is memory cell x, c is an immediate unless
+ * noted. Branches keep their target in c
+ */
+typedef enum
+{
+  vmMOV,    /* R[a] = R[b] */
+  vmLI,     /* R[a] = c */
+  vmADD, vmSUB, vmMUL, vmDIV,          /* R[a] = R[b] op R[c] */
+  vmLT, vmLE, vmGT, vmGE, vmEQ, vmNE,
+  vmADDI, vmMULI, vmDIVI,              /* R[a] = R[b] op c */
+  vmLTI, vmLEI, vmGTI, vmGEI, vmEQI, vmNEI,
+  vmRSUBI,  /* R[a] = c - R[b] */
+  vmJMP,    /* goto c */
+  vmJZ, vmJNZ,                         /* if R[a] ==/!= 0 goto c */
+  vmJLT, vmJLE, vmJGT, vmJGE, vmJEQ, vmJNE,        /* if R[a] op R[b] */
+  vmJLTI, vmJLEI, vmJGTI, vmJGEI, vmJEQI, vmJNEI,  /* if R[a] op b */
+  vmLDG,    /* R[a] = M[c] */
+  vmSTG,    /* M[c] = R[a] */
+  vmLDGX,   /* R[a] = M[c + R[b]] */
+  vmSTGX,   /* M[c + R[b]] = R[a] */
+  vmLDLX,   /* R[a] = R[c + R[b]] */
+  vmSTLX,   /* R[c + R[b]] = R[a] */
+  vmLDP,    /* R[a] = M[R[b] + R[c]] */
+  vmSTP,    /* M[R[b] + R[c]] = R[a] */
+  vmLDPI,   /* R[a] = M[R[b] + c] */
+  vmSTPI,   /* M[R[b] + c] = R[a] */
+  vmADDRL,  /* R[a] = address of R[c] */
+  vmCALL,   /* call function b with its frame at R[a], result to R[c] */
+  vmRET,    /* return R[a] */
+  vmRETV,   /* return without a value */
+  vmIN,     /* R[a] = input */
+  vmOUT,    /* output R[a] */
+  vmHALT,
+  vmNUMOPS
+} VmOp;
+
+typedef struct
+{
+  union
+  {
+    int op;
+    const void *h;    /* handler address once threaded */
+  } u;
+  int a, b, c;
+} VmInst;
+
+typedef struct
+{
+  int entry;          /* first instruction */
+  int nslots;         /* frame size */
+} VmFunc;
+
+typedef struct
+{
+  VmInst *pc;
+  int *fp;
+  int dest;
+} VmReturn;
+
+static VmInst *prog = NULL;
+static int codeSize = 0, codeCount = 0;
+static VmFunc *funcs = NULL;
+static int funcCount = 0;
+static int globalCells = 0;
+
+/* per-function compile state */
+static int numParams, localBase, minLoc;
+static int tempTop, maxSlots;
+
+/**************************************************/
+/***********   Compiling the syntax tree   ********/
+/**************************************************/
+
+static int emit(int op, int a, int b, int c)
+{
+  if (codeCount == codeSize)
+  {
+    codeSize = codeSize ? 2 * codeSize : 1024;
+    prog = (VmInst *)reallocate(AllocCodegen, prog, codeSize * sizeof(VmInst));
+  }
+  prog[codeCount].u.op = op;
+  prog[codeCount].a = a;
+  prog[codeCount].b = b;
+  prog[codeCount].c = c;
+  return codeCount++;
+}
+
+static void patch(int at, int target)
+{
+  if (at >= 0)
+    prog[at].c = target;
+}
+
+static int newTemp(void)
+{
+  int t = tempTop++;
+  if (tempTop > maxSlots)
+    maxSlots = tempTop;
+  return t;
+}
+
+static int target(int dest)
+{
+  return dest >= 0 ? dest : newTemp();
+}
+
+static int isConst(TreeNode *t)
+{
+  return t != NULL && t->nodekind == ExpK && t->kind.exp == ConstK;
+}
+
+/* Function slotOf maps the memloc of a parameter or
+ * local to its frame slot: parameters first, then
+ * locals from the lowest address up, so the elements
+ * of a local array are consecutive slots
+ */
+static int slotOf(SymbolInfo info)
+{
+  if (info->decKind == ParamK)
+  {
+    if (info->memloc < PARAM_STACK_BASE)
+      return (info->memloc - PARAM_REG_BASE) / 4;
+    return (info->memloc - PARAM_STACK_BASE) / 4;
+  }
+  return localBase + (info->memloc - minLoc) / 4;
+}
+
+/* Function globalOf returns the cell of element 0 of
+ * a global array, or of a global scalar
+ */
+static int globalOf(SymbolInfo info)
+{
+  if (info->isArray)
+    return info->memloc / 4 - (info->ArraySize - 1);
+  return info->memloc / 4;
+}
+
+/* Procedure scanLocals finds the lowest memloc of the
+ * locals declared anywhere in a function body
+ */
+static void scanLocals(TreeNode *t, int *lowest, int *highest)
+{
+  int i;
+  for (; t != NULL; t = t->sibling)
+  {
+    if (t->nodekind == DeclarationK &&
+        (t->kind.dec == SimpleK || t->kind.dec == ArrayK) && t->info != NULL)
+    {
+      int top = t->info->memloc +
+                4 * (t->info->isArray ? t->info->ArraySize - 1 : 0);
+      if (t->info->memloc < *lowest)
+        *lowest = t->info->memloc;
+      if (top > *highest)
+        *highest = top;
+    }
+    for (i = 0; i < MAXCHILDREN; i++)
+      scanLocals(t->child[i], lowest, highest);
+  }
+}
+
+static int genExp(TreeNode *t, int dest);
+
+/* Function relOp maps a relational operator to its
+ * opcode in the group starting at base (vmLT, vmLTI,
+ * vmJLT or vmJLTI); -1 if op is not relational
+ */
+static int relOp(TokenType op, int base)
+{
+  switch (op)
+  {
+  case LT:    return base;
+  case LTET:  return base + 1;
+  case GT:    return base + 2;
+  case GTET:  return base + 3;
+  case EQ:    return base + 4;
+  case NOTEQ: return base + 5;
+  default:    return -1;
+  }
+}
+
+static TokenType negateRel(TokenType op)
+{
+  switch (op)
+  {
+  case LT:   return GTET;
+  case LTET: return GT;
+  case GT:   return LTET;
+  case GTET: return LT;
+  case EQ:   return NOTEQ;
+  default:   return EQ;
+  }
+}
+
+static TokenType swapRel(TokenType op)
+{
+  switch (op)
+  {
+  case LT:   return GT;
+  case LTET: return GTET;
+  case GT:   return LT;
+  case GTET: return LTET;
+  default:   return op;
+  }
+}
+
+static int genOp(TreeNode *t, int dest)
+{
+  TreeNode *l = t->child[0], *r = t->child[1];
+  TokenType op = t->attr.op;
+  int save = tempTop, a, b, res, k;
+
+  /* keep a constant operand on the right */
+  if (isConst(l) && !isConst(r) && op != MINUS && op != OVER)
+  {
+    l = t->child[1];
+    r = t->child[0];
+    op = swapRel(op);
+  }
+  if (isConst(r))
+  {
+    k = r->val;
+    a = genExp(l, -1);
+    tempTop = save;
+    res = target(dest);
+    switch (op)
+    {
+    case PLUS:  emit(vmADDI, res, a, k); break;
+    case MINUS: emit(vmADDI, res, a, (int)(0u - (unsigned int)k)); break;
+    case TIMES: emit(vmMULI, res, a, k); break;
+    case OVER:  emit(vmDIVI, res, a, k); break;
+    default:    emit(relOp(op, vmLTI), res, a, k); break;
+    }
+    return res;
+  }
+  if (isConst(l) && op == MINUS)
+  {
+    b = genExp(r, -1);
+    tempTop = save;
+    res = target(dest);
+    emit(vmRSUBI, res, b, l->val);
+    return res;
+  }
+  a = genExp(l, -1);
+  b = genExp(r, -1);
+  tempTop = save;
+  res = target(dest);
+  switch (op)
+  {
+  case PLUS:  emit(vmADD, res, a, b); break;
+  case MINUS: emit(vmSUB, res, a, b); break;
+  case TIMES: emit(vmMUL, res, a, b); break;
+  case OVER:  emit(vmDIV, res, a, b); break;
+  default:    emit(relOp(op, vmLT), res, a, b); break;
+  }
+  return res;
+}
+
+/* Function genStore stores value slot v into the
+ * variable or array element named by the IdK node
+ * var; idx is the slot of the subscript (unused for
+ * constant subscripts and scalars)
+ */
+static void genStore(TreeNode *var, int idx, int v)
+{
+  SymbolInfo info = var->info;
+  TreeNode *sub = var->child[0];
+  if (sub == NULL)
+  {
+    if (info->isGlobal)
+      emit(vmSTG, v, 0, globalOf(info));
+    else if (v != slotOf(info))
+      emit(vmMOV, slotOf(info), v, 0);
+  }
+  else if (info->decKind == ParamK)
+  {
+    if (isConst(sub))
+      emit(vmSTPI, v, slotOf(info), sub->val);
+    else
+      emit(vmSTP, v, slotOf(info), idx);
+  }
+  else if (info->isGlobal)
+  {
+    if (isConst(sub))
+      emit(vmSTG, v, 0, globalOf(info) + sub->val);
+    else
+      emit(vmSTGX, v, idx, globalOf(info));
+  }
+  else
+  {
+    if (isConst(sub))
+    {
+      if (v != slotOf(info) + sub->val)
+        emit(vmMOV, slotOf(info) + sub->val, v, 0);
+    }
+    else
+      emit(vmSTLX, v, idx, slotOf(info));
+  }
+}
+
+/* Function directSlot returns the frame slot that is
+ * the variable named by var, or -1 if it lives in
+ * memory
+ */
+static int directSlot(TreeNode *var)
+{
+  SymbolInfo info = var->info;
+  if (info->isGlobal || (var->child[0] != NULL && info->decKind == ParamK))
+    return -1;
+  if (var->child[0] == NULL)
+    return slotOf(info);
+  if (isConst(var->child[0]))
+    return slotOf(info) + var->child[0]->val;
+  return -1;
+}
+
+/* Function genAssign evaluates the subscript, then the
+ * right side, then stores (the order cgen uses)
+ */
+static int genAssign(TreeNode *t, int dest)
+{
+  TreeNode *var = t->child[0];
+  int idx = -1, v, d;
+
+  d = directSlot(var);
+  if (d >= 0)
+  {
+    v = genExp(t->child[1], d);
+    if (dest >= 0 && dest != v)
+      emit(vmMOV, dest, v, 0);
+    return dest >= 0 ? dest : v;
+  }
+  if (var->child[0] != NULL && !isConst(var->child[0]))
+    idx = genExp(var->child[0], -1);
+  v = genExp(t->child[1], dest);
+  genStore(var, idx, v);
+  return v;
+}
+
+static int genCall(TreeNode *t, int dest)
+{
+  TreeNode *arg;
+  int base = tempTop, n = 0, i, res;
+  for (arg = t->child[0]; arg != NULL; arg = arg->sibling)
+    n++;
+  for (i = 0; i < n; i++)
+    newTemp();
+  for (arg = t->child[0], i = 0; arg != NULL; arg = arg->sibling, i++)
+    genExp(arg, base + i);
+  /* the callee's frame starts at base, so the result
+     is stored after it has returned */
+  tempTop = base;
+  res = target(dest);
+  emit(vmCALL, base, t->info->memloc, res);
+  return res;
+}
+
+/* Function genExp generates code for expression t.
+ * The value ends up in slot dest, or in the returned
+ * slot if dest < 0 (which may be a variable's slot)
+ */
+static int genExp(TreeNode *t, int dest)
+{
+  SymbolInfo info;
+  int save = tempTop, r, idx, d;
+
+  if (t->nodekind == StmtK)
+    return t->kind.stmt == AssignK ? genAssign(t, dest) : target(dest);
+
+  switch (t->kind.exp)
+  {
+  case ConstK:
+    r = target(dest);
+    emit(vmLI, r, 0, t->val);
+    return r;
+
+  case OpK:
+    return genOp(t, dest);
+
+  case IdK:
+    info = t->info;
+    d = directSlot(t);
+    if (d >= 0 && !(info->isArray && t->child[0] == NULL))
+    {
+      if (dest >= 0 && dest != d)
+        emit(vmMOV, dest, d, 0);
+      return dest >= 0 ? dest : d;
+    }
+    if (t->child[0] == NULL)
+    {
+      r = target(dest);
+      if (info->isArray && info->decKind == ParamK)
+        emit(vmMOV, r, slotOf(info), 0);
+      else if (info->isArray && info->isGlobal)
+        emit(vmLI, r, 0, globalOf(info));
+      else if (info->isArray)
+        emit(vmADDRL, r, 0, slotOf(info));
+      else
+        emit(vmLDG, r, 0, globalOf(info));
+      return r;
+    }
+    if (info->decKind == ParamK && isConst(t->child[0]))
+    {
+      r = target(dest);
+      emit(vmLDPI, r, slotOf(info), t->child[0]->val);
+      return r;
+    }
+    if (info->isGlobal && isConst(t->child[0]))
+    {
+      r = target(dest);
+      emit(vmLDG, r, 0, globalOf(info) + t->child[0]->val);
+      return r;
+    }
+    idx = genExp(t->child[0], -1);
+    tempTop = save;
+    r = target(dest);
+    if (info->decKind == ParamK)
+      emit(vmLDP, r, slotOf(info), idx);
+    else if (info->isGlobal)
+      emit(vmLDGX, r, idx, globalOf(info));
+    else
+      emit(vmLDLX, r, idx, slotOf(info));
+    return r;
+
+  case FuncCallK:
+    return genCall(t, dest);
+
+  case InputCallK:
+    d = directSlot(t->child[0]);
+    if (d >= 0)
+    {
+      emit(vmIN, d, 0, 0);
+      return d;
+    }
+    idx = -1;
+    if (t->child[0]->child[0] != NULL && !isConst(t->child[0]->child[0]))
+      idx = genExp(t->child[0]->child[0], -1);
+    r = newTemp();
+    emit(vmIN, r, 0, 0);
+    genStore(t->child[0], idx, r);
+    return r;
+
+  case OutputCallK:
+    r = genExp(t->child[0], -1);
+    emit(vmOUT, r, 0, 0);
+    return r;
+
+  default:
+    return target(dest);
+  }
+}
+
+/* Function genBranch emits a jump taken when cond is
+ * ifTrue and returns it for patching (-1 if the jump
+ * is never taken)
+ */
+static int genBranch(TreeNode *cond, int ifTrue)
+{
+  TreeNode *l, *r;
+  TokenType op;
+  int save = tempTop, a, b, j;
+
+  if (isConst(cond))
+    return (cond->val != 0) == ifTrue ? emit(vmJMP, 0, 0, 0) : -1;
+  if (cond->nodekind == ExpK && cond->kind.exp == OpK &&
+      relOp(cond->attr.op, 0) >= 0)
+  {
+    l = cond->child[0];
+    r = cond->child[1];
+    op = cond->attr.op;
+    if (isConst(l) && !isConst(r))
+    {
+      l = cond->child[1];
+      r = cond->child[0];
+      op = swapRel(op);
+    }
+    if (!ifTrue)
+      op = negateRel(op);
+    a = genExp(l, -1);
+    if (isConst(r))
+      j = emit(relOp(op, vmJLTI), a, r->val, 0);
+    else
+    {
+      b = genExp(r, -1);
+      j = emit(relOp(op, vmJLT), a, b, 0);
+    }
+    tempTop = save;
+    return j;
+  }
+  a = genExp(cond, -1);
+  tempTop = save;
+  return emit(ifTrue ? vmJNZ : vmJZ, a, 0, 0);
+}
+
+static void genStmt(TreeNode *t)
+{
+  int save, j, k, top;
+  for (; t != NULL; t = t->sibling)
+  {
+    save = tempTop;
+    if (t->nodekind == ExpK)
+      genExp(t, -1);
+    else if (t->nodekind == StmtK)
+      switch (t->kind.stmt)
+      {
+      case AssignK:
+        genAssign(t, -1);
+        break;
+      case IfK:
+        j = genBranch(t->child[0], FALSE);
+        genStmt(t->child[1]);
+        if (t->child[2] != NULL)
+        {
+          k = emit(vmJMP, 0, 0, 0);
+          patch(j, codeCount);
+          genStmt(t->child[2]);
+          patch(k, codeCount);
+        }
+        else
+          patch(j, codeCount);
+        break;
+      case WhileK:
+        /* the test is at the bottom, so each iteration
+           executes one branch */
+        j = isConst(t->child[0]) && t->child[0]->val != 0 ?
+            -1 : emit(vmJMP, 0, 0, 0);
+        top = codeCount;
+        genStmt(t->child[1]);
+        patch(j, codeCount);
+        patch(genBranch(t->child[0], TRUE), top);
+        break;
+      case ReturnK:
+        if (t->child[0] != NULL)
+          emit(vmRET, genExp(t->child[0], -1), 0, 0);
+        else
+          emit(vmRETV, 0, 0, 0);
+        break;
+      case CompoundK:
+        genStmt(t->child[1]);
+        break;
+      default:
+        break;
+      }
+    tempTop = save;
+  }
+}
+
+static void genFunction(TreeNode *f)
+{
+  TreeNode *p;
+  VmFunc *fn = &funcs[f->info->memloc];
+  int highest = INT_MIN;
+
+  numParams = 0;
+  for (p = f->child[0]; p != NULL; p = p->sibling)
+    numParams++;
+  minLoc = 0;
+  scanLocals(f->child[1], &minLoc, &highest);
+  localBase = numParams;
+  tempTop = localBase + (highest == INT_MIN ? 0 : (highest - minLoc) / 4 + 1);
+  maxSlots = tempTop;
+
+  fn->entry = codeCount;
+  genStmt(f->child[1]);
+  emit(vmRETV, 0, 0, 0);
+  fn->nslots = maxSlots;
+}
+
+/* Procedure compile translates the whole program;
+ * the code starts with a call of main
+ */
+static int compile(TreeNode *syntaxTree)
+{
+  TreeNode *t;
+  int top, mainFunc = -1;
+
+  codeCount = 0;
+  globalCells = 0;
+  funcCount = 0;
+  for (t = syntaxTree; t != NULL; t = t->sibling)
+  {
+    if (t->nodekind != DeclarationK || t->info == NULL)
+      continue;
+    if (t->kind.dec == FunctionK)
+    {
+      if (t->info->memloc >= funcCount)
+        funcCount = t->info->memloc + 1;
+      if (strcmp(t->attr.name, "main") == 0)
+        mainFunc = t->info->memloc;
+    }
+    else
+    {
+      top = t->info->memloc / 4 + 1;
+      if (top > globalCells)
+        globalCells = top;
+    }
+  }
+  if (mainFunc < 0)
+  {
+    fprintf(stderr, "vm: no main function\n");
+    return FALSE;
+  }
+  funcs = (VmFunc *)allocate(AllocCodegen, funcCount * sizeof(VmFunc));
+  memset(funcs, 0, funcCount * sizeof(VmFunc));
+  emit(vmCALL, 0, mainFunc, 0);
+  emit(vmHALT, 0, 0, 0);
+  for (t = syntaxTree; t != NULL; t = t->sibling)
+    if (t->nodekind == DeclarationK && t->kind.dec == FunctionK)
+      genFunction(t);
+  return TRUE;
+}
+
+/**************************************************/
+/***********   The interpreter   ******************/
+/**************************************************/
+
+static int vmError(char *msg)
+{
+  fflush(stdout);
+  fprintf(stderr, "vm: runtime error: %s\n", msg);
+  return 1;
+}
+
+/* Function execute runs the code from instruction 0.
+ * It is called once with code NULL to get the table of
+ * handler addresses for threading
+ */
+static int execute(VmInst *prog, const void ***handlers)
+{
+#if VM_THREADED
+  static const void *table[vmNUMOPS] = {
+    &&L_vmMOV, &&L_vmLI,
+    &&L_vmADD, &&L_vmSUB, &&L_vmMUL, &&L_vmDIV,
+    &&L_vmLT, &&L_vmLE, &&L_vmGT, &&L_vmGE, &&L_vmEQ, &&L_vmNE,
+    &&L_vmADDI, &&L_vmMULI, &&L_vmDIVI,
+    &&L_vmLTI, &&L_vmLEI, &&L_vmGTI, &&L_vmGEI, &&L_vmEQI, &&L_vmNEI,
+    &&L_vmRSUBI,
+    &&L_vmJMP, &&L_vmJZ, &&L_vmJNZ,
+    &&L_vmJLT, &&L_vmJLE, &&L_vmJGT, &&L_vmJGE, &&L_vmJEQ, &&L_vmJNE,
+    &&L_vmJLTI, &&L_vmJLEI, &&L_vmJGTI, &&L_vmJGEI, &&L_vmJEQI, &&L_vmJNEI,
+    &&L_vmLDG, &&L_vmSTG, &&L_vmLDGX, &&L_vmSTGX, &&L_vmLDLX, &&L_vmSTLX,
+    &&L_vmLDP, &&L_vmSTP, &&L_vmLDPI, &&L_vmSTPI, &&L_vmADDRL,
+    &&L_vmCALL, &&L_vmRET, &&L_vmRETV, &&L_vmIN, &&L_vmOUT, &&L_vmHALT
+  };
+#define CASE(op) L_##op:
+#define NEXT goto *(++ip)->u.h
+#define JUMP(t) do { ip = prog + (t); goto *ip->u.h; } while (0)
+#else
+#define CASE(op) case op:
+#define NEXT ip++; continue
+#define JUMP(t) do { ip = prog + (t); continue; } while (0)
+#endif
+/* wraparound arithmetic of 32-bit registers */
+#define WRAP(x, o, y) ((int)((unsigned int)(x) o (unsigned int)(y)))
+#define CHECK(addr) if ((unsigned int)(addr) >= MEMSIZE) goto badAddress
+
+  VmInst *ip;
+  int *mem, *R, v;
+  VmReturn *rs, *rsp;
+  VmFunc *fn;
+
+#if VM_THREADED
+  if (prog == NULL)
+  {
+    *handlers = table;
+    return 0;
+  }
+#else
+  if (prog == NULL)
+    return 0;
+#endif
+
+  /* calloc zeroes the pages of mem as they are used,
+     so it stays outside the accounting */
+  mem = (int *)calloc(MEMSIZE, sizeof(int));
+  rs = (VmReturn *)allocate(AllocCodegen, MAXCALLDEPTH * sizeof(VmReturn));
+  if (mem == NULL || rs == NULL)
+    return vmError("out of memory");
+  rsp = rs;
+  R = mem + globalCells;
+  ip = prog;
+
+#if VM_THREADED
+  goto *ip->u.h;
+#else
+  for (;;)
+    switch (ip->u.op)
+    {
+#endif
+  CASE(vmMOV)  R[ip->a] = R[ip->b]; NEXT;
+  CASE(vmLI)   R[ip->a] = ip->c; NEXT;
+  CASE(vmADD)  R[ip->a] = WRAP(R[ip->b], +, R[ip->c]); NEXT;
+  CASE(vmSUB)  R[ip->a] = WRAP(R[ip->b], -, R[ip->c]); NEXT;
+  CASE(vmMUL)  R[ip->a] = WRAP(R[ip->b], *, R[ip->c]); NEXT;
+  CASE(vmDIV)
+    v = R[ip->c];
+    if (v == 0)
+      goto divZero;
+    R[ip->a] = v == -1 ? WRAP(0, -, R[ip->b]) : R[ip->b] / v;
+    NEXT;
+  CASE(vmLT)   R[ip->a] = R[ip->b] <  R[ip->c]; NEXT;
+  CASE(vmLE)   R[ip->a] = R[ip->b] <= R[ip->c]; NEXT;
+  CASE(vmGT)   R[ip->a] = R[ip->b] >  R[ip->c]; NEXT;
+  CASE(vmGE)   R[ip->a] = R[ip->b] >= R[ip->c]; NEXT;
+  CASE(vmEQ)   R[ip->a] = R[ip->b] == R[ip->c]; NEXT;
+  CASE(vmNE)   R[ip->a] = R[ip->b] != R[ip->c]; NEXT;
+  CASE(vmADDI) R[ip->a] = WRAP(R[ip->b], +, ip->c); NEXT;
+  CASE(vmMULI) R[ip->a] = WRAP(R[ip->b], *, ip->c); NEXT;
+  CASE(vmDIVI)
+    v = ip->c;
+    if (v == 0)
+      goto divZero;
+    R[ip->a] = v == -1 ? WRAP(0, -, R[ip->b]) : R[ip->b] / v;
+    NEXT;
+  CASE(vmLTI)  R[ip->a] = R[ip->b] <  ip->c; NEXT;
+  CASE(vmLEI)  R[ip->a] = R[ip->b] <= ip->c; NEXT;
+  CASE(vmGTI)  R[ip->a] = R[ip->b] >  ip->c; NEXT;
+  CASE(vmGEI)  R[ip->a] = R[ip->b] >= ip->c; NEXT;
+  CASE(vmEQI)  R[ip->a] = R[ip->b] == ip->c; NEXT;
+  CASE(vmNEI)  R[ip->a] = R[ip->b] != ip->c; NEXT;
+  CASE(vmRSUBI) R[ip->a] = WRAP(ip->c, -, R[ip->b]); NEXT;
+  CASE(vmJMP)  JUMP(ip->c);
+  CASE(vmJZ)   if (R[ip->a] == 0) JUMP(ip->c); NEXT;
+  CASE(vmJNZ)  if (R[ip->a] != 0) JUMP(ip->c); NEXT;
+  CASE(vmJLT)  if (R[ip->a] <  R[ip->b]) JUMP(ip->c); NEXT;
+  CASE(vmJLE)  if (R[ip->a] <= R[ip->b]) JUMP(ip->c); NEXT;
+  CASE(vmJGT)  if (R[ip->a] >  R[ip->b]) JUMP(ip->c); NEXT;
+  CASE(vmJGE)  if (R[ip->a] >= R[ip->b]) JUMP(ip->c); NEXT;
+  CASE(vmJEQ)  if (R[ip->a] == R[ip->b]) JUMP(ip->c); NEXT;
+  CASE(vmJNE)  if (R[ip->a] != R[ip->b]) JUMP(ip->c); NEXT;
+  CASE(vmJLTI) if (R[ip->a] <  ip->b) JUMP(ip->c); NEXT;
+  CASE(vmJLEI) if (R[ip->a] <= ip->b) JUMP(ip->c); NEXT;
+  CASE(vmJGTI) if (R[ip->a] >  ip->b) JUMP(ip->c); NEXT;
+  CASE(vmJGEI) if (R[ip->a] >= ip->b) JUMP(ip->c); NEXT;
+  CASE(vmJEQI) if (R[ip->a] == ip->b) JUMP(ip->c); NEXT;
+  CASE(vmJNEI) if (R[ip->a] != ip->b) JUMP(ip->c); NEXT;
+  CASE(vmLDG)  R[ip->a] = mem[ip->c]; NEXT;
+  CASE(vmSTG)  mem[ip->c] = R[ip->a]; NEXT;
+  CASE(vmLDGX)
+    v = ip->c + R[ip->b];
+    CHECK(v);
+    R[ip->a] = mem[v];
+    NEXT;
+  CASE(vmSTGX)
+    v = ip->c + R[ip->b];
+    CHECK(v);
+    mem[v] = R[ip->a];
+    NEXT;
+  CASE(vmLDLX)
+    v = (int)(R - mem) + ip->c + R[ip->b];
+    CHECK(v);
+    R[ip->a] = mem[v];
+    NEXT;
+  CASE(vmSTLX)
+    v = (int)(R - mem) + ip->c + R[ip->b];
+    CHECK(v);
+    mem[v] = R[ip->a];
+    NEXT;
+  CASE(vmLDP)
+    v = R[ip->b] + R[ip->c];
+    CHECK(v);
+    R[ip->a] = mem[v];
+    NEXT;
+  CASE(vmSTP)
+    v = R[ip->b] + R[ip->c];
+    CHECK(v);
+    mem[v] = R[ip->a];
+    NEXT;
+  CASE(vmLDPI)
+    v = R[ip->b] + ip->c;
+    CHECK(v);
+    R[ip->a] = mem[v];
+    NEXT;
+  CASE(vmSTPI)
+    v = R[ip->b] + ip->c;
+    CHECK(v);
+    mem[v] = R[ip->a];
+    NEXT;
+  CASE(vmADDRL) R[ip->a] = (int)(R - mem) + ip->c; NEXT;
+  CASE(vmCALL)
+    fn = &funcs[ip->b];
+    if (rsp == rs + MAXCALLDEPTH ||
+        (R - mem) + ip->a + fn->nslots > MEMSIZE)
+      return vmError("stack overflow");
+    rsp->pc = ip;
+    rsp->fp = R;
+    rsp->dest = ip->c;
+    rsp++;
+    R += ip->a;
+    JUMP(fn->entry);
+  CASE(vmRET)
+    v = R[ip->a];
+    rsp--;
+    R = rsp->fp;
+    R[rsp->dest] = v;
+    ip = rsp->pc;
+    NEXT;
+  CASE(vmRETV)
+    rsp--;
+    R = rsp->fp;
+    ip = rsp->pc;
+    NEXT;
+  CASE(vmIN)
+    if (Prompts)
+      printf("Enter value for input instruction: ");
+    if (scanf("%d", &v) != 1)
+      v = 0;
+    R[ip->a] = v;
+    NEXT;
+  CASE(vmOUT)
+    printf(Prompts ? "output instruction prints: %d\n" : "%d\n", R[ip->a]);
+    NEXT;
+  CASE(vmHALT)
+    free(mem);
+    release(rs);
+    fflush(stdout);
+    return 0;
+#if !VM_THREADED
+    default:
+      return vmError("bad opcode");
+    }
+#endif
+
+divZero:
+  return vmError("division by zero");
+badAddress:
+  return vmError("array index out of bounds");
+#undef CASE
+#undef NEXT
+#undef JUMP
+#undef WRAP
+#undef CHECK
+}
+
+/* Function vmRun compiles the analyzed syntax tree
+ * to register bytecode and executes it, with input
+ * and output done natively. Returns 0, or 1 after a
+ * runtime error
+ */
+int vmRun(TreeNode *syntaxTree)
+{
+  const void **handlers = NULL;
+  int i;
+  if (!compile(syntaxTree))
+    return 1;
+  execute(NULL, &handlers);
+  if (handlers != NULL)
+    for (i = 0; i < codeCount; i++)
+      prog[i].u.h = handlers[prog[i].u.op];
+  return execute(prog, &handlers);
+}
@@ -0,0 +1,17 @@
+/****************************************************/
+/* File: vm.h                                       */
+/* Bytecode compiler and interpreter for C-         */
+/* (runs a program without generating MIPS code)    */
+/****************************************************/
+
+#ifndef _VM_H_
+#define _VM_H_
+
+/* Function vmRun compiles the analyzed syntax tree
+ * to register bytecode and executes it, with input
+ * and output done natively. Returns 0, or 1 after a
+ * runtime error
+ */
+int vmRun(TreeNode *);
+
+#endif
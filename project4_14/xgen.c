@@ -0,0 +1,955 @@
+/****************************************************/
+/* File: xgen.c                                     */
+/* The code generator implementation for x86-64     */
+/* Linux. It emits GNU assembler (AT&T syntax)      */
+/* following the System V calling convention, plus  */
+/* a runtime for input and output that uses system  */
+/* calls directly, so no C library is needed:       */
+/*   as -o prog.o prog.s && ld -o prog prog.o       */
+/****************************************************/
+
+#include <stdarg.h>
+#include "globals.h"
+#include "symtab.h"
+#include "code.h"
+#include "xgen.h"
+#include "stats.h"
+
+/* expression values are kept in a stack of callee-saved
+ * registers, so they survive calls without spilling;
+ * an expression nested deeper than NPOOL spills to
+ * the machine stack
+ */
+#define NPOOL 5
+static const char *pool32[NPOOL] = { "%ebx", "%r12d", "%r13d", "%r14d", "%r15d" };
+static const char *pool64[NPOOL] = { "%rbx", "%r12", "%r13", "%r14", "%r15" };
+
+/* integer argument registers of the System V ABI */
+#define NARGREGS 6
+static const char *arg64[NARGREGS] = { "%rdi", "%rsi", "%rdx", "%rcx", "%r8", "%r9" };
+
+/* per-function state */
+static int poolUsed;    /* pool registers the function has to save */
+static int pushed;      /* bytes pushed below the 16-byte aligned frame */
+static int paramBase;   /* parameters are saved below this %rbp offset */
+static int returnLabel;
+
+static int labelNum = 0;
+
+static void emit(const char *fmt, ...)
+{
+  va_list ap;
+  va_start(ap, fmt);
+  counters.instructions++;
+  fputc('\t', code);
+  vfprintf(code, fmt, ap);
+  fputc('\n', code);
+  va_end(ap);
+}
+
+static void emitLab(int lab)
+{
+  fprintf(code, ".L%d:\n", lab);
+}
+
+static int isConst(TreeNode *t)
+{
+  return t != NULL && t->nodekind == ExpK && t->kind.exp == ConstK;
+}
+
+/* Function isScalar returns TRUE for a variable that
+ * can be used directly as a memory operand
+ */
+static int isScalar(TreeNode *t)
+{
+  return t->nodekind == ExpK && t->kind.exp == IdK &&
+         t->child[0] == NULL && !t->info->isArray;
+}
+
+/* Function containsCall returns TRUE if expression t
+ * calls a function or assigns, so it can change what
+ * another operand reads
+ */
+static int containsCall(TreeNode *t)
+{
+  int i;
+  if (t == NULL)
+    return FALSE;
+  if ((t->nodekind == ExpK && t->kind.exp == FuncCallK) ||
+      (t->nodekind == StmtK && t->kind.stmt == AssignK))
+    return TRUE;
+  for (i = 0; i < MAXCHILDREN; i++)
+    if (containsCall(t->child[i]))
+      return TRUE;
+  return FALSE;
+}
+
+/* returns k if c == 2^k, otherwise -1 */
+static int log2Of(int c)
+{
+  int k = 0;
+  if (c <= 0 || (c & (c - 1)) != 0)
+    return -1;
+  while ((c >> k) != 1)
+    k++;
+  return k;
+}
+
+/* Function condSuffix returns the condition code
+ * of a relational operator, or NULL
+ */
+static const char *condSuffix(TokenType op)
+{
+  switch (op)
+  {
+  case LT:    return "l";
+  case LTET:  return "le";
+  case GT:    return "g";
+  case GTET:  return "ge";
+  case EQ:    return "e";
+  case NOTEQ: return "ne";
+  default:    return NULL;
+  }
+}
+
+static TokenType negateRel(TokenType op)
+{
+  switch (op)
+  {
+  case LT:   return GTET;
+  case LTET: return GT;
+  case GT:   return LTET;
+  case GTET: return LT;
+  case EQ:   return NOTEQ;
+  default:   return EQ;
+  }
+}
+
+/* Function swapOp returns the operator that gives the
+ * same result with the operands exchanged, or -1
+ */
+static TokenType swapOp(TokenType op)
+{
+  switch (op)
+  {
+  case PLUS: case TIMES: case EQ: case NOTEQ:
+    return op;
+  case LT:   return GT;
+  case GT:   return LT;
+  case LTET: return GTET;
+  case GTET: return LTET;
+  default:   return -1;
+  }
+}
+
+static void usePool(int d)
+{
+  if (d + 1 > poolUsed)
+    poolUsed = d + 1;
+}
+
+/* Function paramOffset returns the %rbp offset of the
+ * 8-byte slot of a parameter: the prologue saves the
+ * register arguments below the locals, the others
+ * stay in the caller's argument area
+ */
+static int paramOffset(SymbolInfo info)
+{
+  int i;
+  if (info->memloc < PARAM_STACK_BASE)
+    i = (info->memloc - PARAM_REG_BASE) / 4;
+  else
+    i = (info->memloc - PARAM_STACK_BASE) / 4;
+  if (i < NARGREGS)
+    return paramBase - 8 * (i + 1);
+  return 16 + 8 * (i - NARGREGS);
+}
+
+/* Procedure varOperand formats the memory operand of
+ * a scalar, or of element k of an array that is not
+ * a parameter. Globals are addressed %rip-relative
+ */
+static void varOperand(char *buf, char *name, SymbolInfo info, int k)
+{
+  if (info->decKind == ParamK)
+    sprintf(buf, "%d(%%rbp)", paramOffset(info));
+  else if (info->isGlobal)
+  {
+    if (k == 0)
+      sprintf(buf, "%s(%%rip)", name);
+    else
+      sprintf(buf, "%s+%d(%%rip)", name, 4 * k);
+  }
+  else
+    sprintf(buf, "%d(%%rbp)", info->memloc + 4 * k);
+}
+
+static void genExp(TreeNode *t, int d);
+
+/* Procedure indexOperand writes to buf the operand of
+ * the array element t whose subscript is already in
+ * pool register d
+ */
+static void indexOperand(char *buf, TreeNode *t, int d)
+{
+  SymbolInfo info = t->info;
+  char base[48];
+
+  emit("movslq\t%s, %s", pool32[d], pool64[d]);
+  if (info->decKind == ParamK)
+  {
+    /* an array parameter holds the address of element 0 */
+    emit("movq\t%d(%%rbp), %%rcx", paramOffset(info));
+    sprintf(buf, "(%%rcx,%s,4)", pool64[d]);
+  }
+  else if (info->isGlobal)
+  {
+    varOperand(base, t->attr.name, info, 0);
+    emit("leaq\t%s, %%rcx", base);
+    sprintf(buf, "(%%rcx,%s,4)", pool64[d]);
+  }
+  else
+    sprintf(buf, "%d(%%rbp,%s,4)", info->memloc, pool64[d]);
+}
+
+/* Procedure elemOperand formats the memory operand of
+ * the array element t. A variable subscript is
+ * computed into pool register d; the array base, if
+ * not a constant offset, goes to %rcx
+ */
+static void elemOperand(char *buf, TreeNode *t, int d)
+{
+  SymbolInfo info = t->info;
+  TreeNode *idx = t->child[0];
+
+  if (isConst(idx) && info->decKind == ParamK)
+  {
+    emit("movq\t%d(%%rbp), %%rcx", paramOffset(info));
+    sprintf(buf, "%d(%%rcx)", 4 * idx->val);
+    return;
+  }
+  if (isConst(idx))
+  {
+    varOperand(buf, t->attr.name, info, idx->val);
+    return;
+  }
+  genExp(idx, d);
+  indexOperand(buf, t, d);
+}
+
+/* Function genRight makes the right operand of a
+ * binary operator available while the left one is in
+ * pool register d, and returns it as an operand:
+ * an immediate, a memory operand, the next pool
+ * register, or %ecx after a spill
+ */
+static const char *genRight(TreeNode *r, int d, char *buf)
+{
+  if (isConst(r))
+  {
+    sprintf(buf, "$%d", r->val);
+    return buf;
+  }
+  if (isScalar(r))
+  {
+    varOperand(buf, r->attr.name, r->info, 0);
+    return buf;
+  }
+  if (d + 1 < NPOOL)
+  {
+    genExp(r, d + 1);
+    return pool32[d + 1];
+  }
+  emit("pushq\t%s", pool64[d]);
+  pushed += 8;
+  genExp(r, d);
+  emit("movl\t%s, %%ecx", pool32[d]);
+  emit("popq\t%s", pool64[d]);
+  pushed -= 8;
+  return "%ecx";
+}
+
+/* Procedure genDiv generates pool[d] = pool[d] / r,
+ * truncating like C. Positive powers of two are
+ * divided by a shift. A zero divisor is a runtime
+ * error, and -1 negates, so INT_MIN / -1 wraps like
+ * MIPS instead of trapping
+ */
+static void genDiv(TreeNode *r, int d)
+{
+  char buf[48];
+  const char *src;
+  int k, lab1, lab2;
+
+  if (isConst(r) && (k = log2Of(r->val)) >= 0)
+  {
+    if (k == 0)
+      return;
+    /* bias a negative dividend so the shift truncates toward 0 */
+    emit("leal\t%d(%s), %%eax", r->val - 1, pool32[d]);
+    emit("testl\t%s, %s", pool32[d], pool32[d]);
+    emit("cmovsl\t%%eax, %s", pool32[d]);
+    emit("sarl\t$%d, %s", k, pool32[d]);
+    return;
+  }
+  if (isConst(r) && r->val == -1)
+  {
+    emit("negl\t%s", pool32[d]);
+    return;
+  }
+  if (isConst(r) && r->val == 0)
+  {
+    emit("jmp\tcm_divzero");
+    return;
+  }
+  if (isConst(r))
+  {
+    emit("movl\t$%d, %%ecx", r->val);
+    emit("movl\t%s, %%eax", pool32[d]);
+    emit("cltd");
+    emit("idivl\t%%ecx");
+    emit("movl\t%%eax, %s", pool32[d]);
+    return;
+  }
+  src = genRight(r, d, buf);
+  lab1 = labelNum++;
+  lab2 = labelNum++;
+  emit("movl\t%s, %%eax", pool32[d]);
+  emit("cmpl\t$0, %s", src);
+  emit("je\tcm_divzero");
+  emit("cmpl\t$-1, %s", src);
+  emit("jne\t.L%d", lab1);
+  emit("negl\t%%eax");
+  emit("jmp\t.L%d", lab2);
+  emitLab(lab1);
+  emit("cltd");
+  emit("idivl\t%s", src);
+  emitLab(lab2);
+  emit("movl\t%%eax, %s", pool32[d]);
+}
+
+/* Procedure genOp generates the operator node t
+ * into pool register d
+ */
+static void genOp(TreeNode *t, int d)
+{
+  TreeNode *l = t->child[0], *r = t->child[1];
+  TokenType op = t->attr.op;
+  const char *src, *cc;
+  char buf[48];
+
+  /* keep a constant operand on the right where it can be an immediate */
+  if (isConst(l) && !isConst(r) && swapOp(op) != -1)
+  {
+    l = t->child[1];
+    r = t->child[0];
+    op = swapOp(op);
+  }
+  if (isConst(l) && op == MINUS)
+  {
+    /* c - x is -x + c */
+    genExp(r, d);
+    emit("negl\t%s", pool32[d]);
+    if (l->val != 0)
+      emit("addl\t$%d, %s", l->val, pool32[d]);
+    return;
+  }
+  genExp(l, d);
+  if (op == OVER)
+  {
+    genDiv(r, d);
+    return;
+  }
+  if (isConst(r) && r->val == 0 && (op == PLUS || op == MINUS))
+    return;
+  src = genRight(r, d, buf);
+  switch (op)
+  {
+  case PLUS:
+    emit("addl\t%s, %s", src, pool32[d]);
+    break;
+  case MINUS:
+    emit("subl\t%s, %s", src, pool32[d]);
+    break;
+  case TIMES:
+    if (isConst(r))
+      emit("imull\t%s, %s, %s", src, pool32[d], pool32[d]);
+    else
+      emit("imull\t%s, %s", src, pool32[d]);
+    break;
+  default:
+    if ((cc = condSuffix(op)) == NULL)
+      break;
+    emit("cmpl\t%s, %s", src, pool32[d]);
+    emit("set%s\t%%al", cc);
+    emit("movzbl\t%%al, %s", pool32[d]);
+    break;
+  }
+}
+
+/* Procedure genArg puts argument t into pool register
+ * d; an array is passed as the address of element 0
+ */
+static void genArg(TreeNode *t, int d)
+{
+  char buf[48];
+  if (t->nodekind == ExpK && t->kind.exp == IdK &&
+      t->child[0] == NULL && t->info->isArray)
+  {
+    usePool(d);
+    if (t->info->decKind == ParamK)
+      emit("movq\t%d(%%rbp), %s", paramOffset(t->info), pool64[d]);
+    else
+    {
+      varOperand(buf, t->attr.name, t->info, 0);
+      emit("leaq\t%s, %s", buf, pool64[d]);
+    }
+  }
+  else
+    genExp(t, d);
+}
+
+/* Procedure emitCall calls a function, padding the
+ * stack so it is 16-byte aligned at the call
+ */
+static void emitCall(char *name)
+{
+  if (pushed % 16 != 0)
+    emit("subq\t$8, %%rsp");
+  emit("call\t%s", name);
+  if (pushed % 16 != 0)
+    emit("addq\t$8, %%rsp");
+}
+
+/* Procedure genCall generates the call t with its
+ * value going to pool register d. With few enough
+ * arguments they are evaluated into the pool and
+ * moved to the argument registers; otherwise they
+ * are built in a stack area whose tail becomes the
+ * stack arguments
+ */
+static void genCall(TreeNode *t, int d)
+{
+  TreeNode *a;
+  int n = 0, i, nreg, nstack, pad;
+
+  for (a = t->child[0]; a != NULL; a = a->sibling)
+    n++;
+  if (d + n <= NPOOL)
+  {
+    for (a = t->child[0], i = 0; a != NULL; a = a->sibling, i++)
+      genArg(a, d + i);
+    for (i = 0; i < n; i++)
+      emit("movq\t%s, %s", pool64[d + i], arg64[i]);
+    emitCall(t->attr.name);
+  }
+  else
+  {
+    nreg = n < NARGREGS ? n : NARGREGS;
+    nstack = n - nreg;
+    pad = (pushed + 8 * nstack) % 16 != 0 ? 8 : 0;
+    emit("subq\t$%d, %%rsp", 8 * n + pad);
+    pushed += 8 * n + pad;
+    for (a = t->child[0], i = 0; a != NULL; a = a->sibling, i++)
+    {
+      genArg(a, d);
+      emit("movq\t%s, %d(%%rsp)", pool64[d], 8 * i);
+    }
+    for (i = 0; i < nreg; i++)
+      emit("movq\t%d(%%rsp), %s", 8 * i, arg64[i]);
+    emit("addq\t$%d, %%rsp", 8 * nreg);
+    pushed -= 8 * nreg;
+    emit("call\t%s", t->attr.name);
+    if (8 * nstack + pad > 0)
+      emit("addq\t$%d, %%rsp", 8 * nstack + pad);
+    pushed -= 8 * nstack + pad;
+  }
+  usePool(d);
+  emit("movl\t%%eax, %s", pool32[d]);
+}
+
+/* Procedure genStore stores pool register d into the
+ * variable or array element t
+ */
+static void genStore(TreeNode *t, int d)
+{
+  char buf[48];
+  if (t->child[0] == NULL)
+    varOperand(buf, t->attr.name, t->info, 0);
+  else
+    elemOperand(buf, t, d + 1);
+  emit("movl\t%s, %s", pool32[d], buf);
+}
+
+/* Procedure genAssignExp generates the assignment t
+ * used as an expression; the value stays in pool
+ * register d. A variable subscript is computed first,
+ * as on MIPS, and waits on the stack beyond the pool
+ */
+static void genAssignExp(TreeNode *t, int d)
+{
+  TreeNode *lhs = t->child[0], *rhs = t->child[1];
+  char buf[48];
+
+  if (lhs->child[0] == NULL || isConst(lhs->child[0]))
+  {
+    genExp(rhs, d);
+    genStore(lhs, d);
+    return;
+  }
+  genExp(lhs->child[0], d);
+  if (d + 1 < NPOOL)
+  {
+    genExp(rhs, d + 1);
+    emit("movl\t%s, %%eax", pool32[d + 1]);
+  }
+  else
+  {
+    emit("pushq\t%s", pool64[d]);
+    pushed += 8;
+    genExp(rhs, d);
+    emit("movl\t%s, %%eax", pool32[d]);
+    emit("popq\t%s", pool64[d]);
+    pushed -= 8;
+  }
+  indexOperand(buf, lhs, d);
+  emit("movl\t%%eax, %s", buf);
+  emit("movl\t%%eax, %s", pool32[d]);
+}
+
+/* Procedure genExp generates the value of expression
+ * t into pool register d
+ */
+static void genExp(TreeNode *t, int d)
+{
+  char buf[48];
+  usePool(d);
+  if (t->nodekind == StmtK)
+  {
+    if (t->kind.stmt == AssignK)
+      genAssignExp(t, d);
+    return;
+  }
+  switch (t->kind.exp)
+  {
+  case ConstK:
+    if (t->val == 0)
+      emit("xorl\t%s, %s", pool32[d], pool32[d]);
+    else
+      emit("movl\t$%d, %s", t->val, pool32[d]);
+    break;
+  case IdK:
+    if (t->child[0] != NULL)
+      elemOperand(buf, t, d);
+    else
+      varOperand(buf, t->attr.name, t->info, 0);
+    emit("movl\t%s, %s", buf, pool32[d]);
+    break;
+  case OpK:
+    genOp(t, d);
+    break;
+  case FuncCallK:
+    genCall(t, d);
+    break;
+  case InputCallK:
+    emitCall("cm_input");
+    emit("movl\t%%eax, %s", pool32[d]);
+    genStore(t->child[0], d);
+    break;
+  case OutputCallK:
+    genExp(t->child[0], d);
+    emit("movl\t%s, %%edi", pool32[d]);
+    emitCall("cm_output");
+    break;
+  default:
+    break;
+  }
+}
+
+/* Procedure genCond jumps to label lab when the value
+ * of t is nonzero (sense TRUE) or zero (sense FALSE).
+ * Comparisons branch on the flags directly
+ */
+static void genCond(TreeNode *t, int lab, int sense)
+{
+  TreeNode *l, *r;
+  TokenType op;
+  const char *src;
+  char buf[48];
+
+  if (isConst(t))
+  {
+    if ((t->val != 0) == sense)
+      emit("jmp\t.L%d", lab);
+    return;
+  }
+  if (t->nodekind == ExpK && t->kind.exp == OpK &&
+      condSuffix(t->attr.op) != NULL)
+  {
+    l = t->child[0];
+    r = t->child[1];
+    op = t->attr.op;
+    if (isConst(l) && !isConst(r))
+    {
+      l = t->child[1];
+      r = t->child[0];
+      op = swapOp(op);
+    }
+    genExp(l, 0);
+    src = genRight(r, 0, buf);
+    emit("cmpl\t%s, %s", src, pool32[0]);
+    emit("j%s\t.L%d", condSuffix(sense ? op : negateRel(op)), lab);
+    return;
+  }
+  genExp(t, 0);
+  emit("testl\t%s, %s", pool32[0], pool32[0]);
+  emit("%s\t.L%d", sense ? "jne" : "je", lab);
+}
+
+/* Procedure genAssign generates the assignment t.
+ * Constants and x = x + c go to memory directly
+ */
+static void genAssign(TreeNode *t)
+{
+  TreeNode *lhs = t->child[0], *rhs = t->child[1];
+  char buf[48];
+
+  if (lhs->child[0] == NULL)
+  {
+    varOperand(buf, lhs->attr.name, lhs->info, 0);
+    if (isConst(rhs))
+    {
+      emit("movl\t$%d, %s", rhs->val, buf);
+      return;
+    }
+    if (rhs->nodekind == ExpK && rhs->kind.exp == OpK &&
+        (rhs->attr.op == PLUS || rhs->attr.op == MINUS) &&
+        isScalar(rhs->child[0]) && rhs->child[0]->info == lhs->info &&
+        isConst(rhs->child[1]))
+    {
+      emit("%s\t$%d, %s", rhs->attr.op == PLUS ? "addl" : "subl",
+           rhs->child[1]->val, buf);
+      return;
+    }
+  }
+  if (lhs->child[0] != NULL && !isConst(lhs->child[0]) && containsCall(rhs))
+  {
+    /* the subscript is computed before a call or an
+       assignment in the value can change what it
+       reads, as on MIPS */
+    genExp(lhs->child[0], 0);
+    genExp(rhs, 1);
+    indexOperand(buf, lhs, 0);
+    emit("movl\t%s, %s", pool32[1], buf);
+    return;
+  }
+  genExp(rhs, 0);
+  genStore(lhs, 0);
+}
+
+/* Procedure genStmt generates code for a statement
+ * list
+ */
+static void genStmt(TreeNode *t)
+{
+  int lab1, lab2;
+  for (; t != NULL; t = t->sibling)
+  {
+    if (t->nodekind == ExpK)
+    {
+      genExp(t, 0);
+      continue;
+    }
+    if (t->nodekind != StmtK)
+      continue;
+    switch (t->kind.stmt)
+    {
+    case AssignK:
+      genAssign(t);
+      break;
+    case IfK:
+      lab1 = labelNum++;
+      genCond(t->child[0], lab1, FALSE);
+      genStmt(t->child[1]);
+      if (t->child[2] != NULL)
+      {
+        lab2 = labelNum++;
+        emit("jmp\t.L%d", lab2);
+        emitLab(lab1);
+        genStmt(t->child[2]);
+        emitLab(lab2);
+      }
+      else
+        emitLab(lab1);
+      break;
+    case WhileK:
+      /* the test is at the bottom, so each iteration
+         executes one branch */
+      lab1 = labelNum++;
+      lab2 = labelNum++;
+      emit("jmp\t.L%d", lab2);
+      emitLab(lab1);
+      genStmt(t->child[1]);
+      emitLab(lab2);
+      genCond(t->child[0], lab1, TRUE);
+      break;
+    case ReturnK:
+      if (t->child[0] != NULL)
+      {
+        genExp(t->child[0], 0);
+        emit("movl\t%s, %%eax", pool32[0]);
+      }
+      emit("jmp\t.L%d", returnLabel);
+      break;
+    case CompoundK:
+      genStmt(t->child[1]);
+      break;
+    default:
+      break;
+    }
+  }
+}
+
+/* Procedure scanLocals finds the lowest memloc of the
+ * locals declared anywhere in a function body
+ */
+static void scanLocals(TreeNode *t, int *lowest)
+{
+  int i;
+  for (; t != NULL; t = t->sibling)
+  {
+    if (t->nodekind == DeclarationK &&
+        (t->kind.dec == SimpleK || t->kind.dec == ArrayK) &&
+        t->info != NULL && t->info->memloc < *lowest)
+      *lowest = t->info->memloc;
+    for (i = 0; i < MAXCHILDREN; i++)
+      scanLocals(t->child[i], lowest);
+  }
+}
+
+/* Procedure genFunction generates function f. The
+ * body is generated first into a temporary file, so
+ * the prologue saves only the pool registers it used.
+ * Frame, from %rbp down: locals at their memloc,
+ * register parameters, saved pool registers
+ */
+static void genFunction(TreeNode *f)
+{
+  FILE *out = code, *body;
+  TreeNode *p;
+  int lowest = 0, nparams = 0, nsaved, frame, i, c;
+  long firstInst = counters.instructions;
+
+  for (p = f->child[0]; p != NULL; p = p->sibling)
+    nparams++;
+  nsaved = nparams < NARGREGS ? nparams : NARGREGS;
+  scanLocals(f->child[1], &lowest);
+  paramBase = lowest & ~7;
+  poolUsed = 0;
+  pushed = 0;
+  returnLabel = labelNum++;
+
+  body = tmpfile();
+  if (body == NULL)
+  {
+    fprintf(stderr, "Unable to create a temporary file\n");
+    exit(1);
+  }
+  code = body;
+  genStmt(f->child[1]);
+  code = out;
+
+  frame = -(paramBase - 8 * nsaved - 8 * poolUsed);
+  frame = (frame + 15) & ~15;
+  fprintf(code, "\n");
+  emitComment(f->attr.name);
+  fprintf(code, "%s:\n", f->attr.name);
+  emit("pushq\t%%rbp");
+  emit("movq\t%%rsp, %%rbp");
+  if (frame > 0)
+    emit("subq\t$%d, %%rsp", frame);
+  for (i = 0; i < poolUsed; i++)
+    emit("movq\t%s, %d(%%rbp)", pool64[i], paramBase - 8 * nsaved - 8 * (i + 1));
+  for (i = 0; i < nsaved; i++)
+    emit("movq\t%s, %d(%%rbp)", arg64[i], paramBase - 8 * (i + 1));
+
+  rewind(body);
+  while ((c = fgetc(body)) != EOF)
+    fputc(c, code);
+  fclose(body);
+
+  emitLab(returnLabel);
+  for (i = 0; i < poolUsed; i++)
+    emit("movq\t%d(%%rbp), %s", paramBase - 8 * nsaved - 8 * (i + 1), pool64[i]);
+  emit("leave");
+  emit("ret");
+  statFunction(f->attr.name, counters.instructions - firstInst);
+}
+
+/* the runtime: _start calls main and exits; input
+ * reads stdin through a buffer, output formats the
+ * line on the stack and writes it with one system
+ * call; a zero divisor jumps to cm_divzero
+ */
+static const char *runtime[] =
+{
+  "\t.data",
+  "cm_inStr:\t.ascii\t\"Enter value for input instruction: \"",
+  "\t.set\tcm_inLen, (. - cm_inStr) * cm_prompts",
+  "cm_outStr:\t.ascii\t\"output instruction prints: \"",
+  "\t.set\tcm_outLen, (. - cm_outStr) * cm_prompts",
+  "cm_divStr:\t.ascii\t\"runtime error: division by zero\\n\"",
+  "\t.set\tcm_divLen, . - cm_divStr",
+  "\t.bss",
+  "\t.p2align 4",
+  "cm_inBuf:\t.zero\t4096",
+  "cm_inPos:\t.zero\t8",
+  "cm_inEnd:\t.zero\t8",
+  "\t.text",
+  "\t.globl\t_start",
+  "_start:",
+  "\tandq\t$-16, %rsp",
+  "\tcall\tmain",
+  "\tmovl\t$60, %eax",
+  "\txorl\t%edi, %edi",
+  "\tsyscall",
+  "",
+  "# cm_divzero: report a zero divisor on stderr and exit",
+  "cm_divzero:",
+  "\tmovl\t$1, %eax",
+  "\tmovl\t$2, %edi",
+  "\tleaq\tcm_divStr(%rip), %rsi",
+  "\tmovl\t$cm_divLen, %edx",
+  "\tsyscall",
+  "\tmovl\t$60, %eax",
+  "\tmovl\t$1, %edi",
+  "\tsyscall",
+  "",
+  "# cm_getc: next byte of stdin in %eax, -1 at the end",
+  "cm_getc:",
+  "\tmovq\tcm_inPos(%rip), %rcx",
+  "\tcmpq\tcm_inEnd(%rip), %rcx",
+  "\tjb\t1f",
+  "\txorl\t%eax, %eax",
+  "\txorl\t%edi, %edi",
+  "\tleaq\tcm_inBuf(%rip), %rsi",
+  "\tmovl\t$4096, %edx",
+  "\tsyscall",
+  "\ttestq\t%rax, %rax",
+  "\tjle\t2f",
+  "\tmovq\t%rax, cm_inEnd(%rip)",
+  "\txorl\t%ecx, %ecx",
+  "1:\tleaq\tcm_inBuf(%rip), %rsi",
+  "\tmovzbl\t(%rsi,%rcx), %eax",
+  "\tincq\t%rcx",
+  "\tmovq\t%rcx, cm_inPos(%rip)",
+  "\tret",
+  "2:\tmovl\t$-1, %eax",
+  "\tret",
+  "",
+  "# cm_input: prompt, then read a decimal integer into %eax",
+  "cm_input:",
+  "\t.if\tcm_prompts",
+  "\tmovl\t$1, %eax",
+  "\tmovl\t$1, %edi",
+  "\tleaq\tcm_inStr(%rip), %rsi",
+  "\tmovl\t$cm_inLen, %edx",
+  "\tsyscall",
+  "\t.endif",
+  "1:\tcall\tcm_getc",
+  "\tcmpl\t$-1, %eax",
+  "\tje\t4f",
+  "\tcmpl\t$32, %eax",
+  "\tjle\t1b",
+  "\txorl\t%r8d, %r8d",
+  "\tcmpl\t$45, %eax",
+  "\tjne\t2f",
+  "\tmovl\t$1, %r8d",
+  "\tcall\tcm_getc",
+  "2:\txorl\t%r9d, %r9d",
+  "3:\tleal\t-48(%rax), %edx",
+  "\tcmpl\t$9, %edx",
+  "\tja\t5f",
+  "\timull\t$10, %r9d, %r9d",
+  "\taddl\t%edx, %r9d",
+  "\tcall\tcm_getc",
+  "\tjmp\t3b",
+  "4:\txorl\t%eax, %eax",
+  "\tret",
+  "5:\tcmpl\t$-1, %eax",
+  "\tje\t6f",
+  "\tdecq\tcm_inPos(%rip)",
+  "6:\tmovl\t%r9d, %eax",
+  "\ttestl\t%r8d, %r8d",
+  "\tje\t7f",
+  "\tnegl\t%eax",
+  "7:\tret",
+  "",
+  "# cm_output: print %edi; the line is built in the red zone",
+  "cm_output:",
+  "\tleaq\t-1(%rsp), %rsi",
+  "\tmovb\t$10, (%rsi)",
+  "\tmovl\t%edi, %eax",
+  "\ttestl\t%eax, %eax",
+  "\tjns\t1f",
+  "\tnegl\t%eax",
+  "1:\tmovl\t$10, %ecx",
+  "2:\txorl\t%edx, %edx",
+  "\tdivl\t%ecx",
+  "\taddl\t$48, %edx",
+  "\tdecq\t%rsi",
+  "\tmovb\t%dl, (%rsi)",
+  "\ttestl\t%eax, %eax",
+  "\tjnz\t2b",
+  "\ttestl\t%edi, %edi",
+  "\tjns\t3f",
+  "\tdecq\t%rsi",
+  "\tmovb\t$45, (%rsi)",
+  "3:\tleaq\t-cm_outLen(%rsi), %rdi",
+  "\tmovq\t%rdi, %r9",
+  "\tleaq\tcm_outStr(%rip), %rsi",
+  "\tmovl\t$cm_outLen, %ecx",
+  "\trep movsb",
+  "\tmovq\t%r9, %rsi",
+  "\tmovq\t%rsp, %rdx",
+  "\tsubq\t%rsi, %rdx",
+  "\tmovl\t$1, %eax",
+  "\tmovl\t$1, %edi",
+  "\tsyscall",
+  "\tret",
+  NULL
+};
+
+/**********************************************/
+/* the primary function of the code generator */
+/**********************************************/
+/* Procedure x86CodeGen generates x86-64 assembly to
+ * the code file by traversal of the syntax tree,
+ * together with the runtime the program needs, so
+ * the file assembles and links on its own. The
+ * second parameter (codefile) is the file name of
+ * the code file, printed as a comment
+ */
+void x86CodeGen(TreeNode *syntaxTree, char *codefile)
+{
+  TreeNode *t;
+  int i;
+
+  fprintf(code, "# C- Compilation to x86-64\n");
+  fprintf(code, "# File: %s\n", codefile);
+  fprintf(code, "\t.set\tcm_prompts, %d\n", Prompts);
+  for (i = 0; runtime[i] != NULL; i++)
+    fprintf(code, "%s\n", runtime[i]);
+
+  fprintf(code, "\n\t.bss\n\t.p2align 2\n");
+  for (t = syntaxTree; t != NULL; t = t->sibling)
+    if (t->nodekind == DeclarationK && t->kind.dec != FunctionK &&
+        t->info != NULL)
+      fprintf(code, "%s:\t.zero\t%d\n", t->attr.name,
+              4 * (t->info->isArray ? t->info->ArraySize : 1));
+
+  fprintf(code, "\n\t.text\n");
+  for (t = syntaxTree; t != NULL; t = t->sibling)
+    if (t->nodekind == DeclarationK && t->kind.dec == FunctionK)
+      genFunction(t);
+}
@@ -0,0 +1,19 @@
+/****************************************************/
+/* File: xgen.h                                     */
+/* The x86-64 code generator interface              */
+/* (GNU assembler for Linux, System V ABI)          */
+/****************************************************/
+
+#ifndef _XGEN_H_
+#define _XGEN_H_
+
+/* Procedure x86CodeGen generates x86-64 assembly to
+ * the code file by traversal of the syntax tree,
+ * together with the runtime the program needs, so
+ * the file assembles and links on its own. The
+ * second parameter (codefile) is the file name of
+ * the code file, printed as a comment
+ */
+void x86CodeGen(TreeNode * syntaxTree, char * codefile);
+
+#endif